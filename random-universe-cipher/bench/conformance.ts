@@ -0,0 +1,539 @@
+/**
+ * Cross-Implementation Conformance and Throughput Runner
+ *
+ *   npm run bench:conformance -- [--vectors N] [--seed TEXT] [--time MS]
+ *                                [--bulk-kb N] [--no-bench] [--strict] [--json FILE]
+ *
+ * Feeds the same generated vectors (key, IV, start block, block count,
+ * plaintext) to every engine that is built, compares the raw CTR blocks
+ * byte for byte, then times each engine and prints one comparison table.
+ *
+ * Engines:
+ * - ts:     encryptCTRBlocks (src/cipher/modes.ts), the reference
+ * - rust:   encrypt_blocks_batch from wasm/pkg (npm run build:wasm)
+ * - native: the N-API addon (npm run build:native): sync, libuv pool,
+ *           constant-time engine, and every registered kernel forced in turn
+ * - wasm:   each C++ WASM variant in cpp-wasm/pkg (npm run build:cpp-wasm),
+ *           with the same engine and kernel rows as native
+ *
+ * Every engine must match the first engine of its family (the C++ builds and
+ * kernels must all agree with the default native engine). A family that
+ * differs from the TS reference fails the run unless the difference is listed
+ * in KNOWN_DIVERGENCE; --strict fails on those too. Missing builds are
+ * reported and skipped.
+ */
+
+import { createHash } from 'node:crypto';
+import { existsSync, readFileSync, writeFileSync } from 'node:fs';
+import { fileURLToPath } from 'node:url';
+import { expandKey } from '../src/cipher/key-expansion';
+import { encryptCTRBlocks } from '../src/cipher/modes';
+import { packKeyMaterialForWASM } from '../src/cipher/modes-wasm';
+import { loadCppWasm, type CppWasmVariant } from '../src/cipher/cpp-wasm-loader';
+
+const BLOCK = 32;
+const KEY = 64;
+const IV = 32;
+
+type Family = 'ts' | 'rust' | 'cpp';
+
+/**
+ * Why a family does not match the TS reference. Remove an entry once the
+ * engine is brought in line; the runner then asserts it.
+ */
+const KNOWN_DIVERGENCE: Partial<Record<Family, string>> = {
+  cpp:
+    'C++ engine XORs the expanded IV into every register without the rotations and cross-mixing ' +
+    'of the spec (mixIVIntoState), and encodes block numbers little-endian instead of big-endian',
+  rust:
+    'Rust encrypt_blocks_batch takes no IV or block number and uses a placeholder SHA3-256 ' +
+    'keystream (disabled in modes-wasm.ts)',
+};
+
+// Start blocks cover byte-boundary carries and the top of the 32-bit counter
+const START_BLOCKS = [0, 1, 7, 255, 256, 65535, 65536, 2 ** 24 + 3, 2 ** 31 - 1, 2 ** 32 - 64];
+const BLOCK_COUNTS = [1, 2, 3, 8, 9, 17, 33];
+
+interface Vector {
+  key: Uint8Array;
+  iv: Uint8Array;
+  startBlock: number;
+  plaintext: Uint8Array;
+}
+
+type Cipher = (startBlock: number, blocks: Uint8Array) => Uint8Array | Promise<Uint8Array>;
+
+interface Bound {
+  run: Cipher;
+  dispose?(): void;
+}
+
+interface Engine {
+  name: string;
+  family: Family;
+  /** Key setup, kept out of the timings */
+  bind(key: Uint8Array, iv: Uint8Array): Bound;
+  /** Set and restore global state (forced kernels) around this engine */
+  enter?(): string | null;
+  leave?(): void;
+}
+
+interface Result {
+  name: string;
+  family: Family;
+  status: 'ok' | 'known' | 'FAIL' | 'skipped';
+  detail: string;
+  matchesReference: boolean | null;
+  p50Us: number | null;
+  p99Us: number | null;
+  mbPerSec: number | null;
+  bulkBlocks: number | null;
+}
+
+interface Options {
+  vectors: number;
+  seed: string;
+  timeMs: number;
+  bulkBlocks: number;
+  bench: boolean;
+  strict: boolean;
+  json: string | null;
+}
+
+function parseArgs(argv: string[]): Options {
+  const options: Options = {
+    vectors: 12,
+    seed: 'ruc-conformance',
+    timeMs: 1000,
+    bulkBlocks: (64 * 1024) / BLOCK,
+    bench: true,
+    strict: false,
+    json: null,
+  };
+  for (let i = 0; i < argv.length; i++) {
+    const arg = argv[i];
+    const value = argv[i + 1];
+    if (arg === '--vectors' && value) { options.vectors = Number(value); i++; }
+    else if (arg === '--seed' && value) { options.seed = value; i++; }
+    else if (arg === '--time' && value) { options.timeMs = Number(value); i++; }
+    else if (arg === '--bulk-kb' && value) { options.bulkBlocks = (Number(value) * 1024) / BLOCK; i++; }
+    else if (arg === '--no-bench') options.bench = false;
+    else if (arg === '--strict') options.strict = true;
+    else if (arg === '--json' && value) { options.json = value; i++; }
+    else if (arg !== '--') throw new Error(`unknown argument: ${arg}`);
+  }
+  if (!(options.vectors > 0) || !(options.timeMs > 0) || !(options.bulkBlocks >= 1)) {
+    throw new Error('--vectors, --time and --bulk-kb must be positive');
+  }
+  return options;
+}
+
+/**
+ * Deterministic vectors: SHAKE256(seed || index) stretched into key, IV and
+ * plaintext, with start blocks and lengths cycling through the edge cases
+ */
+function generateVectors(count: number, seed: string): Vector[] {
+  const vectors: Vector[] = [];
+  for (let i = 0; i < count; i++) {
+    const numBlocks = BLOCK_COUNTS[i % BLOCK_COUNTS.length];
+    const bytes = createHash('shake256', { outputLength: KEY + IV + numBlocks * BLOCK })
+      .update(`${seed}/${i}`)
+      .digest();
+    vectors.push({
+      key: new Uint8Array(bytes.subarray(0, KEY)),
+      iv: new Uint8Array(bytes.subarray(KEY, KEY + IV)),
+      startBlock: START_BLOCKS[i % START_BLOCKS.length],
+      plaintext: new Uint8Array(bytes.subarray(KEY + IV)),
+    });
+  }
+  return vectors;
+}
+
+const repoRoot = fileURLToPath(new URL('..', import.meta.url));
+
+function tsEngine(): Engine {
+  return {
+    name: 'ts reference',
+    family: 'ts',
+    bind(key, iv) {
+      const keyMaterial = expandKey(key);
+      return { run: (startBlock, blocks) => encryptCTRBlocks(blocks, key, iv, startBlock, keyMaterial) };
+    },
+  };
+}
+
+async function rustEngines(): Promise<Engine[] | string> {
+  const wasmPath = `${repoRoot}wasm/pkg/ruc_wasm_bg.wasm`;
+  if (!existsSync(wasmPath)) return 'wasm/pkg not built (npm run build:wasm)';
+  // @ts-ignore - generated by wasm-pack
+  const wasm = await import('../wasm/pkg/ruc_wasm');
+  const bytes = readFileSync(wasmPath);
+  try {
+    wasm.initSync({ module: bytes });
+  } catch {
+    wasm.initSync(bytes); // wasm-bindgen before 0.2.93
+  }
+  return [{
+    name: 'rust-wasm',
+    family: 'rust',
+    bind(key) {
+      const keyMaterial = expandKey(key);
+      const packed = packKeyMaterialForWASM(key, keyMaterial);
+      const selectors = new Uint16Array(keyMaterial.selectors);
+      return {
+        run: (_startBlock, blocks) => {
+          const numBlocks = blocks.length / BLOCK;
+          const constants = new Uint8Array(numBlocks * packed.keyConstants.length);
+          for (let b = 0; b < numBlocks; b++) constants.set(packed.keyConstants, b * packed.keyConstants.length);
+          return wasm.encrypt_blocks_batch(blocks, packed.registersFlat, selectors, packed.sboxesFlat,
+            packed.roundKeysFlat, constants, numBlocks);
+        },
+      };
+    },
+  }];
+}
+
+/**
+ * One C++ build (native addon or WASM module) seen through the same calls
+ */
+interface CppBuild {
+  label: string;
+  bindBatch(key: Uint8Array, iv: Uint8Array): Bound;
+  bindCt(key: Uint8Array, iv: Uint8Array): Bound;
+  bindPool?(key: Uint8Array, iv: Uint8Array): Bound;
+  kernelNames(): Record<string, string[]>;
+  activeKernels(): Record<string, string>;
+  forceKernel(primitive: string, name: string): number;
+}
+
+/**
+ * Default engine, pool and constant-time rows, then one row per registered
+ * kernel forced on its own (rounds_batch kernels only run in the CT engine)
+ */
+function cppEngines(build: CppBuild): Engine[] {
+  const engines: Engine[] = [
+    { name: build.label, family: 'cpp', bind: (key, iv) => build.bindBatch(key, iv) },
+  ];
+  if (build.bindPool) {
+    const bindPool = build.bindPool;
+    engines.push({ name: `${build.label} pool`, family: 'cpp', bind: (key, iv) => bindPool(key, iv) });
+  }
+  engines.push({ name: `${build.label} ct`, family: 'cpp', bind: (key, iv) => build.bindCt(key, iv) });
+
+  const defaults = build.activeKernels();
+  for (const [primitive, names] of Object.entries(build.kernelNames())) {
+    if (names.length < 2) continue;
+    for (const kernel of names) {
+      engines.push({
+        name: `${build.label} ${primitive}=${kernel}`,
+        family: 'cpp',
+        bind: (key, iv) => (primitive === 'rounds_batch' ? build.bindCt(key, iv) : build.bindBatch(key, iv)),
+        enter: () => {
+          const status = build.forceKernel(primitive, kernel);
+          if (status === 0) return null;
+          if (status === -2) return 'unsupported on this CPU';
+          if (status === -5) return 'not constant-time (kept out of the ct engine)';
+          return `forceKernel returned ${status}`;
+        },
+        leave: () => {
+          build.forceKernel(primitive, defaults[primitive]);
+        },
+      });
+    }
+  }
+  return engines;
+}
+
+async function nativeBuild(): Promise<CppBuild | string> {
+  let addon: any;
+  try {
+    // @ts-ignore - plain ESM binding next to the addon sources
+    addon = (await import('../cpp-wasm/node/index.mjs')).native;
+  } catch (error) {
+    return `native addon not built (npm run build:native): ${(error as Error).message.split('\n')[0]}`;
+  }
+  return {
+    label: 'native',
+    bindBatch(key, iv) {
+      const handle = addon.expandKey(key);
+      return { run: (startBlock, blocks) => addon.encryptBlocksSync(handle, iv, startBlock, blocks) };
+    },
+    bindPool(key, iv) {
+      const handle = addon.expandKey(key);
+      return { run: (startBlock, blocks) => addon.encryptBlocks(handle, iv, startBlock, blocks) };
+    },
+    bindCt(key, iv) {
+      const handle = addon.expandKey(key);
+      return { run: (startBlock, blocks) => addon.encryptBlocksCtSync(handle, iv, startBlock, blocks) };
+    },
+    kernelNames: () => addon.kernelNames(),
+    activeKernels: () => addon.kernels(),
+    forceKernel: (primitive, name) => addon.forceKernel(primitive, name),
+  };
+}
+
+async function wasmBuild(variant: CppWasmVariant): Promise<CppBuild | string> {
+  let module: any;
+  try {
+    module = (await loadCppWasm({ variant })).module;
+  } catch (error) {
+    return `cpp-wasm/pkg ${variant} not built (npm run build:cpp-wasm): ${(error as Error).message.split('\n')[0]}`;
+  }
+
+  const primitives: string[] = [];
+  for (let p = 0; ; p++) {
+    const ptr = module._ruc_kernel_primitive_name(p);
+    if (!ptr) break;
+    primitives.push(module.UTF8ToString(ptr));
+  }
+
+  // Key and IV stay in WASM memory for the binding's lifetime; blocks are
+  // copied through a scratch buffer grown on demand
+  const bind = (ct: boolean) => (key: Uint8Array, iv: Uint8Array): Bound => {
+    const keyPtr = module._malloc(KEY + IV);
+    module.HEAPU8.set(key, keyPtr);
+    module.HEAPU8.set(iv, keyPtr + KEY);
+    const km = module._ruc_expand_key(keyPtr);
+    let scratch = 0;
+    let capacity = 0;
+    const encrypt = ct ? module._ruc_encrypt_blocks_ct : module._ruc_encrypt_blocks_batch;
+    return {
+      run: (startBlock, blocks) => {
+        if (blocks.length > capacity) {
+          if (scratch) module._free(scratch);
+          capacity = blocks.length;
+          scratch = module._malloc(capacity * 2);
+        }
+        module.HEAPU8.set(blocks, scratch);
+        encrypt(scratch, blocks.length / BLOCK, keyPtr, keyPtr + KEY, startBlock >>> 0, km, scratch + capacity);
+        return module.HEAPU8.slice(scratch + capacity, scratch + capacity + blocks.length);
+      },
+      dispose: () => {
+        if (scratch) module._free(scratch);
+        module._ruc_free_key_material(km);
+        module.HEAPU8.fill(0, keyPtr, keyPtr + KEY + IV);
+        module._free(keyPtr);
+      },
+    };
+  };
+
+  return {
+    label: `wasm ${variant}`,
+    bindBatch: bind(false),
+    bindCt: bind(true),
+    kernelNames: () => {
+      const names: Record<string, string[]> = {};
+      primitives.forEach((primitive, p) => {
+        names[primitive] = [];
+        const count = module._ruc_kernel_count(p);
+        for (let i = 0; i < count; i++) names[primitive].push(module.UTF8ToString(module._ruc_kernel_name(p, i)));
+      });
+      return names;
+    },
+    activeKernels: () => {
+      const active: Record<string, string> = {};
+      primitives.forEach((primitive, p) => {
+        active[primitive] = module.UTF8ToString(module._ruc_kernel_active(p));
+      });
+      return active;
+    },
+    forceKernel: (primitive, name) =>
+      module.ccall('ruc_kernel_force', 'number', ['number', 'string'], [primitives.indexOf(primitive), name]),
+  };
+}
+
+function firstDifference(a: Uint8Array, b: Uint8Array): number {
+  if (a.length !== b.length) return Math.min(a.length, b.length);
+  for (let i = 0; i < a.length; i++) {
+    if (a[i] !== b[i]) return i;
+  }
+  return -1;
+}
+
+function percentile(sorted: number[], q: number): number {
+  return sorted[Math.min(sorted.length - 1, Math.floor(q * sorted.length))];
+}
+
+/**
+ * Single-block latency until half the budget is spent, then throughput with
+ * a buffer sized so one call fits in the other half (capped at --bulk-kb)
+ */
+async function measure(engine: Engine, options: Options, vector: Vector): Promise<Partial<Result>> {
+  const bound = engine.bind(vector.key, vector.iv);
+  try {
+    const one = vector.plaintext.subarray(0, BLOCK);
+    const latencies: number[] = [];
+    const budget = options.timeMs / 2;
+    const latencyEnd = performance.now() + budget;
+    while (latencies.length < 3 || (performance.now() < latencyEnd && latencies.length < 100000)) {
+      const t = performance.now();
+      await bound.run(0, one);
+      latencies.push(performance.now() - t);
+    }
+    latencies.sort((a, b) => a - b);
+    const p50 = percentile(latencies, 0.5);
+
+    const bulkBlocks = Math.max(1, Math.min(options.bulkBlocks, Math.floor(budget / Math.max(p50, 1e-6))));
+    const bulk = new Uint8Array(bulkBlocks * BLOCK);
+    let calls = 0;
+    const start = performance.now();
+    do {
+      await bound.run(calls * bulkBlocks, bulk);
+      calls++;
+    } while (performance.now() - start < budget);
+    const seconds = (performance.now() - start) / 1000;
+
+    return {
+      p50Us: p50 * 1000,
+      p99Us: percentile(latencies, 0.99) * 1000,
+      mbPerSec: (calls * bulk.length) / 1e6 / seconds,
+      bulkBlocks,
+    };
+  } finally {
+    bound.dispose?.();
+  }
+}
+
+async function runEngine(
+  engine: Engine,
+  vectors: Vector[],
+  reference: Uint8Array[],
+  familyReference: Map<Family, { name: string; outputs: Uint8Array[] }>,
+  options: Options
+): Promise<Result> {
+  const result: Result = {
+    name: engine.name,
+    family: engine.family,
+    status: 'ok',
+    detail: '',
+    matchesReference: null,
+    p50Us: null,
+    p99Us: null,
+    mbPerSec: null,
+    bulkBlocks: null,
+  };
+  const skip = engine.enter?.() ?? null;
+  if (skip) {
+    result.status = 'skipped';
+    result.detail = skip;
+    return result;
+  }
+  try {
+    const outputs: Uint8Array[] = [];
+    for (const vector of vectors) {
+      const bound = engine.bind(vector.key, vector.iv);
+      try {
+        outputs.push(new Uint8Array(await bound.run(vector.startBlock, vector.plaintext)));
+      } finally {
+        bound.dispose?.();
+      }
+    }
+
+    const family = familyReference.get(engine.family);
+    if (!family) {
+      familyReference.set(engine.family, { name: engine.name, outputs });
+    } else {
+      for (let v = 0; v < vectors.length; v++) {
+        const at = firstDifference(outputs[v], family.outputs[v]);
+        if (at >= 0) {
+          result.status = 'FAIL';
+          result.detail = `differs from ${family.name} (vector ${v}, start ${vectors[v].startBlock}, block ${Math.floor(at / BLOCK)})`;
+          break;
+        }
+      }
+    }
+
+    const mismatch = vectors.findIndex((_, v) => firstDifference(outputs[v], reference[v]) >= 0);
+    result.matchesReference = mismatch < 0;
+    if (!result.matchesReference && result.status === 'ok') {
+      const known = KNOWN_DIVERGENCE[engine.family];
+      result.status = known && !options.strict ? 'known' : 'FAIL';
+      if (!known) result.detail = `differs from ts reference (vector ${mismatch})`;
+    }
+
+    if (options.bench) Object.assign(result, await measure(engine, options, vectors[0]));
+  } finally {
+    engine.leave?.();
+  }
+  return result;
+}
+
+function formatNumber(value: number | null, digits: number): string {
+  return value === null ? '-' : value.toFixed(digits);
+}
+
+function printTable(results: Result[], skippedBuilds: string[]): void {
+  const tsRate = results.find(r => r.family === 'ts')?.mbPerSec ?? null;
+  const rows = results.map(r => [
+    r.name,
+    r.status,
+    r.matchesReference === null ? '-' : r.matchesReference ? 'match' : 'differs',
+    formatNumber(r.p50Us, 1),
+    formatNumber(r.p99Us, 1),
+    formatNumber(r.mbPerSec, 3),
+    r.mbPerSec !== null && tsRate ? `${(r.mbPerSec / tsRate).toFixed(1)}x` : '-',
+    r.bulkBlocks === null ? '-' : String(r.bulkBlocks),
+  ]);
+  const header = ['engine', 'status', 'vs ts', '1-block p50 us', 'p99 us', 'MB/s', 'vs ts speed', 'bulk blocks'];
+  const widths = header.map((h, i) => Math.max(h.length, ...rows.map(row => row[i].length)));
+  const line = (cells: string[]) => `| ${cells.map((c, i) => c.padEnd(widths[i])).join(' | ')} |`;
+  console.log(line(header));
+  console.log(`|${widths.map(w => '-'.repeat(w + 2)).join('|')}|`);
+  rows.forEach(row => console.log(line(row)));
+
+  const notes = results.filter(r => r.detail).map(r => `- ${r.name}: ${r.detail}`);
+  for (const family of new Set(results.filter(r => r.status === 'known').map(r => r.family))) {
+    notes.push(`- known divergence (${family}): ${KNOWN_DIVERGENCE[family]}`);
+  }
+  skippedBuilds.forEach(reason => notes.push(`- skipped: ${reason}`));
+  if (notes.length) console.log(`\n${notes.join('\n')}`);
+}
+
+async function main(): Promise<number> {
+  const options = parseArgs(process.argv.slice(2));
+  const vectors = generateVectors(options.vectors, options.seed);
+
+  const engines: Engine[] = [tsEngine()];
+  const skippedBuilds: string[] = [];
+  const rust = await rustEngines();
+  if (typeof rust === 'string') skippedBuilds.push(rust);
+  else engines.push(...rust);
+  for (const build of [nativeBuild(), wasmBuild('baseline'), wasmBuild('simd'), wasmBuild('simd-mt')]) {
+    const loaded = await build;
+    if (typeof loaded === 'string') skippedBuilds.push(loaded);
+    else engines.push(...cppEngines(loaded));
+  }
+
+  // The TS reference output, computed once
+  const reference = vectors.map(v => encryptCTRBlocks(v.plaintext, v.key, v.iv, v.startBlock));
+  const familyReference = new Map<Family, { name: string; outputs: Uint8Array[] }>();
+  const results: Result[] = [];
+  for (const engine of engines) {
+    process.stderr.write(`${engine.name}...\n`);
+    results.push(await runEngine(engine, vectors, reference, familyReference, options));
+  }
+
+  const totalBlocks = vectors.reduce((n, v) => n + v.plaintext.length / BLOCK, 0);
+  console.log(`${vectors.length} vectors (${totalBlocks} blocks, seed "${options.seed}"), ${engines.length} engines\n`);
+  printTable(results, skippedBuilds);
+
+  if (options.json) {
+    writeFileSync(options.json, JSON.stringify({
+      seed: options.seed,
+      vectors: vectors.length,
+      blocks: totalBlocks,
+      knownDivergence: KNOWN_DIVERGENCE,
+      skipped: skippedBuilds,
+      results,
+    }, null, 2));
+  }
+  return results.some(r => r.status === 'FAIL') ? 1 : 0;
+}
+
+main().then(
+  code => process.exit(code),
+  error => {
+    console.error(error);
+    process.exit(2);
+  }
+);
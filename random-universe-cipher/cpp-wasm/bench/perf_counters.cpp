@@ -0,0 +1,114 @@
+#include "perf_counters.h"
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const char* const PERF_EVENT_NAMES[PERF_EV_COUNT] = {
+    "cycles", "instructions", "L1D-misses", "LLC-misses", "branch-misses"
+};
+
+PerfCounters::PerfCounters() : leader_fd_(-1), opened_(0) {
+    for (int i = 0; i < PERF_EV_COUNT; i++) {
+        fds_[i] = -1;
+        slot_[i] = -1;
+    }
+    error_[0] = '\0';
+}
+
+PerfCounters::~PerfCounters() {
+    close();
+}
+
+#ifdef __linux__
+
+static int perf_open(uint32_t type, uint64_t config, int group_fd) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = group_fd < 0 ? 1 : 0;   // the leader starts the group
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+bool PerfCounters::open() {
+    close();
+    static const struct { uint32_t type; uint64_t config; } events[PERF_EV_COUNT] = {
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                              (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                              (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    };
+
+    leader_fd_ = perf_open(events[0].type, events[0].config, -1);
+    if (leader_fd_ < 0) {
+        snprintf(error_, sizeof(error_), "perf_event_open(cycles): %s", strerror(errno));
+        return false;
+    }
+    fds_[0] = leader_fd_;
+    slot_[0] = opened_++;
+    for (int i = 1; i < PERF_EV_COUNT; i++) {
+        fds_[i] = perf_open(events[i].type, events[i].config, leader_fd_);
+        if (fds_[i] >= 0) slot_[i] = opened_++;
+    }
+
+    ioctl(leader_fd_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader_fd_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return true;
+}
+
+void PerfCounters::close() {
+    for (int i = PERF_EV_COUNT - 1; i >= 0; i--) {
+        if (fds_[i] >= 0) ::close(fds_[i]);
+        fds_[i] = -1;
+        slot_[i] = -1;
+    }
+    leader_fd_ = -1;
+    opened_ = 0;
+}
+
+bool PerfCounters::read(PerfSample* out) const {
+    memset(out, 0, sizeof(*out));
+    if (leader_fd_ < 0) return false;
+
+    // { nr, time_enabled, time_running, value[nr] }
+    uint64_t buf[3 + PERF_EV_COUNT];
+    ssize_t want = (ssize_t)((3 + opened_) * sizeof(uint64_t));
+    if (::read(leader_fd_, buf, sizeof(buf)) < want) return false;
+
+    double scale = 1.0;
+    if (buf[2] > 0 && buf[2] < buf[1]) scale = (double)buf[1] / (double)buf[2];
+    for (int i = 0; i < PERF_EV_COUNT; i++) {
+        if (slot_[i] >= 0) out->value[i] = (uint64_t)((double)buf[3 + slot_[i]] * scale);
+    }
+    return true;
+}
+
+#else
+
+bool PerfCounters::open() {
+    snprintf(error_, sizeof(error_), "perf_event_open is Linux-only");
+    return false;
+}
+
+void PerfCounters::close() {}
+
+bool PerfCounters::read(PerfSample* out) const {
+    memset(out, 0, sizeof(*out));
+    return false;
+}
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef RUC_PERF_COUNTERS_H
+#define RUC_PERF_COUNTERS_H
+
+#include <cstdint>
+#include <cstddef>
+
+// Hardware performance counters for the calling thread (Linux perf_event_open).
+// All events are opened as one group so a single read() returns a consistent
+// snapshot; user-space only (exclude_kernel/exclude_hv), so the probe's own
+// syscalls are not counted. On other platforms, or when the kernel refuses
+// (no PMU in a VM, perf_event_paranoid), open() fails and callers fall back
+// to wall-clock time.
+
+enum PerfEvent {
+    PERF_EV_CYCLES = 0,
+    PERF_EV_INSTRUCTIONS,
+    PERF_EV_L1D_MISSES,
+    PERF_EV_LLC_MISSES,
+    PERF_EV_BRANCH_MISSES,
+    PERF_EV_COUNT
+};
+
+extern const char* const PERF_EVENT_NAMES[PERF_EV_COUNT];
+
+struct PerfSample {
+    uint64_t value[PERF_EV_COUNT];
+};
+
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    // Open the group; events the PMU lacks are skipped (see available()).
+    // Returns false with a reason in error() if not even cycles can be opened.
+    bool open();
+    void close();
+
+    bool is_open() const { return leader_fd_ >= 0; }
+    bool available(int event) const { return fds_[event] >= 0; }
+    const char* error() const { return error_; }
+
+    // Snapshot all counters (zeros for unavailable events). Values are scaled
+    // for multiplexing when the group did not run the whole time.
+    bool read(PerfSample* out) const;
+
+private:
+    int leader_fd_;
+    int fds_[PERF_EV_COUNT];
+    int slot_[PERF_EV_COUNT];   // position of each event in the group read
+    int opened_;
+    char error_[128];
+};
+
+#endif // RUC_PERF_COUNTERS_H
@@ -0,0 +1,199 @@
+// Native benchmark driver for the block engine
+//
+//   ruc_bench [--blocks N] [--iters N] [--perf] [--bulk] [--trace FILE]
+//
+// Reports ruc_encrypt_blocks_batch throughput (best of --iters runs). --bulk
+// adds the multi-threaded, NUMA-aware ruc_ctx_encrypt_bulk over the same
+// buffer. With --perf, runs one more pass with phase probes installed and
+// breaks each block down into counter hash / order_selectors / rounds /
+// keystream, with hardware counters (cycles, instructions, L1D and LLC
+// misses, branch misses) per block and IPC when perf_event_open is
+// available, wall time otherwise.
+// --trace runs one more untimed pass (bulk when --bulk is given) with the
+// engine trace on and writes it as Chrome trace-event JSON for
+// ui.perfetto.dev. Kernel selection follows RUC_KERNEL / RUC_KERNEL_AUTOTUNE
+// as usual.
+
+#include "ruc_cipher.h"
+#include "ruc_engine.h"
+#include "kernels.h"
+#include "perf_counters.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static const char* const PHASE_NAMES[RUC_PHASE_COUNT] = {
+    "counter_hash", "order_selectors", "rounds", "keystream"
+};
+
+typedef std::chrono::steady_clock bench_clock;
+
+// Accumulates counter deltas between consecutive phase marks
+struct PhaseProfile {
+    PerfCounters* counters;
+    int current;
+    PerfSample last;
+    bench_clock::time_point last_time;
+    uint64_t totals[RUC_PHASE_COUNT][PERF_EV_COUNT];
+    double nanos[RUC_PHASE_COUNT];
+};
+
+static void on_phase(int phase, void* user) {
+    PhaseProfile* p = (PhaseProfile*)user;
+    PerfSample now;
+    p->counters->read(&now);
+    bench_clock::time_point t = bench_clock::now();
+    if (p->current >= 0) {
+        for (int e = 0; e < PERF_EV_COUNT; e++) {
+            p->totals[p->current][e] += now.value[e] - p->last.value[e];
+        }
+        p->nanos[p->current] += std::chrono::duration<double, std::nano>(t - p->last_time).count();
+    }
+    p->current = phase;
+    p->last = now;
+    p->last_time = t;
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr, "usage: %s [--blocks N] [--iters N] [--perf] [--bulk] [--trace FILE]\n", argv0);
+}
+
+int main(int argc, char** argv) {
+    size_t num_blocks = 4096;
+    int iters = 5;
+    bool perf = false;
+    bool bulk = false;
+    const char* trace_path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--blocks") && i + 1 < argc) {
+            num_blocks = (size_t)strtoull(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--iters") && i + 1 < argc) {
+            iters = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--perf")) {
+            perf = true;
+        } else if (!strcmp(argv[i], "--bulk")) {
+            bulk = true;
+        } else if (!strcmp(argv[i], "--trace") && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (num_blocks == 0 || iters <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    ruc_kernel_init(0);
+    uint8_t key[KEY_SIZE], iv[IV_SIZE];
+    for (size_t i = 0; i < KEY_SIZE; i++) key[i] = (uint8_t)(i * 7 + 1);
+    for (size_t i = 0; i < IV_SIZE; i++) iv[i] = (uint8_t)(i * 13 + 5);
+    void* km = ruc_expand_key(key);
+    std::vector<uint8_t> input(num_blocks * BLOCK_SIZE), output(num_blocks * BLOCK_SIZE);
+    for (size_t i = 0; i < input.size(); i++) input[i] = (uint8_t)i;
+
+    printf("kernels: keccak_f=%s gf_mul_register=%s chacha20_block=%s round=%s\n",
+           ruc_kernel_active(RUC_PRIM_KECCAK_F), ruc_kernel_active(RUC_PRIM_GF_MUL_REGISTER),
+           ruc_kernel_active(RUC_PRIM_CHACHA20_BLOCK), ruc_kernel_active(RUC_PRIM_ROUND));
+
+    double best = 0.0;
+    for (int it = 0; it < iters; it++) {
+        bench_clock::time_point t0 = bench_clock::now();
+        ruc_encrypt_blocks_batch(input.data(), num_blocks, key, iv, 0, km, output.data());
+        double secs = std::chrono::duration<double>(bench_clock::now() - t0).count();
+        double mbps = (double)(num_blocks * BLOCK_SIZE) / secs / 1e6;
+        if (mbps > best) best = mbps;
+    }
+    printf("throughput: %.3f MB/s (%zu blocks, best of %d)\n", best, num_blocks, iters);
+
+    uint32_t key_id = 0;
+    uint32_t ctx_id = 0;
+    if (bulk) {
+        key_id = ruc_key_create(key);
+        ctx_id = ruc_ctx_create(key_id, iv);
+        double best_bulk = 0.0;
+        for (int it = 0; it < iters; it++) {
+            bench_clock::time_point t0 = bench_clock::now();
+            ruc_ctx_encrypt_bulk(ctx_id, input.data(), num_blocks, 0, output.data());
+            double secs = std::chrono::duration<double>(bench_clock::now() - t0).count();
+            double mbps = (double)(num_blocks * BLOCK_SIZE) / secs / 1e6;
+            if (mbps > best_bulk) best_bulk = mbps;
+        }
+        printf("bulk throughput: %.3f MB/s (%u NUMA node%s)\n", best_bulk, ruc_numa_node_count(),
+               ruc_numa_node_count() == 1 ? "" : "s");
+    }
+
+    int rc = 0;
+    if (trace_path) {
+        ruc_trace_start(0);
+        if (bulk) {
+            ruc_ctx_encrypt_bulk(ctx_id, input.data(), num_blocks, 0, output.data());
+        } else {
+            ruc_encrypt_blocks_batch(input.data(), num_blocks, key, iv, 0, km, output.data());
+        }
+        ruc_trace_stop();
+        if (ruc_trace_write(trace_path) != 0) {
+            fprintf(stderr, "cannot write %s\n", trace_path);
+            rc = 1;
+        } else {
+            printf("trace: %s\n", trace_path);
+        }
+    }
+
+    if (perf && rc == 0) {
+        PerfCounters counters;
+        bool hw = counters.open();
+        if (!hw) printf("perf counters unavailable (%s); reporting wall time only\n", counters.error());
+
+        PhaseProfile profile{};
+        profile.counters = &counters;
+        profile.current = RUC_PHASE_NONE;
+
+        ruc_set_phase_probe(on_phase, &profile);
+        ruc_encrypt_blocks_batch(input.data(), num_blocks, key, iv, 0, km, output.data());
+        ruc_set_phase_probe(nullptr, nullptr);
+
+        double n = (double)num_blocks;
+        printf("\nper block %-16s %10s", "phase", "ns");
+        if (hw) {
+            printf(" %12s %12s %6s", "cycles", "instr", "IPC");
+            for (int e = PERF_EV_L1D_MISSES; e < PERF_EV_COUNT; e++) {
+                printf(" %13s", counters.available(e) ? PERF_EVENT_NAMES[e] : "-");
+            }
+        }
+        printf("\n");
+
+        uint64_t sum[PERF_EV_COUNT] = {0};
+        double sum_ns = 0.0;
+        for (int ph = 0; ph <= RUC_PHASE_COUNT; ph++) {
+            bool total = ph == RUC_PHASE_COUNT;
+            const uint64_t* v = total ? sum : profile.totals[ph];
+            double ns = total ? sum_ns : profile.nanos[ph];
+            printf("          %-16s %10.0f", total ? "total" : PHASE_NAMES[ph], ns / n);
+            if (hw) {
+                double ipc = v[PERF_EV_CYCLES] ? (double)v[PERF_EV_INSTRUCTIONS] / (double)v[PERF_EV_CYCLES] : 0.0;
+                printf(" %12.0f %12.0f %6.2f", v[PERF_EV_CYCLES] / n, v[PERF_EV_INSTRUCTIONS] / n, ipc);
+                for (int e = PERF_EV_L1D_MISSES; e < PERF_EV_COUNT; e++) {
+                    if (counters.available(e)) {
+                        printf(" %13.2f", v[e] / n);
+                    } else {
+                        printf(" %13s", "-");
+                    }
+                }
+            }
+            printf("\n");
+            if (!total) {
+                for (int e = 0; e < PERF_EV_COUNT; e++) sum[e] += v[e];
+                sum_ns += ns;
+            }
+        }
+    }
+
+    if (ctx_id) ruc_ctx_destroy(ctx_id);
+    if (key_id) ruc_key_destroy(key_id);
+    ruc_free_key_material(km);
+    return rc;
+}
@@ -0,0 +1,410 @@
+// Native load generator for the block engine
+//
+//   ruc_load [--threads N] [--duration SECONDS] [--keys N] [--sizes SPEC]
+//            [--iv unique|reuse|pool:N] [--rate OPS_PER_SEC] [--mix SPEC]
+//            [--json FILE|-]
+//
+// Worker threads issue a weighted mix of operations against the C API and
+// record the latency of every call:
+//   expand   ruc_expand_key + ruc_free_key_material
+//   encrypt  nonce -> IV, PKCS#7 pad, ruc_encrypt_blocks_batch   (encryptCTR)
+//   decrypt  nonce -> IV, ruc_decrypt_blocks_batch, unpad check  (decryptCTR)
+//   aead     per-call key derivation and expansion, encrypt, tag (aeadEncrypt)
+// The message shapes follow node/index.mjs. The native library has no
+// HMAC-SHA256, so the AEAD tag is a keyed SHAKE256 over the same input; it
+// stands in for the cost of the MAC, not its output.
+//
+// --sizes   fixed:N | uniform:MIN:MAX | mix:N@W,N@W,...  (plaintext bytes)
+// --iv      unique: fresh nonce per message; reuse: one nonce per key (IV
+//           derivation cached); pool:N: N nonces per key, picked at random
+// --rate    0 (default) runs closed-loop, each thread back to back. A
+//           positive rate makes arrivals open-loop (Poisson, split over the
+//           threads), and latency counts from the scheduled arrival, so
+//           queueing behind a slow call is included.
+// --mix     e.g. encrypt=70,decrypt=25,aead=4,expand=1
+//
+// Reports throughput and p50/p99/p99.9/max latency per operation; --json
+// writes the same numbers for capacity tracking across host types.
+
+#include "ruc_cipher.h"
+#include "shake256.h"
+#include "kernels.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+enum LoadOp {
+    OP_EXPAND = 0,
+    OP_ENCRYPT,
+    OP_DECRYPT,
+    OP_AEAD,
+    OP_COUNT
+};
+
+static const char* const OP_NAMES[OP_COUNT] = { "expand", "encrypt", "decrypt", "aead" };
+
+constexpr size_t TAG_SIZE = 32;
+
+typedef std::chrono::steady_clock load_clock;
+
+// splitmix64: cheap per-thread generator for sizes, keys and arrivals
+struct Rng {
+    uint64_t s;
+    uint64_t next() {
+        uint64_t z = (s += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+    double uniform() { return (double)(next() >> 11) * (1.0 / 9007199254740992.0); }
+    void fill(uint8_t* out, size_t len) {
+        for (size_t i = 0; i < len; i++) out[i] = (uint8_t)next();
+    }
+};
+
+struct SizeDist {
+    std::vector<size_t> sizes;
+    std::vector<double> cumulative;   // mix weights, normalized
+    size_t min_size = 0, max_size = 0;
+    bool uniform = false;
+
+    size_t sample(Rng& rng) const {
+        if (uniform) return min_size + (size_t)(rng.next() % (max_size - min_size + 1));
+        double u = rng.uniform();
+        for (size_t i = 0; i < sizes.size(); i++) {
+            if (u < cumulative[i]) return sizes[i];
+        }
+        return sizes.back();
+    }
+    size_t largest() const { return uniform ? max_size : *std::max_element(sizes.begin(), sizes.end()); }
+};
+
+struct Config {
+    int threads = 1;
+    double duration = 5.0;
+    size_t keys = 16;
+    SizeDist sizes;
+    int iv_pool = 0;                  // 0: unique per message, N: N nonces per key
+    double rate = 0.0;                // 0: closed loop
+    double mix[OP_COUNT] = { 0.0, 70.0, 30.0, 0.0 };
+    const char* json_path = nullptr;
+};
+
+// Shared key set: raw keys (AEAD derives from them) and expanded material
+struct KeySet {
+    std::vector<std::vector<uint8_t>> raw;
+    std::vector<void*> km;
+    std::vector<std::vector<uint8_t>> nonces;    // per key, iv_pool entries
+    std::vector<std::vector<uint8_t>> ivs;       // derived IVs for the nonces
+};
+
+struct ThreadResult {
+    std::vector<uint64_t> latency_ns[OP_COUNT];
+    uint64_t bytes[OP_COUNT] = {0};
+};
+
+static void derive_iv(const uint8_t* nonce, uint8_t* iv) {
+    uint8_t input[NONCE_SIZE + 10];
+    memcpy(input, nonce, NONCE_SIZE);
+    memcpy(input + NONCE_SIZE, "RUC-CTR-IV", 10);
+    shake256_hash(input, sizeof(input), iv, IV_SIZE);
+}
+
+static size_t pad_into(const uint8_t* msg, size_t len, uint8_t* out) {
+    size_t padded = len + (BLOCK_SIZE - (len % BLOCK_SIZE));
+    memcpy(out, msg, len);
+    memset(out + len, (int)(padded - len), padded - len);
+    return padded;
+}
+
+// Stand-in for the HMAC-SHA256 tag: SHAKE256(mac_key || ad_len || nonce || ciphertext)
+static void compute_tag(const uint8_t* mac_key, const uint8_t* nonce, const uint8_t* ct, size_t ct_len,
+                        std::vector<uint8_t>& scratch, uint8_t* tag) {
+    scratch.resize(32 + 8 + NONCE_SIZE + ct_len);
+    memcpy(scratch.data(), mac_key, 32);
+    memset(scratch.data() + 32, 0, 8);
+    memcpy(scratch.data() + 40, nonce, NONCE_SIZE);
+    memcpy(scratch.data() + 40 + NONCE_SIZE, ct, ct_len);
+    shake256_hash(scratch.data(), scratch.size(), tag, TAG_SIZE);
+}
+
+static void run_worker(const Config& cfg, const KeySet& keys, int thread_index,
+                       load_clock::time_point start, load_clock::time_point stop, ThreadResult* result) {
+    Rng rng = { 0x5EED0000ULL + (uint64_t)thread_index * 0x1000193ULL };
+    size_t max_padded = cfg.sizes.largest() + BLOCK_SIZE;
+    std::vector<uint8_t> msg(max_padded), buf(max_padded), out(max_padded), scratch;
+    rng.fill(msg.data(), msg.size());
+
+    double op_total = 0.0;
+    for (int op = 0; op < OP_COUNT; op++) op_total += cfg.mix[op];
+
+    // Open loop: this thread's share of the arrival rate
+    double mean_gap_s = cfg.rate > 0.0 ? (double)cfg.threads / cfg.rate : 0.0;
+    load_clock::time_point next_arrival = start;
+
+    while (true) {
+        load_clock::time_point issue;
+        if (mean_gap_s > 0.0) {
+            double gap = -std::log(1.0 - rng.uniform()) * mean_gap_s;
+            next_arrival += std::chrono::duration_cast<load_clock::duration>(std::chrono::duration<double>(gap));
+            if (next_arrival >= stop) break;
+            std::this_thread::sleep_until(next_arrival);
+            issue = next_arrival;
+        } else {
+            issue = load_clock::now();
+            if (issue >= stop) break;
+        }
+
+        double pick = rng.uniform() * op_total;
+        int op = 0;
+        while (op < OP_COUNT - 1 && pick >= cfg.mix[op]) pick -= cfg.mix[op++];
+
+        size_t k = (size_t)(rng.next() % keys.km.size());
+        size_t len = cfg.sizes.sample(rng);
+        uint8_t nonce[NONCE_SIZE], iv[IV_SIZE];
+        const uint8_t* cached_iv = nullptr;
+        const uint8_t* message_nonce = nonce;
+        if (cfg.iv_pool > 0) {
+            size_t slot = (size_t)(rng.next() % (uint64_t)cfg.iv_pool);
+            message_nonce = keys.nonces[k].data() + slot * NONCE_SIZE;
+            cached_iv = keys.ivs[k].data() + slot * IV_SIZE;
+        } else {
+            rng.fill(nonce, NONCE_SIZE);
+        }
+
+        switch (op) {
+            case OP_EXPAND: {
+                void* km = ruc_expand_key(keys.raw[k].data());
+                ruc_free_key_material(km);
+                len = KEY_SIZE;
+                break;
+            }
+            case OP_ENCRYPT: {
+                if (cached_iv) memcpy(iv, cached_iv, IV_SIZE); else derive_iv(message_nonce, iv);
+                size_t padded = pad_into(msg.data(), len, buf.data());
+                ruc_encrypt_blocks_batch(buf.data(), padded / BLOCK_SIZE, keys.raw[k].data(), iv, 0,
+                                         keys.km[k], buf.data());
+                break;
+            }
+            case OP_DECRYPT: {
+                // Random ciphertext-shaped input; read the padding byte as
+                // the unpad step would
+                if (cached_iv) memcpy(iv, cached_iv, IV_SIZE); else derive_iv(message_nonce, iv);
+                size_t padded = len + (BLOCK_SIZE - (len % BLOCK_SIZE));
+                ruc_decrypt_blocks_batch(msg.data(), padded / BLOCK_SIZE, keys.raw[k].data(), iv, 0,
+                                         keys.km[k], out.data());
+                volatile uint8_t pad = out[padded - 1];
+                (void)pad;
+                break;
+            }
+            case OP_AEAD: {
+                uint8_t enc_key[KEY_SIZE], mac_key[32], tag[TAG_SIZE];
+                shake256_with_domain(keys.raw[k].data(), KEY_SIZE, "RUC-AEAD-ENC", 0, enc_key, KEY_SIZE);
+                shake256_with_domain(keys.raw[k].data(), KEY_SIZE, "RUC-AEAD-MAC", 0, mac_key, 32);
+                void* km = ruc_expand_key(enc_key);
+                if (cached_iv) memcpy(iv, cached_iv, IV_SIZE); else derive_iv(message_nonce, iv);
+                size_t padded = pad_into(msg.data(), len, buf.data());
+                ruc_encrypt_blocks_batch(buf.data(), padded / BLOCK_SIZE, enc_key, iv, 0, km, buf.data());
+                compute_tag(mac_key, message_nonce, buf.data(), padded, scratch, tag);
+                ruc_free_key_material(km);
+                break;
+            }
+        }
+
+        uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(load_clock::now() - issue).count();
+        result->latency_ns[op].push_back(ns);
+        result->bytes[op] += len;
+    }
+}
+
+static bool parse_sizes(const char* spec, SizeDist* dist) {
+    dist->sizes.clear();
+    dist->cumulative.clear();
+    dist->uniform = false;
+    if (!strncmp(spec, "fixed:", 6)) {
+        dist->sizes.push_back((size_t)strtoull(spec + 6, nullptr, 10));
+        dist->cumulative.push_back(1.0);
+        return true;
+    }
+    if (!strncmp(spec, "uniform:", 8)) {
+        char* end;
+        dist->min_size = (size_t)strtoull(spec + 8, &end, 10);
+        if (*end != ':') return false;
+        dist->max_size = (size_t)strtoull(end + 1, nullptr, 10);
+        dist->uniform = dist->max_size >= dist->min_size;
+        return dist->uniform;
+    }
+    if (!strncmp(spec, "mix:", 4)) {
+        const char* p = spec + 4;
+        double total = 0.0;
+        std::vector<double> weights;
+        while (*p) {
+            char* end;
+            size_t size = (size_t)strtoull(p, &end, 10);
+            if (*end != '@') return false;
+            double w = strtod(end + 1, &end);
+            if (w <= 0.0) return false;
+            dist->sizes.push_back(size);
+            weights.push_back(w);
+            total += w;
+            p = *end == ',' ? end + 1 : end;
+            if (*end && *end != ',') return false;
+        }
+        if (dist->sizes.empty()) return false;
+        double acc = 0.0;
+        for (double w : weights) {
+            acc += w / total;
+            dist->cumulative.push_back(acc);
+        }
+        return true;
+    }
+    return false;
+}
+
+static bool parse_mix(const char* spec, double* mix) {
+    for (int op = 0; op < OP_COUNT; op++) mix[op] = 0.0;
+    const char* p = spec;
+    double total = 0.0;
+    while (*p) {
+        const char* eq = strchr(p, '=');
+        if (!eq) return false;
+        int op = -1;
+        for (int i = 0; i < OP_COUNT; i++) {
+            if (strlen(OP_NAMES[i]) == (size_t)(eq - p) && !strncmp(p, OP_NAMES[i], eq - p)) op = i;
+        }
+        if (op < 0) return false;
+        char* end;
+        mix[op] = strtod(eq + 1, &end);
+        if (mix[op] < 0.0) return false;
+        total += mix[op];
+        if (*end && *end != ',') return false;
+        p = *end ? end + 1 : end;
+    }
+    return total > 0.0;
+}
+
+static uint64_t percentile(const std::vector<uint64_t>& sorted, double q) {
+    if (sorted.empty()) return 0;
+    size_t idx = (size_t)std::ceil(q * (double)sorted.size());
+    if (idx > 0) idx--;
+    if (idx >= sorted.size()) idx = sorted.size() - 1;
+    return sorted[idx];
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [--threads N] [--duration S] [--keys N] [--sizes SPEC]\n"
+            "          [--iv unique|reuse|pool:N] [--rate OPS] [--mix SPEC] [--json FILE|-]\n", argv0);
+}
+
+int main(int argc, char** argv) {
+    Config cfg;
+    const char* sizes_spec = "mix:64@50,1024@35,16384@15";
+    const char* iv_spec = "unique";
+    const char* mix_spec = "encrypt=70,decrypt=30";
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!strcmp(a, "--threads") && v) { cfg.threads = atoi(v); i++; }
+        else if (!strcmp(a, "--duration") && v) { cfg.duration = atof(v); i++; }
+        else if (!strcmp(a, "--keys") && v) { cfg.keys = (size_t)strtoull(v, nullptr, 10); i++; }
+        else if (!strcmp(a, "--sizes") && v) { sizes_spec = v; i++; }
+        else if (!strcmp(a, "--iv") && v) { iv_spec = v; i++; }
+        else if (!strcmp(a, "--rate") && v) { cfg.rate = atof(v); i++; }
+        else if (!strcmp(a, "--mix") && v) { mix_spec = v; i++; }
+        else if (!strcmp(a, "--json") && v) { cfg.json_path = v; i++; }
+        else { usage(argv[0]); return 2; }
+    }
+
+    if (!strcmp(iv_spec, "unique")) cfg.iv_pool = 0;
+    else if (!strcmp(iv_spec, "reuse")) cfg.iv_pool = 1;
+    else if (!strncmp(iv_spec, "pool:", 5) && atoi(iv_spec + 5) > 0) cfg.iv_pool = atoi(iv_spec + 5);
+    else { fprintf(stderr, "bad --iv '%s'\n", iv_spec); return 2; }
+    if (!parse_sizes(sizes_spec, &cfg.sizes)) { fprintf(stderr, "bad --sizes '%s'\n", sizes_spec); return 2; }
+    if (!parse_mix(mix_spec, cfg.mix)) { fprintf(stderr, "bad --mix '%s'\n", mix_spec); return 2; }
+    if (cfg.threads <= 0 || cfg.duration <= 0.0 || cfg.keys == 0 || cfg.rate < 0.0) { usage(argv[0]); return 2; }
+
+    ruc_kernel_init(0);
+
+    // Keys, nonces and derived IVs are set up before the clock starts
+    KeySet keys;
+    Rng setup = { 0xC0FFEEULL };
+    for (size_t k = 0; k < cfg.keys; k++) {
+        std::vector<uint8_t> raw(KEY_SIZE);
+        setup.fill(raw.data(), KEY_SIZE);
+        keys.km.push_back(ruc_expand_key(raw.data()));
+        keys.raw.push_back(raw);
+        std::vector<uint8_t> nonces(NONCE_SIZE * (size_t)cfg.iv_pool), ivs(IV_SIZE * (size_t)cfg.iv_pool);
+        setup.fill(nonces.data(), nonces.size());
+        for (int s = 0; s < cfg.iv_pool; s++) derive_iv(nonces.data() + s * NONCE_SIZE, ivs.data() + s * IV_SIZE);
+        keys.nonces.push_back(nonces);
+        keys.ivs.push_back(ivs);
+    }
+
+    std::vector<ThreadResult> results(cfg.threads);
+    std::vector<std::thread> workers;
+    load_clock::time_point start = load_clock::now();
+    load_clock::time_point stop = start + std::chrono::duration_cast<load_clock::duration>(std::chrono::duration<double>(cfg.duration));
+    for (int t = 0; t < cfg.threads; t++) {
+        workers.emplace_back(run_worker, std::cref(cfg), std::cref(keys), t, start, stop, &results[t]);
+    }
+    for (std::thread& w : workers) w.join();
+    double elapsed = std::chrono::duration<double>(load_clock::now() - start).count();
+
+    // Merge per-thread samples
+    std::vector<uint64_t> merged[OP_COUNT];
+    uint64_t bytes[OP_COUNT] = {0};
+    for (const ThreadResult& r : results) {
+        for (int op = 0; op < OP_COUNT; op++) {
+            merged[op].insert(merged[op].end(), r.latency_ns[op].begin(), r.latency_ns[op].end());
+            bytes[op] += r.bytes[op];
+        }
+    }
+
+    FILE* json = nullptr;
+    if (cfg.json_path) {
+        json = strcmp(cfg.json_path, "-") ? fopen(cfg.json_path, "w") : stdout;
+        if (!json) { perror(cfg.json_path); return 1; }
+        fprintf(json, "{\n  \"config\": {\"threads\": %d, \"duration_s\": %.3f, \"keys\": %zu, "
+                      "\"sizes\": \"%s\", \"iv\": \"%s\", \"rate\": %.3f, \"mix\": \"%s\", "
+                      "\"hardware_concurrency\": %u, \"keccak_f\": \"%s\", \"gf_mul_register\": \"%s\"},\n"
+                      "  \"elapsed_s\": %.3f,\n  \"ops\": {",
+                cfg.threads, cfg.duration, cfg.keys, sizes_spec, iv_spec, cfg.rate, mix_spec,
+                std::thread::hardware_concurrency(), ruc_kernel_active(RUC_PRIM_KECCAK_F),
+                ruc_kernel_active(RUC_PRIM_GF_MUL_REGISTER), elapsed);
+    }
+    FILE* text = json == stdout ? stderr : stdout;
+    fprintf(text, "%-8s %10s %10s %10s %10s %10s %10s %10s\n",
+            "op", "count", "ops/s", "MB/s", "p50 us", "p99 us", "p99.9 us", "max us");
+
+    bool first = true;
+    for (int op = 0; op < OP_COUNT; op++) {
+        std::vector<uint64_t>& v = merged[op];
+        if (v.empty()) continue;
+        std::sort(v.begin(), v.end());
+        double ops = (double)v.size() / elapsed;
+        double mbps = (double)bytes[op] / elapsed / 1e6;
+        double p50 = percentile(v, 0.50) / 1e3, p99 = percentile(v, 0.99) / 1e3;
+        double p999 = percentile(v, 0.999) / 1e3, max = v.back() / 1e3;
+        fprintf(text, "%-8s %10zu %10.1f %10.3f %10.1f %10.1f %10.1f %10.1f\n",
+                OP_NAMES[op], v.size(), ops, mbps, p50, p99, p999, max);
+        if (json) {
+            fprintf(json, "%s\n    \"%s\": {\"count\": %zu, \"ops_per_s\": %.3f, \"mb_per_s\": %.3f, "
+                          "\"p50_us\": %.3f, \"p99_us\": %.3f, \"p999_us\": %.3f, \"max_us\": %.3f}",
+                    first ? "" : ",", OP_NAMES[op], v.size(), ops, mbps, p50, p99, p999, max);
+            first = false;
+        }
+    }
+    if (json) {
+        fprintf(json, "\n  }\n}\n");
+        if (json != stdout) fclose(json);
+    }
+
+    for (void* km : keys.km) ruc_free_key_material(km);
+    return 0;
+}
@@ -1,6 +1,13 @@
 #!/bin/bash
 
 # Build script for C++ WASM using Emscripten
+#
+# Builds every variant into pkg/ (the loader in src/cipher/cpp-wasm-loader.ts
+# picks the best one the runtime supports):
+#   ruc_wasm          - baseline, runs everywhere
+#   ruc_wasm_simd     - SIMD128 kernels
+#   ruc_wasm_simd_mt  - SIMD128 + shared-memory threads (needs cross-origin isolation)
+# Pass variant names to build a subset, e.g. ./build.sh baseline
 
 set -e
 
@@ -19,23 +26,33 @@ if ! command -v emcc &> /dev/null; then
     exit 1
 fi
 
-# Create build directory
-mkdir -p build
-cd build
-
-# Configure with Emscripten
-emcmake cmake .. -DCMAKE_BUILD_TYPE=Release
-
-# Build
-emmake make -j$(nproc)
+VARIANTS=("$@")
+if [ ${#VARIANTS[@]} -eq 0 ]; then
+    VARIANTS=(baseline simd simd-mt)
+fi
 
-# Copy output to pkg directory
-mkdir -p ../pkg
-cp ruc_wasm.js ../pkg/
-cp ruc_wasm.wasm ../pkg/
+mkdir -p pkg
+for variant in "${VARIANTS[@]}"; do
+    case "$variant" in
+        baseline) name=ruc_wasm ;;
+        simd) name=ruc_wasm_simd ;;
+        simd-mt) name=ruc_wasm_simd_mt ;;
+        *) echo "Error: unknown variant '$variant' (baseline, simd or simd-mt)"; exit 1 ;;
+    esac
+
+    echo "🔨 Building $variant..."
+    # Configure with Emscripten (one build directory per variant)
+    emcmake cmake -S . -B "build/$variant" -DCMAKE_BUILD_TYPE=Release -DRUC_WASM_VARIANT="$variant"
+    emmake make -C "build/$variant" -j$(nproc)
+
+    # Copy output to pkg directory (older Emscripten also emits a .worker.js
+    # for threaded builds)
+    cp "build/$variant/$name.js" "build/$variant/$name.wasm" pkg/
+    if [ -f "build/$variant/$name.worker.js" ]; then
+        cp "build/$variant/$name.worker.js" pkg/
+    fi
+done
 
 echo "✅ C++ WASM build complete!"
 echo "Output files:"
-echo "  - pkg/ruc_wasm.js"
-echo "  - pkg/ruc_wasm.wasm"
-
+ls -1 pkg/ | sed 's/^/  - pkg\//'
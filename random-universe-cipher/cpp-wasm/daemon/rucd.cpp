@@ -0,0 +1,567 @@
+// Local encryption daemon
+//
+//   rucd --socket PATH [--mode OCTAL] [--max-batch N] [--linger-us N]
+//        [--key-cache N]
+//
+// Serves the native engine over a Unix stream socket (protocol in
+// rucd_protocol.h; client library in rucd_client.h), so short-lived processes
+// pay an IPC round trip instead of module startup and ruc_expand_key:
+//
+// - Key cache: expanded keys are kept as ruc_key handles, keyed by the raw key
+//   and shared by every client, LRU-evicted past --key-cache entries.
+// - Coalescing: one event loop reads every request that is ready on any
+//   connection and runs them all as one ruc_encrypt_many batch, which pools
+//   the blocks across threads. --linger-us holds a batch open that much longer
+//   for more requests to arrive (at most MAX_LINGER_US); --max-batch caps its
+//   size.
+// - Shared memory: large payloads stay in a memfd region the client attached
+//   and are encrypted in place there. The memfd must be sealed against
+//   shrinking and at least as large as declared, or the attach is refused.
+//
+// The socket is created with --mode (default 0600): whoever can connect can use
+// the daemon's CPU, and keys travel over it. SIGINT/SIGTERM exit cleanly.
+
+#include "ruc_cipher.h"
+#include "rucd_protocol.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+typedef std::chrono::steady_clock rucd_clock;
+
+constexpr size_t READ_CHUNK = 256 * 1024;
+constexpr size_t OUTPUT_HIGH_WATER = 8 << 20;    // Stop reading from a client this far behind
+constexpr uint64_t MAX_LINGER_US = 60000000;     // One minute; fits poll()'s int ms timeout
+
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_signal(int) {
+    stop_requested = 1;
+}
+
+struct Mapping {
+    uint8_t* base;
+    size_t size;
+};
+
+struct Connection {
+    int fd;
+    std::vector<uint8_t> in;       // Received bytes not yet parsed
+    std::vector<uint8_t> out;      // Response bytes not yet sent
+    size_t out_pos;
+    int passed_fd;                 // memfd from SCM_RIGHTS awaiting its ATTACH header
+    Mapping shm;
+    bool closing;
+};
+
+// A parsed request waiting for the next batch. Control requests carry a ready
+// response so every connection's responses stay in request order.
+struct PendingRequest {
+    Connection* conn;
+    uint64_t request_id;
+    int32_t status;
+    bool crypto;
+    uint32_t key_id;
+    uint8_t iv[RUCD_IV_SIZE];
+    uint32_t start_block_number;
+    uint8_t* data;                     // Encrypted in place
+    size_t len;
+    bool in_shm;
+    std::vector<uint8_t> inline_data;  // Owns inline payloads (padded to whole blocks)
+    uint8_t tail[BLOCK_SIZE];          // Partial last block of a shared-memory payload
+    std::string reply;                 // Control response payload
+};
+
+struct CachedKey {
+    uint32_t key_id;
+    uint64_t last_used;
+};
+
+struct DaemonStats {
+    uint64_t requests;
+    uint64_t batches;
+    uint64_t batch_max;
+    uint64_t bytes;
+    uint64_t key_hits;
+    uint64_t key_misses;
+    uint64_t key_evictions;
+};
+
+struct Daemon {
+    size_t max_batch;
+    uint64_t linger_us;
+    size_t key_cache_capacity;
+
+    std::vector<std::unique_ptr<Connection>> connections;
+    std::vector<std::unique_ptr<PendingRequest>> pending;
+    rucd_clock::time_point batch_opened;
+    std::vector<Mapping> retired;      // Replaced regions still referenced by the pending batch
+
+    std::unordered_map<std::string, CachedKey> key_cache;
+    uint64_t key_clock;
+    DaemonStats stats;
+};
+
+static uint32_t cached_key(Daemon& d, const uint8_t* key) {
+    std::string k((const char*)key, RUCD_KEY_SIZE);
+    auto it = d.key_cache.find(k);
+    if (it != d.key_cache.end()) {
+        it->second.last_used = ++d.key_clock;
+        d.stats.key_hits++;
+        return it->second.key_id;
+    }
+    d.stats.key_misses++;
+    CachedKey entry = { ruc_key_create(key), ++d.key_clock };
+    d.key_cache.emplace(k, entry);
+    return entry.key_id;
+}
+
+// Evict least recently used keys; only between batches, when no pending job
+// holds a key handle
+static void trim_key_cache(Daemon& d) {
+    while (d.key_cache.size() > d.key_cache_capacity) {
+        auto oldest = d.key_cache.begin();
+        for (auto it = d.key_cache.begin(); it != d.key_cache.end(); ++it) {
+            if (it->second.last_used < oldest->second.last_used) oldest = it;
+        }
+        ruc_key_destroy(oldest->second.key_id);
+        std::string& k = const_cast<std::string&>(oldest->first);
+        std::fill(k.begin(), k.end(), '\0');
+        d.key_cache.erase(oldest);
+        d.stats.key_evictions++;
+    }
+}
+
+static void append_response(Connection* conn, uint64_t request_id, int32_t status,
+                            const uint8_t* payload, size_t len) {
+    RucdResponseHeader r;
+    r.magic = RUCD_MAGIC;
+    r.status = status;
+    r.request_id = request_id;
+    r.length = len;
+    const uint8_t* h = (const uint8_t*)&r;
+    conn->out.insert(conn->out.end(), h, h + sizeof(r));
+    if (len) conn->out.insert(conn->out.end(), payload, payload + len);
+}
+
+static std::string stats_text(const Daemon& d) {
+    char buf[1024];
+    snprintf(buf, sizeof(buf),
+             "# TYPE rucd_requests_total counter\nrucd_requests_total %llu\n"
+             "# TYPE rucd_batches_total counter\nrucd_batches_total %llu\n"
+             "# TYPE rucd_batch_requests_max gauge\nrucd_batch_requests_max %llu\n"
+             "# TYPE rucd_bytes_total counter\nrucd_bytes_total %llu\n"
+             "# TYPE rucd_key_cache_hits_total counter\nrucd_key_cache_hits_total %llu\n"
+             "# TYPE rucd_key_cache_misses_total counter\nrucd_key_cache_misses_total %llu\n"
+             "# TYPE rucd_key_cache_evictions_total counter\nrucd_key_cache_evictions_total %llu\n"
+             "# TYPE rucd_key_cache_entries gauge\nrucd_key_cache_entries %zu\n"
+             "# TYPE rucd_connections gauge\nrucd_connections %zu\n",
+             (unsigned long long)d.stats.requests, (unsigned long long)d.stats.batches,
+             (unsigned long long)d.stats.batch_max, (unsigned long long)d.stats.bytes,
+             (unsigned long long)d.stats.key_hits, (unsigned long long)d.stats.key_misses,
+             (unsigned long long)d.stats.key_evictions, d.key_cache.size(), d.connections.size());
+    std::string text(buf);
+    size_t len = ruc_metrics_prometheus(nullptr, 0);
+    std::string engine(len + 1, '\0');
+    ruc_metrics_prometheus(&engine[0], engine.size());
+    engine.resize(len);
+    return text + engine;
+}
+
+// Run every pending request as one multi-message batch and queue the responses
+static void flush_batch(Daemon& d) {
+    if (d.pending.empty()) return;
+    std::vector<RucJob> jobs;
+    jobs.reserve(d.pending.size() * 2);
+    for (auto& p : d.pending) {
+        if (!p->crypto || p->status != RUCD_OK || p->len == 0) continue;
+        size_t full = p->len / BLOCK_SIZE;
+        size_t rem = p->len % BLOCK_SIZE;
+        RucJob job;
+        job.key_id = p->key_id;
+        job.iv = p->iv;
+        job.start_block_number = p->start_block_number;
+        job.status = 0;
+        if (!p->in_shm) {
+            // Inline payloads are already padded to whole blocks
+            job.input = job.output = p->data;
+            job.num_blocks = full + (rem ? 1 : 0);
+            jobs.push_back(job);
+            continue;
+        }
+        if (full) {
+            job.input = job.output = p->data;
+            job.num_blocks = full;
+            jobs.push_back(job);
+        }
+        if (rem) {
+            memset(p->tail, 0, BLOCK_SIZE);
+            memcpy(p->tail, p->data + full * BLOCK_SIZE, rem);
+            job.start_block_number = p->start_block_number + (uint32_t)full;
+            job.input = job.output = p->tail;
+            job.num_blocks = 1;
+            jobs.push_back(job);
+        }
+    }
+    ruc_encrypt_many(jobs.data(), jobs.size());
+
+    d.stats.batches++;
+    d.stats.batch_max = std::max<uint64_t>(d.stats.batch_max, d.pending.size());
+    for (auto& p : d.pending) {
+        if (p->crypto && p->status == RUCD_OK) {
+            d.stats.requests++;
+            d.stats.bytes += p->len;
+            if (p->in_shm) {
+                size_t full = p->len / BLOCK_SIZE;
+                memcpy(p->data + full * BLOCK_SIZE, p->tail, p->len % BLOCK_SIZE);
+                append_response(p->conn, p->request_id, RUCD_OK, nullptr, 0);
+            } else {
+                append_response(p->conn, p->request_id, RUCD_OK, p->data, p->len);
+                std::fill(p->inline_data.begin(), p->inline_data.end(), 0);
+            }
+        } else {
+            append_response(p->conn, p->request_id, p->status, (const uint8_t*)p->reply.data(),
+                            p->status == RUCD_OK ? p->reply.size() : 0);
+        }
+    }
+    d.pending.clear();
+    for (Mapping& m : d.retired) munmap(m.base, m.size);
+    d.retired.clear();
+    trim_key_cache(d);
+}
+
+static void queue_request(Daemon& d, std::unique_ptr<PendingRequest> p) {
+    if (d.pending.empty()) d.batch_opened = rucd_clock::now();
+    d.pending.push_back(std::move(p));
+    if (d.pending.size() >= d.max_batch) flush_batch(d);
+}
+
+// A region is only mapped if it can never be shorter than the mapping:
+// touching pages past the end of the file would SIGBUS the daemon. The file
+// must already be at least `size` bytes and carry F_SEAL_SHRINK, so the client
+// cannot truncate it later.
+static bool shm_fd_usable(int fd, uint64_t size) {
+    if (fd < 0 || size == 0 || size > SIZE_MAX) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 0 || (uint64_t)st.st_size < size) return false;
+#ifdef F_SEAL_SHRINK
+    int seals = fcntl(fd, F_GET_SEALS);
+    return seals >= 0 && (seals & F_SEAL_SHRINK);
+#else
+    return false;
+#endif
+}
+
+static void attach_shm(Daemon& d, Connection* conn, uint64_t size, PendingRequest* p) {
+    int fd = conn->passed_fd;
+    conn->passed_fd = -1;
+    void* map = MAP_FAILED;
+    if (shm_fd_usable(fd, size)) map = mmap(nullptr, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (fd >= 0) close(fd);
+    if (map == MAP_FAILED) {
+        p->status = RUCD_ERR_BAD_REQUEST;
+        return;
+    }
+    if (conn->shm.base) d.retired.push_back(conn->shm);
+    conn->shm.base = (uint8_t*)map;
+    conn->shm.size = size;
+}
+
+// Parse complete requests out of the connection's input buffer
+static void parse_requests(Daemon& d, Connection* conn) {
+    size_t pos = 0;
+    while (conn->in.size() - pos >= sizeof(RucdRequestHeader)) {
+        RucdRequestHeader h;
+        memcpy(&h, conn->in.data() + pos, sizeof(h));
+        if (h.magic != RUCD_MAGIC || h.version != RUCD_VERSION) {
+            conn->closing = true;
+            break;
+        }
+        bool crypto = h.op == RUCD_OP_ENCRYPT || h.op == RUCD_OP_DECRYPT;
+        bool inline_payload = crypto && !(h.flags & RUCD_FLAG_SHM);
+        if (inline_payload && h.length > RUCD_MAX_INLINE) {
+            conn->closing = true;
+            break;
+        }
+        size_t payload = inline_payload ? (size_t)h.length : 0;
+        if (conn->in.size() - pos < sizeof(h) + payload) break;
+
+        std::unique_ptr<PendingRequest> p(new PendingRequest());
+        p->conn = conn;
+        p->request_id = h.request_id;
+        p->status = RUCD_OK;
+        p->crypto = crypto;
+        p->len = 0;
+        p->in_shm = false;
+        if (crypto) {
+            p->key_id = cached_key(d, h.key);
+            memcpy(p->iv, h.iv, RUCD_IV_SIZE);
+            p->start_block_number = h.start_block_number;
+            p->len = (size_t)h.length;
+            if (inline_payload) {
+                p->inline_data.assign((p->len + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE, 0);
+                memcpy(p->inline_data.data(), conn->in.data() + pos + sizeof(h), p->len);
+                p->data = p->inline_data.data();
+            } else if (conn->shm.base && h.shm_offset <= conn->shm.size &&
+                       h.length <= conn->shm.size - h.shm_offset) {
+                p->data = conn->shm.base + h.shm_offset;
+                p->in_shm = true;
+            } else {
+                p->status = RUCD_ERR_BAD_REQUEST;
+            }
+        } else if (h.op == RUCD_OP_ATTACH_SHM) {
+            attach_shm(d, conn, h.length, p.get());
+        } else if (h.op == RUCD_OP_STATS) {
+            p->reply = stats_text(d);
+        } else {
+            p->status = RUCD_ERR_BAD_REQUEST;
+        }
+        memset(conn->in.data() + pos, 0, sizeof(h) + payload);   // Drop key and plaintext
+        pos += sizeof(h) + payload;
+        queue_request(d, std::move(p));
+    }
+    conn->in.erase(conn->in.begin(), conn->in.begin() + pos);
+}
+
+static void read_connection(Daemon& d, Connection* conn) {
+    uint8_t buf[READ_CHUNK];
+    for (;;) {
+        iovec iov = { buf, sizeof(buf) };
+        char control[CMSG_SPACE(sizeof(int) * 4)];
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        ssize_t n = recvmsg(conn->fd, &msg, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n <= 0) {
+            conn->closing = true;
+            break;
+        }
+        for (cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+            if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS) continue;
+            size_t count = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            for (size_t i = 0; i < count; i++) {
+                int fd;
+                memcpy(&fd, CMSG_DATA(c) + i * sizeof(int), sizeof(int));
+                if (conn->passed_fd >= 0) close(conn->passed_fd);
+                conn->passed_fd = fd;
+            }
+        }
+        conn->in.insert(conn->in.end(), buf, buf + n);
+        parse_requests(d, conn);
+        if (conn->closing || (size_t)n < sizeof(buf)) break;
+    }
+}
+
+static void write_connection(Connection* conn) {
+    while (conn->out_pos < conn->out.size()) {
+        ssize_t n = send(conn->fd, conn->out.data() + conn->out_pos, conn->out.size() - conn->out_pos, SEND_FLAGS);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        if (n <= 0) {
+            conn->closing = true;
+            return;
+        }
+        conn->out_pos += (size_t)n;
+    }
+    std::fill(conn->out.begin(), conn->out.end(), 0);
+    conn->out.clear();
+    conn->out_pos = 0;
+}
+
+static void close_connection(Connection* conn) {
+    close(conn->fd);
+    if (conn->passed_fd >= 0) close(conn->passed_fd);
+    if (conn->shm.base) munmap(conn->shm.base, conn->shm.size);
+}
+
+static int open_socket(const char* path, mode_t mode) {
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "socket path too long\n");
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    // Refuse to take over a live daemon's socket; remove a stale one
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe >= 0 && connect(probe, (sockaddr*)&addr, sizeof(addr)) == 0) {
+        close(probe);
+        fprintf(stderr, "%s: a daemon is already listening\n", path);
+        return -1;
+    }
+    if (probe >= 0) close(probe);
+    struct stat st;
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    mode_t old_umask = umask(0177);
+    bool ok = bind(fd, (sockaddr*)&addr, sizeof(addr)) == 0;
+    umask(old_umask);
+    if (!ok || chmod(path, mode) != 0 || listen(fd, 128) != 0) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s --socket PATH [--mode OCTAL] [--max-batch N] [--linger-us N] [--key-cache N]\n",
+            argv0);
+}
+
+int main(int argc, char** argv) {
+    const char* socket_path = nullptr;
+    mode_t mode = 0600;
+    Daemon d;
+    d.max_batch = 256;
+    d.linger_us = 0;
+    d.key_cache_capacity = 256;
+    d.key_clock = 0;
+    memset(&d.stats, 0, sizeof(d.stats));
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!v) { usage(argv[0]); return 2; }
+        if (!strcmp(a, "--socket")) socket_path = v;
+        else if (!strcmp(a, "--mode")) mode = (mode_t)strtoul(v, nullptr, 8);
+        else if (!strcmp(a, "--max-batch")) d.max_batch = (size_t)strtoull(v, nullptr, 10);
+        else if (!strcmp(a, "--linger-us")) {
+            // poll() takes an int millisecond timeout; refuse what it cannot hold
+            char* end;
+            errno = 0;
+            d.linger_us = strtoull(v, &end, 10);
+            if (*v == '-' || *end || end == v || errno || d.linger_us > MAX_LINGER_US) {
+                fprintf(stderr, "rucd: --linger-us must be 0..%llu\n", (unsigned long long)MAX_LINGER_US);
+                return 2;
+            }
+        }
+        else if (!strcmp(a, "--key-cache")) d.key_cache_capacity = (size_t)strtoull(v, nullptr, 10);
+        else { usage(argv[0]); return 2; }
+        i++;
+    }
+    if (!socket_path || d.max_batch == 0) { usage(argv[0]); return 2; }
+
+    int listen_fd = open_socket(socket_path, mode);
+    if (listen_fd < 0) return 1;
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+    fprintf(stderr, "rucd: listening on %s (max batch %zu, linger %llu us, key cache %zu)\n", socket_path,
+            d.max_batch, (unsigned long long)d.linger_us, d.key_cache_capacity);
+
+    std::vector<pollfd> fds;
+    while (!stop_requested) {
+        fds.clear();
+        fds.push_back({ listen_fd, POLLIN, 0 });
+        for (auto& c : d.connections) {
+            short events = 0;
+            if (c->out.size() - c->out_pos < OUTPUT_HIGH_WATER) events |= POLLIN;
+            if (c->out_pos < c->out.size()) events |= POLLOUT;
+            fds.push_back({ c->fd, events, 0 });
+        }
+
+        // An open batch waits at most until its linger time runs out
+        int timeout_ms = -1;
+        if (!d.pending.empty()) {
+            uint64_t waited = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                rucd_clock::now() - d.batch_opened).count();
+            timeout_ms = waited >= d.linger_us ? 0 : (int)((d.linger_us - waited + 999) / 1000);
+        }
+        int ready = poll(fds.data(), fds.size(), timeout_ms);
+        if (ready < 0 && errno != EINTR) {
+            perror("poll");
+            break;
+        }
+
+        if (ready > 0) {
+            size_t num_conns = d.connections.size();
+            for (size_t i = 0; i < num_conns; i++) {
+                Connection* c = d.connections[i].get();
+                if (fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)) read_connection(d, c);
+            }
+            if (fds[0].revents & POLLIN) {
+                for (;;) {
+                    int fd = accept(listen_fd, nullptr, nullptr);
+                    if (fd < 0) break;
+                    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                    std::unique_ptr<Connection> c(new Connection());
+                    c->fd = fd;
+                    c->out_pos = 0;
+                    c->passed_fd = -1;
+                    c->shm.base = nullptr;
+                    c->shm.size = 0;
+                    c->closing = false;
+                    d.connections.push_back(std::move(c));
+                }
+            }
+        }
+
+        if (!d.pending.empty()) {
+            uint64_t waited = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                rucd_clock::now() - d.batch_opened).count();
+            if (waited >= d.linger_us) flush_batch(d);
+        }
+
+        for (auto& c : d.connections) {
+            if (c->out_pos < c->out.size()) write_connection(c.get());
+        }
+
+        // Connections still named by an open batch are closed after it runs
+        for (size_t i = 0; i < d.connections.size();) {
+            Connection* c = d.connections[i].get();
+            bool referenced = false;
+            for (auto& p : d.pending) referenced = referenced || p->conn == c;
+            if (c->closing && !referenced) {
+                close_connection(c);
+                d.connections.erase(d.connections.begin() + i);
+            } else {
+                i++;
+            }
+        }
+    }
+
+    for (auto& c : d.connections) close_connection(c.get());
+    for (auto& entry : d.key_cache) ruc_key_destroy(entry.second.key_id);
+    close(listen_fd);
+    unlink(socket_path);
+    fprintf(stderr, "rucd: %llu requests in %llu batches\n", (unsigned long long)d.stats.requests,
+            (unsigned long long)d.stats.batches);
+    return 0;
+}
@@ -0,0 +1,239 @@
+#include "rucd_client.h"
+#include "rucd_protocol.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+struct RucdClient {
+    int fd;
+    uint64_t next_id;
+    uint8_t* shm;              // Shared region (nullptr until first needed)
+    size_t shm_size;
+};
+
+constexpr size_t SHM_MIN_SIZE = 1 << 20;
+
+// A daemon that went away must surface as an error, not kill the caller
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+static bool write_full(int fd, const void* buf, size_t len) {
+    const uint8_t* p = (const uint8_t*)buf;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, SEND_FLAGS);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+static bool read_full(int fd, void* buf, size_t len) {
+    uint8_t* p = (uint8_t*)buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+RucdClient* rucd_connect(const char* socket_path) {
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) return nullptr;
+    strcpy(addr.sun_path, socket_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return nullptr;
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return nullptr;
+    }
+#ifdef SO_NOSIGPIPE
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+    RucdClient* client = new RucdClient();
+    client->fd = fd;
+    client->next_id = 1;
+    client->shm = nullptr;
+    client->shm_size = 0;
+    return client;
+}
+
+void rucd_close(RucdClient* client) {
+    if (!client) return;
+    close(client->fd);
+    if (client->shm) munmap(client->shm, client->shm_size);
+    delete client;
+}
+
+static void init_header(RucdClient* client, RucdRequestHeader* h, uint16_t op) {
+    memset(h, 0, sizeof(*h));
+    h->magic = RUCD_MAGIC;
+    h->version = RUCD_VERSION;
+    h->op = op;
+    h->request_id = client->next_id++;
+}
+
+// Read a response header for request_id; false on a broken connection
+static bool read_response(RucdClient* client, uint64_t request_id, RucdResponseHeader* r) {
+    return read_full(client->fd, r, sizeof(*r)) && r->magic == RUCD_MAGIC && r->request_id == request_id;
+}
+
+// Make the shared region at least len bytes, replacing it if it has to grow
+static bool ensure_shm(RucdClient* client, size_t len) {
+#ifdef __linux__
+    if (client->shm && client->shm_size >= len) return true;
+    size_t size = client->shm_size ? client->shm_size * 2 : SHM_MIN_SIZE;
+    while (size < len) size *= 2;
+
+    // The daemon only maps regions sealed against shrinking
+    int mfd = memfd_create("rucd", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (mfd < 0) return false;
+    void* map = MAP_FAILED;
+    if (ftruncate(mfd, (off_t)size) == 0 && fcntl(mfd, F_ADD_SEALS, F_SEAL_SHRINK) == 0) {
+        map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, mfd, 0);
+    }
+    if (map == MAP_FAILED) {
+        close(mfd);
+        return false;
+    }
+
+    RucdRequestHeader h;
+    init_header(client, &h, RUCD_OP_ATTACH_SHM);
+    h.length = size;
+    iovec iov = { &h, sizeof(h) };
+    char control[CMSG_SPACE(sizeof(int))];
+    memset(control, 0, sizeof(control));
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &mfd, sizeof(int));
+
+    ssize_t sent;
+    do {
+        sent = sendmsg(client->fd, &msg, SEND_FLAGS);
+    } while (sent < 0 && errno == EINTR);
+    close(mfd);   // The daemon has its own reference once the message is sent
+    RucdResponseHeader r;
+    bool ok = sent == (ssize_t)sizeof(h) && read_response(client, h.request_id, &r) && r.status == RUCD_OK;
+    if (!ok) {
+        munmap(map, size);
+        return false;
+    }
+    if (client->shm) munmap(client->shm, client->shm_size);
+    client->shm = (uint8_t*)map;
+    client->shm_size = size;
+    return true;
+#else
+    (void)client;
+    (void)len;
+    return false;
+#endif
+}
+
+uint8_t* rucd_shm_buffer(RucdClient* client, size_t len) {
+    return ensure_shm(client, len) ? client->shm : nullptr;
+}
+
+static bool in_shm(const RucdClient* client, const uint8_t* p, size_t len) {
+    return client->shm && p >= client->shm && len <= client->shm_size &&
+           (size_t)(p - client->shm) <= client->shm_size - len;
+}
+
+static int process(RucdClient* client, uint16_t op, const uint8_t* key, const uint8_t* iv,
+                   uint32_t start_block_number, const uint8_t* input, size_t len, uint8_t* output) {
+    RucdRequestHeader h;
+    init_header(client, &h, op);
+    memcpy(h.key, key, RUCD_KEY_SIZE);
+    memcpy(h.iv, iv, RUCD_IV_SIZE);
+    h.start_block_number = start_block_number;
+    h.length = len;
+
+    // In place in the shared region: no copies at all
+    bool zero_copy = input == output && in_shm(client, input, len);
+    if (zero_copy || (len >= RUCD_SHM_THRESHOLD && ensure_shm(client, len))) {
+        h.flags = RUCD_FLAG_SHM;
+        h.shm_offset = zero_copy ? (uint64_t)(input - client->shm) : 0;
+        if (!zero_copy) memcpy(client->shm, input, len);
+        RucdResponseHeader r;
+        if (!write_full(client->fd, &h, sizeof(h)) || !read_response(client, h.request_id, &r)) return -1;
+        if (r.status != RUCD_OK) return r.status;
+        if (!zero_copy) memcpy(output, client->shm, len);
+        return 0;
+    }
+
+    if (len > RUCD_MAX_INLINE) return RUCD_ERR_BAD_REQUEST;
+    iovec iov[2] = { { &h, sizeof(h) }, { (void*)input, len } };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = len ? 2 : 1;
+    // Small requests go out in one sendmsg; fall back to plain writes on a short send
+    ssize_t sent;
+    do {
+        sent = sendmsg(client->fd, &msg, SEND_FLAGS);
+    } while (sent < 0 && errno == EINTR);
+    if (sent < 0) return -1;
+    size_t done = (size_t)sent;
+    if (done < sizeof(h)) {
+        if (!write_full(client->fd, (const uint8_t*)&h + done, sizeof(h) - done)) return -1;
+        done = sizeof(h);
+    }
+    if (!write_full(client->fd, input + (done - sizeof(h)), len - (done - sizeof(h)))) return -1;
+
+    RucdResponseHeader r;
+    if (!read_response(client, h.request_id, &r)) return -1;
+    if (r.status != RUCD_OK) return r.status;
+    if (r.length != len || !read_full(client->fd, output, len)) return -1;
+    return 0;
+}
+
+int rucd_encrypt(RucdClient* client, const uint8_t* key, const uint8_t* iv,
+                 uint32_t start_block_number, const uint8_t* input, size_t len, uint8_t* output) {
+    return process(client, RUCD_OP_ENCRYPT, key, iv, start_block_number, input, len, output);
+}
+
+int rucd_decrypt(RucdClient* client, const uint8_t* key, const uint8_t* iv,
+                 uint32_t start_block_number, const uint8_t* input, size_t len, uint8_t* output) {
+    return process(client, RUCD_OP_DECRYPT, key, iv, start_block_number, input, len, output);
+}
+
+long rucd_stats(RucdClient* client, char* buf, size_t cap) {
+    RucdRequestHeader h;
+    init_header(client, &h, RUCD_OP_STATS);
+    RucdResponseHeader r;
+    if (!write_full(client->fd, &h, sizeof(h)) || !read_response(client, h.request_id, &r)) return -1;
+    if (r.status != RUCD_OK) return -1;
+    std::string text(r.length, '\0');
+    if (!read_full(client->fd, &text[0], text.size())) return -1;
+    if (cap > 0) {
+        size_t n = text.size() < cap - 1 ? text.size() : cap - 1;
+        memcpy(buf, text.data(), n);
+        buf[n] = 0;
+    }
+    return (long)text.size();
+}
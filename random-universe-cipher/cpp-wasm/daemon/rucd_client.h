@@ -0,0 +1,43 @@
+#ifndef RUCD_CLIENT_H
+#define RUCD_CLIENT_H
+
+#include <cstdint>
+#include <cstddef>
+
+// Client library for rucd (see rucd_protocol.h). It does not link the cipher:
+// requests go to the daemon, which keeps expanded keys cached and batches
+// concurrent requests from all clients. A client is one connection with one
+// request in flight; use one per thread.
+//
+// Payloads of at least RUCD_SHM_THRESHOLD bytes travel through a shared memory
+// region instead of the socket. Buffers obtained from rucd_shm_buffer() are
+// already in that region and are encrypted in place without any copy.
+
+constexpr size_t RUCD_SHM_THRESHOLD = 64 * 1024;
+
+extern "C" {
+    struct RucdClient;
+
+    // Connect to the daemon's socket; nullptr on failure
+    RucdClient* rucd_connect(const char* socket_path);
+    void rucd_close(RucdClient* client);
+
+    // Encrypt/decrypt len bytes (any length; in == out is allowed) with a
+    // 64-byte key and 32-byte IV, starting at block start_block_number.
+    // Returns 0, -1 for a connection error (the client is then unusable), or
+    // the daemon's negative status.
+    int rucd_encrypt(RucdClient* client, const uint8_t* key, const uint8_t* iv,
+                     uint32_t start_block_number, const uint8_t* input, size_t len, uint8_t* output);
+    int rucd_decrypt(RucdClient* client, const uint8_t* key, const uint8_t* iv,
+                     uint32_t start_block_number, const uint8_t* input, size_t len, uint8_t* output);
+
+    // A buffer of at least len bytes in the shared region (Linux only;
+    // nullptr otherwise). Valid until the next call that grows the region.
+    uint8_t* rucd_shm_buffer(RucdClient* client, size_t len);
+
+    // Daemon counters and engine metrics in Prometheus text format. Returns
+    // the full length like snprintf, or -1 on error.
+    long rucd_stats(RucdClient* client, char* buf, size_t cap);
+}
+
+#endif // RUCD_CLIENT_H
@@ -0,0 +1,60 @@
+#ifndef RUCD_PROTOCOL_H
+#define RUCD_PROTOCOL_H
+
+#include <cstdint>
+#include <cstddef>
+
+// Wire format between rucd and its clients (Unix stream socket, host byte
+// order: both ends are on the same machine). A client sends a request header,
+// followed by `length` payload bytes unless RUCD_FLAG_SHM is set, and gets back
+// a response header followed by `length` bytes (again none for shared-memory
+// requests, whose output is written in place in the shared region).
+//
+// Shared memory: the client sends RUCD_OP_ATTACH_SHM with a memfd attached
+// (SCM_RIGHTS) and `length` = its size. The memfd must already be at least
+// `length` bytes and sealed with F_SEAL_SHRINK; otherwise the attach fails
+// with RUCD_ERR_BAD_REQUEST. Later RUCD_FLAG_SHM requests name a byte range
+// of that region with shm_offset/length. Attaching again replaces the
+// previous region.
+
+constexpr uint32_t RUCD_MAGIC = 0x44435552;          // "RUCD"
+constexpr uint16_t RUCD_VERSION = 1;
+constexpr size_t RUCD_KEY_SIZE = 64;
+constexpr size_t RUCD_IV_SIZE = 32;
+constexpr uint64_t RUCD_MAX_INLINE = 64ull << 20;    // Larger payloads must use shared memory
+
+enum RucdOp : uint16_t {
+    RUCD_OP_ENCRYPT = 1,
+    RUCD_OP_DECRYPT = 2,
+    RUCD_OP_ATTACH_SHM = 3,
+    RUCD_OP_STATS = 4,        // Response payload: Prometheus text
+};
+
+constexpr uint32_t RUCD_FLAG_SHM = 1;
+
+// Response status
+constexpr int32_t RUCD_OK = 0;
+constexpr int32_t RUCD_ERR_BAD_REQUEST = -1;   // Unknown op, bad shm range or region, no region attached
+constexpr int32_t RUCD_ERR_INTERNAL = -2;
+
+struct RucdRequestHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t op;
+    uint32_t flags;
+    uint32_t start_block_number;
+    uint64_t request_id;          // Echoed in the response
+    uint64_t length;              // Payload bytes (any length; output length = input length)
+    uint64_t shm_offset;
+    uint8_t key[RUCD_KEY_SIZE];
+    uint8_t iv[RUCD_IV_SIZE];
+};
+
+struct RucdResponseHeader {
+    uint32_t magic;
+    int32_t status;
+    uint64_t request_id;
+    uint64_t length;
+};
+
+#endif // RUCD_PROTOCOL_H
@@ -0,0 +1,44 @@
+/**
+ * Random Universe Cipher - Native Node.js binding (type declarations)
+ */
+
+type Bytes = Uint8Array | ArrayBuffer | DataView;
+
+/** Opaque expanded-key handle; freed when garbage collected */
+export type KeyHandle = { readonly __rucKeyHandle: unique symbol };
+
+export interface NativeAddon {
+  expandKey(key: Bytes): KeyHandle;
+  /** Encrypt whole 32-byte blocks on libuv's thread pool; output may alias input */
+  encryptBlocks(handle: KeyHandle, iv: Bytes, startBlock: number, input: Bytes, output?: Bytes): Promise<Uint8Array>;
+  decryptBlocks(handle: KeyHandle, iv: Bytes, startBlock: number, input: Bytes, output?: Bytes): Promise<Uint8Array>;
+  encryptBlocksSync(handle: KeyHandle, iv: Bytes, startBlock: number, input: Bytes, output?: Bytes): Uint8Array;
+  decryptBlocksSync(handle: KeyHandle, iv: Bytes, startBlock: number, input: Bytes, output?: Bytes): Uint8Array;
+  /** Active kernel per primitive */
+  kernels(): Record<string, string>;
+  /** Registered kernels per primitive */
+  kernelNames(): Record<string, string[]>;
+  /** Pin a primitive to one kernel; returns 0 or a negative RUC_KERNEL_ERR_* status. Throws (ERR_RUC_BUSY) while async batches are pending */
+  forceKernel(primitive: string, name: string): number;
+  /** Constant-time engine; same output as encryptBlocksSync */
+  encryptBlocksCtSync(handle: KeyHandle, iv: Bytes, startBlock: number, input: Bytes, output?: Bytes): Uint8Array;
+}
+
+export const native: NativeAddon;
+
+export function expandKey(key: Uint8Array): KeyHandle;
+
+export function encryptCTR(plaintext: Uint8Array, key: Uint8Array | KeyHandle, nonce?: Uint8Array): Promise<Uint8Array>;
+export function decryptCTR(ciphertext: Uint8Array, key: Uint8Array | KeyHandle): Promise<Uint8Array>;
+export function encrypt(plaintext: Uint8Array, key: Uint8Array | KeyHandle): Promise<Uint8Array>;
+export function decrypt(ciphertext: Uint8Array, key: Uint8Array | KeyHandle): Promise<Uint8Array>;
+
+export function aeadEncrypt(
+  plaintext: Uint8Array,
+  key: Uint8Array,
+  associatedData?: Uint8Array,
+  nonce?: Uint8Array
+): Promise<Uint8Array>;
+export function aeadDecrypt(ciphertextWithTag: Uint8Array, key: Uint8Array, associatedData?: Uint8Array): Promise<Uint8Array>;
+export function aeadEncryptString(plaintext: string, key: Uint8Array, associatedData?: Uint8Array | string): Promise<Uint8Array>;
+export function aeadDecryptString(ciphertextWithTag: Uint8Array, key: Uint8Array, associatedData?: Uint8Array | string): Promise<string>;
@@ -0,0 +1,204 @@
+/**
+ * Random Universe Cipher - Native Node.js binding
+ *
+ * Same encrypt/decrypt/AEAD surface as src/cipher/index.ts, backed by the
+ * native C++ engine (ruc_native.node) instead of the WASM worker pool.
+ * Ciphertext matches the C++ engine paths (encryptCTRCppParallel /
+ * encryptWithPasswordAEADFast): nonce (16) || ciphertext, PKCS#7 padded.
+ */
+
+import { createRequire } from 'node:module';
+import { createHash, createHmac, randomBytes, timingSafeEqual } from 'node:crypto';
+
+const require = createRequire(import.meta.url);
+
+const BYTES = { KEY: 64, BLOCK: 32, IV: 32, NONCE: 16 };
+const TAG_SIZE = 32;
+
+function loadAddon() {
+  const candidates = [
+    process.env.RUC_NATIVE_ADDON,
+    '../build-native/ruc_native.node',
+    '../build/ruc_native.node',
+  ].filter(Boolean);
+  let lastError;
+  for (const path of candidates) {
+    try {
+      return require(path);
+    } catch (error) {
+      lastError = error;
+    }
+  }
+  throw new Error(`ruc_native.node not found (run: npm run build:native): ${lastError}`);
+}
+
+export const native = loadAddon();
+
+function shake256(data, outputLength) {
+  return createHash('shake256', { outputLength }).update(data).digest();
+}
+
+function deriveIV(nonce) {
+  return shake256(Buffer.concat([nonce, Buffer.from('RUC-CTR-IV')]), BYTES.IV);
+}
+
+function pkcs7Unpad(data) {
+  if (data.length === 0) {
+    throw new Error('Cannot unpad empty data');
+  }
+  const paddingLen = data[data.length - 1];
+  if (paddingLen === 0 || paddingLen > data.length || paddingLen > BYTES.BLOCK) {
+    throw new Error('Invalid padding');
+  }
+  for (let i = data.length - paddingLen; i < data.length; i++) {
+    if (data[i] !== paddingLen) {
+      throw new Error('Invalid padding');
+    }
+  }
+  return data.subarray(0, data.length - paddingLen);
+}
+
+/**
+ * Expand a 64-byte key once and reuse the handle across calls
+ */
+export function expandKey(key) {
+  return native.expandKey(key);
+}
+
+function keyHandleFor(key) {
+  return key instanceof Uint8Array ? native.expandKey(key) : key;
+}
+
+function rawKey(key) {
+  if (!(key instanceof Uint8Array)) {
+    throw new Error('AEAD functions need the raw 64-byte key');
+  }
+  return key;
+}
+
+/**
+ * CTR Mode Encryption (native, runs on libuv's thread pool)
+ *
+ * @param plaintext - Data to encrypt
+ * @param key - 64-byte key or a handle from expandKey()
+ * @param nonce - Optional 16-byte nonce (auto-generated if not provided)
+ * @returns nonce || ciphertext
+ */
+export async function encryptCTR(plaintext, key, nonce) {
+  const actualNonce = nonce ?? randomBytes(BYTES.NONCE);
+  if (actualNonce.length !== BYTES.NONCE) {
+    throw new Error(`Nonce must be ${BYTES.NONCE} bytes`);
+  }
+
+  // Pad straight into the output buffer and encrypt it in place
+  const paddedLen = plaintext.length + (BYTES.BLOCK - (plaintext.length % BYTES.BLOCK));
+  const output = Buffer.allocUnsafe(BYTES.NONCE + paddedLen);
+  output.set(actualNonce, 0);
+  output.set(plaintext, BYTES.NONCE);
+  output.fill(paddedLen - plaintext.length, BYTES.NONCE + plaintext.length);
+
+  const body = output.subarray(BYTES.NONCE);
+  await native.encryptBlocks(keyHandleFor(key), deriveIV(actualNonce), 0, body, body);
+  return output;
+}
+
+/**
+ * CTR Mode Decryption
+ *
+ * @param ciphertext - nonce || ciphertext
+ * @param key - 64-byte key or a handle from expandKey()
+ */
+export async function decryptCTR(ciphertext, key) {
+  if (ciphertext.length < BYTES.NONCE + BYTES.BLOCK) {
+    throw new Error('Ciphertext too short');
+  }
+  const nonce = ciphertext.subarray(0, BYTES.NONCE);
+  const encryptedData = ciphertext.subarray(BYTES.NONCE);
+  if (encryptedData.length % BYTES.BLOCK !== 0) {
+    throw new Error('Invalid ciphertext length');
+  }
+
+  const padded = await native.decryptBlocks(keyHandleFor(key), deriveIV(nonce), 0, encryptedData);
+  return pkcs7Unpad(padded);
+}
+
+/**
+ * Simple encryption with auto-generated nonce (convenience function)
+ */
+export function encrypt(plaintext, key) {
+  return encryptCTR(plaintext, key);
+}
+
+/**
+ * Simple decryption (convenience function)
+ */
+export function decrypt(ciphertext, key) {
+  return decryptCTR(ciphertext, key);
+}
+
+function deriveKeys(masterKey) {
+  return {
+    encKey: shake256(Buffer.concat([masterKey, Buffer.from('RUC-AEAD-ENC')]), BYTES.KEY),
+    macKey: shake256(Buffer.concat([masterKey, Buffer.from('RUC-AEAD-MAC')]), 32),
+  };
+}
+
+// Tag over AD_length (8, big-endian) || AD || nonce || ciphertext
+function computeTag(macKey, ciphertext, associatedData) {
+  const adLenBytes = Buffer.alloc(8);
+  adLenBytes.writeBigUInt64BE(BigInt(associatedData?.length ?? 0));
+  const mac = createHmac('sha256', macKey).update(adLenBytes);
+  if (associatedData) mac.update(associatedData);
+  return mac.update(ciphertext).digest();
+}
+
+function toBytes(data) {
+  return typeof data === 'string' ? Buffer.from(data, 'utf8') : data;
+}
+
+/**
+ * AEAD Encrypt - Encrypt and authenticate data
+ *
+ * @returns nonce || ciphertext || tag
+ */
+export async function aeadEncrypt(plaintext, key, associatedData, nonce) {
+  const { encKey, macKey } = deriveKeys(rawKey(key));
+  const ciphertext = await encryptCTR(plaintext, encKey, nonce);
+  const tag = computeTag(macKey, ciphertext, associatedData);
+  return Buffer.concat([ciphertext, tag]);
+}
+
+/**
+ * AEAD Decrypt - Verify the tag, then decrypt
+ *
+ * @throws Error if authentication fails
+ */
+export async function aeadDecrypt(ciphertextWithTag, key, associatedData) {
+  if (ciphertextWithTag.length < BYTES.NONCE + BYTES.BLOCK + TAG_SIZE) {
+    throw new Error('Ciphertext too short');
+  }
+  const ciphertext = ciphertextWithTag.subarray(0, ciphertextWithTag.length - TAG_SIZE);
+  const providedTag = ciphertextWithTag.subarray(ciphertextWithTag.length - TAG_SIZE);
+
+  const { encKey, macKey } = deriveKeys(rawKey(key));
+  const expectedTag = computeTag(macKey, ciphertext, associatedData);
+  if (!timingSafeEqual(providedTag, expectedTag)) {
+    throw new Error('Authentication failed: invalid tag');
+  }
+  return decryptCTR(ciphertext, encKey);
+}
+
+/**
+ * AEAD Encrypt with string plaintext
+ */
+export function aeadEncryptString(plaintext, key, associatedData) {
+  return aeadEncrypt(toBytes(plaintext), key, associatedData && toBytes(associatedData));
+}
+
+/**
+ * AEAD Decrypt to string
+ */
+export async function aeadDecryptString(ciphertextWithTag, key, associatedData) {
+  const plaintext = await aeadDecrypt(ciphertextWithTag, key, associatedData && toBytes(associatedData));
+  return Buffer.from(plaintext.buffer, plaintext.byteOffset, plaintext.length).toString('utf8');
+}
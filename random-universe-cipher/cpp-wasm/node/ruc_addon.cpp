@@ -0,0 +1,427 @@
+// Node.js N-API binding to the native RUC engine
+//
+// Inputs are read straight from Buffer/TypedArray/ArrayBuffer memory (no
+// copies) and large batches are split into chunks that run on libuv's thread
+// pool. The wire-format envelope (nonce, IV derivation, padding, AEAD tag)
+// lives in index.mjs, mirroring src/cipher/modes-cpp-parallel.ts.
+
+#include <node_api.h>
+#include "ruc_cipher.h"
+#include "kernels.h"
+#include <atomic>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+
+// Smallest chunk handed to a pool thread (256 blocks = 8 KB)
+constexpr size_t MIN_CHUNK_BLOCKS = 256;
+
+#define NAPI_CALL(env, call)                                              \
+    do {                                                                  \
+        if ((call) != napi_ok) {                                          \
+            napi_throw_error((env), nullptr, "N-API call failed: " #call); \
+            return nullptr;                                               \
+        }                                                                 \
+    } while (0)
+
+// Expanded key material plus the raw key (needed for selector ordering)
+struct KeyHandle {
+    void* km;
+    uint8_t key[KEY_SIZE];
+};
+
+// Marks externals created by expandKey(), so an external from anywhere else
+// is rejected instead of being read as a KeyHandle
+static const napi_type_tag KEY_HANDLE_TAG = { 0x7275635f6b657968ULL, 0x8d1f5a3c62e94b07ULL };
+
+// Async batches with chunks still queued or running, across all envs
+static std::atomic<size_t> pending_batches(0);
+
+// One encrypt/decrypt request, shared by all of its chunks
+struct BatchJob {
+    napi_deferred deferred;
+    napi_ref handle_ref;
+    napi_ref input_ref;
+    napi_ref output_ref;
+    const KeyHandle* handle;
+    uint8_t iv[IV_SIZE];
+    const uint8_t* input;
+    uint8_t* output;
+    uint32_t start_block;
+    bool encrypt;
+    size_t pending_chunks;
+};
+
+struct ChunkWork {
+    BatchJob* job;
+    napi_async_work work;
+    size_t first_block;
+    size_t num_blocks;
+};
+
+static void finalize_key_handle(napi_env, void* data, void*) {
+    KeyHandle* handle = (KeyHandle*)data;
+    ruc_free_key_material(handle->km);
+    memset(handle->key, 0, KEY_SIZE);
+    delete handle;
+}
+
+// Resolve the backing memory of a Buffer, TypedArray, DataView or ArrayBuffer
+static bool get_bytes(napi_env env, napi_value value, uint8_t** data, size_t* length) {
+    bool is_type = false;
+    void* ptr = nullptr;
+
+    if (napi_is_typedarray(env, value, &is_type) == napi_ok && is_type) {
+        napi_typedarray_type type;
+        size_t element_count;
+        napi_value buffer;
+        size_t offset;
+        if (napi_get_typedarray_info(env, value, &type, &element_count, &ptr, &buffer, &offset) != napi_ok) return false;
+        size_t element_size = 1;
+        switch (type) {
+            case napi_int16_array: case napi_uint16_array: element_size = 2; break;
+            case napi_int32_array: case napi_uint32_array: case napi_float32_array: element_size = 4; break;
+            case napi_float64_array: case napi_bigint64_array: case napi_biguint64_array: element_size = 8; break;
+            default: break;
+        }
+        *data = (uint8_t*)ptr;
+        *length = element_count * element_size;
+        return true;
+    }
+    if (napi_is_dataview(env, value, &is_type) == napi_ok && is_type) {
+        napi_value buffer;
+        size_t offset;
+        if (napi_get_dataview_info(env, value, length, &ptr, &buffer, &offset) != napi_ok) return false;
+        *data = (uint8_t*)ptr;
+        return true;
+    }
+    if (napi_is_arraybuffer(env, value, &is_type) == napi_ok && is_type) {
+        if (napi_get_arraybuffer_info(env, value, &ptr, length) != napi_ok) return false;
+        *data = (uint8_t*)ptr;
+        return true;
+    }
+    return false;
+}
+
+static KeyHandle* get_key_handle(napi_env env, napi_value value) {
+    napi_valuetype type;
+    if (napi_typeof(env, value, &type) != napi_ok || type != napi_external) return nullptr;
+    bool tagged = false;
+    if (napi_check_object_type_tag(env, value, &KEY_HANDLE_TAG, &tagged) != napi_ok || !tagged) return nullptr;
+    void* data = nullptr;
+    if (napi_get_value_external(env, value, &data) != napi_ok) return nullptr;
+    return (KeyHandle*)data;
+}
+
+// expandKey(key: 64 bytes) -> KeyHandle
+static napi_value expand_key(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value argv[1];
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, argv, nullptr, nullptr));
+
+    uint8_t* key;
+    size_t key_len;
+    if (argc < 1 || !get_bytes(env, argv[0], &key, &key_len)) {
+        napi_throw_type_error(env, nullptr, "key must be a Buffer, TypedArray or ArrayBuffer");
+        return nullptr;
+    }
+    if (key_len != KEY_SIZE) {
+        napi_throw_range_error(env, nullptr, "key must be 64 bytes");
+        return nullptr;
+    }
+
+    KeyHandle* handle = new (std::nothrow) KeyHandle;
+    if (!handle) {
+        napi_throw_error(env, nullptr, "out of memory");
+        return nullptr;
+    }
+    memcpy(handle->key, key, KEY_SIZE);
+    handle->km = ruc_expand_key(handle->key);
+
+    napi_value result;
+    if (napi_create_external(env, handle, finalize_key_handle, nullptr, &result) != napi_ok) {
+        finalize_key_handle(env, handle, nullptr);
+        napi_throw_error(env, nullptr, "failed to create key handle");
+        return nullptr;
+    }
+    // The external owns the handle now; an untagged one is never accepted
+    NAPI_CALL(env, napi_type_tag_object(env, result, &KEY_HANDLE_TAG));
+    return result;
+}
+
+// Shared argument parsing: (handle, iv, startBlock, input[, output])
+struct BatchArgs {
+    napi_value handle_value;
+    napi_value input_value;
+    napi_value output_value;
+    KeyHandle* handle;
+    const uint8_t* iv;
+    uint32_t start_block;
+    uint8_t* input;
+    size_t length;
+    uint8_t* output;
+};
+
+static bool parse_batch_args(napi_env env, napi_callback_info info, BatchArgs* args) {
+    size_t argc = 5;
+    napi_value argv[5];
+    if (napi_get_cb_info(env, info, &argc, argv, nullptr, nullptr) != napi_ok || argc < 4) {
+        napi_throw_type_error(env, nullptr, "expected (keyHandle, iv, startBlock, input[, output])");
+        return false;
+    }
+
+    args->handle_value = argv[0];
+    args->handle = get_key_handle(env, argv[0]);
+    if (!args->handle) {
+        napi_throw_type_error(env, nullptr, "keyHandle must come from expandKey()");
+        return false;
+    }
+
+    uint8_t* iv;
+    size_t iv_len;
+    if (!get_bytes(env, argv[1], &iv, &iv_len) || iv_len != IV_SIZE) {
+        napi_throw_range_error(env, nullptr, "iv must be 32 bytes");
+        return false;
+    }
+    args->iv = iv;
+
+    if (napi_get_value_uint32(env, argv[2], &args->start_block) != napi_ok) {
+        napi_throw_type_error(env, nullptr, "startBlock must be a number");
+        return false;
+    }
+
+    args->input_value = argv[3];
+    if (!get_bytes(env, argv[3], &args->input, &args->length)) {
+        napi_throw_type_error(env, nullptr, "input must be a Buffer, TypedArray or ArrayBuffer");
+        return false;
+    }
+    if (args->length % BLOCK_SIZE != 0) {
+        napi_throw_range_error(env, nullptr, "input length must be a multiple of 32 bytes");
+        return false;
+    }
+
+    napi_valuetype output_type = napi_undefined;
+    if (argc >= 5) napi_typeof(env, argv[4], &output_type);
+    if (output_type != napi_undefined && output_type != napi_null) {
+        size_t output_len;
+        args->output_value = argv[4];
+        if (!get_bytes(env, argv[4], &args->output, &output_len) || output_len != args->length) {
+            napi_throw_range_error(env, nullptr, "output must be writable memory of the same length as input");
+            return false;
+        }
+    } else {
+        void* data = nullptr;
+        if (napi_create_buffer(env, args->length, &data, &args->output_value) != napi_ok) {
+            napi_throw_error(env, nullptr, "failed to allocate output buffer");
+            return false;
+        }
+        args->output = (uint8_t*)data;
+    }
+    return true;
+}
+
+static void run_batch(bool encrypt, const KeyHandle* handle, const uint8_t* iv, uint32_t start_block,
+                      const uint8_t* input, size_t num_blocks, uint8_t* output) {
+    if (encrypt) {
+        ruc_encrypt_blocks_batch(input, num_blocks, handle->key, iv, start_block, handle->km, output);
+    } else {
+        ruc_decrypt_blocks_batch(input, num_blocks, handle->key, iv, start_block, handle->km, output);
+    }
+}
+
+static napi_value process_sync(napi_env env, napi_callback_info info, bool encrypt) {
+    BatchArgs args;
+    if (!parse_batch_args(env, info, &args)) return nullptr;
+    run_batch(encrypt, args.handle, args.iv, args.start_block, args.input, args.length / BLOCK_SIZE, args.output);
+    return args.output_value;
+}
+
+static void execute_chunk(napi_env, void* data) {
+    ChunkWork* chunk = (ChunkWork*)data;
+    BatchJob* job = chunk->job;
+    run_batch(job->encrypt, job->handle, job->iv, job->start_block + (uint32_t)chunk->first_block,
+              job->input + chunk->first_block * BLOCK_SIZE, chunk->num_blocks,
+              job->output + chunk->first_block * BLOCK_SIZE);
+}
+
+static void release_job(napi_env env, BatchJob* job) {
+    napi_delete_reference(env, job->handle_ref);
+    napi_delete_reference(env, job->input_ref);
+    napi_delete_reference(env, job->output_ref);
+    delete job;
+    pending_batches.fetch_sub(1);
+}
+
+// Runs on the JS thread once a chunk finishes; the last one settles the promise
+static void complete_chunk(napi_env env, napi_status status, void* data) {
+    ChunkWork* chunk = (ChunkWork*)data;
+    BatchJob* job = chunk->job;
+    napi_delete_async_work(env, chunk->work);
+    delete chunk;
+
+    if (--job->pending_chunks > 0) return;
+
+    napi_value output;
+    if (status == napi_ok && napi_get_reference_value(env, job->output_ref, &output) == napi_ok) {
+        napi_resolve_deferred(env, job->deferred, output);
+    } else {
+        napi_value message, error;
+        napi_create_string_utf8(env, "native batch failed or was cancelled", NAPI_AUTO_LENGTH, &message);
+        napi_create_error(env, nullptr, message, &error);
+        napi_reject_deferred(env, job->deferred, error);
+    }
+    release_job(env, job);
+}
+
+// Number of pool threads to spread a batch over (libuv default is 4)
+static size_t pool_threads() {
+    const char* env_size = getenv("UV_THREADPOOL_SIZE");
+    long threads = env_size ? strtol(env_size, nullptr, 10) : 4;
+    return threads > 0 ? (size_t)threads : 4;
+}
+
+static napi_value process_async(napi_env env, napi_callback_info info, bool encrypt) {
+    BatchArgs args;
+    if (!parse_batch_args(env, info, &args)) return nullptr;
+
+    napi_value resource_name;
+    NAPI_CALL(env, napi_create_string_utf8(env, "ruc_native_batch", NAPI_AUTO_LENGTH, &resource_name));
+
+    BatchJob* job = new (std::nothrow) BatchJob();
+    if (!job) {
+        napi_throw_error(env, nullptr, "out of memory");
+        return nullptr;
+    }
+    napi_value promise;
+    if (napi_create_promise(env, &job->deferred, &promise) != napi_ok) {
+        delete job;
+        napi_throw_error(env, nullptr, "failed to create promise");
+        return nullptr;
+    }
+    pending_batches.fetch_add(1);  // Dropped by release_job
+    napi_create_reference(env, args.handle_value, 1, &job->handle_ref);
+    napi_create_reference(env, args.input_value, 1, &job->input_ref);
+    napi_create_reference(env, args.output_value, 1, &job->output_ref);
+    job->handle = args.handle;
+    memcpy(job->iv, args.iv, IV_SIZE);
+    job->input = args.input;
+    job->output = args.output;
+    job->start_block = args.start_block;
+    job->encrypt = encrypt;
+
+    size_t num_blocks = args.length / BLOCK_SIZE;
+    size_t chunk_blocks = (num_blocks + pool_threads() - 1) / pool_threads();
+    if (chunk_blocks < MIN_CHUNK_BLOCKS) chunk_blocks = MIN_CHUNK_BLOCKS;
+    size_t num_chunks = num_blocks == 0 ? 0 : (num_blocks + chunk_blocks - 1) / chunk_blocks;
+
+    if (num_chunks == 0) {
+        napi_value output;
+        napi_get_reference_value(env, job->output_ref, &output);
+        napi_resolve_deferred(env, job->deferred, output);
+        release_job(env, job);
+        return promise;
+    }
+
+    // Count every chunk up front so an early completion cannot settle the job
+    job->pending_chunks = num_chunks;
+    for (size_t c = 0; c < num_chunks; c++) {
+        ChunkWork* chunk = new ChunkWork();
+        chunk->job = job;
+        chunk->first_block = c * chunk_blocks;
+        chunk->num_blocks = (c + 1 == num_chunks) ? num_blocks - chunk->first_block : chunk_blocks;
+        napi_create_async_work(env, nullptr, resource_name, execute_chunk, complete_chunk, chunk, &chunk->work);
+        napi_queue_async_work(env, chunk->work);
+    }
+    return promise;
+}
+
+static napi_value encrypt_blocks(napi_env env, napi_callback_info info) { return process_async(env, info, true); }
+static napi_value decrypt_blocks(napi_env env, napi_callback_info info) { return process_async(env, info, false); }
+static napi_value encrypt_blocks_sync(napi_env env, napi_callback_info info) { return process_sync(env, info, true); }
+static napi_value decrypt_blocks_sync(napi_env env, napi_callback_info info) { return process_sync(env, info, false); }
+
+// kernels() -> { keccak_f: "unrolled", ... } (active kernel per primitive)
+static napi_value active_kernels(napi_env env, napi_callback_info) {
+    napi_value result;
+    NAPI_CALL(env, napi_create_object(env, &result));
+    for (int p = 0; p < RUC_PRIM_COUNT; p++) {
+        napi_value name;
+        NAPI_CALL(env, napi_create_string_utf8(env, ruc_kernel_active(p), NAPI_AUTO_LENGTH, &name));
+        NAPI_CALL(env, napi_set_named_property(env, result, ruc_kernel_primitive_name(p), name));
+    }
+    return result;
+}
+
+// kernelNames() -> { keccak_f: ["unrolled", ...], ... } (registered kernels per primitive)
+static napi_value kernel_names(napi_env env, napi_callback_info) {
+    napi_value result;
+    NAPI_CALL(env, napi_create_object(env, &result));
+    for (int p = 0; p < RUC_PRIM_COUNT; p++) {
+        napi_value names;
+        size_t count = ruc_kernel_count(p);
+        NAPI_CALL(env, napi_create_array_with_length(env, count, &names));
+        for (size_t i = 0; i < count; i++) {
+            napi_value name;
+            NAPI_CALL(env, napi_create_string_utf8(env, ruc_kernel_name(p, i), NAPI_AUTO_LENGTH, &name));
+            NAPI_CALL(env, napi_set_element(env, names, (uint32_t)i, name));
+        }
+        NAPI_CALL(env, napi_set_named_property(env, result, ruc_kernel_primitive_name(p), names));
+    }
+    return result;
+}
+
+// forceKernel(primitive: string, name: string) -> RUC_KERNEL_* status (0 = ok).
+// Throws while async batches are running, so chunks of one batch never see
+// two different kernels
+static napi_value force_kernel(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value argv[2];
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, argv, nullptr, nullptr));
+    char primitive[64], name[64];
+    size_t len;
+    if (argc < 2 || napi_get_value_string_utf8(env, argv[0], primitive, sizeof(primitive), &len) != napi_ok ||
+        napi_get_value_string_utf8(env, argv[1], name, sizeof(name), &len) != napi_ok) {
+        napi_throw_type_error(env, nullptr, "forceKernel(primitive, name) takes two strings");
+        return nullptr;
+    }
+    if (pending_batches.load() > 0) {
+        napi_throw_error(env, "ERR_RUC_BUSY", "forceKernel cannot run while encryptBlocks/decryptBlocks calls are pending");
+        return nullptr;
+    }
+    int p = 0;
+    while (p < RUC_PRIM_COUNT && strcmp(ruc_kernel_primitive_name(p), primitive) != 0) p++;
+    if (p == RUC_PRIM_COUNT) {
+        napi_throw_range_error(env, nullptr, "unknown kernel primitive");
+        return nullptr;
+    }
+    napi_value result;
+    NAPI_CALL(env, napi_create_int32(env, ruc_kernel_force(p, name), &result));
+    return result;
+}
+
+// Constant-time engine (ruc_encrypt_blocks_ct); same arguments as encryptBlocksSync
+static napi_value encrypt_blocks_ct_sync(napi_env env, napi_callback_info info) {
+    BatchArgs args;
+    if (!parse_batch_args(env, info, &args)) return nullptr;
+    ruc_encrypt_blocks_ct(args.input, args.length / BLOCK_SIZE, args.handle->key, args.iv, args.start_block,
+                          args.handle->km, args.output);
+    return args.output_value;
+}
+
+static napi_value init(napi_env env, napi_value exports) {
+    napi_property_descriptor props[] = {
+        { "expandKey", nullptr, expand_key, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "encryptBlocks", nullptr, encrypt_blocks, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "decryptBlocks", nullptr, decrypt_blocks, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "encryptBlocksSync", nullptr, encrypt_blocks_sync, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "decryptBlocksSync", nullptr, decrypt_blocks_sync, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "kernels", nullptr, active_kernels, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "kernelNames", nullptr, kernel_names, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "forceKernel", nullptr, force_kernel, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "encryptBlocksCtSync", nullptr, encrypt_blocks_ct_sync, nullptr, nullptr, nullptr, napi_default, nullptr },
+    };
+    NAPI_CALL(env, napi_define_properties(env, exports, sizeof(props) / sizeof(props[0]), props));
+    return exports;
+}
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, init)
@@ -0,0 +1,107 @@
+#include "bitslice.h"
+#include "kernels.h"
+#include "ruc_engine.h"
+#include "ruc_metrics.h"
+#include <cstring>
+#include <vector>
+#include "bitslice_impl.h"
+
+// Constant-time batch engine: per-block setup (counter hash, selector
+// ordering, keystream) stays scalar - SHAKE256 and ChaCha20 are already free
+// of secret-dependent branches and lookups - while the rounds run through the
+// active rounds_batch kernel. The registry only lets constant-time kernels
+// (the bitsliced ones) into that slot, whatever is forced or autotuned.
+
+constexpr size_t CT_GROUP_BLOCKS = 256;
+
+void rounds_batch_ref(
+    CipherState* states,
+    size_t count,
+    int first_round,
+    int num_rounds,
+    const uint16_t* ordered_selectors,
+    const size_t* selector_indices,
+    const KeyMaterial* km
+) {
+    for (size_t s = 0; s < count; s++) {
+        for (int r = first_round; r < first_round + num_rounds; r++) {
+            execute_round_ref(&states[s], r, ordered_selectors + s * MAX_SELECTORS,
+                              selector_indices + s * MAX_SELECTORS, km->num_selectors, km);
+        }
+    }
+}
+
+void rounds_batch_bs64(
+    CipherState* states,
+    size_t count,
+    int first_round,
+    int num_rounds,
+    const uint16_t* ordered_selectors,
+    const size_t* selector_indices,
+    const KeyMaterial* km
+) {
+    bs_rounds_batch<uint64_t>(states, count, first_round, num_rounds, ordered_selectors, selector_indices, km);
+}
+
+void ruc_encrypt_blocks_ct(
+    const uint8_t* plaintext_blocks,
+    size_t num_blocks,
+    const uint8_t* key,
+    const uint8_t* iv,
+    uint32_t start_block_number,
+    void* key_material,
+    uint8_t* ciphertext_blocks
+) {
+    RucCallTimer timer(RUC_OP_ENCRYPT_CT, (uint64_t)num_blocks * BLOCK_SIZE);
+    const KeyMaterial* km = (const KeyMaterial*)key_material;
+    uint8_t iv_expanded[REGISTER_SIZE];
+    ruc_expand_iv(iv, iv_expanded);
+
+    size_t group = num_blocks < CT_GROUP_BLOCKS ? num_blocks : CT_GROUP_BLOCKS;
+    std::vector<CipherState> states(group);
+    std::vector<uint16_t> ordered(group * MAX_SELECTORS);
+    std::vector<size_t> indices(group * MAX_SELECTORS);
+    const rounds_batch_fn rounds_batch = ruc_kernels().rounds_batch;
+
+    for (size_t base = 0; base < num_blocks; base += group) {
+        size_t count = num_blocks - base < group ? num_blocks - base : group;
+        for (size_t i = 0; i < count; i++) {
+            uint32_t block_number = start_block_number + (uint32_t)(base + i);
+            ruc_init_block_state(km, iv_expanded, block_number, &states[i]);
+            ruc_order_selectors_ct(km, key, iv, block_number,
+                                   &ordered[i * MAX_SELECTORS], &indices[i * MAX_SELECTORS]);
+        }
+
+        rounds_batch(states.data(), count, 0, ROUNDS, ordered.data(), indices.data(), km);
+
+        for (size_t i = 0; i < count; i++) {
+            uint8_t keystream[BLOCK_SIZE];
+            ruc_block_keystream(&states[i], start_block_number + (uint32_t)(base + i), keystream);
+            const uint8_t* in = plaintext_blocks + (base + i) * BLOCK_SIZE;
+            uint8_t* out = ciphertext_blocks + (base + i) * BLOCK_SIZE;
+            for (size_t j = 0; j < BLOCK_SIZE; j++) {
+                out[j] = in[j] ^ keystream[j];
+            }
+            memset(keystream, 0, sizeof(keystream));
+        }
+    }
+
+    // Block states and selector orderings are key-derived; wipe before release
+    memset(states.data(), 0, states.size() * sizeof(CipherState));
+    memset(ordered.data(), 0, ordered.size() * sizeof(uint16_t));
+    memset(indices.data(), 0, indices.size() * sizeof(size_t));
+}
+
+// Decryption is the same keystream XOR
+void ruc_decrypt_blocks_ct(
+    const uint8_t* ciphertext_blocks,
+    size_t num_blocks,
+    const uint8_t* key,
+    const uint8_t* iv,
+    uint32_t start_block_number,
+    void* key_material,
+    uint8_t* plaintext_blocks
+) {
+    RucCallTimer timer(RUC_OP_DECRYPT_CT, (uint64_t)num_blocks * BLOCK_SIZE);
+    ruc_encrypt_blocks_ct(ciphertext_blocks, num_blocks, key, iv, start_block_number, key_material, plaintext_blocks);
+}
@@ -0,0 +1,36 @@
+#ifndef BITSLICE_H
+#define BITSLICE_H
+
+#include "ruc_cipher.h"
+#include <cstdint>
+#include <cstddef>
+
+// Bitsliced rounds_batch kernels (see kernels.h). Each processes independent
+// block states in lane groups - 64 per uint64_t word, 256 per AVX2 word - with
+// data-independent logic only: GF multiplies, S-box lookups and register
+// selection are evaluated as AND/XOR networks over bit planes, so timing and
+// memory addresses do not depend on state, selectors or key material.
+
+void rounds_batch_bs64(
+    CipherState* states,
+    size_t count,
+    int first_round,
+    int num_rounds,
+    const uint16_t* ordered_selectors,
+    const size_t* selector_indices,
+    const KeyMaterial* km
+);
+
+#if defined(__x86_64__) || defined(__i386__)
+void rounds_batch_bs256_avx2(
+    CipherState* states,
+    size_t count,
+    int first_round,
+    int num_rounds,
+    const uint16_t* ordered_selectors,
+    const size_t* selector_indices,
+    const KeyMaterial* km
+);
+#endif
+
+#endif // BITSLICE_H
@@ -0,0 +1,30 @@
+#include "bitslice.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// 256-lane instantiation of the bitsliced engine. The target pragma comes
+// after every standard header so only the engine itself is compiled for AVX2;
+// the kernel is registered with RUC_CPU_AVX2 and never runs without it.
+#pragma GCC push_options
+#pragma GCC target("avx2")
+
+typedef uint64_t bs_u64x4 __attribute__((vector_size(32)));
+
+#include "bitslice_impl.h"
+
+void rounds_batch_bs256_avx2(
+    CipherState* states,
+    size_t count,
+    int first_round,
+    int num_rounds,
+    const uint16_t* ordered_selectors,
+    const size_t* selector_indices,
+    const KeyMaterial* km
+) {
+    bs_rounds_batch<bs_u64x4>(states, count, first_round, num_rounds, ordered_selectors, selector_indices, km);
+}
+
+#pragma GCC pop_options
+
+#endif
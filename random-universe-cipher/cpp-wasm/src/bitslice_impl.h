@@ -0,0 +1,357 @@
+#ifndef BITSLICE_IMPL_H
+#define BITSLICE_IMPL_H
+
+// Bitsliced round engine, instantiated once per slice word type W (uint64_t
+// in bitslice.cpp, a 256-bit vector in bitslice_avx2.cpp). Lane n of a word is
+// one block state; bit b of byte i of register k for all lanes is one word.
+//
+// Only included by those two files, after their standard headers (and after
+// the AVX2 target pragma), so everything here has internal linkage.
+
+namespace {
+
+constexpr int BS_ACC_BITS = 20;  // ROUNDS * MAX_SELECTORS * 255 < 2^20
+
+template <typename W>
+inline W bs_fill(uint64_t v) {
+    return W{} ^ v;
+}
+
+template <typename W>
+inline W bs_mask(uint32_t bit) {
+    return bs_fill<W>(0 - (uint64_t)bit);
+}
+
+template <typename W>
+inline uint64_t bs_get_word(const W& w, size_t g) {
+    uint64_t v;
+    memcpy(&v, (const uint64_t*)&w + g, sizeof(v));
+    return v;
+}
+
+template <typename W>
+inline void bs_set_word(W& w, size_t g, uint64_t v) {
+    memcpy((uint64_t*)&w + g, &v, sizeof(v));
+}
+
+// 64x64 bit-matrix transpose: bit j of a[i] <-> bit i of a[j]
+inline void bs_transpose64(uint64_t a[64]) {
+    uint64_t m = 0x00000000FFFFFFFFULL;
+    for (int j = 32; j != 0; j >>= 1, m ^= (m << j)) {
+        for (int k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+            uint64_t t = ((a[k] >> j) ^ a[k | j]) & m;
+            a[k] ^= t << j;
+            a[k | j] ^= t;
+        }
+    }
+}
+
+// True GF(2^8) product mod x^8 + x^4 + x^3 + x + 1
+template <typename W>
+inline void bs_gf_mul(const W* a, const W* b, W* out) {
+    W p[15];
+    for (int k = 0; k < 15; k++) p[k] = W{};
+    for (int i = 0; i < 8; i++) {
+        for (int j = 0; j < 8; j++) {
+            p[i + j] ^= a[i] & b[j];
+        }
+    }
+    for (int k = 14; k >= 8; k--) {
+        p[k - 4] ^= p[k];
+        p[k - 5] ^= p[k];
+        p[k - 7] ^= p[k];
+        p[k - 8] ^= p[k];
+    }
+    for (int k = 0; k < 8; k++) out[k] = p[k];
+}
+
+// x^16 (Frobenius, linear)
+template <typename W>
+inline void bs_gf_pow16(const W* a, W* out) {
+    out[0] = a[0] ^ a[4] ^ a[5] ^ a[6];
+    out[1] = a[1];
+    out[2] = a[1] ^ a[2] ^ a[4] ^ a[6] ^ a[7];
+    out[3] = a[1] ^ a[3] ^ a[4] ^ a[6] ^ a[7];
+    out[4] = a[1] ^ a[5] ^ a[6];
+    out[5] = a[2] ^ a[3] ^ a[7];
+    out[6] = a[1] ^ a[2] ^ a[3] ^ a[4] ^ a[7];
+    out[7] = a[2] ^ a[3] ^ a[5];
+}
+
+// gf_mul() only spans the 51-element subgroup generated by 2 and folds every
+// other non-zero input to 1 (see gf_math.cpp). Members are the x with
+// x^51 == 1, i.e. whose norm x^17 (an element of GF(16)) is a cube root of
+// unity: 0x01, 0xBD or 0xBC.
+template <typename W>
+inline void bs_gf_fold(const W* x, W* out) {
+    W x16[8], norm[8];
+    bs_gf_pow16(x, x16);
+    bs_gf_mul(x, x16, norm);
+    W high = norm[7] & ~norm[6] & norm[5] & norm[4] & norm[3] & norm[2] & ~norm[1];    // 0xBD, 0xBC
+    W one = ~(norm[7] | norm[6] | norm[5] | norm[4] | norm[3] | norm[2] | norm[1]) & norm[0];
+    W member = high | one;
+    W nonzero = x[0] | x[1] | x[2] | x[3] | x[4] | x[5] | x[6] | x[7];
+
+    out[0] = (x[0] & member) | (nonzero & ~member);
+    for (int b = 1; b < 8; b++) out[b] = x[b] & member;
+}
+
+// gf_mul(a, b) of this engine
+template <typename W>
+inline void bs_gf_mul_folded(const W* a, const W* b, W* out) {
+    W fa[8], fb[8];
+    bs_gf_fold(a, fa);
+    bs_gf_fold(b, fb);
+    bs_gf_mul(fa, fb, out);
+}
+
+// S-box lookup evaluated over all 256 entries: one-hot decode of x, then each
+// output bit is the XOR of the decoded lanes whose entry has that bit set
+template <typename W>
+inline void bs_sbox(const uint8_t* sbox, const W* x, W* out) {
+    W dec[256];
+    dec[0] = ~x[0];
+    dec[1] = x[0];
+    for (int b = 1; b < 8; b++) {
+        int n = 1 << b;
+        for (int v = 0; v < n; v++) {
+            dec[v + n] = dec[v] & x[b];
+            dec[v] &= ~x[b];
+        }
+    }
+    for (int j = 0; j < 8; j++) out[j] = W{};
+    for (int v = 0; v < 256; v++) {
+        uint32_t entry = sbox[v];
+        for (int j = 0; j < 8; j++) {
+            out[j] ^= dec[v] & bs_mask<W>((entry >> j) & 1);
+        }
+    }
+}
+
+template <typename W>
+struct BitsliceState {
+    W reg[REGISTER_COUNT][REGISTER_SIZE][8];
+    W sel[MAX_SELECTORS][16];        // Ordered selector per step
+    W key_const[MAX_SELECTORS][8];   // key_constants[selector_indices[step]]
+    W acc[BS_ACC_BITS];              // Sum of round results (added to accumulator at the end)
+    W selected[REGISTER_SIZE][8];    // Selected register before the step
+    W next[REGISTER_SIZE][8];        // New value of the selected register
+};
+
+template <typename W>
+void bs_load(BitsliceState<W>* bs, const CipherState* states, size_t count,
+             const uint16_t* ordered, const size_t* indices, const KeyMaterial* km) {
+    constexpr size_t WORDS = sizeof(W) / sizeof(uint64_t);
+    const size_t n = km->num_selectors;
+    uint64_t rows[64];
+
+    for (size_t g = 0; g < WORDS; g++) {
+        for (size_t c = 0; c < REGISTER_COUNT * REGISTER_SIZE / 8; c++) {
+            for (size_t i = 0; i < 64; i++) {
+                size_t lane = g * 64 + i;
+                rows[i] = 0;
+                if (lane < count) memcpy(&rows[i], &states[lane].registers[0][0] + c * 8, 8);
+            }
+            bs_transpose64(rows);
+            for (size_t q = 0; q < 8; q++) {
+                size_t byte = c * 8 + q;
+                for (int b = 0; b < 8; b++) {
+                    bs_set_word(bs->reg[byte / REGISTER_SIZE][byte % REGISTER_SIZE][b], g, rows[q * 8 + b]);
+                }
+            }
+        }
+
+        // Per-step selector and key constant (masked scan instead of an indexed load)
+        for (size_t pos = 0; pos < n; pos++) {
+            uint64_t sel_bits[16] = {0};
+            uint64_t const_bits[8] = {0};
+            for (size_t i = 0; i < 64 && g * 64 + i < count; i++) {
+                size_t lane = g * 64 + i;
+                uint32_t sel = ordered[lane * MAX_SELECTORS + pos];
+                size_t index = indices[lane * MAX_SELECTORS + pos];
+                uint32_t key_const = 0;
+                for (size_t t = 0; t < n; t++) {
+                    key_const |= km->key_constants[t] & (0 - (uint32_t)(t == index));
+                }
+                for (int b = 0; b < 16; b++) sel_bits[b] |= (uint64_t)((sel >> b) & 1) << i;
+                for (int b = 0; b < 8; b++) const_bits[b] |= (uint64_t)((key_const >> b) & 1) << i;
+            }
+            for (int b = 0; b < 16; b++) bs_set_word(bs->sel[pos][b], g, sel_bits[b]);
+            for (int b = 0; b < 8; b++) bs_set_word(bs->key_const[pos][b], g, const_bits[b]);
+        }
+    }
+    for (int b = 0; b < BS_ACC_BITS; b++) bs->acc[b] = W{};
+}
+
+template <typename W>
+void bs_store(const BitsliceState<W>* bs, CipherState* states, size_t count) {
+    constexpr size_t WORDS = sizeof(W) / sizeof(uint64_t);
+    uint64_t rows[64];
+
+    for (size_t g = 0; g < WORDS && g * 64 < count; g++) {
+        for (size_t c = 0; c < REGISTER_COUNT * REGISTER_SIZE / 8; c++) {
+            for (size_t q = 0; q < 8; q++) {
+                size_t byte = c * 8 + q;
+                for (int b = 0; b < 8; b++) {
+                    rows[q * 8 + b] = bs_get_word(bs->reg[byte / REGISTER_SIZE][byte % REGISTER_SIZE][b], g);
+                }
+            }
+            bs_transpose64(rows);
+            for (size_t i = 0; i < 64 && g * 64 + i < count; i++) {
+                memcpy(&states[g * 64 + i].registers[0][0] + c * 8, &rows[i], 8);
+            }
+        }
+
+        for (size_t i = 0; i < 64 && g * 64 + i < count; i++) {
+            uint64_t sum = 0;
+            for (int b = 0; b < BS_ACC_BITS; b++) {
+                sum |= ((bs_get_word(bs->acc[b], g) >> i) & 1) << b;
+            }
+            uint64_t acc;
+            memcpy(&acc, states[g * 64 + i].accumulator, sizeof(acc));
+            acc += sum;
+            memcpy(states[g * 64 + i].accumulator, &acc, sizeof(acc));
+        }
+    }
+}
+
+// One selector step of execute_round_ref for every lane
+template <typename W>
+inline void bs_step(BitsliceState<W>* bs, size_t pos, const uint8_t* sbox, const W* rk) {
+    W (*reg)[REGISTER_SIZE][8] = bs->reg;
+    const W* sel = bs->sel[pos];
+
+    // Destination register as a one-hot residue of
+    // (low 32 bits of R[0] ^ selector ^ round key) mod 7, MSB first: r = 2r + bit
+    W place[REGISTER_COUNT];
+    place[0] = ~W{};
+    for (size_t k = 1; k < REGISTER_COUNT; k++) place[k] = W{};
+    for (int j = 31; j >= 0; j--) {
+        W bit = reg[0][j >> 3][j & 7] ^ rk[j];
+        if (j < 16) bit ^= sel[j];
+        W doubled[REGISTER_COUNT];
+        for (size_t k = 0; k < REGISTER_COUNT; k++) doubled[(2 * k) % REGISTER_COUNT] = place[k];
+        for (size_t k = 0; k < REGISTER_COUNT; k++) {
+            W from = doubled[(k + REGISTER_COUNT - 1) % REGISTER_COUNT];
+            place[k] = doubled[k] ^ ((doubled[k] ^ from) & bit);
+        }
+    }
+
+    // result = sbox[gf_mul(selector * 2, R[place][0]) ^ key_const]
+    W state_byte[8], temp[8], gf_result[8], result[8];
+    for (int b = 0; b < 8; b++) {
+        state_byte[b] = W{};
+        for (size_t k = 0; k < REGISTER_COUNT; k++) state_byte[b] ^= place[k] & reg[k][0][b];
+    }
+    temp[0] = W{};
+    for (int b = 1; b < 8; b++) temp[b] = sel[b - 1];
+    bs_gf_mul_folded(temp, state_byte, gf_result);
+    for (int b = 0; b < 8; b++) gf_result[b] ^= bs->key_const[pos][b];
+    bs_sbox(sbox, gf_result, result);
+
+    // GF multiply each byte of the selected register by result
+    W folded_result[8];
+    bs_gf_fold(result, folded_result);
+    for (size_t i = 0; i < REGISTER_SIZE; i++) {
+        W* selected = bs->selected[i];
+        W folded[8];
+        for (int b = 0; b < 8; b++) {
+            selected[b] = W{};
+            for (size_t k = 0; k < REGISTER_COUNT; k++) selected[b] ^= place[k] & reg[k][i][b];
+        }
+        bs_gf_fold(selected, folded);
+        bs_gf_mul(folded, folded_result, bs->next[i]);
+    }
+    W (*next)[8] = bs->next;
+
+    // reg[0] ^= result << (selector % 16) when the shift is below 8
+    for (int shift = 0; shift < 8; shift++) {
+        W match = ~sel[3];
+        match &= (shift & 1) ? sel[0] : ~sel[0];
+        match &= (shift & 2) ? sel[1] : ~sel[1];
+        match &= (shift & 4) ? sel[2] : ~sel[2];
+        for (int b = shift; b < 8; b++) next[0][b] ^= match & result[b - shift];
+    }
+
+    // S-box on the low byte
+    W low[8];
+    bs_sbox(sbox, next[REGISTER_SIZE - 1], low);
+    for (int b = 0; b < 8; b++) next[REGISTER_SIZE - 1][b] ^= low[b];
+
+    // Rotate by one bit, mix the adjacent register, write back into the selected one
+    W first_bit = next[0][0];
+    for (size_t i = 0; i < REGISTER_SIZE; i++) {
+        W value[8];
+        for (int b = 0; b < 7; b++) value[b] = next[i][b + 1];
+        value[7] = i + 1 < REGISTER_SIZE ? next[i + 1][0] : first_bit;
+        for (int b = 0; b < 8; b++) {
+            for (size_t k = 0; k < REGISTER_COUNT; k++) {
+                value[b] ^= place[k] & reg[(k + 1) % REGISTER_COUNT][i][b];
+            }
+            // Only the selected register changes, and it held selected[i]
+            W delta = bs->selected[i][b] ^ value[b];
+            for (size_t k = 0; k < REGISTER_COUNT; k++) reg[k][i][b] ^= place[k] & delta;
+        }
+    }
+
+    // Accumulate result (ripple-carry add into the bitsliced sum)
+    W carry = W{};
+    for (int b = 0; b < BS_ACC_BITS; b++) {
+        W addend = b < 8 ? result[b] : W{};
+        W sum = bs->acc[b] ^ addend;
+        W next_carry = (bs->acc[b] & addend) | (carry & sum);
+        bs->acc[b] = sum ^ carry;
+        carry = next_carry;
+    }
+}
+
+template <typename W>
+void bs_rounds(BitsliceState<W>* bs, int first_round, int num_rounds, const KeyMaterial* km) {
+    for (int r = first_round; r < first_round + num_rounds; r++) {
+        const uint8_t* round_key = km->round_keys[r];
+        W rk[32];
+        for (int j = 0; j < 32; j++) rk[j] = bs_mask<W>((round_key[j >> 3] >> (j & 7)) & 1);
+
+        for (size_t pos = 0; pos < km->num_selectors; pos++) {
+            bs_step(bs, pos, km->sboxes[r], rk);
+        }
+
+        // Inter-round state mixing
+        for (size_t i = 0; i < REGISTER_COUNT; i++) {
+            W (*dst)[8] = bs->reg[i];
+            W (*a)[8] = bs->reg[(i + 1) % REGISTER_COUNT];
+            W (*b)[8] = bs->reg[(i + 2) % REGISTER_COUNT];
+            for (size_t j = 0; j < REGISTER_SIZE; j++) {
+                for (int bit = 0; bit < 8; bit++) dst[j][bit] ^= a[j][bit] ^ b[j][bit];
+            }
+        }
+    }
+}
+
+template <typename W>
+void bs_rounds_batch(
+    CipherState* states,
+    size_t count,
+    int first_round,
+    int num_rounds,
+    const uint16_t* ordered_selectors,
+    const size_t* selector_indices,
+    const KeyMaterial* km
+) {
+    constexpr size_t LANES = sizeof(W) * 8;
+    BitsliceState<W>* bs = new BitsliceState<W>;
+    for (size_t base = 0; base < count; base += LANES) {
+        size_t lanes = count - base < LANES ? count - base : LANES;
+        bs_load(bs, states + base, lanes, ordered_selectors + base * MAX_SELECTORS,
+                selector_indices + base * MAX_SELECTORS, km);
+        bs_rounds(bs, first_round, num_rounds, km);
+        bs_store(bs, states + base, lanes);
+    }
+    // The slices hold key-derived round state
+    memset(bs, 0, sizeof(*bs));
+    delete bs;
+}
+
+}  // namespace
+
+#endif // BITSLICE_IMPL_H
@@ -1,5 +1,9 @@
 #include "chacha20.h"
+#include "kernels.h"
 #include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 static const uint32_t CHACHA_CONSTANTS[4] = {
     0x61707865, 0x3320646e, 0x79622d32, 0x6b206574
@@ -23,7 +27,7 @@ static void quarter_round(uint32_t* state, int a, int b, int c, int d) {
     state[b] = rotl32(state[b] ^ state[c], 7);
 }
 
-static void chacha_block(const uint8_t* key, const uint8_t* nonce, uint32_t counter, uint8_t* output) {
+void chacha20_block_scalar(const uint8_t* key, const uint8_t* nonce, uint32_t counter, uint8_t* output) {
     uint32_t state[16];
     
     // Constants
@@ -73,6 +77,48 @@ static void chacha_block(const uint8_t* key, const uint8_t* nonce, uint32_t coun
     memcpy(output, working, 64);
 }
 
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("sse2")))
+static inline __m128i rotl32_x4(__m128i v, int n) {
+    return _mm_or_si128(_mm_slli_epi32(v, n), _mm_srli_epi32(v, 32 - n));
+}
+
+// Row-vectorized block: one SSE register per state row, diagonals via lane shuffles
+__attribute__((target("sse2")))
+void chacha20_block_sse2(const uint8_t* key, const uint8_t* nonce, uint32_t counter, uint8_t* output) {
+    uint32_t nonce_words[3];
+    memcpy(nonce_words, nonce, 12);
+    
+    const __m128i a0 = _mm_loadu_si128((const __m128i*)CHACHA_CONSTANTS);
+    const __m128i b0 = _mm_loadu_si128((const __m128i*)key);
+    const __m128i c0 = _mm_loadu_si128((const __m128i*)(key + 16));
+    const __m128i d0 = _mm_set_epi32((int)nonce_words[2], (int)nonce_words[1], (int)nonce_words[0], (int)counter);
+    __m128i a = a0, b = b0, c = c0, d = d0;
+    
+    for (int i = 0; i < 10; i++) {
+        // Column round
+        a = _mm_add_epi32(a, b); d = rotl32_x4(_mm_xor_si128(d, a), 16);
+        c = _mm_add_epi32(c, d); b = rotl32_x4(_mm_xor_si128(b, c), 12);
+        a = _mm_add_epi32(a, b); d = rotl32_x4(_mm_xor_si128(d, a), 8);
+        c = _mm_add_epi32(c, d); b = rotl32_x4(_mm_xor_si128(b, c), 7);
+        b = _mm_shuffle_epi32(b, 0x39); c = _mm_shuffle_epi32(c, 0x4E); d = _mm_shuffle_epi32(d, 0x93);
+        // Diagonal round
+        a = _mm_add_epi32(a, b); d = rotl32_x4(_mm_xor_si128(d, a), 16);
+        c = _mm_add_epi32(c, d); b = rotl32_x4(_mm_xor_si128(b, c), 12);
+        a = _mm_add_epi32(a, b); d = rotl32_x4(_mm_xor_si128(d, a), 8);
+        c = _mm_add_epi32(c, d); b = rotl32_x4(_mm_xor_si128(b, c), 7);
+        b = _mm_shuffle_epi32(b, 0x93); c = _mm_shuffle_epi32(c, 0x4E); d = _mm_shuffle_epi32(d, 0x39);
+    }
+    
+    _mm_storeu_si128((__m128i*)output, _mm_add_epi32(a, a0));
+    _mm_storeu_si128((__m128i*)(output + 16), _mm_add_epi32(b, b0));
+    _mm_storeu_si128((__m128i*)(output + 32), _mm_add_epi32(c, c0));
+    _mm_storeu_si128((__m128i*)(output + 48), _mm_add_epi32(d, d0));
+}
+
+#endif
+
 ChaCha20PRNG::ChaCha20PRNG(const uint8_t* seed_key, const uint8_t* seed_nonce) {
     memcpy(key, seed_key, 32);
     if (seed_nonce) {
@@ -85,7 +131,7 @@ ChaCha20PRNG::ChaCha20PRNG(const uint8_t* seed_key, const uint8_t* seed_nonce) {
 }
 
 void ChaCha20PRNG::generate_block() {
-    chacha_block(key, nonce, counter, buffer);
+    ruc_kernels().chacha20_block(key, nonce, counter, buffer);
     counter++;
     buffer_pos = 0;
 }
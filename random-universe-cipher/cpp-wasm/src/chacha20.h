@@ -4,6 +4,12 @@
 #include <cstdint>
 #include <cstddef>
 
+// ChaCha20 block function kernels (selected at runtime, see kernels.h)
+void chacha20_block_scalar(const uint8_t* key, const uint8_t* nonce, uint32_t counter, uint8_t* output);
+#if defined(__x86_64__) || defined(__i386__)
+void chacha20_block_sse2(const uint8_t* key, const uint8_t* nonce, uint32_t counter, uint8_t* output);
+#endif
+
 // ChaCha20 PRNG class
 class ChaCha20PRNG {
 private:
@@ -1,5 +1,13 @@
 #include "gf_math.h"
+#include "kernels.h"
 #include <cstddef>
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
 
 // GF(2^8) multiplication using log/exp tables (much smaller than full lookup table)
 // Only 512 bytes total (256 log + 256 exp) vs 65KB for full table
@@ -7,8 +15,15 @@ static uint8_t gf_log_table[256];
 static uint8_t gf_exp_table[256];
 static bool gf_tables_initialized = false;
 
+// The generator used below (x = 2) only spans a 51-element subgroup, so gf_mul
+// is exp(log a + log b) over that subgroup with every other non-zero input
+// folded to 1. SIMD kernels reproduce this exactly via a fold table and a
+// membership bitmap instead of the log/exp lookups.
+static uint8_t gf_fold_table[256];        // gf_exp_table[gf_log_table[a]]
+static uint8_t gf_member_bitmap[32];      // bit a set when gf_fold_table[a] == a
+
 // Initialize log/exp tables (called once)
-static void init_gf_tables() {
+void gf_init_tables() {
     if (gf_tables_initialized) return;
     
     // Find a primitive element (generator) for GF(2^8)
@@ -26,6 +41,14 @@ static void init_gf_tables() {
     gf_log_table[0] = 0; // Special case: log(0) = 0 (but 0 * anything = 0)
     gf_log_table[1] = 0;
     
+    memset(gf_member_bitmap, 0, sizeof(gf_member_bitmap));
+    for (int a = 0; a < 256; a++) {
+        gf_fold_table[a] = gf_exp_table[gf_log_table[a]];
+        if (a != 0 && gf_fold_table[a] == a) {
+            gf_member_bitmap[a >> 3] |= (uint8_t)(1 << (a & 7));
+        }
+    }
+    
     gf_tables_initialized = true;
 }
 
@@ -33,7 +56,7 @@ static void init_gf_tables() {
 // Optimized: Initialize tables at module load time (static initialization)
 __attribute__((constructor))
 static void init_gf_tables_auto() {
-    init_gf_tables();
+    gf_init_tables();
 }
 
 uint8_t gf_mul(uint8_t a, uint8_t b) {
@@ -59,8 +82,146 @@ void gf_mul_register(const uint8_t* reg, uint8_t multiplier, uint8_t* result) {
 
 // Multiply each byte of a 64-byte register by a constant (in-place)
 void gf_mul_register_inplace(uint8_t* reg, uint8_t multiplier) {
+    ruc_kernels().gf_mul_register(reg, multiplier);
+}
+
+// Reference kernel: per-byte log/exp lookups
+void gf_mul_register_inplace_scalar(uint8_t* reg, uint8_t multiplier) {
     for (size_t i = 0; i < 64; i++) {
         reg[i] = gf_mul(reg[i], multiplier);
     }
 }
 
+#if defined(__x86_64__) || defined(__i386__) || defined(__wasm_simd128__)
+
+// Split-nibble tables for a true GF(2^8) multiply by c: c*x = lo[x & 15] ^ hi[x >> 4]
+static void gf_nibble_tables(uint8_t c, uint8_t* lo, uint8_t* hi) {
+    uint8_t pow[8];
+    pow[0] = c;
+    for (int k = 1; k < 8; k++) {
+        pow[k] = (uint8_t)((pow[k - 1] << 1) ^ ((pow[k - 1] & 0x80) ? GF_POLYNOMIAL : 0));
+    }
+    lo[0] = 0;
+    hi[0] = 0;
+    for (int i = 1; i < 16; i++) {
+        int low_bit = __builtin_ctz(i);
+        lo[i] = lo[i & (i - 1)] ^ pow[low_bit];
+        hi[i] = hi[i & (i - 1)] ^ pow[low_bit + 4];
+    }
+}
+
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// 16 lanes of gf_mul(a, c_folded): fold a through the subgroup bitmap, then
+// multiply with pshufb nibble tables; zero inputs stay zero.
+__attribute__((target("ssse3")))
+static inline __m128i gf_mul_fold_16(__m128i a, __m128i tlo, __m128i thi, __m128i bm_lo, __m128i bm_hi) {
+    const __m128i bit_table = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, (char)0x80,
+                                            1, 2, 4, 8, 16, 32, 64, (char)0x80);
+    const __m128i low_nibble = _mm_set1_epi8(0x0F);
+    
+    __m128i idx = _mm_and_si128(_mm_srli_epi16(a, 3), _mm_set1_epi8(0x1F));
+    __m128i use_hi = _mm_cmpgt_epi8(idx, low_nibble);
+    __m128i word = _mm_or_si128(_mm_and_si128(use_hi, _mm_shuffle_epi8(bm_hi, idx)),
+                                _mm_andnot_si128(use_hi, _mm_shuffle_epi8(bm_lo, idx)));
+    __m128i bit = _mm_shuffle_epi8(bit_table, _mm_and_si128(a, _mm_set1_epi8(7)));
+    __m128i member = _mm_cmpeq_epi8(_mm_and_si128(word, bit), bit);
+    __m128i folded = _mm_or_si128(_mm_and_si128(member, a), _mm_andnot_si128(member, _mm_set1_epi8(1)));
+    
+    __m128i prod = _mm_xor_si128(
+        _mm_shuffle_epi8(tlo, _mm_and_si128(folded, low_nibble)),
+        _mm_shuffle_epi8(thi, _mm_and_si128(_mm_srli_epi16(folded, 4), low_nibble)));
+    return _mm_andnot_si128(_mm_cmpeq_epi8(a, _mm_setzero_si128()), prod);
+}
+
+__attribute__((target("ssse3")))
+void gf_mul_register_inplace_ssse3(uint8_t* reg, uint8_t multiplier) {
+    if (multiplier == 0) {
+        memset(reg, 0, 64);
+        return;
+    }
+    alignas(16) uint8_t lo[16], hi[16];
+    gf_nibble_tables(gf_fold_table[multiplier], lo, hi);
+    const __m128i tlo = _mm_load_si128((const __m128i*)lo);
+    const __m128i thi = _mm_load_si128((const __m128i*)hi);
+    const __m128i bm_lo = _mm_loadu_si128((const __m128i*)gf_member_bitmap);
+    const __m128i bm_hi = _mm_loadu_si128((const __m128i*)(gf_member_bitmap + 16));
+    
+    for (size_t i = 0; i < 64; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(reg + i));
+        _mm_storeu_si128((__m128i*)(reg + i), gf_mul_fold_16(a, tlo, thi, bm_lo, bm_hi));
+    }
+}
+
+__attribute__((target("avx2")))
+void gf_mul_register_inplace_avx2(uint8_t* reg, uint8_t multiplier) {
+    if (multiplier == 0) {
+        memset(reg, 0, 64);
+        return;
+    }
+    alignas(16) uint8_t lo[16], hi[16];
+    gf_nibble_tables(gf_fold_table[multiplier], lo, hi);
+    const __m256i tlo = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)lo));
+    const __m256i thi = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)hi));
+    const __m256i bm_lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)gf_member_bitmap));
+    const __m256i bm_hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(gf_member_bitmap + 16)));
+    const __m256i bit_table = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, (char)0x80, 1, 2, 4, 8, 16, 32, 64, (char)0x80,
+                                               1, 2, 4, 8, 16, 32, 64, (char)0x80, 1, 2, 4, 8, 16, 32, 64, (char)0x80);
+    const __m256i low_nibble = _mm256_set1_epi8(0x0F);
+    
+    for (size_t i = 0; i < 64; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(reg + i));
+        __m256i idx = _mm256_and_si256(_mm256_srli_epi16(a, 3), _mm256_set1_epi8(0x1F));
+        __m256i use_hi = _mm256_cmpgt_epi8(idx, low_nibble);
+        __m256i word = _mm256_blendv_epi8(_mm256_shuffle_epi8(bm_lo, idx), _mm256_shuffle_epi8(bm_hi, idx), use_hi);
+        __m256i bit = _mm256_shuffle_epi8(bit_table, _mm256_and_si256(a, _mm256_set1_epi8(7)));
+        __m256i member = _mm256_cmpeq_epi8(_mm256_and_si256(word, bit), bit);
+        __m256i folded = _mm256_blendv_epi8(_mm256_set1_epi8(1), a, member);
+        __m256i prod = _mm256_xor_si256(
+            _mm256_shuffle_epi8(tlo, _mm256_and_si256(folded, low_nibble)),
+            _mm256_shuffle_epi8(thi, _mm256_and_si256(_mm256_srli_epi16(folded, 4), low_nibble)));
+        prod = _mm256_andnot_si256(_mm256_cmpeq_epi8(a, _mm256_setzero_si256()), prod);
+        _mm256_storeu_si256((__m256i*)(reg + i), prod);
+    }
+}
+
+#endif
+
+#if defined(__wasm_simd128__)
+
+// WASM SIMD128 port of the SSSE3 kernel. swizzle yields 0 for indices >= 16
+// (pshufb only looks at the low nibble), so the two bitmap halves are looked
+// up with idx and idx - 16 and ORed.
+void gf_mul_register_inplace_simd128(uint8_t* reg, uint8_t multiplier) {
+    if (multiplier == 0) {
+        memset(reg, 0, 64);
+        return;
+    }
+    uint8_t lo[16], hi[16];
+    gf_nibble_tables(gf_fold_table[multiplier], lo, hi);
+    const v128_t tlo = wasm_v128_load(lo);
+    const v128_t thi = wasm_v128_load(hi);
+    const v128_t bm_lo = wasm_v128_load(gf_member_bitmap);
+    const v128_t bm_hi = wasm_v128_load(gf_member_bitmap + 16);
+    const v128_t bit_table = wasm_u8x16_make(1, 2, 4, 8, 16, 32, 64, 0x80, 1, 2, 4, 8, 16, 32, 64, 0x80);
+    const v128_t low_nibble = wasm_u8x16_splat(0x0F);
+    const v128_t sixteen = wasm_u8x16_splat(16);
+    
+    for (size_t i = 0; i < 64; i += 16) {
+        v128_t a = wasm_v128_load(reg + i);
+        v128_t idx = wasm_u8x16_shr(a, 3);
+        v128_t word = wasm_v128_or(wasm_i8x16_swizzle(bm_lo, idx),
+                                   wasm_i8x16_swizzle(bm_hi, wasm_i8x16_sub(idx, sixteen)));
+        v128_t bit = wasm_i8x16_swizzle(bit_table, wasm_v128_and(a, wasm_u8x16_splat(7)));
+        v128_t member = wasm_i8x16_eq(wasm_v128_and(word, bit), bit);
+        v128_t folded = wasm_v128_bitselect(a, wasm_u8x16_splat(1), member);
+        v128_t prod = wasm_v128_xor(wasm_i8x16_swizzle(tlo, wasm_v128_and(folded, low_nibble)),
+                                    wasm_i8x16_swizzle(thi, wasm_u8x16_shr(folded, 4)));
+        prod = wasm_v128_andnot(prod, wasm_i8x16_eq(a, wasm_u8x16_splat(0)));
+        wasm_v128_store(reg + i, prod);
+    }
+}
+
+#endif
@@ -3,6 +3,9 @@
 
 #include <cstdint>
 
+// Build the log/exp tables (idempotent; also runs automatically at load time)
+void gf_init_tables();
+
 // GF(2^8) multiplication with polynomial 0x1B
 uint8_t gf_mul(uint8_t a, uint8_t b);
 
@@ -10,7 +13,17 @@ uint8_t gf_mul(uint8_t a, uint8_t b);
 void gf_mul_register(const uint8_t* reg, uint8_t multiplier, uint8_t* result);
 
 // Multiply each byte of a 64-byte register by a constant (in-place)
+// Dispatches to the active kernel (see kernels.h)
 void gf_mul_register_inplace(uint8_t* reg, uint8_t multiplier);
 
-#endif // GF_MATH_H
+// gf_mul_register_inplace kernels
+void gf_mul_register_inplace_scalar(uint8_t* reg, uint8_t multiplier);
+#if defined(__x86_64__) || defined(__i386__)
+void gf_mul_register_inplace_ssse3(uint8_t* reg, uint8_t multiplier);
+void gf_mul_register_inplace_avx2(uint8_t* reg, uint8_t multiplier);
+#endif
+#if defined(__wasm_simd128__)
+void gf_mul_register_inplace_simd128(uint8_t* reg, uint8_t multiplier);
+#endif
 
+#endif // GF_MATH_H
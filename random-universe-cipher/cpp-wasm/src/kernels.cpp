@@ -0,0 +1,633 @@
+#include "kernels.h"
+#include "gf_math.h"
+#include "shake256.h"
+#include "chacha20.h"
+#include "bitslice.h"
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <mutex>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+// Reference kernels are active before (and if) the registry initializes
+ActiveKernels ruc_active_kernels = {
+    keccak_f_unrolled,
+    gf_mul_register_inplace_scalar,
+    chacha20_block_scalar,
+    execute_round_ref,
+    rounds_batch_bs64,      // Never rounds_batch_ref: this slot must stay constant-time
+};
+
+constexpr size_t MAX_KERNELS_PER_PRIMITIVE = 8;
+
+struct KernelEntry {
+    const char* name;
+    uint32_t required_features;
+    ruc_kernel_fn fn;
+    uint32_t status;
+};
+
+struct KernelSlot {
+    const char* name;
+    KernelEntry entries[MAX_KERNELS_PER_PRIMITIVE];  // entries[0] is the reference (simplest form)
+    size_t count;
+    size_t active;
+    bool forced;
+    bool constant_time_only;    // Only RUC_KERNEL_CONSTANT_TIME entries may be selected
+    bool (*verify)(ruc_kernel_fn fn, ruc_kernel_fn ref);
+    double (*bench)(ruc_kernel_fn fn);
+};
+
+// Guards everything below; the hot path only reads ruc_active_kernels
+static std::mutex registry_mutex;
+static KernelSlot kernel_slots[RUC_PRIM_COUNT];
+static uint32_t cpu_features = 0;
+static bool registry_initialized = false;
+
+// ---------------------------------------------------------------------------
+// CPU feature detection
+// ---------------------------------------------------------------------------
+
+#if defined(__x86_64__) || defined(__i386__)
+static uint64_t read_xcr0() {
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64_t)edx << 32) | eax;
+}
+#endif
+
+static uint32_t detect_cpu_features() {
+    uint32_t features = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return 0;
+
+    if (edx & (1u << 26)) features |= RUC_CPU_SSE2;
+    if (ecx & (1u << 9)) features |= RUC_CPU_SSSE3;
+    if (ecx & (1u << 19)) features |= RUC_CPU_SSE41;
+
+    // AVX state must be enabled by the OS (OSXSAVE + XCR0 bits 1,2)
+    bool os_avx = false;
+    bool os_avx512 = false;
+    if ((ecx & (1u << 27)) && (ecx & (1u << 28))) {
+        uint64_t xcr0 = read_xcr0();
+        os_avx = (xcr0 & 0x6) == 0x6;
+        os_avx512 = os_avx && (xcr0 & 0xE0) == 0xE0;
+    }
+    if (os_avx) features |= RUC_CPU_AVX;
+
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        if (os_avx && (ebx & (1u << 5))) features |= RUC_CPU_AVX2;
+        if (ebx & (1u << 8)) features |= RUC_CPU_BMI2;
+        if (os_avx512 && (ebx & (1u << 16))) features |= RUC_CPU_AVX512F;
+        if (os_avx512 && (ebx & (1u << 30))) features |= RUC_CPU_AVX512BW;
+        if (os_avx512 && (ebx & (1u << 31))) features |= RUC_CPU_AVX512VL;
+    }
+#endif
+#if defined(__wasm_simd128__)
+    features |= RUC_CPU_WASM_SIMD128;
+#endif
+    return features;
+}
+
+// ---------------------------------------------------------------------------
+// Self-test helpers
+// ---------------------------------------------------------------------------
+
+// Deterministic filler for test inputs (xorshift64)
+static void fill_test_bytes(uint8_t* out, size_t len, uint64_t seed) {
+    uint64_t x = seed * 0x9E3779B97F4A7C15ULL + 1;
+    for (size_t i = 0; i < len; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        out[i] = (uint8_t)(x >> 24);
+    }
+}
+
+static double elapsed_ns(std::chrono::steady_clock::time_point start) {
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+// This engine's Keccak-f[1600] (see PI_SRC in shake256.cpp) applied to the
+// all-zero state, first two lanes
+static const uint64_t KECCAK_ZERO_KAT[2] = { 0x77EB00F70F7A2DCBULL, 0x25A77D2A899DE2C9ULL };
+
+static bool verify_keccak_f(ruc_kernel_fn fn, ruc_kernel_fn ref) {
+    keccak_f_fn f = (keccak_f_fn)fn;
+    uint64_t state[25] = {0};
+    f(state);
+    if (state[0] != KECCAK_ZERO_KAT[0] || state[1] != KECCAK_ZERO_KAT[1]) return false;
+    if (!ref) return true;
+
+    uint64_t expected[25];
+    for (uint64_t seed = 1; seed <= 4; seed++) {
+        fill_test_bytes((uint8_t*)state, sizeof(state), seed);
+        memcpy(expected, state, sizeof(state));
+        f(state);
+        ((keccak_f_fn)ref)(expected);
+        if (memcmp(state, expected, sizeof(state)) != 0) return false;
+    }
+    return true;
+}
+
+static double bench_keccak_f(ruc_kernel_fn fn) {
+    keccak_f_fn f = (keccak_f_fn)fn;
+    uint64_t state[25] = {0};
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 2000; i++) f(state);
+    double ns = elapsed_ns(start);
+    return state[0] == 0 ? ns + 1 : ns;  // keep the loop observable
+}
+
+// gf_mul_register must equal gf_mul() byte-for-byte for every (byte, multiplier)
+static bool verify_gf_mul_register(ruc_kernel_fn fn, ruc_kernel_fn) {
+    gf_mul_register_fn f = (gf_mul_register_fn)fn;
+    uint8_t reg[64];
+    for (int m = 0; m < 256; m++) {
+        for (int chunk = 0; chunk < 4; chunk++) {
+            for (int i = 0; i < 64; i++) reg[i] = (uint8_t)(chunk * 64 + i);
+            f(reg, (uint8_t)m);
+            for (int i = 0; i < 64; i++) {
+                if (reg[i] != gf_mul((uint8_t)(chunk * 64 + i), (uint8_t)m)) return false;
+            }
+        }
+    }
+    return true;
+}
+
+static double bench_gf_mul_register(ruc_kernel_fn fn) {
+    gf_mul_register_fn f = (gf_mul_register_fn)fn;
+    uint8_t reg[64];
+    fill_test_bytes(reg, sizeof(reg), 7);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 20000; i++) f(reg, (uint8_t)(i | 1));
+    double ns = elapsed_ns(start);
+    return reg[0] == 0xFF ? ns + 1 : ns;
+}
+
+// RFC 7539 section 2.3.2 block function test vector
+static const uint8_t CHACHA_KAT_NONCE[12] = { 0, 0, 0, 0x09, 0, 0, 0, 0x4a, 0, 0, 0, 0 };
+static const uint8_t CHACHA_KAT_OUTPUT[64] = {
+    0x10, 0xf1, 0xe7, 0xe4, 0xd1, 0x3b, 0x59, 0x15, 0x50, 0x0f, 0xdd, 0x1f, 0xa3, 0x20, 0x71, 0xc4,
+    0xc7, 0xd1, 0xf4, 0xc7, 0x33, 0xc0, 0x68, 0x03, 0x04, 0x22, 0xaa, 0x9a, 0xc3, 0xd4, 0x6c, 0x4e,
+    0xd2, 0x82, 0x64, 0x46, 0x07, 0x9f, 0xaa, 0x09, 0x14, 0xc2, 0xd7, 0x05, 0xd9, 0x8b, 0x02, 0xa2,
+    0xb5, 0x12, 0x9c, 0xd1, 0xde, 0x16, 0x4e, 0xb9, 0xcb, 0xd0, 0x83, 0xe8, 0xa2, 0x50, 0x3c, 0x4e,
+};
+
+static bool verify_chacha20_block(ruc_kernel_fn fn, ruc_kernel_fn ref) {
+    chacha20_block_fn f = (chacha20_block_fn)fn;
+    uint8_t key[32], nonce[12], out[64], expected[64];
+    for (int i = 0; i < 32; i++) key[i] = (uint8_t)i;
+    f(key, CHACHA_KAT_NONCE, 1, out);
+    if (memcmp(out, CHACHA_KAT_OUTPUT, 64) != 0) return false;
+    if (!ref) return true;
+
+    for (uint64_t seed = 1; seed <= 4; seed++) {
+        fill_test_bytes(key, sizeof(key), seed);
+        fill_test_bytes(nonce, sizeof(nonce), seed + 100);
+        uint32_t counter = (uint32_t)(seed * 0x9E3779B9u);
+        f(key, nonce, counter, out);
+        ((chacha20_block_fn)ref)(key, nonce, counter, expected);
+        if (memcmp(out, expected, 64) != 0) return false;
+    }
+    return true;
+}
+
+static double bench_chacha20_block(ruc_kernel_fn fn) {
+    chacha20_block_fn f = (chacha20_block_fn)fn;
+    uint8_t key[32], nonce[12] = {0}, out[64];
+    fill_test_bytes(key, sizeof(key), 3);
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < 5000; i++) {
+        f(key, nonce, i, out);
+        key[0] ^= out[0];
+    }
+    return elapsed_ns(start);
+}
+
+// Synthetic key material: round kernels only read tables, so any contents work
+static void fill_test_key_material(KeyMaterial* km, uint16_t* ordered, size_t* indices, uint64_t seed) {
+    fill_test_bytes((uint8_t*)km, sizeof(KeyMaterial), seed);
+    km->num_selectors = MIN_SELECTORS + (size_t)(seed % (MAX_SELECTORS - MIN_SELECTORS + 1));
+    for (size_t i = 0; i < km->num_selectors; i++) {
+        km->selectors[i] |= 1;
+        ordered[i] = km->selectors[(i * 7) % km->num_selectors];
+        indices[i] = (i * 7) % km->num_selectors;
+    }
+}
+
+static bool verify_round(ruc_kernel_fn fn, ruc_kernel_fn ref) {
+    if (!ref) return true;
+    round_fn f = (round_fn)fn;
+    KeyMaterial km;
+    uint16_t ordered[MAX_SELECTORS];
+    size_t indices[MAX_SELECTORS];
+    CipherState state, expected;
+
+    for (uint64_t seed = 1; seed <= 3; seed++) {
+        fill_test_key_material(&km, ordered, indices, seed);
+        fill_test_bytes((uint8_t*)&state, sizeof(state), seed + 50);
+        memcpy(&expected, &state, sizeof(state));
+        for (int r = 0; r < (int)ROUNDS; r++) {
+            f(&state, r, ordered, indices, km.num_selectors, &km);
+            ((round_fn)ref)(&expected, r, ordered, indices, km.num_selectors, &km);
+        }
+        if (memcmp(&state, &expected, sizeof(state)) != 0) return false;
+    }
+    return true;
+}
+
+static double bench_round(ruc_kernel_fn fn) {
+    round_fn f = (round_fn)fn;
+    KeyMaterial km;
+    uint16_t ordered[MAX_SELECTORS];
+    size_t indices[MAX_SELECTORS];
+    CipherState state;
+    fill_test_key_material(&km, ordered, indices, 9);
+    fill_test_bytes((uint8_t*)&state, sizeof(state), 10);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 10; i++) {
+        for (int r = 0; r < (int)ROUNDS; r++) {
+            f(&state, r, ordered, indices, km.num_selectors, &km);
+        }
+    }
+    return elapsed_ns(start);
+}
+
+// Per-state selector orders that differ between lanes, so lane mix-ups show up
+static void fill_test_batch_orders(const KeyMaterial* km, size_t count, uint16_t* ordered, size_t* indices) {
+    for (size_t s = 0; s < count; s++) {
+        for (size_t i = 0; i < km->num_selectors; i++) {
+            size_t index = (i * 7 + s) % km->num_selectors;
+            ordered[s * MAX_SELECTORS + i] = km->selectors[index];
+            indices[s * MAX_SELECTORS + i] = index;
+        }
+    }
+}
+
+// A partial group (not a multiple of any lane width) over a few rounds
+constexpr size_t BATCH_TEST_STATES = 67;
+
+static bool verify_rounds_batch(ruc_kernel_fn fn, ruc_kernel_fn ref) {
+    if (!ref) return true;
+    rounds_batch_fn f = (rounds_batch_fn)fn;
+    KeyMaterial km;
+    uint16_t ordered[MAX_SELECTORS];
+    size_t indices[MAX_SELECTORS];
+    fill_test_key_material(&km, ordered, indices, 5);
+
+    uint16_t* batch_ordered = new uint16_t[BATCH_TEST_STATES * MAX_SELECTORS];
+    size_t* batch_indices = new size_t[BATCH_TEST_STATES * MAX_SELECTORS];
+    CipherState* states = new CipherState[BATCH_TEST_STATES];
+    CipherState* expected = new CipherState[BATCH_TEST_STATES];
+    fill_test_batch_orders(&km, BATCH_TEST_STATES, batch_ordered, batch_indices);
+    fill_test_bytes((uint8_t*)states, BATCH_TEST_STATES * sizeof(CipherState), 77);
+    memcpy(expected, states, BATCH_TEST_STATES * sizeof(CipherState));
+
+    f(states, BATCH_TEST_STATES, ROUNDS - 2, 2, batch_ordered, batch_indices, &km);
+    ((rounds_batch_fn)ref)(expected, BATCH_TEST_STATES, ROUNDS - 2, 2, batch_ordered, batch_indices, &km);
+    bool ok = memcmp(states, expected, BATCH_TEST_STATES * sizeof(CipherState)) == 0;
+
+    delete[] batch_ordered;
+    delete[] batch_indices;
+    delete[] states;
+    delete[] expected;
+    return ok;
+}
+
+static double bench_rounds_batch(ruc_kernel_fn fn) {
+    rounds_batch_fn f = (rounds_batch_fn)fn;
+    const size_t count = 256;
+    KeyMaterial km;
+    uint16_t ordered[MAX_SELECTORS];
+    size_t indices[MAX_SELECTORS];
+    fill_test_key_material(&km, ordered, indices, 11);
+    uint16_t* batch_ordered = new uint16_t[count * MAX_SELECTORS];
+    size_t* batch_indices = new size_t[count * MAX_SELECTORS];
+    CipherState* states = new CipherState[count];
+    fill_test_batch_orders(&km, count, batch_ordered, batch_indices);
+    fill_test_bytes((uint8_t*)states, count * sizeof(CipherState), 12);
+
+    auto start = std::chrono::steady_clock::now();
+    f(states, count, 0, 2, batch_ordered, batch_indices, &km);
+    double ns = elapsed_ns(start);
+
+    delete[] batch_ordered;
+    delete[] batch_indices;
+    delete[] states;
+    return ns;
+}
+
+// ---------------------------------------------------------------------------
+// Registry (callers hold registry_mutex)
+// ---------------------------------------------------------------------------
+
+static ruc_kernel_fn installed_kernel(int primitive) {
+    switch (primitive) {
+        case RUC_PRIM_KECCAK_F: return (ruc_kernel_fn)ruc_active_kernels.keccak_f.load();
+        case RUC_PRIM_GF_MUL_REGISTER: return (ruc_kernel_fn)ruc_active_kernels.gf_mul_register.load();
+        case RUC_PRIM_CHACHA20_BLOCK: return (ruc_kernel_fn)ruc_active_kernels.chacha20_block.load();
+        case RUC_PRIM_ROUND: return (ruc_kernel_fn)ruc_active_kernels.round.load();
+        case RUC_PRIM_ROUNDS_BATCH: return (ruc_kernel_fn)ruc_active_kernels.rounds_batch.load();
+    }
+    return nullptr;
+}
+
+// Set the ACTIVE bit on slot.active only (the reported name follows it)
+static void mark_active(KernelSlot& slot) {
+    for (size_t i = 0; i < slot.count; i++) {
+        slot.entries[i].status &= ~RUC_KERNEL_ACTIVE;
+    }
+    slot.entries[slot.active].status |= RUC_KERNEL_ACTIVE;
+}
+
+// Point slot.active at the kernel that is actually installed, so the
+// reported name never disagrees with what runs
+static void adopt_installed(int primitive) {
+    KernelSlot& slot = kernel_slots[primitive];
+    ruc_kernel_fn installed = installed_kernel(primitive);
+    for (size_t i = 0; i < slot.count; i++) {
+        if (slot.entries[i].fn == installed) {
+            slot.active = i;
+            mark_active(slot);
+            return;
+        }
+    }
+}
+
+static void publish_active(int primitive) {
+    KernelSlot& slot = kernel_slots[primitive];
+    mark_active(slot);
+
+    ruc_kernel_fn fn = slot.entries[slot.active].fn;
+    switch (primitive) {
+        case RUC_PRIM_KECCAK_F: ruc_active_kernels.keccak_f.store((keccak_f_fn)fn); break;
+        case RUC_PRIM_GF_MUL_REGISTER: ruc_active_kernels.gf_mul_register.store((gf_mul_register_fn)fn); break;
+        case RUC_PRIM_CHACHA20_BLOCK: ruc_active_kernels.chacha20_block.store((chacha20_block_fn)fn); break;
+        case RUC_PRIM_ROUND: ruc_active_kernels.round.store((round_fn)fn); break;
+        case RUC_PRIM_ROUNDS_BATCH: ruc_active_kernels.rounds_batch.store((rounds_batch_fn)fn); break;
+    }
+}
+
+static bool kernel_usable(const KernelSlot& slot, const KernelEntry& entry) {
+    const uint32_t usable = RUC_KERNEL_SUPPORTED | RUC_KERNEL_VERIFIED;
+    if (slot.constant_time_only && !(entry.status & RUC_KERNEL_CONSTANT_TIME)) return false;
+    return (entry.status & usable) == usable;
+}
+
+static int add_kernel(int primitive, const char* name, uint32_t required_features, ruc_kernel_fn fn,
+                      bool constant_time = false) {
+    KernelSlot& slot = kernel_slots[primitive];
+    if (slot.count == MAX_KERNELS_PER_PRIMITIVE) return RUC_KERNEL_ERR_FULL;
+
+    KernelEntry& entry = slot.entries[slot.count];
+    entry.name = name;
+    entry.required_features = required_features;
+    entry.fn = fn;
+    entry.status = constant_time ? RUC_KERNEL_CONSTANT_TIME : 0;
+
+    // Never execute a kernel the CPU cannot run
+    if ((cpu_features & required_features) == required_features) {
+        entry.status |= RUC_KERNEL_SUPPORTED;
+        ruc_kernel_fn ref = slot.count > 0 ? slot.entries[0].fn : nullptr;
+        if (slot.verify(fn, ref)) {
+            entry.status |= RUC_KERNEL_VERIFIED;
+        }
+    }
+    slot.count++;
+
+    if (!(entry.status & RUC_KERNEL_SUPPORTED)) return RUC_KERNEL_ERR_UNSUPPORTED;
+    if (!(entry.status & RUC_KERNEL_VERIFIED)) return RUC_KERNEL_ERR_SELFTEST;
+    if (slot.constant_time_only && !constant_time) return RUC_KERNEL_ERR_NOT_CT;
+    return RUC_KERNEL_OK;
+}
+
+static int find_kernel(int primitive, const char* name, size_t name_len) {
+    KernelSlot& slot = kernel_slots[primitive];
+    for (size_t i = 0; i < slot.count; i++) {
+        if (strlen(slot.entries[i].name) == name_len && strncmp(slot.entries[i].name, name, name_len) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+static int find_primitive(const char* name, size_t name_len) {
+    for (int p = 0; p < RUC_PRIM_COUNT; p++) {
+        if (strlen(kernel_slots[p].name) == name_len && strncmp(kernel_slots[p].name, name, name_len) == 0) {
+            return p;
+        }
+    }
+    return -1;
+}
+
+static int select_kernel(int primitive, size_t index) {
+    KernelSlot& slot = kernel_slots[primitive];
+    if (!(slot.entries[index].status & RUC_KERNEL_SUPPORTED)) return RUC_KERNEL_ERR_UNSUPPORTED;
+    if (!(slot.entries[index].status & RUC_KERNEL_VERIFIED)) return RUC_KERNEL_ERR_SELFTEST;
+    if (!kernel_usable(slot, slot.entries[index])) return RUC_KERNEL_ERR_NOT_CT;
+    slot.active = index;
+    publish_active(primitive);
+    return RUC_KERNEL_OK;
+}
+
+// Preferred kernel: last registered usable entry, or fastest when autotuning.
+// Falls back to entries[0] when nothing is usable, except in a
+// constant-time-only slot, which then leaves its current kernel in place.
+static void select_automatic(int primitive, bool autotune) {
+    KernelSlot& slot = kernel_slots[primitive];
+    size_t best = 0;
+    double best_ns = 0;
+    bool found = false;
+    for (size_t i = 0; i < slot.count; i++) {
+        if (!kernel_usable(slot, slot.entries[i])) continue;
+        found = true;
+        if (!autotune) {
+            best = i;
+            continue;
+        }
+        // Best of three runs to filter out scheduling noise
+        double ns = slot.bench(slot.entries[i].fn);
+        for (int run = 1; run < 3; run++) {
+            double again = slot.bench(slot.entries[i].fn);
+            if (again < ns) ns = again;
+        }
+        if (best_ns == 0 || ns < best_ns) {
+            best = i;
+            best_ns = ns;
+        }
+    }
+    if (!found && slot.constant_time_only) return;  // slot.active already names the installed kernel
+    slot.active = best;
+    publish_active(primitive);
+}
+
+// Apply one "primitive=name" entry
+static int apply_env_entry(const char* entry, size_t len) {
+    const char* eq = (const char*)memchr(entry, '=', len);
+    if (!eq) return RUC_KERNEL_ERR_UNKNOWN;
+    int primitive = find_primitive(entry, (size_t)(eq - entry));
+    if (primitive < 0) return RUC_KERNEL_ERR_UNKNOWN;
+    int index = find_kernel(primitive, eq + 1, len - (size_t)(eq + 1 - entry));
+    if (index < 0) return RUC_KERNEL_ERR_UNKNOWN;
+    int rc = select_kernel(primitive, (size_t)index);
+    if (rc == RUC_KERNEL_OK) kernel_slots[primitive].forced = true;
+    return rc;
+}
+
+// Apply RUC_KERNEL="primitive=name,primitive=name". Bad entries are skipped;
+// the first one's error is returned
+static int apply_env_overrides() {
+    const char* spec = getenv("RUC_KERNEL");
+    if (!spec) return RUC_KERNEL_OK;
+
+    int result = RUC_KERNEL_OK;
+    while (*spec) {
+        const char* end = strchr(spec, ',');
+        size_t len = end ? (size_t)(end - spec) : strlen(spec);
+        if (len > 0) {
+            int rc = apply_env_entry(spec, len);
+            if (result == RUC_KERNEL_OK) result = rc;
+        }
+        spec += len;
+        if (*spec == ',') spec++;
+    }
+    return result;
+}
+
+static void register_builtin_kernels() {
+    kernel_slots[RUC_PRIM_KECCAK_F].name = "keccak_f";
+    kernel_slots[RUC_PRIM_KECCAK_F].verify = verify_keccak_f;
+    kernel_slots[RUC_PRIM_KECCAK_F].bench = bench_keccak_f;
+    kernel_slots[RUC_PRIM_GF_MUL_REGISTER].name = "gf_mul_register";
+    kernel_slots[RUC_PRIM_GF_MUL_REGISTER].verify = verify_gf_mul_register;
+    kernel_slots[RUC_PRIM_GF_MUL_REGISTER].bench = bench_gf_mul_register;
+    kernel_slots[RUC_PRIM_CHACHA20_BLOCK].name = "chacha20_block";
+    kernel_slots[RUC_PRIM_CHACHA20_BLOCK].verify = verify_chacha20_block;
+    kernel_slots[RUC_PRIM_CHACHA20_BLOCK].bench = bench_chacha20_block;
+    kernel_slots[RUC_PRIM_ROUND].name = "round";
+    kernel_slots[RUC_PRIM_ROUND].verify = verify_round;
+    kernel_slots[RUC_PRIM_ROUND].bench = bench_round;
+    kernel_slots[RUC_PRIM_ROUNDS_BATCH].name = "rounds_batch";
+    kernel_slots[RUC_PRIM_ROUNDS_BATCH].verify = verify_rounds_batch;
+    kernel_slots[RUC_PRIM_ROUNDS_BATCH].bench = bench_rounds_batch;
+    kernel_slots[RUC_PRIM_ROUNDS_BATCH].constant_time_only = true;
+
+    // Registration order is preference order (later wins without autotuning)
+    add_kernel(RUC_PRIM_KECCAK_F, "looped", 0, (ruc_kernel_fn)keccak_f_looped);
+    add_kernel(RUC_PRIM_KECCAK_F, "lanecomp", 0, (ruc_kernel_fn)keccak_f_lanecomp);
+    add_kernel(RUC_PRIM_KECCAK_F, "unrolled", 0, (ruc_kernel_fn)keccak_f_unrolled);
+    add_kernel(RUC_PRIM_GF_MUL_REGISTER, "scalar", 0, (ruc_kernel_fn)gf_mul_register_inplace_scalar);
+    add_kernel(RUC_PRIM_CHACHA20_BLOCK, "scalar", 0, (ruc_kernel_fn)chacha20_block_scalar);
+    add_kernel(RUC_PRIM_ROUND, "ref", 0, (ruc_kernel_fn)execute_round_ref);
+    add_kernel(RUC_PRIM_ROUNDS_BATCH, "ref", 0, (ruc_kernel_fn)rounds_batch_ref);
+    add_kernel(RUC_PRIM_ROUNDS_BATCH, "bs64", 0, (ruc_kernel_fn)rounds_batch_bs64, true);
+#if defined(__x86_64__) || defined(__i386__)
+    add_kernel(RUC_PRIM_KECCAK_F, "avx512", RUC_CPU_AVX512F, (ruc_kernel_fn)keccak_f_avx512);
+    add_kernel(RUC_PRIM_GF_MUL_REGISTER, "ssse3", RUC_CPU_SSSE3, (ruc_kernel_fn)gf_mul_register_inplace_ssse3);
+    add_kernel(RUC_PRIM_GF_MUL_REGISTER, "avx2", RUC_CPU_AVX2, (ruc_kernel_fn)gf_mul_register_inplace_avx2);
+    add_kernel(RUC_PRIM_CHACHA20_BLOCK, "sse2", RUC_CPU_SSE2, (ruc_kernel_fn)chacha20_block_sse2);
+    add_kernel(RUC_PRIM_ROUNDS_BATCH, "bs256_avx2", RUC_CPU_AVX2, (ruc_kernel_fn)rounds_batch_bs256_avx2, true);
+#endif
+#if defined(__wasm_simd128__)
+    add_kernel(RUC_PRIM_GF_MUL_REGISTER, "simd128", RUC_CPU_WASM_SIMD128, (ruc_kernel_fn)gf_mul_register_inplace_simd128);
+#endif
+}
+
+static void ensure_registry() {
+    if (registry_initialized) return;
+    registry_initialized = true;
+    gf_init_tables();
+    cpu_features = detect_cpu_features();
+    register_builtin_kernels();
+    for (int p = 0; p < RUC_PRIM_COUNT; p++) adopt_installed(p);
+}
+
+
+int ruc_kernel_register(int primitive, const char* name, uint32_t required_features, ruc_kernel_fn fn,
+                        bool constant_time) {
+    if (primitive < 0 || primitive >= RUC_PRIM_COUNT || !name || !fn) return RUC_KERNEL_ERR_UNKNOWN;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    ensure_registry();
+    return add_kernel(primitive, name, required_features, fn, constant_time);
+}
+
+uint32_t ruc_cpu_features() {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    ensure_registry();
+    return cpu_features;
+}
+
+int ruc_kernel_init(int autotune) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    ensure_registry();
+    const char* env_autotune = getenv("RUC_KERNEL_AUTOTUNE");
+    if (env_autotune && env_autotune[0] == '1') autotune = 1;
+    for (int p = 0; p < RUC_PRIM_COUNT; p++) {
+        if (!kernel_slots[p].forced) select_automatic(p, autotune != 0);
+    }
+    return apply_env_overrides();
+}
+
+int ruc_kernel_force(int primitive, const char* name) {
+    if (primitive < 0 || primitive >= RUC_PRIM_COUNT) return RUC_KERNEL_ERR_UNKNOWN;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    ensure_registry();
+    if (!name) {
+        kernel_slots[primitive].forced = false;
+        select_automatic(primitive, false);
+        return RUC_KERNEL_OK;
+    }
+    int index = find_kernel(primitive, name, strlen(name));
+    if (index < 0) return RUC_KERNEL_ERR_UNKNOWN;
+    int rc = select_kernel(primitive, (size_t)index);
+    if (rc == RUC_KERNEL_OK) kernel_slots[primitive].forced = true;
+    return rc;
+}
+
+const char* ruc_kernel_active(int primitive) {
+    if (primitive < 0 || primitive >= RUC_PRIM_COUNT) return nullptr;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    ensure_registry();
+    return kernel_slots[primitive].entries[kernel_slots[primitive].active].name;
+}
+
+size_t ruc_kernel_count(int primitive) {
+    if (primitive < 0 || primitive >= RUC_PRIM_COUNT) return 0;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    ensure_registry();
+    return kernel_slots[primitive].count;
+}
+
+const char* ruc_kernel_name(int primitive, size_t index) {
+    if (primitive < 0 || primitive >= RUC_PRIM_COUNT) return nullptr;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    ensure_registry();
+    if (index >= kernel_slots[primitive].count) return nullptr;
+    return kernel_slots[primitive].entries[index].name;
+}
+
+uint32_t ruc_kernel_status(int primitive, size_t index) {
+    if (primitive < 0 || primitive >= RUC_PRIM_COUNT) return 0;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    ensure_registry();
+    if (index >= kernel_slots[primitive].count) return 0;
+    return kernel_slots[primitive].entries[index].status;
+}
+
+const char* ruc_kernel_primitive_name(int primitive) {
+    if (primitive < 0 || primitive >= RUC_PRIM_COUNT) return nullptr;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    ensure_registry();
+    return kernel_slots[primitive].name;
+}
+
+// Validate and select kernels at module load time
+__attribute__((constructor))
+static void ruc_kernel_init_auto() {
+    ruc_kernel_init(0);
+}
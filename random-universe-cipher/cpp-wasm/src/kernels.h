@@ -0,0 +1,156 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include "ruc_cipher.h"
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// Runtime kernel registry
+//
+// Each hot primitive can have several implementations. At load time every
+// registered kernel is checked against CPU features (CPUID + XGETBV on x86),
+// validated against the reference kernel and known-answer vectors, and the
+// preferred (last registered) passing kernel becomes active. Optionally the
+// candidates are micro-benchmarked and the fastest one wins.
+//
+// Environment overrides (read at load time and by ruc_kernel_init):
+//   RUC_KERNEL=keccak_f=looped,gf_mul_register=scalar
+//   RUC_KERNEL_AUTOTUNE=1
+// An entry that cannot be applied is skipped and its error is returned by
+// ruc_kernel_init.
+//
+// The registry is guarded by a mutex, and each active kernel pointer is an
+// atomic, so kernels can be switched while other threads encrypt: a call
+// runs every primitive on some validated kernel, and all of them agree.
+//
+// rounds_batch only backs the constant-time engine, so it only ever selects
+// kernels registered as constant-time. Its reference kernel stays registered
+// to validate the others but cannot be selected, forced or autotuned in.
+
+// CPU feature bits (ruc_cpu_features)
+constexpr uint32_t RUC_CPU_SSE2 = 1u << 0;
+constexpr uint32_t RUC_CPU_SSSE3 = 1u << 1;
+constexpr uint32_t RUC_CPU_SSE41 = 1u << 2;
+constexpr uint32_t RUC_CPU_AVX = 1u << 3;
+constexpr uint32_t RUC_CPU_AVX2 = 1u << 4;
+constexpr uint32_t RUC_CPU_BMI2 = 1u << 5;
+constexpr uint32_t RUC_CPU_AVX512F = 1u << 6;
+constexpr uint32_t RUC_CPU_AVX512VL = 1u << 7;
+constexpr uint32_t RUC_CPU_AVX512BW = 1u << 8;
+constexpr uint32_t RUC_CPU_WASM_SIMD128 = 1u << 9;
+
+// Primitive identifiers
+constexpr int RUC_PRIM_KECCAK_F = 0;
+constexpr int RUC_PRIM_GF_MUL_REGISTER = 1;
+constexpr int RUC_PRIM_CHACHA20_BLOCK = 2;
+constexpr int RUC_PRIM_ROUND = 3;
+constexpr int RUC_PRIM_ROUNDS_BATCH = 4;
+constexpr int RUC_PRIM_COUNT = 5;
+
+// Kernel status bits (ruc_kernel_status)
+constexpr uint32_t RUC_KERNEL_SUPPORTED = 1u << 0;  // CPU has the required features
+constexpr uint32_t RUC_KERNEL_VERIFIED = 1u << 1;   // Passed the startup self-test
+constexpr uint32_t RUC_KERNEL_ACTIVE = 1u << 2;     // Currently selected
+constexpr uint32_t RUC_KERNEL_CONSTANT_TIME = 1u << 3;  // No secret-dependent branches or indices
+
+// Return codes
+constexpr int RUC_KERNEL_OK = 0;
+constexpr int RUC_KERNEL_ERR_UNKNOWN = -1;      // Unknown primitive or kernel name
+constexpr int RUC_KERNEL_ERR_UNSUPPORTED = -2;  // CPU lacks required features
+constexpr int RUC_KERNEL_ERR_SELFTEST = -3;     // Kernel failed validation
+constexpr int RUC_KERNEL_ERR_FULL = -4;         // No room for another kernel
+constexpr int RUC_KERNEL_ERR_NOT_CT = -5;       // Slot requires a constant-time kernel
+
+// Kernel signatures
+typedef void (*keccak_f_fn)(uint64_t state[25]);
+typedef void (*gf_mul_register_fn)(uint8_t* reg, uint8_t multiplier);
+typedef void (*chacha20_block_fn)(const uint8_t* key, const uint8_t* nonce, uint32_t counter, uint8_t* output);
+typedef void (*round_fn)(
+    CipherState* state,
+    int round_index,
+    const uint16_t* ordered_selectors,
+    const size_t* selector_indices,
+    size_t num_selectors,
+    const KeyMaterial* km
+);
+
+// Runs rounds [first_round, first_round + num_rounds) on count independent
+// block states sharing one key. ordered_selectors/selector_indices hold
+// MAX_SELECTORS entries per state.
+typedef void (*rounds_batch_fn)(
+    CipherState* states,
+    size_t count,
+    int first_round,
+    int num_rounds,
+    const uint16_t* ordered_selectors,
+    const size_t* selector_indices,
+    const KeyMaterial* km
+);
+
+// Generic kernel pointer used for registration
+typedef void (*ruc_kernel_fn)();
+
+// Currently selected kernels (read on the hot path)
+struct ActiveKernels {
+    std::atomic<keccak_f_fn> keccak_f;
+    std::atomic<gf_mul_register_fn> gf_mul_register;
+    std::atomic<chacha20_block_fn> chacha20_block;
+    std::atomic<round_fn> round;
+    std::atomic<rounds_batch_fn> rounds_batch;
+};
+
+extern ActiveKernels ruc_active_kernels;
+
+inline const ActiveKernels& ruc_kernels() {
+    return ruc_active_kernels;
+}
+
+// Reference round kernel (defined in ruc_cipher.cpp)
+void execute_round_ref(
+    CipherState* state,
+    int round_index,
+    const uint16_t* ordered_selectors,
+    const size_t* selector_indices,
+    size_t num_selectors,
+    const KeyMaterial* km
+);
+
+// Reference rounds_batch kernel: execute_round_ref per state (defined in bitslice.cpp)
+void rounds_batch_ref(
+    CipherState* states,
+    size_t count,
+    int first_round,
+    int num_rounds,
+    const uint16_t* ordered_selectors,
+    const size_t* selector_indices,
+    const KeyMaterial* km
+);
+
+// Register an additional kernel. It is validated immediately and becomes a
+// candidate on the next ruc_kernel_init(). rounds_batch kernels must pass
+// constant_time.
+int ruc_kernel_register(int primitive, const char* name, uint32_t required_features, ruc_kernel_fn fn,
+                        bool constant_time = false);
+
+extern "C" {
+    // Detected CPU features (RUC_CPU_* bits)
+    uint32_t ruc_cpu_features();
+
+    // Re-run kernel selection (env overrides, forced kernels, optional autotune).
+    // Returns RUC_KERNEL_OK, or the error of the first RUC_KERNEL entry that
+    // could not be applied (RUC_KERNEL_ERR_UNKNOWN for a malformed entry)
+    int ruc_kernel_init(int autotune);
+
+    // Force a kernel by name (nullptr returns the primitive to automatic selection)
+    int ruc_kernel_force(int primitive, const char* name);
+
+    // Introspection
+    const char* ruc_kernel_active(int primitive);
+    size_t ruc_kernel_count(int primitive);
+    const char* ruc_kernel_name(int primitive, size_t index);
+    uint32_t ruc_kernel_status(int primitive, size_t index);
+    const char* ruc_kernel_primitive_name(int primitive);
+}
+
+#endif // KERNELS_H
@@ -0,0 +1,179 @@
+#include "lz4_block.h"
+#include <cstring>
+
+// LZ4 block format: a run of sequences, each
+//   token (literal length << 4 | match length - 4), [literal length bytes],
+//   literals, 2-byte little-endian offset, [match length bytes]
+// where a nibble of 15 continues in following bytes (255 = keep adding). The
+// last sequence carries literals only. Format rules the encoder must keep: the
+// last 5 bytes are literals and no match starts within the last 12 bytes.
+
+constexpr size_t LZ4_MIN_MATCH = 4;
+constexpr size_t LZ4_LAST_LITERALS = 5;
+constexpr size_t LZ4_MF_LIMIT = 12;
+constexpr size_t LZ4_MAX_OFFSET = 65535;
+constexpr int LZ4_HASH_LOG = 12;
+constexpr int LZ4_SKIP_TRIGGER = 6;      // Probe step grows every 64 missed bytes
+
+static inline uint32_t read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint64_t read64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint32_t hash4(uint32_t v) {
+    return (v * 2654435761u) >> (32 - LZ4_HASH_LOG);
+}
+
+// Length of the common prefix of p and q, stopping at limit (p side)
+static inline size_t match_length(const uint8_t* p, const uint8_t* q, const uint8_t* limit) {
+    const uint8_t* start = p;
+    while (p + 8 <= limit) {
+        uint64_t diff = read64(p) ^ read64(q);
+        if (diff) {
+            // Little-endian (x86, ARM, WASM): lowest set bit is the first differing byte
+            return (size_t)(p - start) + (__builtin_ctzll(diff) >> 3);
+        }
+        p += 8;
+        q += 8;
+    }
+    while (p < limit && *p == *q) {
+        p++;
+        q++;
+    }
+    return (size_t)(p - start);
+}
+
+static inline uint8_t* write_length(uint8_t* op, size_t len) {
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+// Emit one sequence; nullptr if it would overrun oend
+static uint8_t* emit_sequence(uint8_t* op, uint8_t* oend, const uint8_t* literals, size_t lit_len,
+                              size_t offset, size_t match_len) {
+    size_t ml = match_len - LZ4_MIN_MATCH;
+    size_t worst = 1 + lit_len / 255 + 1 + lit_len + 2 + ml / 255 + 1;
+    if (worst > (size_t)(oend - op)) return nullptr;
+
+    uint8_t* token = op++;
+    *token = (uint8_t)(((lit_len >= 15 ? 15 : lit_len) << 4) | (ml >= 15 ? 15 : ml));
+    if (lit_len >= 15) op = write_length(op, lit_len - 15);
+    if (lit_len) memcpy(op, literals, lit_len);
+    op += lit_len;
+    *op++ = (uint8_t)offset;
+    *op++ = (uint8_t)(offset >> 8);
+    if (ml >= 15) op = write_length(op, ml - 15);
+    return op;
+}
+
+size_t lz4_compress_bound(size_t src_len) {
+    return src_len + src_len / 255 + 16;
+}
+
+size_t lz4_compress_block(const uint8_t* src, size_t src_len, uint8_t* dst, size_t dst_cap) {
+    const uint8_t* ip = src;
+    const uint8_t* anchor = src;
+    const uint8_t* iend = src + src_len;
+    uint8_t* op = dst;
+    uint8_t* oend = dst + dst_cap;
+
+    if (src_len > LZ4_MF_LIMIT) {
+        const uint8_t* mflimit = iend - LZ4_MF_LIMIT;
+        const uint8_t* matchlimit = iend - LZ4_LAST_LITERALS;
+        uint32_t table[1 << LZ4_HASH_LOG] = {0};   // Offsets from src
+
+        ip++;
+        while (ip < mflimit) {
+            uint32_t seq = read32(ip);
+            uint32_t h = hash4(seq);
+            const uint8_t* ref = src + table[h];
+            table[h] = (uint32_t)(ip - src);
+            if (ref >= ip || (size_t)(ip - ref) > LZ4_MAX_OFFSET || read32(ref) != seq) {
+                ip += 1 + ((size_t)(ip - anchor) >> LZ4_SKIP_TRIGGER);
+                continue;
+            }
+
+            // Extend backwards over pending literals, then forwards
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+            size_t len = LZ4_MIN_MATCH + match_length(ip + LZ4_MIN_MATCH, ref + LZ4_MIN_MATCH, matchlimit);
+            op = emit_sequence(op, oend, anchor, (size_t)(ip - anchor), (size_t)(ip - ref), len);
+            if (!op) return 0;
+            ip += len;
+            anchor = ip;
+            if (ip < mflimit) table[hash4(read32(ip - 2))] = (uint32_t)(ip - 2 - src);
+        }
+    }
+
+    // Trailing literals
+    size_t lit_len = (size_t)(iend - anchor);
+    if (1 + lit_len / 255 + 1 + lit_len > (size_t)(oend - op)) return 0;
+    *op++ = (uint8_t)((lit_len >= 15 ? 15 : lit_len) << 4);
+    if (lit_len >= 15) op = write_length(op, lit_len - 15);
+    if (lit_len) memcpy(op, anchor, lit_len);
+    op += lit_len;
+    return (size_t)(op - dst);
+}
+
+// Read a continued length (after a nibble of 15); false on truncation
+static inline bool read_length(const uint8_t*& ip, const uint8_t* iend, size_t& len) {
+    uint8_t b;
+    do {
+        if (ip >= iend) return false;
+        b = *ip++;
+        len += b;
+    } while (b == 255);
+    return true;
+}
+
+int lz4_decompress_block(const uint8_t* src, size_t src_len, uint8_t* dst, size_t dst_len) {
+    const uint8_t* ip = src;
+    const uint8_t* iend = src + src_len;
+    uint8_t* op = dst;
+    uint8_t* oend = dst + dst_len;
+
+    for (;;) {
+        if (ip >= iend) return -1;
+        uint8_t token = *ip++;
+
+        size_t lit_len = token >> 4;
+        if (lit_len == 15 && !read_length(ip, iend, lit_len)) return -1;
+        if (lit_len > (size_t)(iend - ip) || lit_len > (size_t)(oend - op)) return -1;
+        if (lit_len) memcpy(op, ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+        if (ip == iend) return op == oend ? 0 : -1;
+
+        if (iend - ip < 2) return -1;
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst)) return -1;
+
+        size_t match_len = token & 15;
+        if (match_len == 15 && !read_length(ip, iend, match_len)) return -1;
+        match_len += LZ4_MIN_MATCH;
+        if (match_len > (size_t)(oend - op)) return -1;
+
+        const uint8_t* ref = op - offset;
+        if (offset >= match_len) {
+            memcpy(op, ref, match_len);
+            op += match_len;
+        } else {
+            // Overlapping copy repeats the last offset bytes
+            for (size_t i = 0; i < match_len; i++) *op++ = ref[i];
+        }
+    }
+}
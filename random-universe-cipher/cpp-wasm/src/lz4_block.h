@@ -0,0 +1,23 @@
+#ifndef LZ4_BLOCK_H
+#define LZ4_BLOCK_H
+
+#include <cstdint>
+#include <cstddef>
+
+// LZ4 block format codec (greedy single-probe matcher, LZ4 "fast" level 1).
+// Output is a plain LZ4 block, readable by any LZ4 block decoder; there is no
+// frame or checksum here (see ruc_compress.cpp for the framing).
+
+// Worst-case compressed size of src_len bytes
+size_t lz4_compress_bound(size_t src_len);
+
+// Compress src into dst. Returns the compressed size, or 0 if the result would
+// not fit in dst_cap; passing dst_cap < src_len makes incompressible input
+// bail out early.
+size_t lz4_compress_block(const uint8_t* src, size_t src_len, uint8_t* dst, size_t dst_cap);
+
+// Decompress a block that expands to exactly dst_len bytes. Bounds-checked
+// against both buffers; returns 0, or -1 for malformed input.
+int lz4_decompress_block(const uint8_t* src, size_t src_len, uint8_t* dst, size_t dst_len);
+
+#endif // LZ4_BLOCK_H
@@ -0,0 +1,266 @@
+#include "ruc_cipher.h"
+#include "ruc_engine.h"
+#include "ruc_metrics.h"
+#include "ruc_parallel.h"
+#include "ruc_trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+#define RUC_ASYNC_THREADS 1
+#endif
+
+// Asynchronous context encryption for event-loop callers, on the shared
+// engine pool (ruc_parallel.h). A request is split into RUC_ASYNC_CHUNK_BLOCKS
+// chunks; up to one runner per pool thread claims chunks from it, and after
+// every chunk a runner goes to the back of the async queue, so concurrent
+// requests interleave instead of one large request holding every thread.
+// Each runner is served by a task posted to the engine pool, which works the
+// queue until it is empty. Cancellation stops further chunks from being
+// claimed; the completion callback runs once, on a pool thread, after the
+// last in-flight chunk. Non-pthread WASM builds run requests inline.
+//
+// ruc_async_shutdown() (also run from an atexit handler, so a program that
+// returns from main without it still exits cleanly) refuses new requests,
+// lets in-flight ones finish and waits for every posted task to return before
+// the static mutex and condition variable below are destroyed.
+
+constexpr size_t RUC_ASYNC_CHUNK_BLOCKS = 64;
+
+struct AsyncRequest {
+    uint64_t id;
+    int op;                          // RUC_OP_ENCRYPT_ASYNC / RUC_OP_DECRYPT_ASYNC
+    RucContext ctx;                  // Retained copy (keeps the key alive)
+    const uint8_t* input;
+    uint8_t* output;
+    size_t num_blocks;
+    uint32_t start_block_number;
+    size_t num_chunks;
+    ruc_async_callback callback;
+    void* user;
+    std::chrono::steady_clock::time_point submitted;
+    std::atomic<size_t> next_chunk;
+    std::atomic<size_t> done_chunks;
+    std::atomic<size_t> runners;
+    std::atomic<bool> cancelled;
+};
+
+typedef std::shared_ptr<AsyncRequest> AsyncRequestPtr;
+
+static std::mutex async_mutex;
+static std::unordered_map<uint64_t, AsyncRequestPtr> async_active;
+static uint64_t async_next_id = 1;
+static bool async_shutting_down = false;          // Submits refused
+
+#ifdef RUC_ASYNC_THREADS
+static std::condition_variable async_idle_cv;     // a request or task finished
+static std::deque<AsyncRequestPtr> async_queue;   // one entry per runner
+static size_t async_tasks = 0;                    // Posted tasks not yet returned
+static size_t async_max_runners = 0;              // Per request (0 = pool size)
+static bool async_started = false;
+static thread_local bool in_async_task = false;
+#endif
+
+static void finish_request(const AsyncRequestPtr& req) {
+    bool complete = req->done_chunks.load() == req->num_chunks;
+    int status = complete ? 0 : -2;
+    {
+        std::lock_guard<std::mutex> lock(async_mutex);
+        async_active.erase(req->id);
+    }
+    ruc_ctx_release_copy(&req->ctx);
+    uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - req->submitted).count();
+    if (ruc_metrics_enabled()) ruc_metrics_record(req->op, ns, (uint64_t)req->num_blocks * BLOCK_SIZE);
+    req->callback(req->id, status, req->user);
+#ifdef RUC_ASYNC_THREADS
+    async_idle_cv.notify_all();
+#endif
+}
+
+// Process one chunk; false once the request has nothing left to claim
+static bool run_chunk(AsyncRequest* req) {
+    if (req->cancelled.load(std::memory_order_relaxed)) return false;
+    size_t chunk = req->next_chunk.fetch_add(1);
+    if (chunk >= req->num_chunks) return false;
+    size_t begin = chunk * RUC_ASYNC_CHUNK_BLOCKS;
+    size_t count = std::min(RUC_ASYNC_CHUNK_BLOCKS, req->num_blocks - begin);
+    RucTraceSpan span("async_chunk", "blocks", count);
+    ruc_process_blocks(req->ctx.km, req->ctx.key, req->ctx.iv, req->ctx.iv_expanded,
+                       req->start_block_number + (uint32_t)begin,
+                       req->input + begin * BLOCK_SIZE, count, req->output + begin * BLOCK_SIZE);
+    req->done_chunks.fetch_add(1);
+    return true;
+}
+
+#ifdef RUC_ASYNC_THREADS
+// One posted engine pool task: serve runners until the queue is empty
+static void async_task() {
+    in_async_task = true;
+    for (;;) {
+        AsyncRequestPtr req;
+        {
+            std::lock_guard<std::mutex> lock(async_mutex);
+            if (async_queue.empty()) break;
+            req = std::move(async_queue.front());
+            async_queue.pop_front();
+        }
+        if (run_chunk(req.get())) {
+            // Yield: go to the back of the queue behind other requests
+            std::lock_guard<std::mutex> lock(async_mutex);
+            async_queue.push_back(std::move(req));
+        } else if (req->runners.fetch_sub(1) == 1) {
+            finish_request(req);
+        }
+    }
+    in_async_task = false;
+    std::lock_guard<std::mutex> lock(async_mutex);
+    async_tasks--;
+    async_idle_cv.notify_all();
+}
+
+static void stop_pool_at_exit() {
+    ruc_async_shutdown();
+}
+
+// Caller holds async_mutex
+static void start_locked(size_t max_runners) {
+    if (!async_started) {
+        atexit(stop_pool_at_exit);
+        async_started = true;
+    }
+    async_max_runners = max_runners;
+    async_shutting_down = false;
+}
+#endif
+
+int ruc_async_init(size_t num_threads) {
+#ifdef RUC_ASYNC_THREADS
+    std::lock_guard<std::mutex> lock(async_mutex);
+    if (async_started && !async_shutting_down) return -1;
+    start_locked(num_threads);
+#else
+    (void)num_threads;
+    std::lock_guard<std::mutex> lock(async_mutex);
+    async_shutting_down = false;
+#endif
+    return 0;
+}
+
+void ruc_async_shutdown() {
+    std::unique_lock<std::mutex> lock(async_mutex);
+    async_shutting_down = true;
+#ifdef RUC_ASYNC_THREADS
+    // exit() from a completion callback runs this inside a posted task, which
+    // cannot wait for itself
+    size_t own_task = in_async_task ? 1 : 0;
+    async_idle_cv.wait(lock, [own_task] { return async_active.empty() && async_tasks == own_task; });
+#endif
+}
+
+static uint64_t submit(
+    int op,
+    uint32_t ctx_id,
+    const uint8_t* input_blocks,
+    size_t num_blocks,
+    uint32_t start_block_number,
+    uint8_t* output_blocks,
+    ruc_async_callback callback,
+    void* user
+) {
+    if (!callback) return 0;
+    AsyncRequestPtr req = std::make_shared<AsyncRequest>();
+    if (!ruc_ctx_retain_copy(ctx_id, &req->ctx)) return 0;
+    req->op = op;
+    req->input = input_blocks;
+    req->output = output_blocks;
+    req->num_blocks = num_blocks;
+    req->start_block_number = start_block_number;
+    req->num_chunks = (num_blocks + RUC_ASYNC_CHUNK_BLOCKS - 1) / RUC_ASYNC_CHUNK_BLOCKS;
+    req->callback = callback;
+    req->user = user;
+    req->submitted = std::chrono::steady_clock::now();
+    req->next_chunk = 0;
+    req->done_chunks = 0;
+    req->cancelled = false;
+
+#ifdef RUC_ASYNC_THREADS
+    size_t runners;
+    {
+        std::lock_guard<std::mutex> lock(async_mutex);
+        if (async_shutting_down) {
+            ruc_ctx_release_copy(&req->ctx);
+            return 0;
+        }
+        if (!async_started) start_locked(0);
+        size_t pool = ruc_parallel_max_workers() - 1;
+        if (async_max_runners) pool = std::min(pool, async_max_runners);
+        req->id = async_next_id++;
+        runners = std::max<size_t>(1, std::min(req->num_chunks, pool));
+        req->runners = runners;
+        async_active[req->id] = req;
+        for (size_t i = 0; i < runners; i++) {
+            async_queue.push_back(req);
+        }
+        async_tasks += runners;
+    }
+    // runners never exceeds the pool size, so every posted task runs
+    ruc_parallel_post(runners, [](size_t) { async_task(); });
+#else
+    {
+        std::lock_guard<std::mutex> lock(async_mutex);
+        if (async_shutting_down) {
+            ruc_ctx_release_copy(&req->ctx);
+            return 0;
+        }
+        req->id = async_next_id++;
+        async_active[req->id] = req;
+    }
+    req->runners = 1;
+    while (run_chunk(req.get())) {}
+    finish_request(req);
+#endif
+    return req->id;
+}
+
+uint64_t ruc_ctx_encrypt_async(
+    uint32_t ctx_id,
+    const uint8_t* input_blocks,
+    size_t num_blocks,
+    uint32_t start_block_number,
+    uint8_t* output_blocks,
+    ruc_async_callback callback,
+    void* user
+) {
+    return submit(RUC_OP_ENCRYPT_ASYNC, ctx_id, input_blocks, num_blocks, start_block_number,
+                  output_blocks, callback, user);
+}
+
+// Decryption is the same keystream XOR
+uint64_t ruc_ctx_decrypt_async(
+    uint32_t ctx_id,
+    const uint8_t* input_blocks,
+    size_t num_blocks,
+    uint32_t start_block_number,
+    uint8_t* output_blocks,
+    ruc_async_callback callback,
+    void* user
+) {
+    return submit(RUC_OP_DECRYPT_ASYNC, ctx_id, input_blocks, num_blocks, start_block_number,
+                  output_blocks, callback, user);
+}
+
+int ruc_async_cancel(uint64_t request_id) {
+    std::lock_guard<std::mutex> lock(async_mutex);
+    auto it = async_active.find(request_id);
+    if (it == async_active.end()) return -1;
+    it->second->cancelled.store(true);
+    return 0;
+}
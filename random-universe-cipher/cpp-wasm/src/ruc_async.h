@@ -0,0 +1,174 @@
+#ifndef RUC_ASYNC_H
+#define RUC_ASYNC_H
+
+#include "ruc_cipher.h"
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <future>
+
+// C++ front ends for ruc_ctx_encrypt_async/ruc_ctx_decrypt_async (header only;
+// the library itself stays C++17):
+//
+//   std::future<int> f = ruc::encrypt_future(ctx, in, out, num_blocks);
+//
+//   // C++20
+//   int status = co_await ruc::encrypt_async(ctx, in_span, out_span);
+//
+// Status is 0, -1 for an unknown context, or -2 if cancelled through a
+// CancelToken. Awaiting coroutines resume on an engine pool thread unless an
+// executor is given that posts the handle back to the caller's event loop.
+
+namespace ruc {
+
+// Cancels the request it is attached to; safe to use from any thread, and a
+// cancel() before the request is submitted takes effect on submission
+class CancelToken {
+public:
+    CancelToken() : id_(0), cancel_requested_(false) {}
+    CancelToken(const CancelToken&) = delete;
+    CancelToken& operator=(const CancelToken&) = delete;
+
+    void cancel() {
+        cancel_requested_.store(true);
+        uint64_t id = id_.load();
+        if (id) ruc_async_cancel(id);
+    }
+    bool cancel_requested() const { return cancel_requested_.load(); }
+
+    // Called by the wrappers once the request has an ID
+    void bind(uint64_t id) {
+        id_.store(id);
+        if (cancel_requested_.load()) ruc_async_cancel(id);
+    }
+
+private:
+    std::atomic<uint64_t> id_;
+    std::atomic<bool> cancel_requested_;
+};
+
+namespace detail {
+
+inline void complete_promise(uint64_t, int status, void* user) {
+    std::promise<int>* promise = static_cast<std::promise<int>*>(user);
+    promise->set_value(status);
+    delete promise;
+}
+
+inline std::future<int> submit_future(bool decrypt, uint32_t ctx_id, const uint8_t* input,
+                                      uint8_t* output, size_t num_blocks, uint32_t start_block,
+                                      CancelToken* token) {
+    std::promise<int>* promise = new std::promise<int>();
+    std::future<int> future = promise->get_future();
+    uint64_t id = decrypt
+        ? ruc_ctx_decrypt_async(ctx_id, input, num_blocks, start_block, output, complete_promise, promise)
+        : ruc_ctx_encrypt_async(ctx_id, input, num_blocks, start_block, output, complete_promise, promise);
+    if (id == 0) {
+        promise->set_value(-1);
+        delete promise;
+    } else if (token) {
+        token->bind(id);
+    }
+    return future;
+}
+
+} // namespace detail
+
+inline std::future<int> encrypt_future(uint32_t ctx_id, const uint8_t* input, uint8_t* output,
+                                       size_t num_blocks, uint32_t start_block = 0,
+                                       CancelToken* token = nullptr) {
+    return detail::submit_future(false, ctx_id, input, output, num_blocks, start_block, token);
+}
+
+inline std::future<int> decrypt_future(uint32_t ctx_id, const uint8_t* input, uint8_t* output,
+                                       size_t num_blocks, uint32_t start_block = 0,
+                                       CancelToken* token = nullptr) {
+    return detail::submit_future(true, ctx_id, input, output, num_blocks, start_block, token);
+}
+
+} // namespace ruc
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>) && __has_include(<span>)
+#include <coroutine>
+#include <functional>
+#include <span>
+
+namespace ruc {
+
+// Posts a resumption to the caller's executor (e.g. an event loop); empty
+// means resume directly on the engine thread that finished the request
+typedef std::function<void(std::coroutine_handle<>)> Executor;
+
+class AsyncOp {
+public:
+    AsyncOp(bool decrypt, uint32_t ctx_id, const uint8_t* input, uint8_t* output, size_t num_blocks,
+            uint32_t start_block, CancelToken* token, Executor executor)
+        : decrypt_(decrypt), ctx_id_(ctx_id), input_(input), output_(output), num_blocks_(num_blocks),
+          start_block_(start_block), token_(token), executor_(std::move(executor)), status_(0) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+        handle_ = handle;
+        // The callback may resume (and destroy) this awaiter before submit
+        // returns, so nothing below touches members once it is issued
+        CancelToken* token = token_;
+        uint64_t id = decrypt_
+            ? ruc_ctx_decrypt_async(ctx_id_, input_, num_blocks_, start_block_, output_, on_complete, this)
+            : ruc_ctx_encrypt_async(ctx_id_, input_, num_blocks_, start_block_, output_, on_complete, this);
+        if (id == 0) {
+            status_ = -1;
+            return false;
+        }
+        if (token) token->bind(id);
+        return true;
+    }
+
+    int await_resume() const noexcept { return status_; }
+
+private:
+    static void on_complete(uint64_t, int status, void* user) {
+        AsyncOp* op = static_cast<AsyncOp*>(user);
+        op->status_ = status;
+        // Resuming may destroy the awaiter: take what is needed first
+        std::coroutine_handle<> handle = op->handle_;
+        Executor executor = std::move(op->executor_);
+        if (executor) {
+            executor(handle);
+        } else {
+            handle.resume();
+        }
+    }
+
+    bool decrypt_;
+    uint32_t ctx_id_;
+    const uint8_t* input_;
+    uint8_t* output_;
+    size_t num_blocks_;
+    uint32_t start_block_;
+    CancelToken* token_;
+    Executor executor_;
+    int status_;
+    std::coroutine_handle<> handle_;
+};
+
+// in.size() must be a multiple of BLOCK_SIZE and out at least as large
+inline AsyncOp encrypt_async(uint32_t ctx_id, std::span<const uint8_t> in, std::span<uint8_t> out,
+                             uint32_t start_block = 0, CancelToken* token = nullptr,
+                             Executor executor = {}) {
+    return AsyncOp(false, ctx_id, in.data(), out.data(), in.size() / BLOCK_SIZE, start_block, token,
+                   std::move(executor));
+}
+
+inline AsyncOp decrypt_async(uint32_t ctx_id, std::span<const uint8_t> in, std::span<uint8_t> out,
+                             uint32_t start_block = 0, CancelToken* token = nullptr,
+                             Executor executor = {}) {
+    return AsyncOp(true, ctx_id, in.data(), out.data(), in.size() / BLOCK_SIZE, start_block, token,
+                   std::move(executor));
+}
+
+} // namespace ruc
+
+#endif // coroutines
+
+#endif // RUC_ASYNC_H
@@ -0,0 +1,99 @@
+#include "ruc_cipher.h"
+#include "ruc_engine.h"
+#include "ruc_metrics.h"
+#include "ruc_parallel.h"
+#include "ruc_trace.h"
+#include <algorithm>
+#include <vector>
+
+// Multi-message batches. Small messages (a few blocks each) are dominated by
+// per-call setup and leave threads idle, so jobs are flattened into one block
+// sequence and engine pool workers claim fixed-size chunks of it; a chunk may
+// cover the tail of one message and the head of the next.
+
+constexpr size_t MANY_CHUNK_BLOCKS = 8;
+
+struct PreparedJob {
+    uint32_t key_id;       // Retained until the batch finishes
+    const KeyMaterial* km;
+    const uint8_t* key;
+    const uint8_t* iv;
+    uint8_t iv_expanded[REGISTER_SIZE];
+    uint32_t start_block_number;
+    const uint8_t* input;
+    uint8_t* output;
+    size_t num_blocks;
+    size_t first_block;    // Offset of this job in the flattened sequence
+};
+
+// Process flattened blocks [begin, end)
+static void process_range(const std::vector<PreparedJob>& prepared, size_t begin, size_t end) {
+    // Last job whose first block is <= begin
+    size_t j = std::upper_bound(prepared.begin(), prepared.end(), begin,
+        [](size_t block, const PreparedJob& job) { return block < job.first_block; }) - prepared.begin() - 1;
+
+    while (begin < end) {
+        const PreparedJob& job = prepared[j];
+        size_t offset = begin - job.first_block;
+        size_t count = std::min(job.num_blocks - offset, end - begin);
+        if (count > 0) {
+            ruc_process_blocks(job.km, job.key, job.iv, job.iv_expanded,
+                               job.start_block_number + (uint32_t)offset,
+                               job.input + offset * BLOCK_SIZE, count,
+                               job.output + offset * BLOCK_SIZE);
+        }
+        begin += count;
+        j++;
+    }
+}
+
+size_t ruc_encrypt_many(RucJob* jobs, size_t num_jobs) {
+    RucCallTimer timer(RUC_OP_ENCRYPT_MANY, 0);
+    std::vector<PreparedJob> prepared;
+    prepared.reserve(num_jobs);
+    size_t failed = 0;
+    size_t total_blocks = 0;
+
+    // Resolve keys and expand IVs once per job
+    for (size_t i = 0; i < num_jobs; i++) {
+        RucJob& job = jobs[i];
+        PreparedJob p;
+        if (!ruc_key_retain(job.key_id, &p.km, &p.key)) {
+            job.status = -1;
+            failed++;
+            continue;
+        }
+        job.status = 0;
+        if (job.num_blocks == 0) {
+            ruc_key_release(job.key_id);
+            continue;
+        }
+        p.key_id = job.key_id;
+        p.iv = job.iv;
+        ruc_expand_iv(job.iv, p.iv_expanded);
+        p.start_block_number = job.start_block_number;
+        p.input = job.input;
+        p.output = job.output;
+        p.num_blocks = job.num_blocks;
+        p.first_block = total_blocks;
+        total_blocks += job.num_blocks;
+        prepared.push_back(p);
+    }
+    timer.set_bytes((uint64_t)total_blocks * BLOCK_SIZE);
+
+    // Keys are retained, so a concurrent ruc_key_destroy cannot free them mid-batch
+    ruc_parallel_for(total_blocks, MANY_CHUNK_BLOCKS, [&](size_t begin, size_t end) {
+        RucTraceSpan span("many_chunk", "blocks", end - begin);
+        process_range(prepared, begin, end);
+    });
+    for (const PreparedJob& p : prepared) ruc_key_release(p.key_id);
+    return failed;
+}
+
+// Decryption is the same keystream XOR
+size_t ruc_decrypt_many(RucJob* jobs, size_t num_jobs) {
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < num_jobs; i++) bytes += (uint64_t)jobs[i].num_blocks * BLOCK_SIZE;
+    RucCallTimer timer(RUC_OP_DECRYPT_MANY, bytes);
+    return ruc_encrypt_many(jobs, num_jobs);
+}
@@ -3,6 +3,10 @@
 #include "shake256.h"
 #include "chacha20.h"
 #include "sbox.h"
+#include "kernels.h"
+#include "ruc_engine.h"
+#include "ruc_metrics.h"
+#include "ruc_trace.h"
 #include <cstring>
 #include <cstdlib>
 #include <algorithm>
@@ -10,14 +14,30 @@
 #include <cstdio>
 
 // Profiling counters (for performance analysis) - exported for access from shake256.cpp
-uint64_t profile_shake256_calls = 0;
-static uint64_t profile_rounds_executed = 0;
-static uint64_t profile_selector_ordering_calls = 0;
-static uint64_t profile_keystream_calls = 0;
-static uint64_t profile_counter_hash_calls = 0;
-static uint64_t profile_gf_mul_calls = 0;
-static uint64_t profile_register_ops_calls = 0;
-static uint64_t profile_blocks_processed = 0;
+// Per-thread so native callers can run batches concurrently; stats describe the
+// calling thread's last batch
+thread_local uint64_t profile_shake256_calls = 0;
+static thread_local uint64_t profile_rounds_executed = 0;
+static thread_local uint64_t profile_selector_ordering_calls = 0;
+static thread_local uint64_t profile_keystream_calls = 0;
+static thread_local uint64_t profile_counter_hash_calls = 0;
+static thread_local uint64_t profile_gf_mul_calls = 0;
+static thread_local uint64_t profile_register_ops_calls = 0;
+static thread_local uint64_t profile_blocks_processed = 0;
+
+// Per-thread phase probe (see ruc_engine.h)
+static thread_local ruc_phase_probe_fn phase_probe = nullptr;
+static thread_local void* phase_probe_user = nullptr;
+
+void ruc_set_phase_probe(ruc_phase_probe_fn probe, void* user) {
+    phase_probe = probe;
+    phase_probe_user = user;
+}
+
+static inline void phase_mark(int phase) {
+    if (phase_probe) phase_probe(phase, phase_probe_user);
+    if (ruc_trace_enabled()) ruc_trace_phase(phase);
+}
 
 // Rotate 512-bit register left by n bits
 static void rotate_left_512(const uint8_t* reg, int n, uint8_t* result) {
@@ -73,14 +93,13 @@ static uint64_t bytes_to_u64(const uint8_t* bytes) {
            ((uint64_t)bytes[7] << 56);
 }
 
-// Order selectors by priority
-static void order_selectors(
+// Draw one priority (0..6) per selector for this block
+static void selector_priorities(
     const KeyMaterial* km,
     const uint8_t* key,
     const uint8_t* iv,
     uint64_t block_number,
-    uint16_t* ordered_selectors,
-    size_t* selector_indices  // Output: index in km->selectors for each ordered selector
+    uint32_t* priorities
 ) {
     // Create seed: key || iv || block_number || "RUC-PRIO"
     uint8_t block_bytes[8];
@@ -101,6 +120,22 @@ static void order_selectors(
     delete[] seed_input;
     
     ChaCha20PRNG prng(seed);
+    for (size_t i = 0; i < km->num_selectors; i++) {
+        priorities[i] = prng.next_int(7);
+    }
+}
+
+// Order selectors by priority
+static void order_selectors(
+    const KeyMaterial* km,
+    const uint8_t* key,
+    const uint8_t* iv,
+    uint64_t block_number,
+    uint16_t* ordered_selectors,
+    size_t* selector_indices  // Output: index in km->selectors for each ordered selector
+) {
+    uint32_t drawn[MAX_SELECTORS];
+    selector_priorities(km, key, iv, block_number, drawn);
     
     // Assign priorities
     struct PriorityItem {
@@ -113,7 +148,7 @@ static void order_selectors(
     for (size_t i = 0; i < km->num_selectors; i++) {
         PriorityItem item;
         item.selector = km->selectors[i];
-        item.priority = prng.next_int(7);
+        item.priority = drawn[i];
         item.index = i;
         priorities.push_back(item);
     }
@@ -137,18 +172,60 @@ static void order_selectors(
     }
 }
 
-// Execute a single round
-static void execute_round(
+// Same ordering as order_selectors without data-dependent branches or
+// addresses: each selector's rank is counted with arithmetic compares and the
+// outputs are gathered with masks (used by the constant-time engine)
+void ruc_order_selectors_ct(
+    const KeyMaterial* km,
+    const uint8_t* key,
+    const uint8_t* iv,
+    uint64_t block_number,
+    uint16_t* ordered_selectors,
+    size_t* selector_indices
+) {
+    uint32_t priorities[MAX_SELECTORS];
+    selector_priorities(km, key, iv, block_number, priorities);
+    
+    // Stable rank: lower priorities first, ties keep selector order
+    // (priorities are < 7, so the subtractions below only underflow on "less than")
+    const uint32_t n = (uint32_t)km->num_selectors;
+    uint32_t rank[MAX_SELECTORS];
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t r = 0;
+        for (uint32_t j = 0; j < n; j++) {
+            uint32_t less = (priorities[j] - priorities[i]) >> 31;
+            uint32_t equal = ((priorities[j] ^ priorities[i]) - 1) >> 31;
+            uint32_t before = (j - i) >> 31;
+            r += less | (equal & before);
+        }
+        rank[i] = r;
+    }
+    
+    for (uint32_t pos = 0; pos < n; pos++) {
+        uint16_t selector = 0;
+        size_t index = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            uint32_t hit = ((rank[i] ^ pos) - 1) >> 31;
+            selector |= (uint16_t)(km->selectors[i] & (0 - hit));
+            index |= (size_t)i & (0 - (size_t)hit);
+        }
+        ordered_selectors[pos] = selector;
+        selector_indices[pos] = index;
+    }
+}
+
+// Execute a single round (reference round kernel, see kernels.h)
+void execute_round_ref(
     CipherState* state,
     int round_index,
     const uint16_t* ordered_selectors,
     const size_t* selector_indices,  // New: pre-computed indices for fast constant lookup
     size_t num_selectors,
-    const KeyMaterial* km,
-    const uint8_t* key
+    const KeyMaterial* km
 ) {
     const uint8_t* sbox = km->sboxes[round_index];
     const uint8_t* round_key = km->round_keys[round_index];
+    const gf_mul_register_fn gf_mul_register = ruc_kernels().gf_mul_register;
     
     // Process each selector
     for (size_t sel_idx = 0; sel_idx < num_selectors; sel_idx++) {
@@ -178,7 +255,7 @@ static void execute_round(
         // Update state register: GF multiply each byte (in-place)
         uint8_t* reg = state->registers[place_idx];
         profile_gf_mul_calls += REGISTER_SIZE;
-        gf_mul_register_inplace(reg, result);
+        gf_mul_register(reg, result);
         
         // XOR with shifted result (in-place)
         int shift_amount = sel % 16;
@@ -262,6 +339,7 @@ static void apply_ciphertext_feedback(CipherState* state, const uint8_t* ciphert
 
 // Expand key into key material
 void* ruc_expand_key(const uint8_t* key) {
+    RucCallTimer timer(RUC_OP_EXPAND, KEY_SIZE);
     KeyMaterial* km = (KeyMaterial*)malloc(sizeof(KeyMaterial));
     
     // Generate 7 state registers
@@ -342,6 +420,7 @@ void ruc_encrypt_block(
     void* key_material,
     uint8_t* ciphertext
 ) {
+    RucCallTimer timer(RUC_OP_ENCRYPT_BLOCK, BLOCK_SIZE);
     KeyMaterial* km = (KeyMaterial*)key_material;
     
     // Create state from key material
@@ -363,7 +442,7 @@ void ruc_encrypt_block(
     // Incorporate counter (CTR mode)
     uint8_t counter_bytes[8];
     for (int i = 0; i < 8; i++) {
-        counter_bytes[i] = (block_number >> (i * 8)) & 0xFF;
+        counter_bytes[i] = ((uint64_t)block_number >> (i * 8)) & 0xFF;
     }
     uint8_t counter_hash[REGISTER_SIZE];
     uint8_t ctr_input[8 + 3];
@@ -378,8 +457,9 @@ void ruc_encrypt_block(
     order_selectors(km, key, iv, block_number, ordered_selectors, selector_indices);
     
     // Execute all rounds
+    const round_fn execute_round = ruc_kernels().round;
     for (int r = 0; r < ROUNDS; r++) {
-        execute_round(&state, r, ordered_selectors, selector_indices, km->num_selectors, km, key);
+        execute_round(&state, r, ordered_selectors, selector_indices, km->num_selectors, km);
     }
     
     // Generate keystream
@@ -404,21 +484,98 @@ void ruc_decrypt_block(
     void* key_material,
     uint8_t* plaintext
 ) {
+    RucCallTimer timer(RUC_OP_DECRYPT_BLOCK, BLOCK_SIZE);
     ruc_encrypt_block(ciphertext, key, iv, block_number, key_material, plaintext);
 }
 
-// Encrypt multiple blocks in batch (optimized with caching)
-void ruc_encrypt_blocks_batch(
-    const uint8_t* plaintext_blocks,
-    size_t num_blocks,
+// Expand IV into a register-sized mask (same for all blocks with the same IV)
+void ruc_expand_iv(const uint8_t* iv, uint8_t* iv_expanded) {
+    uint8_t iv_input[IV_SIZE + 14];
+    memcpy(iv_input, iv, IV_SIZE);
+    memcpy(iv_input + IV_SIZE, "RUC-IV-EXPAND", 13);
+    shake256_hash(iv_input, IV_SIZE + 13, iv_expanded, REGISTER_SIZE);
+}
+
+// Initial per-block state: key registers, IV mask and counter hash (CTR mode)
+void ruc_init_block_state(
+    const KeyMaterial* km,
+    const uint8_t* iv_expanded,
+    uint32_t block_number,
+    CipherState* state
+) {
+    memcpy(state->registers, km->registers, REGISTER_COUNT * REGISTER_SIZE);
+    memset(state->accumulator, 0, ACCUMULATOR_SIZE);
+    
+    // Mix pre-computed IV into state (no SHAKE256 call per block!) - in-place
+    for (int j = 0; j < REGISTER_COUNT; j++) {
+        xor_512_inplace(state->registers[j], iv_expanded);
+    }
+    
+    // Incorporate counter (CTR mode)
+    uint8_t counter_bytes[8];
+    for (int j = 0; j < 8; j++) {
+        counter_bytes[j] = ((uint64_t)block_number >> (j * 8)) & 0xFF;
+    }
+    uint8_t counter_hash[REGISTER_SIZE];
+    uint8_t ctr_input[8 + 3];
+    memcpy(ctr_input, counter_bytes, 8);
+    memcpy(ctr_input + 8, "CTR", 3);
+    profile_counter_hash_calls++;
+    shake256_hash(ctr_input, 11, counter_hash, REGISTER_SIZE);
+    xor_512_inplace(state->registers[0], counter_hash);
+}
+
+// Keystream for a block after all rounds
+void ruc_block_keystream(const CipherState* state, uint32_t block_number, uint8_t* keystream) {
+    profile_keystream_calls++;
+    generate_keystream(state, block_number, keystream);
+}
+
+// One block's state and keystream: counter hash, selector ordering, rounds
+static inline void compute_block_keystream(
+    const KeyMaterial* km,
+    const uint8_t* key,
+    const uint8_t* iv,
+    const uint8_t* iv_expanded,
+    uint32_t block_number,
+    round_fn execute_round,
+    CipherState* state,
+    uint8_t* keystream
+) {
+    // Create state from key material, IV and counter
+    phase_mark(RUC_PHASE_COUNTER_HASH);
+    ruc_init_block_state(km, iv_expanded, block_number, state);
+    
+    // Order selectors (uses SHAKE256 but necessary for security)
+    phase_mark(RUC_PHASE_ORDER_SELECTORS);
+    profile_selector_ordering_calls++;
+    uint16_t ordered_selectors[MAX_SELECTORS];
+    size_t selector_indices[MAX_SELECTORS];
+    order_selectors(km, key, iv, block_number, ordered_selectors, selector_indices);
+    
+    // Execute all rounds
+    phase_mark(RUC_PHASE_ROUNDS);
+    profile_rounds_executed += ROUNDS;
+    for (int r = 0; r < ROUNDS; r++) {
+        execute_round(state, r, ordered_selectors, selector_indices, km->num_selectors, km);
+    }
+    
+    // Generate keystream
+    phase_mark(RUC_PHASE_KEYSTREAM);
+    ruc_block_keystream(state, block_number, keystream);
+}
+
+// Process a run of blocks with a pre-expanded IV (shared by all batch entry points)
+void ruc_process_blocks(
+    const KeyMaterial* km,
     const uint8_t* key,
     const uint8_t* iv,
+    const uint8_t* iv_expanded,
     uint32_t start_block_number,
-    void* key_material,
+    const uint8_t* plaintext_blocks,
+    size_t num_blocks,
     uint8_t* ciphertext_blocks
 ) {
-    KeyMaterial* km = (KeyMaterial*)key_material;
-    
     // Reset profiling counters for this batch
     profile_shake256_calls = 0;
     profile_rounds_executed = 0;
@@ -429,56 +586,14 @@ void ruc_encrypt_blocks_batch(
     profile_register_ops_calls = 0;
     profile_blocks_processed = num_blocks; // Set total blocks for this batch
     
-    // Pre-compute IV expansion once (same for all blocks with same IV) - MAJOR OPTIMIZATION!
-    uint8_t iv_expanded[REGISTER_SIZE];
-    uint8_t iv_input[IV_SIZE + 14];
-    memcpy(iv_input, iv, IV_SIZE);
-    memcpy(iv_input + IV_SIZE, "RUC-IV-EXPAND", 13);
-    shake256_hash(iv_input, IV_SIZE + 13, iv_expanded, REGISTER_SIZE);
+    const round_fn execute_round = ruc_kernels().round;
     
     // Process all blocks
     for (size_t i = 0; i < num_blocks; i++) {
         uint32_t block_number = start_block_number + i;
-        
-        // Create state from key material
         CipherState state;
-        memcpy(state.registers, km->registers, REGISTER_COUNT * REGISTER_SIZE);
-        memset(state.accumulator, 0, ACCUMULATOR_SIZE);
-        
-        // Mix pre-computed IV into state (no SHAKE256 call per block!) - in-place
-        for (int j = 0; j < REGISTER_COUNT; j++) {
-            xor_512_inplace(state.registers[j], iv_expanded);
-        }
-        
-        // Incorporate counter (CTR mode)
-        uint8_t counter_bytes[8];
-        for (int j = 0; j < 8; j++) {
-            counter_bytes[j] = (block_number >> (j * 8)) & 0xFF;
-        }
-        uint8_t counter_hash[REGISTER_SIZE];
-        uint8_t ctr_input[8 + 3];
-        memcpy(ctr_input, counter_bytes, 8);
-        memcpy(ctr_input + 8, "CTR", 3);
-        profile_counter_hash_calls++;
-        shake256_hash(ctr_input, 11, counter_hash, REGISTER_SIZE);
-        xor_512_inplace(state.registers[0], counter_hash);
-        
-        // Order selectors (uses SHAKE256 but necessary for security)
-        profile_selector_ordering_calls++;
-        uint16_t ordered_selectors[MAX_SELECTORS];
-        size_t selector_indices[MAX_SELECTORS];
-        order_selectors(km, key, iv, block_number, ordered_selectors, selector_indices);
-        
-        // Execute all rounds
-        profile_rounds_executed += ROUNDS;
-        for (int r = 0; r < ROUNDS; r++) {
-            execute_round(&state, r, ordered_selectors, selector_indices, km->num_selectors, km, key);
-        }
-        
-        // Generate keystream
-        profile_keystream_calls++;
         uint8_t keystream[BLOCK_SIZE];
-        generate_keystream(&state, block_number, keystream);
+        compute_block_keystream(km, key, iv, iv_expanded, block_number, execute_round, &state, keystream);
         
         // XOR plaintext with keystream
         const uint8_t* plaintext = plaintext_blocks + i * BLOCK_SIZE;
@@ -489,9 +604,60 @@ void ruc_encrypt_blocks_batch(
         
         // Apply ciphertext feedback
         apply_ciphertext_feedback(&state, ciphertext);
+        phase_mark(RUC_PHASE_NONE);
     }
 }
 
+// Switch blocks from one key/IV to another: both keystreams are XORed into
+// each block in turn, so the plaintext only ever exists one block at a time
+// in a register-sized temporary
+void ruc_rekey_blocks(
+    const RucContext* from,
+    const RucContext* to,
+    uint32_t start_block_number,
+    const uint8_t* input_blocks,
+    size_t num_blocks,
+    uint8_t* output_blocks
+) {
+    const round_fn execute_round = ruc_kernels().round;
+    for (size_t i = 0; i < num_blocks; i++) {
+        uint32_t block_number = start_block_number + i;
+        CipherState state;
+        uint8_t old_keystream[BLOCK_SIZE];
+        uint8_t new_keystream[BLOCK_SIZE];
+        compute_block_keystream(from->km, from->key, from->iv, from->iv_expanded, block_number,
+                                execute_round, &state, old_keystream);
+        compute_block_keystream(to->km, to->key, to->iv, to->iv_expanded, block_number,
+                                execute_round, &state, new_keystream);
+        const uint8_t* in = input_blocks + i * BLOCK_SIZE;
+        uint8_t* out = output_blocks + i * BLOCK_SIZE;
+        for (int j = 0; j < BLOCK_SIZE; j++) {
+            out[j] = in[j] ^ old_keystream[j] ^ new_keystream[j];
+        }
+        phase_mark(RUC_PHASE_NONE);
+    }
+}
+
+// Encrypt multiple blocks in batch (optimized with caching)
+void ruc_encrypt_blocks_batch(
+    const uint8_t* plaintext_blocks,
+    size_t num_blocks,
+    const uint8_t* key,
+    const uint8_t* iv,
+    uint32_t start_block_number,
+    void* key_material,
+    uint8_t* ciphertext_blocks
+) {
+    RucCallTimer timer(RUC_OP_ENCRYPT_BATCH, (uint64_t)num_blocks * BLOCK_SIZE);
+    KeyMaterial* km = (KeyMaterial*)key_material;
+    
+    // Pre-compute IV expansion once (same for all blocks with same IV) - MAJOR OPTIMIZATION!
+    uint8_t iv_expanded[REGISTER_SIZE];
+    ruc_expand_iv(iv, iv_expanded);
+    
+    ruc_process_blocks(km, key, iv, iv_expanded, start_block_number, plaintext_blocks, num_blocks, ciphertext_blocks);
+}
+
 // Get profiling statistics
 void ruc_get_profile_stats(
     uint64_t* shake256_calls,
@@ -523,6 +689,7 @@ void ruc_decrypt_blocks_batch(
     void* key_material,
     uint8_t* plaintext_blocks
 ) {
+    RucCallTimer timer(RUC_OP_DECRYPT_BATCH, (uint64_t)num_blocks * BLOCK_SIZE);
     ruc_encrypt_blocks_batch(
         ciphertext_blocks,
         num_blocks,
@@ -16,6 +16,71 @@ constexpr size_t REGISTER_COUNT = 7;
 constexpr size_t MIN_SELECTORS = 16;
 constexpr size_t MAX_SELECTORS = 31;
 constexpr uint8_t GF_POLYNOMIAL = 0x1B;
+constexpr uint32_t RUC_MAX_BUFFERS = 64;
+constexpr size_t RUC_COMPRESS_CHUNK_SIZE = 65536;   // Max uncompressed bytes per frame
+
+// Scatter/gather segment for ruc_stream_updatev (same layout as POSIX iovec)
+struct RucIovec {
+    void* base;
+    size_t len;
+};
+
+// One message for ruc_encrypt_many/ruc_decrypt_many
+struct RucJob {
+    uint32_t key_id;             // Handle from ruc_key_create
+    const uint8_t* iv;           // IV_SIZE bytes
+    uint32_t start_block_number;
+    const uint8_t* input;        // num_blocks * BLOCK_SIZE bytes
+    uint8_t* output;             // May equal input
+    size_t num_blocks;
+    int32_t status;              // Set on return: 0, or -1 for an unknown key
+};
+
+// Public entry points tracked by the per-call metrics (ruc_metrics_*)
+constexpr int RUC_OP_EXPAND = 0;          // ruc_expand_key (and ruc_key_create)
+constexpr int RUC_OP_ENCRYPT_BLOCK = 1;
+constexpr int RUC_OP_DECRYPT_BLOCK = 2;
+constexpr int RUC_OP_ENCRYPT_BATCH = 3;   // ruc_encrypt_blocks_batch
+constexpr int RUC_OP_DECRYPT_BATCH = 4;
+constexpr int RUC_OP_CTX_ENCRYPT = 5;
+constexpr int RUC_OP_CTX_DECRYPT = 6;
+constexpr int RUC_OP_STREAM_UPDATE = 7;   // ruc_stream_update and ruc_stream_updatev
+constexpr int RUC_OP_ENCRYPT_MANY = 8;
+constexpr int RUC_OP_DECRYPT_MANY = 9;
+constexpr int RUC_OP_CBC_ENCRYPT = 10;
+constexpr int RUC_OP_CBC_DECRYPT = 11;
+constexpr int RUC_OP_ENCRYPT_CT = 12;
+constexpr int RUC_OP_DECRYPT_CT = 13;
+constexpr int RUC_OP_ENCRYPT_ASYNC = 14;  // submit to completion callback
+constexpr int RUC_OP_DECRYPT_ASYNC = 15;
+constexpr int RUC_OP_COMPRESS_UPDATE = 16;  // bytes = uncompressed input
+constexpr int RUC_OP_DECOMPRESS_UPDATE = 17; // bytes = uncompressed output
+constexpr int RUC_OP_CTX_ENCRYPT_BULK = 18;
+constexpr int RUC_OP_CTX_DECRYPT_BULK = 19;
+constexpr int RUC_OP_REENCRYPT = 20;
+constexpr int RUC_OP_COUNT = 21;
+
+// Point-in-time view of one entry point's latency and size histograms.
+// Percentiles are HDR bucket values (within 6.25%), clamped to the maximum.
+struct RucMetricsSnapshot {
+    uint64_t calls;
+    uint64_t latency_sum_ns;
+    uint64_t latency_min_ns;
+    uint64_t latency_max_ns;
+    uint64_t latency_p50_ns;
+    uint64_t latency_p90_ns;
+    uint64_t latency_p99_ns;
+    uint64_t latency_p999_ns;
+    uint64_t bytes_total;
+    uint64_t bytes_p50;
+    uint64_t bytes_p99;
+    uint64_t bytes_max;
+};
+
+// Completion callback for ruc_ctx_encrypt_async/ruc_ctx_decrypt_async. Runs on
+// an engine pool thread; status is 0, or -2 if the request was cancelled
+// before all of its blocks were processed (output is then partial).
+typedef void (*ruc_async_callback)(uint64_t request_id, int status, void* user);
 
 // Cipher state structure
 struct CipherState {
@@ -86,6 +151,282 @@ extern "C" {
         uint8_t* plaintext_blocks
     );
     
+    // Long-lived key handles: expand once, refer to by ID (0 = failure)
+    uint32_t ruc_key_create(const uint8_t* key);
+    
+    // Release a key handle (material is freed once no context uses it)
+    void ruc_key_destroy(uint32_t key_id);
+    
+    // Encryption context: key handle + IV with the IV expansion cached (0 = failure)
+    uint32_t ruc_ctx_create(uint32_t key_id, const uint8_t* iv);
+    
+    void ruc_ctx_destroy(uint32_t ctx_id);
+    
+    // Encrypt/decrypt blocks with a context (returns 0, or -1 for an unknown ID)
+    int ruc_ctx_encrypt(
+        uint32_t ctx_id,
+        const uint8_t* input_blocks,
+        size_t num_blocks,
+        uint32_t start_block_number,
+        uint8_t* output_blocks
+    );
+    
+    int ruc_ctx_decrypt(
+        uint32_t ctx_id,
+        const uint8_t* input_blocks,
+        size_t num_blocks,
+        uint32_t start_block_number,
+        uint8_t* output_blocks
+    );
+    
+    // Incremental encryption over a context: accepts arbitrary-length input,
+    // carries the unused keystream of a partial block between calls, and runs
+    // whole blocks straight through the batch engine. No padding is added;
+    // output length always equals input length. Returns a stream ID (0 = failure).
+    // The stream keeps its key alive, so the context may be destroyed first.
+    uint32_t ruc_stream_init(uint32_t ctx_id, uint32_t start_block_number);
+    
+    // Encrypt/decrypt len bytes (in == out is allowed). A stream covers at most
+    // 2^32 blocks (128 GiB) from its start block; an update that would go past
+    // that is rejected as a whole. Returns 0, -1 for an unknown ID, or -2 once
+    // the block counter would wrap (output is left untouched).
+    int ruc_stream_update(uint32_t stream_id, const uint8_t* input, size_t len, uint8_t* output);
+    
+    // Encrypt/decrypt a list of segments in place, as one continuous stream.
+    // Same return values as ruc_stream_update.
+    int ruc_stream_updatev(uint32_t stream_id, const RucIovec* iov, size_t iov_count);
+    
+    // Release the stream; total_bytes (optional) receives the bytes processed.
+    // Returns 0, or -1 for an unknown ID.
+    int ruc_stream_final(uint32_t stream_id, uint64_t* total_bytes);
+    
+    // Compress-then-encrypt stream: input is cut into RUC_COMPRESS_CHUNK_SIZE
+    // chunks, each LZ4-compressed (or stored as-is when that saves under ~3%)
+    // into a frame recording its compressed and uncompressed sizes, and the
+    // framed bytes are encrypted as one ruc_stream. Output length varies;
+    // update and final each write at most ruc_compress_bound(len) bytes.
+    // Note that the ciphertext length reveals how well the plaintext compressed.
+    size_t ruc_compress_bound(size_t len);
+    
+    uint32_t ruc_compress_init(uint32_t ctx_id, uint32_t start_block_number);
+    
+    // Returns 0, -1 for an unknown ID or out_cap < ruc_compress_bound(len), or
+    // -2 once the framed stream would pass the 2^32-block limit of ruc_stream
+    int ruc_compress_update(uint32_t stream_id, const uint8_t* input, size_t len,
+                            uint8_t* output, size_t out_cap, size_t* out_len);
+    
+    // Flush the last chunk and the end-of-stream frame, then release the stream.
+    // total_bytes (optional) receives the uncompressed bytes consumed.
+    // Returns 0, -1 or -2 as ruc_compress_update (the stream is released either way).
+    int ruc_compress_final(uint32_t stream_id, uint8_t* output, size_t out_cap, size_t* out_len,
+                           uint64_t* total_bytes);
+    
+    uint32_t ruc_decompress_init(uint32_t ctx_id, uint32_t start_block_number);
+    
+    // Decrypt len bytes of a compressed stream and write whole decoded chunks to
+    // output. Chunks that do not fit stay queued: call again with len = 0 until
+    // out_len is 0. out_cap >= RUC_COMPRESS_CHUNK_SIZE always makes progress.
+    // Returns 0, -1 for an unknown ID, or -2 for a malformed stream (wrong key
+    // or IV, or corrupted data).
+    int ruc_decompress_update(uint32_t stream_id, const uint8_t* input, size_t len,
+                              uint8_t* output, size_t out_cap, size_t* out_len);
+    
+    // Release the stream. Returns 0 if it ended cleanly with everything
+    // drained, -2 if it was truncated, malformed or had undrained output.
+    int ruc_decompress_final(uint32_t stream_id, uint64_t* total_bytes);
+    
+    // Constant-time engine: same output as ruc_encrypt_blocks_batch, but rounds
+    // run through the bitsliced rounds_batch kernel (64 or 256 blocks per pass)
+    // with no table lookups, branches or addresses that depend on secret data.
+    // Best for bulk data; short inputs still pay for a full lane group.
+    void ruc_encrypt_blocks_ct(
+        const uint8_t* plaintext_blocks,
+        size_t num_blocks,
+        const uint8_t* key,
+        const uint8_t* iv,
+        uint32_t start_block_number,
+        void* key_material,
+        uint8_t* ciphertext_blocks
+    );
+    
+    void ruc_decrypt_blocks_ct(
+        const uint8_t* ciphertext_blocks,
+        size_t num_blocks,
+        const uint8_t* key,
+        const uint8_t* iv,
+        uint32_t start_block_number,
+        void* key_material,
+        uint8_t* plaintext_blocks
+    );
+    
+    // Encrypt/decrypt many independent messages (each with its own key handle
+    // and IV) in one call. IVs are expanded once per job, then all blocks are
+    // pooled and handed out to worker threads in small chunks that may span
+    // several messages. Returns the number of jobs that failed (see RucJob::status).
+    size_t ruc_encrypt_many(RucJob* jobs, size_t num_jobs);
+    
+    size_t ruc_decrypt_many(RucJob* jobs, size_t num_jobs);
+    
+    // CBC mode, layout iv (IV_SIZE) || ciphertext, PKCS#7 padded (the layout
+    // of modes.ts; the ciphertext itself does not interoperate with it).
+    // Each block's keystream depends only on key, IV and block number, so the
+    // engine runs all blocks in parallel and only the previous-ciphertext XOR
+    // chain is serial. Returns 0, -1 for an unknown key, -2 for a bad length,
+    // -3 for bad padding.
+    //
+    // Encrypt writes IV_SIZE + ruc_cbc_padded_len(len) bytes to output
+    // (output must not overlap plaintext); on -1 nothing is written.
+    size_t ruc_cbc_padded_len(size_t plaintext_len);
+    
+    int ruc_cbc_encrypt(
+        uint32_t key_id,
+        const uint8_t* iv,
+        const uint8_t* plaintext,
+        size_t len,
+        uint8_t* output,
+        size_t* output_len
+    );
+    
+    // Decrypt writes up to len - IV_SIZE bytes to plaintext (must not overlap input).
+    // Padding is checked in constant time; on -3 those bytes are zeroed and
+    // plaintext_len is left untouched.
+    int ruc_cbc_decrypt(
+        uint32_t key_id,
+        const uint8_t* input,
+        size_t len,
+        uint8_t* plaintext,
+        size_t* plaintext_len
+    );
+    
+    // Persistent, growable I/O regions addressed by caller-chosen IDs
+    // (0..RUC_MAX_BUFFERS-1). Returns a 64-byte aligned region of at least
+    // min_size bytes, or nullptr if that cannot be allocated (the region is
+    // then left as it was). Contents are wiped, not preserved, when the
+    // region grows or is released.
+    uint8_t* ruc_buffer_acquire(uint32_t buffer_id, size_t min_size);
+    
+    size_t ruc_buffer_capacity(uint32_t buffer_id);
+    
+    void ruc_buffer_release(uint32_t buffer_id);
+    
+    // Multi-threaded, NUMA-aware context encryption for large buffers. The
+    // input is sharded by page and each shard is queued on the NUMA node
+    // holding that page. Workers are pinned to their node's CPUs and read a
+    // node-local replica of the key material; idle workers take shards from
+    // other nodes. Single-node hosts (and builds without threads) get a plain
+    // parallel split. Same output as ruc_ctx_encrypt; returns 0, or -1 for an
+    // unknown context. RUC_NUMA=0 disables topology detection.
+    int ruc_ctx_encrypt_bulk(
+        uint32_t ctx_id,
+        const uint8_t* input_blocks,
+        size_t num_blocks,
+        uint32_t start_block_number,
+        uint8_t* output_blocks
+    );
+    
+    int ruc_ctx_decrypt_bulk(
+        uint32_t ctx_id,
+        const uint8_t* input_blocks,
+        size_t num_blocks,
+        uint32_t start_block_number,
+        uint8_t* output_blocks
+    );
+    
+    // NUMA nodes found in sysfs (1 when the topology is unavailable)
+    uint32_t ruc_numa_node_count(void);
+    
+    // Key rotation: turn ciphertext made with old_ctx_id into ciphertext for
+    // new_ctx_id (same block numbering) in a single pass. Both keystreams are
+    // applied to each block in turn, so no plaintext buffer is ever written.
+    // input == output is allowed; blocks are spread over all cores. Call it
+    // chunk by chunk with advancing start_block_number to stream large data.
+    // Returns 0, or -1 for an unknown context.
+    int ruc_reencrypt(
+        uint32_t old_ctx_id,
+        uint32_t new_ctx_id,
+        const uint8_t* input_blocks,
+        size_t num_blocks,
+        uint32_t start_block_number,
+        uint8_t* output_blocks
+    );
+    
+    // Asynchronous context encryption on the engine's shared thread pool
+    // (native and pthread builds; otherwise the request runs inline and the
+    // callback fires before the call returns). Large requests are processed in
+    // chunks that interleave with other requests. Returns a request ID, or 0
+    // (and no callback) for an unknown context, a null callback, or once
+    // ruc_async_shutdown has begun. Buffers must stay valid until the callback
+    // runs.
+    uint64_t ruc_ctx_encrypt_async(
+        uint32_t ctx_id,
+        const uint8_t* input_blocks,
+        size_t num_blocks,
+        uint32_t start_block_number,
+        uint8_t* output_blocks,
+        ruc_async_callback callback,
+        void* user
+    );
+    
+    uint64_t ruc_ctx_decrypt_async(
+        uint32_t ctx_id,
+        const uint8_t* input_blocks,
+        size_t num_blocks,
+        uint32_t start_block_number,
+        uint8_t* output_blocks,
+        ruc_async_callback callback,
+        void* user
+    );
+    
+    // Stop claiming further chunks of a request. Returns 0 if the request was
+    // still pending (its callback reports -2 unless it had already finished),
+    // -1 if the ID is unknown or already completed.
+    int ruc_async_cancel(uint64_t request_id);
+    
+    // Let each request use at most num_threads engine pool threads (0 = all of
+    // them). Also re-enables submits after ruc_async_shutdown. Returns -1 if
+    // already initialized, or a request was submitted, and not shut down since.
+    int ruc_async_init(size_t num_threads);
+    
+    // Refuse new requests and wait for outstanding ones (not from a callback).
+    // Also runs automatically at exit once a request was submitted.
+    void ruc_async_shutdown(void);
+    
+    // Per-call metrics: every public entry point records its latency and
+    // bytes processed into per-thread histograms, merged when read (on by
+    // default; nested calls are counted once, under the outermost entry point).
+    void ruc_metrics_enable(int enabled);
+    
+    void ruc_metrics_reset(void);
+    
+    // Name used in the Prometheus labels (nullptr for an unknown op)
+    const char* ruc_metrics_op_name(int op);
+    
+    // Returns 0, or -1 for an unknown op
+    int ruc_metrics_snapshot(int op, RucMetricsSnapshot* out);
+    
+    // Prometheus text exposition of all histograms (summaries with
+    // 0.5/0.9/0.99/0.999 quantiles). Works like snprintf: writes at most
+    // capacity bytes including the terminator and returns the full length.
+    size_t ruc_metrics_prometheus(char* buffer, size_t capacity);
+    
+    // Engine trace: while on, every thread records spans (public calls, batch
+    // chunks and shards, per-block phases, async chunks and thread joins) into
+    // its own ring of events_per_thread entries (0 = 16384; oldest entries
+    // are overwritten). Starting again discards the previous trace. When off,
+    // each trace point costs one relaxed load.
+    int ruc_trace_start(size_t events_per_thread);
+    
+    void ruc_trace_stop(void);
+    
+    // Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev) of the
+    // current trace; like snprintf it returns the full length. Safe while the
+    // trace is still on, but spans recorded during the export may be left
+    // out (or overwritten ones dropped), so stop it first for a full dump.
+    size_t ruc_trace_json(char* buffer, size_t capacity);
+    
+    // ruc_trace_json into a file; returns 0, or -1 if it cannot be written
+    int ruc_trace_write(const char* path);
+    
     // Profiling: Get performance counters (for debugging)
     void ruc_get_profile_stats(
         uint64_t* shake256_calls,
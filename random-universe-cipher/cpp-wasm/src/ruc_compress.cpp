@@ -0,0 +1,362 @@
+#include "ruc_cipher.h"
+#include "ruc_metrics.h"
+#include "lz4_block.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+// Compress-then-encrypt streams. The plaintext side of the stream is
+//
+//   "RUCZ" version codec 0 0                     stream header (8 bytes)
+//   raw_len:u32le stored_len:u32le payload       one frame per chunk
+//   0:u32le 0:u32le                              end of stream
+//
+// raw_len is 1..RUC_COMPRESS_CHUNK_SIZE. stored_len is the LZ4 block size, or
+// raw_len with RUC_FRAME_STORED set when the chunk is kept uncompressed. The
+// whole framed stream, headers included, runs through a ruc_stream, so it is
+// encrypted exactly like ruc_stream_update output. The end frame lets the
+// reader tell a complete stream from a truncated one.
+//
+// Buffers that hold plaintext are allocated once at their full capacity and
+// never reallocated, so no copy is left behind in freed memory: the
+// compressor keeps at most one raw chunk, the decompressor at most the stream
+// header plus one maximal frame. Both are wiped as they are drained and again
+// when the stream is released. Ciphertext the decompressor has no room for
+// yet waits, still encrypted, in a backlog.
+
+constexpr uint8_t RUC_FRAME_MAGIC[4] = {'R', 'U', 'C', 'Z'};
+constexpr uint8_t RUC_FRAME_VERSION = 1;
+constexpr uint8_t RUC_FRAME_CODEC_LZ4 = 1;
+constexpr size_t RUC_FRAME_HEADER_SIZE = 8;
+constexpr uint32_t RUC_FRAME_STORED = 0x80000000u;
+
+struct RucCompressStream {
+    uint32_t stream_id;              // Inner ruc_stream (encrypts the framed bytes)
+    bool header_written;
+    std::vector<uint8_t> pending;    // Raw bytes of the unfinished chunk (RUC_COMPRESS_CHUNK_SIZE)
+    size_t pending_len;
+    uint64_t total_bytes;
+};
+
+struct RucDecompressStream {
+    uint32_t stream_id;
+    bool header_seen;
+    bool end_seen;
+    bool failed;
+    std::vector<uint8_t> buffer;     // Decrypted, not yet decoded bytes (fixed capacity)
+    size_t buffered;                 // Bytes used in buffer
+    size_t consumed;                 // Decoded prefix of buffer
+    std::vector<uint8_t> backlog;    // Ciphertext that did not fit in buffer yet
+    uint64_t total_bytes;
+};
+
+static std::mutex compress_mutex;
+static std::vector<RucCompressStream*> compress_table;
+static std::vector<RucDecompressStream*> decompress_table;
+
+template <typename T>
+static uint32_t insert_stream(std::vector<T*>& table, T* stream) {
+    std::lock_guard<std::mutex> lock(compress_mutex);
+    for (size_t i = 0; i < table.size(); i++) {
+        if (!table[i]) {
+            table[i] = stream;
+            return (uint32_t)(i + 1);
+        }
+    }
+    table.push_back(stream);
+    return (uint32_t)table.size();
+}
+
+template <typename T>
+static T* lookup_stream(std::vector<T*>& table, uint32_t id) {
+    std::lock_guard<std::mutex> lock(compress_mutex);
+    if (id == 0 || id > table.size()) return nullptr;
+    return table[id - 1];
+}
+
+template <typename T>
+static T* remove_stream(std::vector<T*>& table, uint32_t id) {
+    std::lock_guard<std::mutex> lock(compress_mutex);
+    if (id == 0 || id > table.size()) return nullptr;
+    T* stream = table[id - 1];
+    table[id - 1] = nullptr;
+    return stream;
+}
+
+static inline void store32_le(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint32_t load32_le(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+size_t ruc_compress_bound(size_t len) {
+    // Pending bytes from earlier calls can complete a chunk here, so allow one
+    // extra chunk, plus stream header, per-frame headers and the end frame
+    size_t chunks = len / RUC_COMPRESS_CHUNK_SIZE + 2;
+    return len + RUC_COMPRESS_CHUNK_SIZE + chunks * RUC_FRAME_HEADER_SIZE + 2 * RUC_FRAME_HEADER_SIZE;
+}
+
+uint32_t ruc_compress_init(uint32_t ctx_id, uint32_t start_block_number) {
+    uint32_t inner = ruc_stream_init(ctx_id, start_block_number);
+    if (!inner) return 0;
+    RucCompressStream* stream = new RucCompressStream();
+    stream->stream_id = inner;
+    stream->header_written = false;
+    stream->total_bytes = 0;
+    stream->pending.resize(RUC_COMPRESS_CHUNK_SIZE);
+    stream->pending_len = 0;
+    return insert_stream(compress_table, stream);
+}
+
+// Append bytes to the output and encrypt them in place. False once the inner
+// stream has run out of block numbers.
+static bool emit(RucCompressStream* stream, uint8_t*& out, size_t len) {
+    if (ruc_stream_update(stream->stream_id, out, len, out) != 0) return false;
+    out += len;
+    return true;
+}
+
+static bool emit_stream_header(RucCompressStream* stream, uint8_t*& out) {
+    if (stream->header_written) return true;
+    memcpy(out, RUC_FRAME_MAGIC, 4);
+    out[4] = RUC_FRAME_VERSION;
+    out[5] = RUC_FRAME_CODEC_LZ4;
+    out[6] = 0;
+    out[7] = 0;
+    if (!emit(stream, out, RUC_FRAME_HEADER_SIZE)) return false;
+    stream->header_written = true;
+    return true;
+}
+
+// Compress one chunk straight into the output as a frame. Anything that does
+// not shrink by at least 1/32 is stored: LZ4 stops as soon as it runs past
+// that budget, so incompressible data costs little more than a copy.
+static bool emit_chunk(RucCompressStream* stream, const uint8_t* raw, size_t raw_len, uint8_t*& out) {
+    uint8_t* payload = out + RUC_FRAME_HEADER_SIZE;
+    size_t budget = raw_len - raw_len / 32;
+    size_t stored_len = lz4_compress_block(raw, raw_len, payload, budget);
+    uint32_t stored_field = (uint32_t)stored_len;
+    if (stored_len == 0) {
+        memcpy(payload, raw, raw_len);
+        stored_len = raw_len;
+        stored_field = (uint32_t)raw_len | RUC_FRAME_STORED;
+    }
+    store32_le(out, (uint32_t)raw_len);
+    store32_le(out + 4, stored_field);
+    return emit(stream, out, RUC_FRAME_HEADER_SIZE + stored_len);
+}
+
+int ruc_compress_update(uint32_t stream_id, const uint8_t* input, size_t len,
+                        uint8_t* output, size_t out_cap, size_t* out_len) {
+    RucCallTimer timer(RUC_OP_COMPRESS_UPDATE, len);
+    RucCompressStream* stream = lookup_stream(compress_table, stream_id);
+    if (!stream || out_cap < ruc_compress_bound(len)) return -1;
+    stream->total_bytes += len;
+
+    uint8_t* out = output;
+    if (!emit_stream_header(stream, out)) return -2;
+
+    // Top up the pending chunk first
+    if (stream->pending_len > 0) {
+        size_t take = RUC_COMPRESS_CHUNK_SIZE - stream->pending_len;
+        if (take > len) take = len;
+        memcpy(stream->pending.data() + stream->pending_len, input, take);
+        stream->pending_len += take;
+        input += take;
+        len -= take;
+        if (stream->pending_len == RUC_COMPRESS_CHUNK_SIZE) {
+            if (!emit_chunk(stream, stream->pending.data(), RUC_COMPRESS_CHUNK_SIZE, out)) return -2;
+            memset(stream->pending.data(), 0, RUC_COMPRESS_CHUNK_SIZE);
+            stream->pending_len = 0;
+        }
+    }
+
+    // Whole chunks are compressed directly from the caller's buffer
+    while (len >= RUC_COMPRESS_CHUNK_SIZE) {
+        if (!emit_chunk(stream, input, RUC_COMPRESS_CHUNK_SIZE, out)) return -2;
+        input += RUC_COMPRESS_CHUNK_SIZE;
+        len -= RUC_COMPRESS_CHUNK_SIZE;
+    }
+    memcpy(stream->pending.data() + stream->pending_len, input, len);
+    stream->pending_len += len;
+
+    *out_len = (size_t)(out - output);
+    return 0;
+}
+
+int ruc_compress_final(uint32_t stream_id, uint8_t* output, size_t out_cap, size_t* out_len,
+                       uint64_t* total_bytes) {
+    // Counted as an update: it compresses and encrypts the last chunk
+    RucCallTimer timer(RUC_OP_COMPRESS_UPDATE, 0);
+    RucCompressStream* stream = lookup_stream(compress_table, stream_id);
+    if (!stream || out_cap < ruc_compress_bound(0)) return -1;
+    remove_stream(compress_table, stream_id);
+
+    uint8_t* out = output;
+    bool ok = emit_stream_header(stream, out);
+    if (ok && stream->pending_len > 0) {
+        ok = emit_chunk(stream, stream->pending.data(), stream->pending_len, out);
+    }
+    timer.set_bytes(stream->pending_len);
+    if (ok) {
+        memset(out, 0, RUC_FRAME_HEADER_SIZE);
+        ok = emit(stream, out, RUC_FRAME_HEADER_SIZE);
+    }
+    *out_len = (size_t)(out - output);
+    if (total_bytes) *total_bytes = stream->total_bytes;
+
+    ruc_stream_final(stream->stream_id, nullptr);
+    memset(stream->pending.data(), 0, stream->pending.size());
+    delete stream;
+    return ok ? 0 : -2;
+}
+
+uint32_t ruc_decompress_init(uint32_t ctx_id, uint32_t start_block_number) {
+    uint32_t inner = ruc_stream_init(ctx_id, start_block_number);
+    if (!inner) return 0;
+    RucDecompressStream* stream = new RucDecompressStream();
+    stream->stream_id = inner;
+    stream->header_seen = false;
+    stream->end_seen = false;
+    stream->failed = false;
+    stream->buffer.resize(2 * RUC_FRAME_HEADER_SIZE + lz4_compress_bound(RUC_COMPRESS_CHUNK_SIZE));
+    stream->buffered = 0;
+    stream->consumed = 0;
+    stream->total_bytes = 0;
+    return insert_stream(decompress_table, stream);
+}
+
+// Decode as many buffered frames as fit in the output; false on a bad frame
+static bool decode_frames(RucDecompressStream* stream, uint8_t* output, size_t out_cap, size_t* out_len) {
+    const uint8_t* buf = stream->buffer.data();
+    size_t end = stream->buffered;
+    size_t pos = stream->consumed;
+    size_t produced = 0;
+
+    if (!stream->header_seen && end - pos >= RUC_FRAME_HEADER_SIZE) {
+        if (memcmp(buf + pos, RUC_FRAME_MAGIC, 4) != 0 || buf[pos + 4] != RUC_FRAME_VERSION ||
+            buf[pos + 5] != RUC_FRAME_CODEC_LZ4) {
+            return false;
+        }
+        pos += RUC_FRAME_HEADER_SIZE;
+        stream->header_seen = true;
+    }
+
+    while (stream->header_seen && !stream->end_seen && end - pos >= RUC_FRAME_HEADER_SIZE) {
+        uint32_t raw_len = load32_le(buf + pos);
+        uint32_t stored_field = load32_le(buf + pos + 4);
+        if (raw_len == 0) {
+            if (stored_field != 0) return false;
+            pos += RUC_FRAME_HEADER_SIZE;
+            stream->end_seen = true;
+            break;
+        }
+        bool stored = (stored_field & RUC_FRAME_STORED) != 0;
+        size_t stored_len = stored_field & ~RUC_FRAME_STORED;
+        if (raw_len > RUC_COMPRESS_CHUNK_SIZE) return false;
+        if (stored ? stored_len != raw_len : stored_len == 0 || stored_len > lz4_compress_bound(raw_len)) {
+            return false;
+        }
+        if (end - pos < RUC_FRAME_HEADER_SIZE + stored_len) break;
+        if (out_cap - produced < raw_len) break;
+
+        const uint8_t* payload = buf + pos + RUC_FRAME_HEADER_SIZE;
+        if (stored) {
+            memcpy(output + produced, payload, raw_len);
+        } else if (lz4_decompress_block(payload, stored_len, output + produced, raw_len) != 0) {
+            return false;
+        }
+        produced += raw_len;
+        pos += RUC_FRAME_HEADER_SIZE + stored_len;
+    }
+    if (stream->end_seen && pos != end) return false;   // Data after the end frame
+
+    stream->consumed = pos;
+    stream->total_bytes += produced;
+    *out_len = produced;
+    return true;
+}
+
+// Drop the decoded prefix of the buffer, wiping the bytes it vacates
+static void compact_buffer(RucDecompressStream* stream) {
+    if (stream->consumed == 0) return;
+    uint8_t* buf = stream->buffer.data();
+    size_t remaining = stream->buffered - stream->consumed;
+    memmove(buf, buf + stream->consumed, remaining);
+    memset(buf + remaining, 0, stream->consumed);
+    stream->buffered = remaining;
+    stream->consumed = 0;
+}
+
+int ruc_decompress_update(uint32_t stream_id, const uint8_t* input, size_t len,
+                          uint8_t* output, size_t out_cap, size_t* out_len) {
+    RucCallTimer timer(RUC_OP_DECOMPRESS_UPDATE, 0);
+    RucDecompressStream* stream = lookup_stream(decompress_table, stream_id);
+    if (!stream) return -1;
+    *out_len = 0;
+    if (stream->failed) return -2;
+
+    // Ciphertext is taken in order: whatever is backlogged comes first
+    if (!stream->backlog.empty() && len > 0) {
+        stream->backlog.insert(stream->backlog.end(), input, input + len);
+    }
+    bool from_backlog = !stream->backlog.empty();
+    const uint8_t* src = from_backlog ? stream->backlog.data() : input;
+    size_t src_len = from_backlog ? stream->backlog.size() : len;
+    size_t taken = 0;
+
+    // Decrypt as much as fits, decode, repeat until neither makes progress
+    size_t produced = 0;
+    for (;;) {
+        compact_buffer(stream);
+        size_t n = std::min(stream->buffer.size() - stream->buffered, src_len - taken);
+        if (n > 0 && ruc_stream_update(stream->stream_id, src + taken, n,
+                                       stream->buffer.data() + stream->buffered) != 0) {
+            stream->failed = true;
+            break;
+        }
+        stream->buffered += n;
+        taken += n;
+
+        size_t decoded = 0;
+        if (!decode_frames(stream, output + produced, out_cap - produced, &decoded)) {
+            stream->failed = true;
+            break;
+        }
+        produced += decoded;
+        if (n == 0 && decoded == 0) break;
+    }
+    if (from_backlog) {
+        stream->backlog.erase(stream->backlog.begin(), stream->backlog.begin() + taken);
+    } else {
+        stream->backlog.assign(input + taken, input + len);
+    }
+
+    if (stream->failed) {
+        *out_len = 0;
+        return -2;
+    }
+    *out_len = produced;
+    timer.set_bytes(produced);
+    return 0;
+}
+
+int ruc_decompress_final(uint32_t stream_id, uint64_t* total_bytes) {
+    RucDecompressStream* stream = remove_stream(decompress_table, stream_id);
+    if (!stream) return -1;
+    bool clean = !stream->failed && stream->end_seen && stream->consumed == stream->buffered &&
+                 stream->backlog.empty();
+    if (total_bytes) *total_bytes = stream->total_bytes;
+
+    ruc_stream_final(stream->stream_id, nullptr);
+    // The buffer holds decrypted plaintext
+    memset(stream->buffer.data(), 0, stream->buffer.size());
+    delete stream;
+    return clean ? 0 : -2;
+}
@@ -0,0 +1,240 @@
+#include "ruc_cipher.h"
+#include "ruc_engine.h"
+#include "ruc_metrics.h"
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+// ID-based handles so callers (WASM workers in particular) can keep key
+// material, IV expansion and I/O buffers resident across tasks instead of
+// re-expanding and re-allocating per call. IDs are 1-based slot indices;
+// freed slots are reused.
+
+// Per-node copy of the hot key data for NUMA bulk encryption
+struct KeyReplica {
+    KeyMaterial km;
+    uint8_t key[KEY_SIZE];
+};
+
+struct KeyEntry {
+    KeyMaterial* km;
+    uint8_t key[KEY_SIZE];
+    uint32_t context_refs;  // Contexts and in-flight calls still using this key
+    bool released;          // ruc_key_destroy() called by the owner
+    KeyReplica* replicas[RUC_MAX_NUMA_NODES];   // Created on demand
+};
+
+struct BufferRegion {
+    uint8_t* data;
+    size_t capacity;
+};
+
+static std::mutex handle_mutex;
+static std::vector<KeyEntry*> key_table;
+static std::vector<RucContext*> ctx_table;
+static BufferRegion buffer_table[RUC_MAX_BUFFERS];
+
+template <typename T>
+static uint32_t store_handle(std::vector<T*>& table, T* entry) {
+    for (size_t i = 0; i < table.size(); i++) {
+        if (!table[i]) {
+            table[i] = entry;
+            return (uint32_t)(i + 1);
+        }
+    }
+    table.push_back(entry);
+    return (uint32_t)table.size();
+}
+
+template <typename T>
+static T* lookup_handle(const std::vector<T*>& table, uint32_t id) {
+    if (id == 0 || id > table.size()) return nullptr;
+    return table[id - 1];
+}
+
+static void free_key_entry(uint32_t key_id) {
+    KeyEntry* entry = key_table[key_id - 1];
+    ruc_free_key_material(entry->km);
+    for (int node = 0; node < RUC_MAX_NUMA_NODES; node++) {
+        if (entry->replicas[node]) ruc_numa_free_local(entry->replicas[node], sizeof(KeyReplica));
+    }
+    memset(entry->key, 0, KEY_SIZE);
+    delete entry;
+    key_table[key_id - 1] = nullptr;
+}
+
+uint32_t ruc_key_create(const uint8_t* key) {
+    KeyEntry* entry = new KeyEntry();
+    memcpy(entry->key, key, KEY_SIZE);
+    entry->km = (KeyMaterial*)ruc_expand_key(entry->key);
+    entry->context_refs = 0;
+    entry->released = false;
+
+    std::lock_guard<std::mutex> lock(handle_mutex);
+    return store_handle(key_table, entry);
+}
+
+void ruc_key_destroy(uint32_t key_id) {
+    std::lock_guard<std::mutex> lock(handle_mutex);
+    KeyEntry* entry = lookup_handle(key_table, key_id);
+    if (!entry || entry->released) return;
+    entry->released = true;
+    if (entry->context_refs == 0) free_key_entry(key_id);
+}
+
+bool ruc_key_retain(uint32_t key_id, const KeyMaterial** km, const uint8_t** key) {
+    std::lock_guard<std::mutex> lock(handle_mutex);
+    KeyEntry* entry = lookup_handle(key_table, key_id);
+    if (!entry || entry->released) return false;
+    entry->context_refs++;
+    *km = entry->km;
+    *key = entry->key;
+    return true;
+}
+
+bool ruc_key_node_replica(uint32_t key_id, int node, const KeyMaterial** km, const uint8_t** key) {
+    if (node < 0 || node >= RUC_MAX_NUMA_NODES) return false;
+    std::lock_guard<std::mutex> lock(handle_mutex);
+    KeyEntry* entry = lookup_handle(key_table, key_id);
+    // A destroyed key gets no new copies, even while contexts still hold it
+    if (!entry || entry->released) return false;
+    KeyReplica* replica = entry->replicas[node];
+    if (!replica) {
+        replica = (KeyReplica*)ruc_numa_alloc_local(sizeof(KeyReplica));
+        if (!replica) return false;
+        memcpy(&replica->km, entry->km, sizeof(KeyMaterial));
+        memcpy(replica->key, entry->key, KEY_SIZE);
+        entry->replicas[node] = replica;
+    }
+    *km = &replica->km;
+    *key = replica->key;
+    return true;
+}
+
+uint32_t ruc_ctx_create(uint32_t key_id, const uint8_t* iv) {
+    RucContext* ctx = new RucContext();
+    memcpy(ctx->iv, iv, IV_SIZE);
+    ruc_expand_iv(ctx->iv, ctx->iv_expanded);
+
+    std::lock_guard<std::mutex> lock(handle_mutex);
+    KeyEntry* entry = lookup_handle(key_table, key_id);
+    if (!entry || entry->released) {
+        delete ctx;
+        return 0;
+    }
+    entry->context_refs++;
+    ctx->key_id = key_id;
+    ctx->km = entry->km;
+    ctx->key = entry->key;
+    return store_handle(ctx_table, ctx);
+}
+
+// Drop one reference; caller holds handle_mutex
+static void unref_key(uint32_t key_id) {
+    KeyEntry* entry = lookup_handle(key_table, key_id);
+    if (entry && --entry->context_refs == 0 && entry->released) {
+        free_key_entry(key_id);
+    }
+}
+
+void ruc_key_release(uint32_t key_id) {
+    std::lock_guard<std::mutex> lock(handle_mutex);
+    unref_key(key_id);
+}
+
+void ruc_ctx_destroy(uint32_t ctx_id) {
+    std::lock_guard<std::mutex> lock(handle_mutex);
+    RucContext* ctx = lookup_handle(ctx_table, ctx_id);
+    if (!ctx) return;
+    ctx_table[ctx_id - 1] = nullptr;
+
+    unref_key(ctx->key_id);
+    memset(ctx, 0, sizeof(RucContext));
+    delete ctx;
+}
+
+bool ruc_ctx_retain_copy(uint32_t ctx_id, RucContext* copy) {
+    std::lock_guard<std::mutex> lock(handle_mutex);
+    const RucContext* ctx = lookup_handle(ctx_table, ctx_id);
+    if (!ctx) return false;
+    *copy = *ctx;
+    key_table[ctx->key_id - 1]->context_refs++;
+    return true;
+}
+
+void ruc_ctx_release_copy(RucContext* copy) {
+    std::lock_guard<std::mutex> lock(handle_mutex);
+    unref_key(copy->key_id);
+    memset(copy, 0, sizeof(RucContext));
+}
+
+int ruc_ctx_encrypt(
+    uint32_t ctx_id,
+    const uint8_t* input_blocks,
+    size_t num_blocks,
+    uint32_t start_block_number,
+    uint8_t* output_blocks
+) {
+    RucCallTimer timer(RUC_OP_CTX_ENCRYPT, (uint64_t)num_blocks * BLOCK_SIZE);
+    // A copy keeps the key alive even if the context is destroyed meanwhile
+    RucContext ctx;
+    if (!ruc_ctx_retain_copy(ctx_id, &ctx)) return -1;
+    ruc_process_blocks(ctx.km, ctx.key, ctx.iv, ctx.iv_expanded, start_block_number,
+                       input_blocks, num_blocks, output_blocks);
+    ruc_ctx_release_copy(&ctx);
+    return 0;
+}
+
+// Decryption is the same keystream XOR
+int ruc_ctx_decrypt(
+    uint32_t ctx_id,
+    const uint8_t* input_blocks,
+    size_t num_blocks,
+    uint32_t start_block_number,
+    uint8_t* output_blocks
+) {
+    RucCallTimer timer(RUC_OP_CTX_DECRYPT, (uint64_t)num_blocks * BLOCK_SIZE);
+    return ruc_ctx_encrypt(ctx_id, input_blocks, num_blocks, start_block_number, output_blocks);
+}
+
+// Buffers hold plaintext and keystream: wipe before handing memory back
+static void free_buffer(BufferRegion& region) {
+    if (region.data) memset(region.data, 0, region.capacity);
+    free(region.data);
+    region.data = nullptr;
+    region.capacity = 0;
+}
+
+uint8_t* ruc_buffer_acquire(uint32_t buffer_id, size_t min_size) {
+    if (buffer_id >= RUC_MAX_BUFFERS) return nullptr;
+    std::lock_guard<std::mutex> lock(handle_mutex);
+    BufferRegion& region = buffer_table[buffer_id];
+    if (region.data && region.capacity >= min_size) return region.data;
+
+    // Grow geometrically so steadily increasing chunk sizes settle quickly;
+    // a size no doubling can reach fails instead of wrapping to 0
+    size_t capacity = region.capacity ? region.capacity : 4096;
+    while (capacity < min_size) {
+        if (capacity > SIZE_MAX / 2) return nullptr;
+        capacity *= 2;
+    }
+
+    free_buffer(region);
+    region.data = (uint8_t*)aligned_alloc(64, capacity);
+    region.capacity = region.data ? capacity : 0;
+    return region.data;
+}
+
+size_t ruc_buffer_capacity(uint32_t buffer_id) {
+    if (buffer_id >= RUC_MAX_BUFFERS) return 0;
+    std::lock_guard<std::mutex> lock(handle_mutex);
+    return buffer_table[buffer_id].capacity;
+}
+
+void ruc_buffer_release(uint32_t buffer_id) {
+    if (buffer_id >= RUC_MAX_BUFFERS) return;
+    std::lock_guard<std::mutex> lock(handle_mutex);
+    free_buffer(buffer_table[buffer_id]);
+}
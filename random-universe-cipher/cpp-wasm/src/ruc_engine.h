@@ -0,0 +1,111 @@
+#ifndef RUC_ENGINE_H
+#define RUC_ENGINE_H
+
+#include "ruc_cipher.h"
+#include <cstdint>
+#include <cstddef>
+
+// Internal engine entry points shared by the public C APIs (not exported to WASM)
+
+// Expand IV into the register-sized mask mixed into every block's state
+void ruc_expand_iv(const uint8_t* iv, uint8_t* iv_expanded);
+
+// Encrypt/decrypt a run of blocks using a pre-expanded IV
+void ruc_process_blocks(
+    const KeyMaterial* km,
+    const uint8_t* key,
+    const uint8_t* iv,
+    const uint8_t* iv_expanded,
+    uint32_t start_block_number,
+    const uint8_t* input_blocks,
+    size_t num_blocks,
+    uint8_t* output_blocks
+);
+
+// Initial per-block state (key registers ^ IV mask, counter hash mixed into R0)
+void ruc_init_block_state(
+    const KeyMaterial* km,
+    const uint8_t* iv_expanded,
+    uint32_t block_number,
+    CipherState* state
+);
+
+// Keystream for a block whose rounds have been executed
+void ruc_block_keystream(const CipherState* state, uint32_t block_number, uint8_t* keystream);
+
+// Selector ordering without secret-dependent branches or table indices
+void ruc_order_selectors_ct(
+    const KeyMaterial* km,
+    const uint8_t* key,
+    const uint8_t* iv,
+    uint64_t block_number,
+    uint16_t* ordered_selectors,
+    size_t* selector_indices
+);
+
+// Phase probes for the serial block loop (ruc_process_blocks). When the
+// calling thread has a probe installed it is called with the phase that is
+// about to start; RUC_PHASE_NONE marks the end of a block. Used by the native
+// benchmark to attribute hardware counters to each phase.
+enum RucPhase {
+    RUC_PHASE_NONE = -1,
+    RUC_PHASE_COUNTER_HASH = 0,   // state setup: key registers, IV mask, counter hash
+    RUC_PHASE_ORDER_SELECTORS,    // order_selectors
+    RUC_PHASE_ROUNDS,             // the ROUNDS execute_round calls
+    RUC_PHASE_KEYSTREAM,          // generate_keystream, output XOR, feedback
+    RUC_PHASE_COUNT
+};
+
+typedef void (*ruc_phase_probe_fn)(int phase, void* user);
+
+// Install (or clear, with nullptr) the probe for the calling thread
+void ruc_set_phase_probe(ruc_phase_probe_fn probe, void* user);
+
+// Long-lived encryption context (see ruc_ctx_create)
+struct RucContext {
+    uint32_t key_id;
+    const KeyMaterial* km;
+    const uint8_t* key;
+    uint8_t iv[IV_SIZE];
+    uint8_t iv_expanded[REGISTER_SIZE];
+};
+
+// Re-encrypt blocks from one context's keystream to another's in one pass
+// (input == output allowed)
+void ruc_rekey_blocks(
+    const RucContext* from,
+    const RucContext* to,
+    uint32_t start_block_number,
+    const uint8_t* input_blocks,
+    size_t num_blocks,
+    uint8_t* output_blocks
+);
+
+// Copy a context and keep its key material alive until the copy is released
+// (lets derived handles such as streams outlive the context they came from)
+bool ruc_ctx_retain_copy(uint32_t ctx_id, RucContext* copy);
+void ruc_ctx_release_copy(RucContext* copy);
+
+// Resolve a key ID to its expanded material and raw key (false if unknown)
+// and keep them alive, even past ruc_key_destroy(), until ruc_key_release()
+bool ruc_key_retain(uint32_t key_id, const KeyMaterial** km, const uint8_t** key);
+void ruc_key_release(uint32_t key_id);
+
+// NUMA support (ruc_numa.cpp). Nodes are dense indices 0..count-1 into the
+// detected topology, which is capped at RUC_MAX_NUMA_NODES.
+constexpr int RUC_MAX_NUMA_NODES = 16;
+
+// Page-backed allocation, first touched by the calling thread so that under
+// the default first-touch policy it lands on that thread's node. Freeing
+// wipes the pages.
+void* ruc_numa_alloc_local(size_t size);
+void ruc_numa_free_local(void* ptr, size_t size);
+
+// Node-local copy of a key's material and raw key, created on first use by
+// the calling thread (which should be pinned to that node) and freed with
+// the key. The caller must hold a reference to the key, e.g. a retained
+// context copy. False if the key is unknown or already destroyed; the
+// caller then reads the shared key material.
+bool ruc_key_node_replica(uint32_t key_id, int node, const KeyMaterial** km, const uint8_t** key);
+
+#endif // RUC_ENGINE_H
@@ -0,0 +1,294 @@
+#include "ruc_metrics.h"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <cstdarg>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// HDR-style log-linear histograms: values below 16 get exact buckets, above
+// that every power of two is split into 16 linear sub-buckets (relative error
+// under 6.25%). 40 octaves cover latencies up to ~4.8 hours in nanoseconds
+// and byte counts up to 16 TiB; larger values land in the top bucket.
+//
+// Histograms are sharded per thread, like the trace rings: only the owner
+// writes a shard, so recording is plain relaxed loads and stores with no
+// shared cache lines, even for per-block calls on every engine thread. A
+// shard is handed to a new thread once its thread exits, so its counts are
+// kept. Snapshots and the exporter merge all shards under shards_mutex; they
+// are not atomic across buckets but every count they see is real. Reset bumps
+// a generation number and each shard clears itself the next time its owner
+// records; until then the merge skips it.
+
+constexpr int SUB_BUCKET_BITS = 4;
+constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+constexpr int OCTAVES = 40;
+constexpr int HIST_BUCKETS = SUB_BUCKETS + OCTAVES * SUB_BUCKETS;
+
+// One thread's histogram; atomics only so that the merge may read it
+struct Histogram {
+    std::atomic<uint64_t> buckets[HIST_BUCKETS];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> min;       // Stored inverted: 0 means none yet
+    std::atomic<uint64_t> max;
+};
+
+struct OpMetrics {
+    Histogram latency;
+    Histogram bytes;
+};
+
+struct MetricsShard {
+    OpMetrics ops[RUC_OP_COUNT];
+    std::atomic<uint64_t> generation;
+};
+
+// All shards merged, for snapshots and export
+struct HistTotals {
+    uint64_t buckets[HIST_BUCKETS];
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+};
+
+static std::atomic<bool> metrics_on(true);
+static std::atomic<uint64_t> metrics_generation(0);
+static std::mutex shards_mutex;                   // shards, free_shards
+static std::vector<MetricsShard*> shards;         // Kept for the process lifetime
+static std::vector<MetricsShard*> free_shards;    // Shards of exited threads
+thread_local int ruc_metrics_depth = 0;
+
+static const char* const OP_NAMES[RUC_OP_COUNT] = {
+    "expand", "encrypt_block", "decrypt_block", "encrypt_batch", "decrypt_batch",
+    "ctx_encrypt", "ctx_decrypt", "stream_update", "encrypt_many", "decrypt_many",
+    "cbc_encrypt", "cbc_decrypt", "encrypt_ct", "decrypt_ct", "encrypt_async", "decrypt_async",
+    "compress_update", "decompress_update", "ctx_encrypt_bulk", "ctx_decrypt_bulk",
+    "reencrypt"
+};
+
+static inline int bucket_index(uint64_t v) {
+    if (v < SUB_BUCKETS) return (int)v;
+    int e = 63 - __builtin_clzll(v);   // >= SUB_BUCKET_BITS
+    int octave = e - SUB_BUCKET_BITS;
+    if (octave >= OCTAVES) return HIST_BUCKETS - 1;
+    int sub = (int)((v >> octave) & (SUB_BUCKETS - 1));
+    return SUB_BUCKETS + octave * SUB_BUCKETS + sub;
+}
+
+// Highest value that maps to a bucket (HDR "highest equivalent value")
+static inline uint64_t bucket_upper(int index) {
+    if (index < SUB_BUCKETS) return (uint64_t)index;
+    int octave = (index - SUB_BUCKETS) / SUB_BUCKETS;
+    uint64_t sub = (uint64_t)((index - SUB_BUCKETS) % SUB_BUCKETS);
+    uint64_t lower = (SUB_BUCKETS + sub) << octave;
+    return lower + ((uint64_t)1 << octave) - 1;
+}
+
+// Owner-only update, so no read-modify-write is needed
+static inline void add_relaxed(std::atomic<uint64_t>& a, uint64_t v) {
+    a.store(a.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+}
+
+static void hist_record(Histogram* h, uint64_t v) {
+    add_relaxed(h->buckets[bucket_index(v)], 1);
+    add_relaxed(h->sum, v);
+    if (~v > h->min.load(std::memory_order_relaxed)) h->min.store(~v, std::memory_order_relaxed);
+    if (v > h->max.load(std::memory_order_relaxed)) h->max.store(v, std::memory_order_relaxed);
+    add_relaxed(h->count, 1);
+}
+
+static void hist_reset(Histogram* h) {
+    for (int i = 0; i < HIST_BUCKETS; i++) h->buckets[i].store(0, std::memory_order_relaxed);
+    h->count.store(0, std::memory_order_relaxed);
+    h->sum.store(0, std::memory_order_relaxed);
+    h->min.store(0, std::memory_order_relaxed);
+    h->max.store(0, std::memory_order_relaxed);
+}
+
+static void hist_add(HistTotals* t, const Histogram* h) {
+    for (int i = 0; i < HIST_BUCKETS; i++) t->buckets[i] += h->buckets[i].load(std::memory_order_relaxed);
+    t->count += h->count.load(std::memory_order_relaxed);
+    t->sum += h->sum.load(std::memory_order_relaxed);
+    uint64_t inv_min = h->min.load(std::memory_order_relaxed);
+    if (inv_min && ~inv_min < t->min) t->min = ~inv_min;
+    uint64_t max = h->max.load(std::memory_order_relaxed);
+    if (max > t->max) t->max = max;
+}
+
+// Merge one op's latency (or bytes) histogram over every current shard
+static void hist_collect(int op, bool latency, HistTotals* t) {
+    memset(t, 0, sizeof(*t));
+    t->min = ~(uint64_t)0;
+    uint64_t generation = metrics_generation.load(std::memory_order_acquire);
+    std::lock_guard<std::mutex> lock(shards_mutex);
+    for (const MetricsShard* shard : shards) {
+        if (shard->generation.load(std::memory_order_acquire) != generation) continue;
+        hist_add(t, latency ? &shard->ops[op].latency : &shard->ops[op].bytes);
+    }
+    if (t->count == 0) t->min = 0;
+}
+
+// Value at quantile q (0..1), clamped to the observed maximum
+static uint64_t hist_quantile(const HistTotals* h, double q) {
+    uint64_t total = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) total += h->buckets[i];
+    if (total == 0) return 0;
+    uint64_t rank = (uint64_t)(q * (double)total + 0.999999);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank) {
+            uint64_t v = bucket_upper(i);
+            return v < h->max ? v : h->max;
+        }
+    }
+    return h->max;
+}
+
+// Hands the thread's shard back for reuse when the thread exits
+struct ThreadShard {
+    MetricsShard* shard = nullptr;
+    ~ThreadShard() {
+        if (!shard) return;
+        std::lock_guard<std::mutex> lock(shards_mutex);
+        free_shards.push_back(shard);
+    }
+};
+
+static thread_local ThreadShard thread_shard;
+
+// The calling thread's shard, cleared if it predates the last reset
+static MetricsShard* current_shard() {
+    MetricsShard* shard = thread_shard.shard;
+    uint64_t generation = metrics_generation.load(std::memory_order_acquire);
+    if (shard && shard->generation.load(std::memory_order_relaxed) == generation) return shard;
+
+    if (!shard) {
+        std::lock_guard<std::mutex> lock(shards_mutex);
+        if (!free_shards.empty()) {
+            shard = free_shards.back();
+            free_shards.pop_back();
+        } else {
+            shard = new MetricsShard();
+            for (OpMetrics& m : shard->ops) {
+                hist_reset(&m.latency);
+                hist_reset(&m.bytes);
+            }
+            shard->generation.store(generation, std::memory_order_relaxed);
+            shards.push_back(shard);
+        }
+        thread_shard.shard = shard;
+        if (shard->generation.load(std::memory_order_relaxed) == generation) return shard;
+    }
+    for (OpMetrics& m : shard->ops) {
+        hist_reset(&m.latency);
+        hist_reset(&m.bytes);
+    }
+    shard->generation.store(generation, std::memory_order_release);
+    return shard;
+}
+
+void ruc_metrics_record(int op, uint64_t latency_ns, uint64_t bytes) {
+    if (op < 0 || op >= RUC_OP_COUNT) return;
+    MetricsShard* shard = current_shard();
+    hist_record(&shard->ops[op].latency, latency_ns);
+    hist_record(&shard->ops[op].bytes, bytes);
+}
+
+bool ruc_metrics_enabled() {
+    return metrics_on.load(std::memory_order_relaxed);
+}
+
+void ruc_metrics_enable(int enabled) {
+    metrics_on.store(enabled != 0, std::memory_order_relaxed);
+}
+
+void ruc_metrics_reset() {
+    metrics_generation.fetch_add(1, std::memory_order_release);
+}
+
+const char* ruc_metrics_op_name(int op) {
+    return op >= 0 && op < RUC_OP_COUNT ? OP_NAMES[op] : nullptr;
+}
+
+int ruc_metrics_snapshot(int op, RucMetricsSnapshot* out) {
+    if (op < 0 || op >= RUC_OP_COUNT || !out) return -1;
+    // Merged totals are ~5 KiB each; keep them off small (WASM) stacks
+    std::unique_ptr<HistTotals> lat(new HistTotals), bytes(new HistTotals);
+    hist_collect(op, true, lat.get());
+    hist_collect(op, false, bytes.get());
+    out->calls = lat->count;
+    out->latency_sum_ns = lat->sum;
+    out->latency_min_ns = lat->min;
+    out->latency_max_ns = lat->max;
+    out->latency_p50_ns = hist_quantile(lat.get(), 0.50);
+    out->latency_p90_ns = hist_quantile(lat.get(), 0.90);
+    out->latency_p99_ns = hist_quantile(lat.get(), 0.99);
+    out->latency_p999_ns = hist_quantile(lat.get(), 0.999);
+    out->bytes_total = bytes->sum;
+    out->bytes_p50 = hist_quantile(bytes.get(), 0.50);
+    out->bytes_p99 = hist_quantile(bytes.get(), 0.99);
+    out->bytes_max = bytes->max;
+    return 0;
+}
+
+void ruc_text_printf(RucTextOut* t, const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    char* dst = t->len < t->capacity ? t->buf + t->len : nullptr;
+    size_t room = t->len < t->capacity ? t->capacity - t->len : 0;
+    int n = vsnprintf(dst, room, fmt, ap);
+    va_end(ap);
+    if (n > 0) t->len += (size_t)n;
+}
+
+size_t ruc_metrics_prometheus(char* buffer, size_t capacity) {
+    static const double QUANTILES[] = { 0.5, 0.9, 0.99, 0.999 };
+    RucTextOut t = { buffer, capacity, 0 };
+    if (buffer && capacity) buffer[0] = '\0';
+    std::unique_ptr<HistTotals> h(new HistTotals);
+
+    ruc_text_printf(&t, "# HELP ruc_call_duration_seconds Latency of RUC library calls.\n");
+    ruc_text_printf(&t, "# TYPE ruc_call_duration_seconds summary\n");
+    for (int op = 0; op < RUC_OP_COUNT; op++) {
+        hist_collect(op, true, h.get());
+        bool empty = h->count == 0;
+        for (double q : QUANTILES) {
+            if (empty) {
+                // Prometheus convention for a summary with no observations
+                ruc_text_printf(&t, "ruc_call_duration_seconds{op=\"%s\",quantile=\"%g\"} NaN\n", OP_NAMES[op], q);
+            } else {
+                ruc_text_printf(&t, "ruc_call_duration_seconds{op=\"%s\",quantile=\"%g\"} %.9f\n",
+                            OP_NAMES[op], q, (double)hist_quantile(h.get(), q) * 1e-9);
+            }
+        }
+        ruc_text_printf(&t, "ruc_call_duration_seconds_sum{op=\"%s\"} %.9f\n", OP_NAMES[op],
+                    (double)h->sum * 1e-9);
+        ruc_text_printf(&t, "ruc_call_duration_seconds_count{op=\"%s\"} %llu\n", OP_NAMES[op],
+                    (unsigned long long)h->count);
+    }
+
+    ruc_text_printf(&t, "# HELP ruc_call_bytes Bytes processed per RUC library call.\n");
+    ruc_text_printf(&t, "# TYPE ruc_call_bytes summary\n");
+    for (int op = 0; op < RUC_OP_COUNT; op++) {
+        hist_collect(op, false, h.get());
+        bool empty = h->count == 0;
+        for (double q : QUANTILES) {
+            if (empty) {
+                ruc_text_printf(&t, "ruc_call_bytes{op=\"%s\",quantile=\"%g\"} NaN\n", OP_NAMES[op], q);
+            } else {
+                ruc_text_printf(&t, "ruc_call_bytes{op=\"%s\",quantile=\"%g\"} %llu\n",
+                            OP_NAMES[op], q, (unsigned long long)hist_quantile(h.get(), q));
+            }
+        }
+        ruc_text_printf(&t, "ruc_call_bytes_sum{op=\"%s\"} %llu\n", OP_NAMES[op],
+                    (unsigned long long)h->sum);
+        ruc_text_printf(&t, "ruc_call_bytes_count{op=\"%s\"} %llu\n", OP_NAMES[op],
+                    (unsigned long long)h->count);
+    }
+    return t.len;
+}
@@ -0,0 +1,61 @@
+#ifndef RUC_METRICS_H
+#define RUC_METRICS_H
+
+#include "ruc_cipher.h"
+#include "ruc_trace.h"
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+// Internal hook for per-call metrics (public API in ruc_cipher.h). Each public
+// entry point opens a RucCallTimer; only the outermost one on a thread records,
+// so entry points built on other entry points (context decrypt on context
+// encrypt, batch decrypt on batch encrypt) are counted once, under the name the caller used.
+
+// snprintf-style appender for the text exporters: keeps counting past the
+// end of the buffer so the caller gets the full length
+struct RucTextOut {
+    char* buf;
+    size_t capacity;
+    size_t len;
+};
+
+void ruc_text_printf(RucTextOut* t, const char* fmt, ...);
+
+void ruc_metrics_record(int op, uint64_t latency_ns, uint64_t bytes);
+bool ruc_metrics_enabled();
+
+extern thread_local int ruc_metrics_depth;
+
+// Also a trace span (ruc_trace.h) at every depth while tracing is on
+class RucCallTimer {
+public:
+    RucCallTimer(int op, uint64_t bytes)
+        : op_(op), bytes_(bytes), active_(ruc_metrics_depth++ == 0 && ruc_metrics_enabled()),
+          trace_start_(ruc_trace_enabled() ? ruc_trace_now() : TRACE_OFF) {
+        if (active_) start_ = std::chrono::steady_clock::now();
+    }
+    ~RucCallTimer() {
+        ruc_metrics_depth--;
+        if (active_) {
+            uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start_).count();
+            ruc_metrics_record(op_, ns, bytes_);
+        }
+        if (trace_start_ != TRACE_OFF) {
+            ruc_trace_record(ruc_metrics_op_name(op_), trace_start_, ruc_trace_now(), "bytes", bytes_);
+        }
+    }
+    // For calls whose size is only known part way through
+    void set_bytes(uint64_t bytes) { bytes_ = bytes; }
+
+private:
+    static constexpr uint64_t TRACE_OFF = ~(uint64_t)0;
+    int op_;
+    uint64_t bytes_;
+    bool active_;
+    uint64_t trace_start_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#endif // RUC_METRICS_H
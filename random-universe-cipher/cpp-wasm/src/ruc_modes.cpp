@@ -0,0 +1,134 @@
+#include "ruc_cipher.h"
+#include "ruc_engine.h"
+#include "ruc_metrics.h"
+#include "ruc_parallel.h"
+#include <cstring>
+
+// CBC over the engine's block function E_n(x) = x ^ keystream(key, IV, n):
+//   C_n = E_n(P_n ^ C_{n-1}) = P_n ^ keystream_n ^ C_{n-1},  C_{-1} = IV
+// The keystream never depends on data, so both directions generate it for
+// every block on the engine pool and finish with a cheap XOR pass.
+// Only the layout (IV || ciphertext, PKCS#7) matches encryptCBC/decryptCBC in
+// src/cipher/modes.ts: that version chains cipher state between blocks, so
+// the ciphertexts do not interoperate.
+// Short messages skip the thread pool: below CBC_INLINE_BLOCKS the keystream
+// is generated on the calling thread. The key is retained for the whole call.
+
+constexpr size_t CBC_INLINE_BLOCKS = 64;
+constexpr size_t CBC_CHUNK_BLOCKS = 8;
+
+// PKCS#7 check on the last block without data-dependent branches or early
+// exits: every byte is examined whatever the padding length turns out to be
+static bool cbc_padding_valid(const uint8_t* last_block, uint8_t* padding_len) {
+    uint32_t pad = last_block[BLOCK_SIZE - 1];
+    uint32_t bad = (pad - 1) >> 31;                           // pad == 0
+    bad |= ((uint32_t)BLOCK_SIZE - pad) >> 31;                // pad > BLOCK_SIZE
+    for (uint32_t i = 0; i < BLOCK_SIZE; i++) {
+        uint32_t in_padding = ~((pad - (BLOCK_SIZE - i)) >> 31) & 1;  // BLOCK_SIZE - i <= pad
+        bad |= in_padding & (uint32_t)((0u - (last_block[i] ^ pad)) >> 31);
+    }
+    *padding_len = (uint8_t)pad;
+    return bad == 0;
+}
+
+// XOR a 32-byte block into dst
+static inline void xor_block(uint8_t* dst, const uint8_t* src) {
+    for (size_t i = 0; i < BLOCK_SIZE; i++) {
+        dst[i] ^= src[i];
+    }
+}
+
+size_t ruc_cbc_padded_len(size_t plaintext_len) {
+    return plaintext_len + (BLOCK_SIZE - (plaintext_len % BLOCK_SIZE));
+}
+
+// XOR every block with its keystream (blocks 0..num_blocks-1), in parallel
+// for long messages
+static void cbc_keystream(const KeyMaterial* km, const uint8_t* key, const uint8_t* iv,
+                          const uint8_t* input, size_t num_blocks, uint8_t* output) {
+    uint8_t iv_expanded[REGISTER_SIZE];
+    ruc_expand_iv(iv, iv_expanded);
+    if (num_blocks < CBC_INLINE_BLOCKS) {
+        ruc_process_blocks(km, key, iv, iv_expanded, 0, input, num_blocks, output);
+        return;
+    }
+    ruc_parallel_for(num_blocks, CBC_CHUNK_BLOCKS, [&](size_t begin, size_t end) {
+        ruc_process_blocks(km, key, iv, iv_expanded, (uint32_t)begin, input + begin * BLOCK_SIZE,
+                           end - begin, output + begin * BLOCK_SIZE);
+    });
+}
+
+int ruc_cbc_encrypt(
+    uint32_t key_id,
+    const uint8_t* iv,
+    const uint8_t* plaintext,
+    size_t len,
+    uint8_t* output,
+    size_t* output_len
+) {
+    RucCallTimer timer(RUC_OP_CBC_ENCRYPT, len);
+    // Check the key before writing anything, so a failure leaves output untouched
+    const KeyMaterial* km;
+    const uint8_t* key;
+    if (!ruc_key_retain(key_id, &km, &key)) return -1;
+    size_t padded_len = ruc_cbc_padded_len(len);
+    size_t num_blocks = padded_len / BLOCK_SIZE;
+    uint8_t* body = output + IV_SIZE;
+
+    // Pad straight into the output; no intermediate buffers
+    memcpy(output, iv, IV_SIZE);
+    memcpy(body, plaintext, len);
+    memset(body + len, (int)(padded_len - len), padded_len - len);
+
+    // P_n ^ keystream_n for all blocks, in place
+    cbc_keystream(km, key, iv, body, num_blocks, body);
+    ruc_key_release(key_id);
+
+    // Serial chain: C_n ^= C_{n-1}
+    const uint8_t* prev = output;
+    for (size_t n = 0; n < num_blocks; n++) {
+        uint8_t* block = body + n * BLOCK_SIZE;
+        xor_block(block, prev);
+        prev = block;
+    }
+
+    *output_len = IV_SIZE + padded_len;
+    return 0;
+}
+
+int ruc_cbc_decrypt(
+    uint32_t key_id,
+    const uint8_t* input,
+    size_t len,
+    uint8_t* plaintext,
+    size_t* plaintext_len
+) {
+    RucCallTimer timer(RUC_OP_CBC_DECRYPT, len);
+    if (len < IV_SIZE + BLOCK_SIZE || (len - IV_SIZE) % BLOCK_SIZE != 0) return -2;
+    const uint8_t* iv = input;
+    const uint8_t* body = input + IV_SIZE;
+    size_t padded_len = len - IV_SIZE;
+    size_t num_blocks = padded_len / BLOCK_SIZE;
+    const KeyMaterial* km;
+    const uint8_t* key;
+    if (!ruc_key_retain(key_id, &km, &key)) return -1;
+
+    // C_n ^ keystream_n for all blocks (no serial dependency)
+    cbc_keystream(km, key, iv, body, num_blocks, plaintext);
+    ruc_key_release(key_id);
+
+    // P_n = (C_n ^ keystream_n) ^ C_{n-1}
+    xor_block(plaintext, iv);
+    for (size_t n = 1; n < num_blocks; n++) {
+        xor_block(plaintext + n * BLOCK_SIZE, body + (n - 1) * BLOCK_SIZE);
+    }
+
+    // Remove PKCS#7 padding; on failure nothing decrypted is left behind
+    uint8_t padding_len;
+    if (!cbc_padding_valid(plaintext + padded_len - BLOCK_SIZE, &padding_len)) {
+        memset(plaintext, 0, padded_len);
+        return -3;
+    }
+    *plaintext_len = padded_len - padding_len;
+    return 0;
+}
@@ -0,0 +1,357 @@
+#include "ruc_cipher.h"
+#include "ruc_engine.h"
+#include "ruc_metrics.h"
+#include "ruc_parallel.h"
+#include "ruc_trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+#include <thread>
+#define RUC_NUMA_THREADS 1
+#endif
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define RUC_NUMA_LINUX 1
+#endif
+
+// NUMA-aware bulk encryption. On a multi-socket host a thread on the wrong
+// node pays remote latency for every S-box and round-key lookup and for every
+// input and output line. So the buffer is cut into page shards, each queued on
+// the node that holds the page (move_pages in query mode), workers are pinned
+// to a node's CPUs, and each node reads its own first-touched replica of the
+// key material. Workers drain their own node's queue before taking shards from
+// other nodes, so a buffer that sits on one node still uses every core.
+//
+// Topology comes from /sys/devices/system/node (RUC_NUMA_SYSFS overrides the
+// root, RUC_NUMA=0 disables detection). Without it there is one pseudo-node
+// and no pinning.
+
+constexpr size_t NUMA_DEFAULT_SHARD_BYTES = 4096;   // Shard = page: the unit of placement
+
+struct NumaTopology {
+    std::vector<int> node_ids;                  // sysfs node number per dense index
+    std::vector<std::vector<int>> node_cpus;    // CPUs per dense index
+    std::vector<int> cpu_node;                  // CPU -> dense index
+    size_t page_size;
+    bool detected;                              // Multi-node topology found
+};
+
+// "0-3,8-11" -> {0,1,2,3,8,9,10,11}
+static std::vector<int> parse_cpulist(const char* text) {
+    std::vector<int> cpus;
+    const char* p = text;
+    while (*p) {
+        char* end;
+        long first = strtol(p, &end, 10);
+        if (end == p) break;
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = strtol(p + 1, &end, 10);
+            p = end;
+        }
+        for (long cpu = first; cpu <= last && cpu < 65536; cpu++) cpus.push_back((int)cpu);
+        if (*p == ',') p++;
+    }
+    return cpus;
+}
+
+static NumaTopology detect_topology() {
+    NumaTopology topo;
+    topo.detected = false;
+    topo.page_size = NUMA_DEFAULT_SHARD_BYTES;
+#ifdef RUC_NUMA_LINUX
+    long page = sysconf(_SC_PAGESIZE);
+    if (page > 0) topo.page_size = (size_t)page;
+
+    const char* flag = getenv("RUC_NUMA");
+    const char* root = getenv("RUC_NUMA_SYSFS");
+    if (!root) root = "/sys/devices/system/node";
+    DIR* dir = (flag && strcmp(flag, "0") == 0) ? nullptr : opendir(root);
+    if (dir) {
+        std::vector<int> ids;
+        while (dirent* entry = readdir(dir)) {
+            int id;
+            char tail;
+            if (sscanf(entry->d_name, "node%d%c", &id, &tail) == 1) ids.push_back(id);
+        }
+        closedir(dir);
+        std::sort(ids.begin(), ids.end());
+        if (ids.size() > (size_t)RUC_MAX_NUMA_NODES) ids.resize(RUC_MAX_NUMA_NODES);
+
+        for (int id : ids) {
+            std::string path = std::string(root) + "/node" + std::to_string(id) + "/cpulist";
+            char buf[4096] = {0};
+            FILE* f = fopen(path.c_str(), "r");
+            if (f) {
+                size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+                buf[n] = 0;
+                fclose(f);
+            }
+            // Memory-only nodes keep an empty CPU list: their shards are stolen
+            topo.node_ids.push_back(id);
+            topo.node_cpus.push_back(parse_cpulist(buf));
+        }
+        topo.detected = topo.node_ids.size() > 1;
+    }
+#endif
+    if (!topo.detected) {
+        unsigned cpus = 1;
+#ifdef RUC_NUMA_THREADS
+        cpus = std::max(1u, std::thread::hardware_concurrency());
+#endif
+        topo.node_ids.assign(1, 0);
+        topo.node_cpus.assign(1, std::vector<int>());
+        for (unsigned cpu = 0; cpu < cpus; cpu++) topo.node_cpus[0].push_back((int)cpu);
+    }
+
+    for (size_t node = 0; node < topo.node_cpus.size(); node++) {
+        for (int cpu : topo.node_cpus[node]) {
+            if ((size_t)cpu >= topo.cpu_node.size()) topo.cpu_node.resize(cpu + 1, 0);
+            topo.cpu_node[cpu] = (int)node;
+        }
+    }
+    return topo;
+}
+
+static const NumaTopology& numa_topology() {
+    static const NumaTopology topo = detect_topology();
+    return topo;
+}
+
+uint32_t ruc_numa_node_count(void) {
+    return (uint32_t)numa_topology().node_ids.size();
+}
+
+void* ruc_numa_alloc_local(size_t size) {
+#ifdef RUC_NUMA_LINUX
+    void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) return nullptr;
+#else
+    void* ptr = malloc(size);
+    if (!ptr) return nullptr;
+#endif
+    // First touch places the pages on the calling thread's node
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+void ruc_numa_free_local(void* ptr, size_t size) {
+    if (!ptr) return;
+    memset(ptr, 0, size);
+#ifdef RUC_NUMA_LINUX
+    munmap(ptr, size);
+#else
+    free(ptr);
+#endif
+}
+
+// Dense node of each page starting at first_page; -1 where unknown (not yet
+// faulted in, or no move_pages)
+static std::vector<int> page_nodes(const NumaTopology& topo, uintptr_t first_page, size_t num_pages) {
+    std::vector<int> nodes(num_pages, -1);
+#if defined(RUC_NUMA_LINUX) && defined(SYS_move_pages)
+    constexpr size_t QUERY_BATCH = 1024;
+    void* pages[QUERY_BATCH];
+    int status[QUERY_BATCH];
+    for (size_t i = 0; i < num_pages; i += QUERY_BATCH) {
+        size_t n = std::min(QUERY_BATCH, num_pages - i);
+        for (size_t j = 0; j < n; j++) pages[j] = (void*)(first_page + (i + j) * topo.page_size);
+        // A null node list only reports where each page lives
+        if (syscall(SYS_move_pages, 0, (unsigned long)n, pages, nullptr, status, 0) != 0) break;
+        for (size_t j = 0; j < n; j++) {
+            auto it = std::find(topo.node_ids.begin(), topo.node_ids.end(), status[j]);
+            if (status[j] >= 0 && it != topo.node_ids.end()) nodes[i + j] = (int)(it - topo.node_ids.begin());
+        }
+    }
+#else
+    (void)topo;
+    (void)first_page;
+#endif
+    return nodes;
+}
+
+#ifdef RUC_NUMA_THREADS
+// Pins the calling thread to a node's CPUs for its lifetime. Engine pool
+// threads are shared, so the previous affinity is restored afterwards.
+class NodePin {
+public:
+    NodePin(const NumaTopology& topo, int node) {
+#ifdef RUC_NUMA_LINUX
+        saved_ = pthread_getaffinity_np(pthread_self(), sizeof(previous_), &previous_) == 0;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : topo.node_cpus[node]) {
+            if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+        }
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+        (void)topo;
+        (void)node;
+#endif
+    }
+    ~NodePin() {
+#ifdef RUC_NUMA_LINUX
+        if (saved_) pthread_setaffinity_np(pthread_self(), sizeof(previous_), &previous_);
+#endif
+    }
+
+private:
+#ifdef RUC_NUMA_LINUX
+    cpu_set_t previous_;
+    bool saved_;
+#endif
+};
+
+static int current_node(const NumaTopology& topo) {
+#ifdef RUC_NUMA_LINUX
+    int cpu = sched_getcpu();
+    if (cpu >= 0 && (size_t)cpu < topo.cpu_node.size()) return topo.cpu_node[cpu];
+#else
+    (void)topo;
+#endif
+    return 0;
+}
+#endif
+
+struct BulkShard {
+    size_t begin;   // Block range [begin, end)
+    size_t end;
+};
+
+static int ctx_process_bulk(
+    uint32_t ctx_id,
+    const uint8_t* input_blocks,
+    size_t num_blocks,
+    uint32_t start_block_number,
+    uint8_t* output_blocks
+) {
+    RucContext ctx;
+    if (!ruc_ctx_retain_copy(ctx_id, &ctx)) return -1;
+    const NumaTopology& topo = numa_topology();
+    size_t num_nodes = topo.node_ids.size();
+    size_t page = topo.page_size;
+
+    // One shard per input page; a block straddling pages goes with its first byte
+    uintptr_t start = (uintptr_t)input_blocks;
+    uintptr_t first_page = start & ~(uintptr_t)(page - 1);
+    size_t num_pages = (start + num_blocks * BLOCK_SIZE - first_page + page - 1) / page;
+    std::vector<int> nodes;
+    if (topo.detected) nodes = page_nodes(topo, first_page, num_pages);
+
+    std::vector<std::vector<BulkShard>> queues(num_nodes);
+    size_t begin = 0;
+    for (size_t p = 0; p < num_pages && begin < num_blocks; p++) {
+        uintptr_t page_end = first_page + (p + 1) * page;
+        size_t end = std::min(num_blocks, (size_t)(page_end - start + BLOCK_SIZE - 1) / BLOCK_SIZE);
+        if (end <= begin) continue;
+        // Pages not faulted in yet are spread evenly
+        int node = topo.detected && nodes[p] >= 0 ? nodes[p] : (int)(p * num_nodes / num_pages);
+        queues[node].push_back({begin, end});
+        begin = end;
+    }
+
+    std::unique_ptr<std::atomic<size_t>[]> next(new std::atomic<size_t>[num_nodes]);
+    for (size_t n = 0; n < num_nodes; n++) next[n] = 0;
+
+    // Own node first, then steal from the others in turn
+    auto run = [&](size_t node, const KeyMaterial* km, const uint8_t* key) {
+        for (size_t i = 0; i < num_nodes; i++) {
+            size_t q = (node + i) % num_nodes;
+            for (;;) {
+                size_t s = next[q].fetch_add(1, std::memory_order_relaxed);
+                if (s >= queues[q].size()) break;
+                const BulkShard& shard = queues[q][s];
+                RucTraceSpan span(q == node ? "bulk_shard" : "bulk_shard_stolen", "node", q);
+                ruc_process_blocks(km, key, ctx.iv, ctx.iv_expanded,
+                                   start_block_number + (uint32_t)shard.begin,
+                                   input_blocks + shard.begin * BLOCK_SIZE, shard.end - shard.begin,
+                                   output_blocks + shard.begin * BLOCK_SIZE);
+            }
+        }
+    };
+
+#ifdef RUC_NUMA_THREADS
+    // One worker per CPU, capped at the shard count (and at the engine pool's
+    // size). Nodes holding shards get theirs first; CPUs left over elsewhere
+    // steal. The caller works unpinned as one of its current node's workers.
+    size_t total_cpus = 0, total_shards = 0;
+    for (size_t node = 0; node < num_nodes; node++) {
+        total_cpus += topo.node_cpus[node].size();
+        total_shards += queues[node].size();
+    }
+    size_t caller_node = (size_t)current_node(topo);
+    std::vector<size_t> workers(num_nodes, 0);
+    workers[caller_node] = 1;
+    size_t budget = std::min(total_cpus, total_shards);
+    budget = budget > 0 ? budget - 1 : 0;
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t node = 0; node < num_nodes; node++) {
+            size_t cpus = topo.node_cpus[node].size();
+            size_t cap = pass == 0 ? std::min(cpus, queues[node].size()) : cpus;
+            size_t add = cap > workers[node] ? std::min(cap - workers[node], budget) : 0;
+            workers[node] += add;
+            budget -= add;
+        }
+    }
+
+    // Worker 0 is the caller; pool workers are pinned to their node while they run
+    std::vector<size_t> worker_node(1, caller_node);
+    for (size_t node = 0; node < num_nodes; node++) {
+        for (size_t w = node == caller_node ? 1 : 0; w < workers[node]; w++) {
+            worker_node.push_back(node);
+        }
+    }
+    ruc_parallel_run(worker_node.size(), [&](size_t worker) {
+        size_t node = worker_node[worker];
+        if (worker == 0 || !topo.detected) {
+            run(node, ctx.km, ctx.key);
+            return;
+        }
+        NodePin pin(topo, (int)node);
+        const KeyMaterial* km = ctx.km;
+        const uint8_t* key = ctx.key;
+        ruc_key_node_replica(ctx.key_id, (int)node, &km, &key);
+        run(node, km, key);
+    });
+#else
+    run(0, ctx.km, ctx.key);
+#endif
+
+    ruc_ctx_release_copy(&ctx);
+    return 0;
+}
+
+int ruc_ctx_encrypt_bulk(
+    uint32_t ctx_id,
+    const uint8_t* input_blocks,
+    size_t num_blocks,
+    uint32_t start_block_number,
+    uint8_t* output_blocks
+) {
+    RucCallTimer timer(RUC_OP_CTX_ENCRYPT_BULK, (uint64_t)num_blocks * BLOCK_SIZE);
+    return ctx_process_bulk(ctx_id, input_blocks, num_blocks, start_block_number, output_blocks);
+}
+
+// Decryption is the same keystream XOR
+int ruc_ctx_decrypt_bulk(
+    uint32_t ctx_id,
+    const uint8_t* input_blocks,
+    size_t num_blocks,
+    uint32_t start_block_number,
+    uint8_t* output_blocks
+) {
+    RucCallTimer timer(RUC_OP_CTX_DECRYPT_BULK, (uint64_t)num_blocks * BLOCK_SIZE);
+    return ctx_process_bulk(ctx_id, input_blocks, num_blocks, start_block_number, output_blocks);
+}
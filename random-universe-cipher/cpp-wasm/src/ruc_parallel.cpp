@@ -0,0 +1,172 @@
+#include "ruc_parallel.h"
+#include "ruc_trace.h"
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#define RUC_PARALLEL_THREADS 1
+#endif
+
+// simd-mt WASM builds pre-spawn this many pthread workers (PTHREAD_POOL_SIZE,
+// set from the same CMake cache variable). A thread beyond that can only start
+// once the main thread returns to the event loop, which a blocking engine
+// call never does, so the pool must not ask for more.
+#if defined(__EMSCRIPTEN_PTHREADS__) && !defined(RUC_WASM_THREAD_POOL)
+#define RUC_WASM_THREAD_POOL 4
+#endif
+
+// A call publishes one job asking for some number of helpers. Idle pool
+// threads take a worker index from it until it has enough; the caller runs
+// worker 0, withdraws the job so no late helper can join, and waits only for
+// the helpers that did. Jobs are served in arrival order.
+//
+// Posted jobs work the same way without a caller: the job owns its task and
+// the last helper to finish deletes it.
+//
+// The pool state is allocated once and never destroyed, and its threads are
+// detached: nothing runs at static destruction time, so a process can exit
+// while the pool is idle without joining it.
+
+#ifdef RUC_PARALLEL_THREADS
+struct ParallelJob {
+    const std::function<void(size_t)>* task;
+    size_t wanted;      // Helpers still to start
+    size_t next_worker;
+    size_t active;      // Helpers running
+    std::function<void(size_t)> posted_task;  // Owned task of a posted job
+};
+
+struct ParallelPool {
+    std::mutex mutex;
+    std::condition_variable work_cv;
+    std::condition_variable done_cv;
+    std::deque<ParallelJob*> jobs;
+    size_t num_threads;
+    bool post_thread_started;   // Extra thread for posted work (no pool threads)
+};
+
+static void pool_worker(ParallelPool* pool) {
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    for (;;) {
+        pool->work_cv.wait(lock, [pool] { return !pool->jobs.empty(); });
+        ParallelJob* job = pool->jobs.front();
+        size_t worker = job->next_worker++;
+        if (--job->wanted == 0) pool->jobs.pop_front();
+        job->active++;
+        lock.unlock();
+        (*job->task)(worker);
+        lock.lock();
+        if (--job->active > 0) continue;
+        if (job->task == &job->posted_task) {
+            if (job->wanted == 0) delete job;
+        } else {
+            pool->done_cv.notify_all();
+        }
+    }
+}
+
+static ParallelPool* parallel_pool() {
+    static ParallelPool* pool = [] {
+        ParallelPool* p = new ParallelPool();
+        p->post_thread_started = false;
+        size_t cpus = std::max(1u, std::thread::hardware_concurrency());
+        p->num_threads = cpus - 1;
+#ifdef __EMSCRIPTEN_PTHREADS__
+        p->num_threads = std::min(p->num_threads, (size_t)RUC_WASM_THREAD_POOL);
+#endif
+        for (size_t i = 0; i < p->num_threads; i++) {
+            std::thread(pool_worker, p).detach();
+        }
+        return p;
+    }();
+    return pool;
+}
+#endif
+
+size_t ruc_parallel_max_workers() {
+#ifdef RUC_PARALLEL_THREADS
+    return parallel_pool()->num_threads + 1;
+#else
+    return 1;
+#endif
+}
+
+void ruc_parallel_run(size_t num_workers, const std::function<void(size_t worker)>& task) {
+#ifdef RUC_PARALLEL_THREADS
+    ParallelPool* pool = parallel_pool();
+    size_t helpers = num_workers > 0 ? std::min(num_workers - 1, pool->num_threads) : 0;
+    if (helpers == 0) {
+        task(0);
+        return;
+    }
+
+    ParallelJob job = {&task, helpers, 1, 0};
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->jobs.push_back(&job);
+    }
+    if (helpers == 1) {
+        pool->work_cv.notify_one();
+    } else {
+        pool->work_cv.notify_all();
+    }
+
+    task(0);
+
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    if (job.wanted > 0) {
+        pool->jobs.erase(std::find(pool->jobs.begin(), pool->jobs.end(), &job));
+    }
+    RucTraceSpan join("join", "threads", job.next_worker - 1);
+    pool->done_cv.wait(lock, [&job] { return job.active == 0; });
+#else
+    (void)num_workers;
+    task(0);
+#endif
+}
+
+void ruc_parallel_post(size_t num_workers, std::function<void(size_t worker)> task) {
+#ifdef RUC_PARALLEL_THREADS
+    ParallelPool* pool = parallel_pool();
+    size_t threads = std::max<size_t>(pool->num_threads, 1);
+    ParallelJob* job = new ParallelJob();
+    job->posted_task = std::move(task);
+    job->task = &job->posted_task;
+    job->wanted = std::max<size_t>(1, std::min(num_workers, threads));
+    job->next_worker = 0;
+    job->active = 0;
+    bool notify_all = job->wanted > 1;
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        if (pool->num_threads == 0 && !pool->post_thread_started) {
+            std::thread(pool_worker, pool).detach();
+            pool->post_thread_started = true;
+        }
+        pool->jobs.push_back(job);
+    }
+    if (notify_all) {
+        pool->work_cv.notify_all();
+    } else {
+        pool->work_cv.notify_one();
+    }
+#else
+    (void)num_workers;
+    task(0);
+#endif
+}
+
+void ruc_parallel_for(size_t count, size_t chunk, const std::function<void(size_t begin, size_t end)>& body) {
+    size_t num_chunks = (count + chunk - 1) / chunk;
+    std::atomic<size_t> next_chunk(0);
+    ruc_parallel_run(num_chunks, [&](size_t) {
+        for (;;) {
+            size_t c = next_chunk.fetch_add(1, std::memory_order_relaxed);
+            if (c >= num_chunks) break;
+            size_t begin = c * chunk;
+            body(begin, std::min(begin + chunk, count));
+        }
+    });
+}
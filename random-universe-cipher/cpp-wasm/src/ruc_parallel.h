@@ -0,0 +1,33 @@
+#ifndef RUC_PARALLEL_H
+#define RUC_PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+
+// Engine worker pool shared by the multi-threaded entry points (batches, key
+// rotation, NUMA bulk). Threads are started once, on first use, instead of
+// per call. The calling thread always takes part, so a call makes progress
+// even when every pool thread is busy with someone else's work; pool threads
+// that are not free by the time the caller finishes are simply not used.
+// Builds without threads (non-pthread WASM) run everything on the caller.
+
+// Calling thread plus pool threads
+size_t ruc_parallel_max_workers();
+
+// Run task(worker) on the calling thread (worker 0) and on up to
+// num_workers - 1 pool threads (workers 1, 2, ...), and return once every
+// started task has returned. Not every index is guaranteed to run, so tasks
+// should claim work from a shared counter rather than own a fixed slice.
+void ruc_parallel_run(size_t num_workers, const std::function<void(size_t worker)>& task);
+
+// Run task(worker) on up to num_workers pool threads (workers 0, 1, ...) and
+// return at once, for callers that must not block (the async API). A
+// single-core host has no pool threads, so the first post starts one thread
+// that only serves posted work. Builds without threads run task(0) inline.
+void ruc_parallel_post(size_t num_workers, std::function<void(size_t worker)> task);
+
+// Cut [0, count) into chunk-sized ranges and hand them out to workers from
+// an atomic counter; body(begin, end) runs once per range
+void ruc_parallel_for(size_t count, size_t chunk, const std::function<void(size_t begin, size_t end)>& body);
+
+#endif // RUC_PARALLEL_H
@@ -0,0 +1,40 @@
+#include "ruc_cipher.h"
+#include "ruc_engine.h"
+#include "ruc_metrics.h"
+#include "ruc_parallel.h"
+#include "ruc_trace.h"
+
+// Fused key rotation. A decrypt followed by an encrypt reads and writes the
+// data twice and holds the plaintext in between; here each block gets both
+// keystreams at once (ruc_rekey_blocks), and engine pool workers claim
+// fixed-size chunks so the pass runs on every core.
+
+constexpr size_t REKEY_CHUNK_BLOCKS = 8;
+
+int ruc_reencrypt(
+    uint32_t old_ctx_id,
+    uint32_t new_ctx_id,
+    const uint8_t* input_blocks,
+    size_t num_blocks,
+    uint32_t start_block_number,
+    uint8_t* output_blocks
+) {
+    RucCallTimer timer(RUC_OP_REENCRYPT, (uint64_t)num_blocks * BLOCK_SIZE);
+    // Copies keep both keys alive even if a context is destroyed meanwhile
+    RucContext from, to;
+    if (!ruc_ctx_retain_copy(old_ctx_id, &from)) return -1;
+    if (!ruc_ctx_retain_copy(new_ctx_id, &to)) {
+        ruc_ctx_release_copy(&from);
+        return -1;
+    }
+
+    ruc_parallel_for(num_blocks, REKEY_CHUNK_BLOCKS, [&](size_t begin, size_t end) {
+        RucTraceSpan span("rekey_chunk", "blocks", end - begin);
+        ruc_rekey_blocks(&from, &to, start_block_number + (uint32_t)begin,
+                         input_blocks + begin * BLOCK_SIZE, end - begin, output_blocks + begin * BLOCK_SIZE);
+    });
+
+    ruc_ctx_release_copy(&to);
+    ruc_ctx_release_copy(&from);
+    return 0;
+}
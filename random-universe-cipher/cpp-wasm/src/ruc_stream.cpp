@@ -0,0 +1,147 @@
+#include "ruc_cipher.h"
+#include "ruc_engine.h"
+#include "ruc_metrics.h"
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+// Incremental encryptor over a context. The cipher is a pure keystream XOR
+// (block N's keystream depends only on key, IV and N), so a stream only has to
+// remember the next block number and whatever is left of the last partial
+// block's keystream. A single stream must not be updated from two threads at
+// once; different streams are independent.
+//
+// Block numbers are 32-bit, so a stream covers at most 2^32 blocks from its
+// start block. An update that would run past that fails instead of wrapping
+// the counter and reusing keystream.
+
+constexpr uint64_t RUC_STREAM_BLOCK_LIMIT = 1ull << 32;
+
+struct RucStream {
+    RucContext ctx;              // Retained copy (keeps the key alive)
+    uint64_t next_block;         // Next block whose keystream is not yet generated
+    uint8_t keystream[BLOCK_SIZE];
+    size_t keystream_used;       // BLOCK_SIZE = no leftover keystream
+    uint64_t total_bytes;
+};
+
+static std::mutex stream_mutex;
+static std::vector<RucStream*> stream_table;
+
+static RucStream* lookup_stream(uint32_t stream_id) {
+    std::lock_guard<std::mutex> lock(stream_mutex);
+    if (stream_id == 0 || stream_id > stream_table.size()) return nullptr;
+    return stream_table[stream_id - 1];
+}
+
+uint32_t ruc_stream_init(uint32_t ctx_id, uint32_t start_block_number) {
+    RucStream* stream = new RucStream();
+    if (!ruc_ctx_retain_copy(ctx_id, &stream->ctx)) {
+        delete stream;
+        return 0;
+    }
+    stream->next_block = start_block_number;
+    stream->keystream_used = BLOCK_SIZE;
+    stream->total_bytes = 0;
+
+    std::lock_guard<std::mutex> lock(stream_mutex);
+    for (size_t i = 0; i < stream_table.size(); i++) {
+        if (!stream_table[i]) {
+            stream_table[i] = stream;
+            return (uint32_t)(i + 1);
+        }
+    }
+    stream_table.push_back(stream);
+    return (uint32_t)stream_table.size();
+}
+
+// Keystream blocks a len-byte update still has to generate
+static uint64_t stream_blocks_needed(const RucStream* stream, uint64_t len) {
+    size_t leftover = BLOCK_SIZE - stream->keystream_used;
+    if (len <= leftover) return 0;
+    return (len - leftover + BLOCK_SIZE - 1) / BLOCK_SIZE;
+}
+
+static bool stream_has_room(const RucStream* stream, uint64_t len) {
+    return stream_blocks_needed(stream, len) <= RUC_STREAM_BLOCK_LIMIT - stream->next_block;
+}
+
+static void stream_process(RucStream* stream, const uint8_t* input, size_t len, uint8_t* output) {
+    const RucContext& ctx = stream->ctx;
+    stream->total_bytes += len;
+
+    // Finish the keystream left over from the previous partial block
+    size_t leftover = BLOCK_SIZE - stream->keystream_used;
+    size_t n = len < leftover ? len : leftover;
+    for (size_t i = 0; i < n; i++) {
+        output[i] = input[i] ^ stream->keystream[stream->keystream_used + i];
+    }
+    stream->keystream_used += n;
+    input += n;
+    output += n;
+    len -= n;
+
+    // Whole blocks go straight to the batch engine
+    size_t full_blocks = len / BLOCK_SIZE;
+    if (full_blocks > 0) {
+        ruc_process_blocks(ctx.km, ctx.key, ctx.iv, ctx.iv_expanded, (uint32_t)stream->next_block,
+                           input, full_blocks, output);
+        stream->next_block += full_blocks;
+        input += full_blocks * BLOCK_SIZE;
+        output += full_blocks * BLOCK_SIZE;
+        len -= full_blocks * BLOCK_SIZE;
+    }
+
+    // Partial tail: generate one block of keystream and keep the rest for later
+    if (len > 0) {
+        static const uint8_t zero_block[BLOCK_SIZE] = {0};
+        ruc_process_blocks(ctx.km, ctx.key, ctx.iv, ctx.iv_expanded, (uint32_t)stream->next_block,
+                           zero_block, 1, stream->keystream);
+        stream->next_block++;
+        for (size_t i = 0; i < len; i++) {
+            output[i] = input[i] ^ stream->keystream[i];
+        }
+        stream->keystream_used = len;
+    }
+}
+
+int ruc_stream_update(uint32_t stream_id, const uint8_t* input, size_t len, uint8_t* output) {
+    RucCallTimer timer(RUC_OP_STREAM_UPDATE, len);
+    RucStream* stream = lookup_stream(stream_id);
+    if (!stream) return -1;
+    if (!stream_has_room(stream, len)) return -2;
+    stream_process(stream, input, len, output);
+    return 0;
+}
+
+int ruc_stream_updatev(uint32_t stream_id, const RucIovec* iov, size_t iov_count) {
+    RucCallTimer timer(RUC_OP_STREAM_UPDATE, 0);
+    RucStream* stream = lookup_stream(stream_id);
+    if (!stream) return -1;
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < iov_count; i++) bytes += iov[i].len;
+    if (!stream_has_room(stream, bytes)) return -2;
+    for (size_t i = 0; i < iov_count; i++) {
+        uint8_t* data = (uint8_t*)iov[i].base;
+        stream_process(stream, data, iov[i].len, data);
+    }
+    timer.set_bytes(bytes);
+    return 0;
+}
+
+int ruc_stream_final(uint32_t stream_id, uint64_t* total_bytes) {
+    RucStream* stream;
+    {
+        std::lock_guard<std::mutex> lock(stream_mutex);
+        if (stream_id == 0 || stream_id > stream_table.size()) return -1;
+        stream = stream_table[stream_id - 1];
+        if (!stream) return -1;
+        stream_table[stream_id - 1] = nullptr;
+    }
+    if (total_bytes) *total_bytes = stream->total_bytes;
+
+    ruc_ctx_release_copy(&stream->ctx);
+    memset(stream, 0, sizeof(RucStream));
+    delete stream;
+    return 0;
+}
@@ -0,0 +1,226 @@
+#include "ruc_trace.h"
+#include "ruc_cipher.h"
+#include "ruc_engine.h"
+#include "ruc_metrics.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Engine trace. Each thread appends complete spans to its own ring; only the
+// owner writes a ring's events and head, so recording is a few relaxed stores
+// and one release store. Starting a trace bumps the session number and each
+// ring resets itself (under trace_mutex) the next time its owner records.
+// The export walks the rings under trace_mutex and writes Chrome trace-event
+// JSON, one "X" (complete) event per span.
+//
+// The export may run while owners keep recording. Slots are published like a
+// seqlock, with head as the sequence: the owner issues a release fence before
+// it overwrites a slot, and the export copies a ring's events, issues an
+// acquire fence and re-reads head. Any copied slot an owner may have started
+// to overwrite by then (index <= head - capacity) is dropped, so only whole
+// spans are written.
+
+constexpr size_t DEFAULT_EVENTS_PER_THREAD = 16384;
+constexpr uint64_t NO_SESSION = ~(uint64_t)0;
+
+// A ring slot; fields are atomics (relaxed) so the export may read them
+// while the owner writes
+struct TraceSlot {
+    std::atomic<const char*> name;
+    std::atomic<const char*> arg_name;
+    std::atomic<uint64_t> start;
+    std::atomic<uint64_t> dur;
+    std::atomic<uint64_t> arg;
+};
+
+// A span copied out of a slot by the export
+struct TraceEvent {
+    const char* name;
+    const char* arg_name;
+    uint64_t start;
+    uint64_t dur;
+    uint64_t arg;
+};
+
+struct TraceRing {
+    std::unique_ptr<TraceSlot[]> events;
+    size_t capacity;                 // Power of two
+    std::atomic<uint64_t> head;      // Events written this session
+    uint64_t session;
+    uint32_t lane;                   // Trace viewer tid
+    int phase;                       // Running RUC_PHASE_*, or RUC_PHASE_NONE
+    uint64_t phase_start;
+};
+
+std::atomic<bool> ruc_trace_on(false);
+static std::atomic<uint64_t> trace_session(0);
+static std::atomic<int64_t> trace_origin_ns(0);
+static std::mutex trace_mutex;                   // rings, free_rings, events_per_thread
+static std::vector<TraceRing*> rings;            // Kept for the process lifetime
+static std::vector<TraceRing*> free_rings;       // Rings of exited threads
+static size_t events_per_thread = DEFAULT_EVENTS_PER_THREAD;
+
+static const char* const PHASE_NAMES[RUC_PHASE_COUNT] = {
+    "counter_hash", "order_selectors", "rounds", "keystream"
+};
+
+static int64_t steady_ns() {
+    return (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t ruc_trace_now() {
+    int64_t t = steady_ns() - trace_origin_ns.load(std::memory_order_relaxed);
+    return t > 0 ? (uint64_t)t : 0;
+}
+
+// Hands the thread's ring back for reuse when the thread exits
+struct ThreadRing {
+    TraceRing* ring = nullptr;
+    ~ThreadRing() {
+        if (!ring) return;
+        std::lock_guard<std::mutex> lock(trace_mutex);
+        free_rings.push_back(ring);
+    }
+};
+
+static thread_local ThreadRing thread_ring;
+
+// The calling thread's ring, reset if it still holds an older session
+static TraceRing* current_ring() {
+    TraceRing* ring = thread_ring.ring;
+    uint64_t session = trace_session.load(std::memory_order_acquire);
+    if (ring && ring->session == session) return ring;
+
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    if (!ring) {
+        if (!free_rings.empty()) {
+            ring = free_rings.back();
+            free_rings.pop_back();
+        } else {
+            ring = new TraceRing();
+            ring->capacity = 0;
+            ring->head.store(0, std::memory_order_relaxed);
+            ring->session = NO_SESSION;
+            ring->lane = (uint32_t)rings.size() + 1;
+            rings.push_back(ring);
+        }
+        ring->phase = RUC_PHASE_NONE;
+        thread_ring.ring = ring;
+    }
+    if (ring->session != session) {
+        if (ring->capacity != events_per_thread) {
+            ring->events.reset(new TraceSlot[events_per_thread]);
+            ring->capacity = events_per_thread;
+        }
+        ring->head.store(0, std::memory_order_relaxed);
+        ring->session = session;
+        ring->phase = RUC_PHASE_NONE;
+    }
+    return ring;
+}
+
+void ruc_trace_record(const char* name, uint64_t start_ns, uint64_t end_ns,
+                      const char* arg_name, uint64_t arg) {
+    TraceRing* ring = current_ring();
+    uint64_t h = ring->head.load(std::memory_order_relaxed);
+    TraceSlot& e = ring->events[h & (ring->capacity - 1)];
+    // Orders the previous head store before this overwrite (see the export)
+    std::atomic_thread_fence(std::memory_order_release);
+    e.name.store(name, std::memory_order_relaxed);
+    e.arg_name.store(arg_name, std::memory_order_relaxed);
+    e.start.store(start_ns, std::memory_order_relaxed);
+    e.dur.store(end_ns > start_ns ? end_ns - start_ns : 0, std::memory_order_relaxed);
+    e.arg.store(arg, std::memory_order_relaxed);
+    ring->head.store(h + 1, std::memory_order_release);
+}
+
+void ruc_trace_phase(int phase) {
+    TraceRing* ring = current_ring();
+    uint64_t now = ruc_trace_now();
+    if (ring->phase >= 0 && ring->phase < RUC_PHASE_COUNT) {
+        ruc_trace_record(PHASE_NAMES[ring->phase], ring->phase_start, now, nullptr, 0);
+    }
+    ring->phase = phase;
+    ring->phase_start = now;
+}
+
+int ruc_trace_start(size_t events_per_thread_hint) {
+    size_t wanted = events_per_thread_hint ? events_per_thread_hint : DEFAULT_EVENTS_PER_THREAD;
+    size_t capacity = 1;
+    while (capacity < wanted) capacity <<= 1;
+
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    events_per_thread = capacity;
+    trace_origin_ns.store(steady_ns(), std::memory_order_relaxed);
+    trace_session.fetch_add(1, std::memory_order_release);
+    ruc_trace_on.store(true, std::memory_order_relaxed);
+    return 0;
+}
+
+void ruc_trace_stop() {
+    ruc_trace_on.store(false, std::memory_order_relaxed);
+}
+
+size_t ruc_trace_json(char* buffer, size_t capacity) {
+    RucTextOut t = { buffer, capacity, 0 };
+    if (buffer && capacity) buffer[0] = '\0';
+
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    uint64_t session = trace_session.load(std::memory_order_acquire);
+    std::vector<TraceEvent> copied;
+    ruc_text_printf(&t, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    ruc_text_printf(&t, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"ruc\"}}");
+    for (TraceRing* ring : rings) {
+        if (ring->session != session) continue;
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t begin = head > ring->capacity ? head - ring->capacity : 0;
+        copied.clear();
+        for (uint64_t i = begin; i < head; i++) {
+            const TraceSlot& slot = ring->events[i & (ring->capacity - 1)];
+            copied.push_back({ slot.name.load(std::memory_order_relaxed),
+                               slot.arg_name.load(std::memory_order_relaxed),
+                               slot.start.load(std::memory_order_relaxed),
+                               slot.dur.load(std::memory_order_relaxed),
+                               slot.arg.load(std::memory_order_relaxed) });
+        }
+        // Slots the owner may have begun to overwrite while they were copied
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t now = ring->head.load(std::memory_order_relaxed);
+        uint64_t first_whole = now >= ring->capacity ? now - ring->capacity + 1 : 0;
+
+        ruc_text_printf(&t, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                        "\"args\":{\"name\":\"lane %u\"}}", ring->lane, ring->lane);
+        for (uint64_t i = std::max(begin, first_whole); i < head; i++) {
+            const TraceEvent& e = copied[i - begin];
+            ruc_text_printf(&t, ",\n{\"name\":\"%s\",\"cat\":\"ruc\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+                            "\"ts\":%.3f,\"dur\":%.3f", e.name, ring->lane, (double)e.start / 1000.0,
+                            (double)e.dur / 1000.0);
+            if (e.arg_name) {
+                ruc_text_printf(&t, ",\"args\":{\"%s\":%llu}}", e.arg_name, (unsigned long long)e.arg);
+            } else {
+                ruc_text_printf(&t, "}");
+            }
+        }
+    }
+    ruc_text_printf(&t, "\n]}\n");
+    return t.len;
+}
+
+int ruc_trace_write(const char* path) {
+    // Spans recorded between sizing and rendering (trace still running)
+    // lengthen the output; resize with some slack until a render fits. Rings
+    // are bounded, so this ends, and the JSON is never cut off
+    std::vector<char> text(ruc_trace_json(nullptr, 0) + 1);
+    size_t len;
+    while ((len = ruc_trace_json(text.data(), text.size())) >= text.size()) {
+        text.resize(len + len / 4 + 1);
+    }
+    FILE* f = fopen(path, "wb");
+    if (!f) return -1;
+    bool ok = fwrite(text.data(), 1, len, f) == len;
+    return fclose(f) == 0 && ok ? 0 : -1;
+}
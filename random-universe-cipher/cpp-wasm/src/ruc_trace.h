@@ -0,0 +1,47 @@
+#ifndef RUC_TRACE_H
+#define RUC_TRACE_H
+
+#include <atomic>
+#include <cstdint>
+
+// Internal hooks for the engine trace (public API in ruc_cipher.h). Spans go
+// into a ring owned by the recording thread, so recording takes no lock; a
+// ring is handed to a new thread once its thread exits, so each ring is one
+// lane in the trace viewer rather than one OS thread.
+
+extern std::atomic<bool> ruc_trace_on;
+
+inline bool ruc_trace_enabled() {
+    return ruc_trace_on.load(std::memory_order_relaxed);
+}
+
+// Nanoseconds since ruc_trace_start
+uint64_t ruc_trace_now();
+
+// Record [start_ns, end_ns) on the calling thread. name and arg_name must be
+// string literals (stored by pointer); arg_name nullptr omits the argument.
+void ruc_trace_record(const char* name, uint64_t start_ns, uint64_t end_ns,
+                      const char* arg_name, uint64_t arg);
+
+// Phase boundary from ruc_process_blocks: ends the running phase span and
+// starts the next (RUC_PHASE_NONE only ends it)
+void ruc_trace_phase(int phase);
+
+class RucTraceSpan {
+public:
+    RucTraceSpan(const char* name, const char* arg_name = nullptr, uint64_t arg = 0)
+        : name_(ruc_trace_enabled() ? name : nullptr), arg_name_(arg_name), arg_(arg),
+          start_(name_ ? ruc_trace_now() : 0) {}
+    ~RucTraceSpan() {
+        if (name_) ruc_trace_record(name_, start_, ruc_trace_now(), arg_name_, arg_);
+    }
+    void set_arg(uint64_t arg) { arg_ = arg; }
+
+private:
+    const char* name_;
+    const char* arg_name_;
+    uint64_t arg_;
+    uint64_t start_;
+};
+
+#endif // RUC_TRACE_H
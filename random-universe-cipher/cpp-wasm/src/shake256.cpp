@@ -1,6 +1,10 @@
 #include "shake256.h"
+#include "kernels.h"
 #include <cstring>
 #include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 // Simple SHAKE256 implementation using Keccak-f[1600]
 // For production, use a proper SHAKE256 library like tiny_sha3
@@ -24,12 +28,11 @@ static const int ROT[5][5] = {
 
 // Rotate left (inline for better performance - called thousands of times)
 static inline uint64_t rotl64(uint64_t x, int y) {
-    return (x << y) | (x >> (64 - y));
+    return (x << y) | (x >> ((64 - y) & 63));
 }
 
-// Macro to generate a single Keccak round (fully unrolled for maximum performance)
-#define KECCAK_ROUND(round_num) \
-    do { \
+// Theta, Rho and Pi of one Keccak round; leaves the permuted lanes in B[25]
+#define KECCAK_THETA_RHO_PI() \
         /* Theta */ \
         uint64_t C0 = state[0] ^ state[5] ^ state[10] ^ state[15] ^ state[20]; \
         uint64_t C1 = state[1] ^ state[6] ^ state[11] ^ state[16] ^ state[21]; \
@@ -56,7 +59,12 @@ static inline uint64_t rotl64(uint64_t x, int y) {
         B[15] = rotl64(state[18], 21); B[16] = rotl64(state[8], 45); B[17] = rotl64(state[23], 8); \
         B[18] = rotl64(state[13], 15); B[19] = rotl64(state[3], 41); B[20] = rotl64(state[24], 18); \
         B[21] = rotl64(state[14], 2); B[22] = rotl64(state[9], 61); B[23] = rotl64(state[4], 56); \
-        B[24] = rotl64(state[19], 14); \
+        B[24] = rotl64(state[19], 14);
+
+// Macro to generate a single Keccak round (fully unrolled for maximum performance)
+#define KECCAK_ROUND(round_num) \
+    do { \
+        KECCAK_THETA_RHO_PI() \
         /* Chi */ \
         state[0] = B[0] ^ ((~B[1]) & B[2]); state[1] = B[1] ^ ((~B[2]) & B[3]); \
         state[2] = B[2] ^ ((~B[3]) & B[4]); state[3] = B[3] ^ ((~B[4]) & B[0]); \
@@ -76,7 +84,7 @@ static inline uint64_t rotl64(uint64_t x, int y) {
     } while(0)
 
 // Keccak-f[1600] permutation (FULLY UNROLLED - all 24 rounds inline for maximum performance)
-static void keccak_f(uint64_t state[25]) {
+void keccak_f_unrolled(uint64_t state[25]) {
     // Fully unroll all 24 rounds - eliminates loop overhead and enables better compiler optimization
     KECCAK_ROUND(0); KECCAK_ROUND(1); KECCAK_ROUND(2); KECCAK_ROUND(3);
     KECCAK_ROUND(4); KECCAK_ROUND(5); KECCAK_ROUND(6); KECCAK_ROUND(7);
@@ -86,37 +94,229 @@ static void keccak_f(uint64_t state[25]) {
     KECCAK_ROUND(20); KECCAK_ROUND(21); KECCAK_ROUND(22); KECCAK_ROUND(23);
 }
 
+// Lane-complementing transform: lanes in the complemented set are kept
+// inverted between rounds, which lets Chi use AND/OR forms that need only six
+// NOTs per round instead of 25. The set is chosen for this engine's Rho/Pi
+// mapping (below) and accounts for Theta propagating complements across
+// columns of odd parity; it is not the textbook {1, 2, 8, 12, 17, 20}.
+#define KECCAK_COMPLEMENT_LANES() \
+    do { \
+        state[1] = ~state[1]; state[2] = ~state[2]; state[8] = ~state[8]; \
+        state[10] = ~state[10]; state[13] = ~state[13]; state[14] = ~state[14]; \
+        state[15] = ~state[15]; state[19] = ~state[19]; state[21] = ~state[21]; \
+    } while(0)
+
+#define KECCAK_ROUND_LC(round_num) \
+    do { \
+        KECCAK_THETA_RHO_PI() \
+        /* Chi on the complemented representation */ \
+        uint64_t N9 = ~B[9], N10 = ~B[10], N13 = ~B[13], N15 = ~B[15], N22 = ~B[22]; \
+        state[0] = B[0] ^ (B[1] & B[2]); state[1] = B[1] ^ ((~B[2]) & B[3]); \
+        state[2] = B[2] ^ (B[3] | B[4]); state[3] = B[3] ^ (B[4] & B[0]); \
+        state[4] = B[4] ^ (B[0] | B[1]); state[5] = B[5] ^ (B[6] | B[7]); \
+        state[6] = B[6] ^ (B[7] & B[8]); state[7] = B[7] ^ (B[8] | B[9]); \
+        state[8] = B[8] ^ (N9 | B[5]); state[9] = N9 ^ (B[5] & B[6]); \
+        state[10] = N10 ^ (B[11] & B[12]); state[11] = B[11] ^ (B[12] | N13); \
+        state[12] = B[12] ^ (N13 & B[14]); state[13] = B[13] ^ (B[14] | N10); \
+        state[14] = B[14] ^ (B[10] | B[11]); state[15] = N15 ^ (B[16] | B[17]); \
+        state[16] = B[16] ^ (B[17] & B[18]); state[17] = B[17] ^ (B[18] | B[19]); \
+        state[18] = B[18] ^ (B[19] & N15); state[19] = B[19] ^ (B[15] & B[16]); \
+        state[20] = B[20] ^ (B[21] & B[22]); state[21] = B[21] ^ (N22 & B[23]); \
+        state[22] = N22 ^ (B[23] | B[24]); state[23] = B[23] ^ (B[24] & B[20]); \
+        state[24] = B[24] ^ (B[20] | B[21]); \
+        /* Iota */ \
+        state[0] ^= RC[round_num]; \
+    } while(0)
+
+// Keccak-f[1600] permutation (unrolled, lane-complemented - fewer NOTs for
+// targets without an and-not instruction, e.g. baseline x86-64 and WASM)
+void keccak_f_lanecomp(uint64_t state[25]) {
+    KECCAK_COMPLEMENT_LANES();
+    KECCAK_ROUND_LC(0); KECCAK_ROUND_LC(1); KECCAK_ROUND_LC(2); KECCAK_ROUND_LC(3);
+    KECCAK_ROUND_LC(4); KECCAK_ROUND_LC(5); KECCAK_ROUND_LC(6); KECCAK_ROUND_LC(7);
+    KECCAK_ROUND_LC(8); KECCAK_ROUND_LC(9); KECCAK_ROUND_LC(10); KECCAK_ROUND_LC(11);
+    KECCAK_ROUND_LC(12); KECCAK_ROUND_LC(13); KECCAK_ROUND_LC(14); KECCAK_ROUND_LC(15);
+    KECCAK_ROUND_LC(16); KECCAK_ROUND_LC(17); KECCAK_ROUND_LC(18); KECCAK_ROUND_LC(19);
+    KECCAK_ROUND_LC(20); KECCAK_ROUND_LC(21); KECCAK_ROUND_LC(22); KECCAK_ROUND_LC(23);
+    KECCAK_COMPLEMENT_LANES();
+}
+
+// Rho/Pi lane mapping used by KECCAK_ROUND: B[i] = rotl64(state[PI_SRC[i]], PI_ROT[i]).
+// This mapping is not the FIPS 202 one, and every ciphertext produced by this
+// engine depends on it, so all keccak_f kernels must reproduce it exactly
+// (enforced by the kernel self-test in kernels.cpp).
+static const uint8_t PI_SRC[25] = {
+    0, 15, 5, 20, 10, 6, 21, 11, 1, 16, 12, 2, 17, 7, 22, 18, 8, 23, 13, 3, 24, 14, 9, 4, 19
+};
+static const uint8_t PI_ROT[25] = {
+    0, 28, 1, 27, 62, 44, 20, 6, 36, 55, 43, 3, 25, 10, 39, 21, 45, 8, 15, 41, 18, 2, 61, 56, 14
+};
+
+// Keccak-f[1600] permutation (compact loop form - smaller code, friendlier to small i-caches)
+void keccak_f_looped(uint64_t state[25]) {
+    uint64_t C[5], B[25];
+    for (int round = 0; round < 24; round++) {
+        // Theta
+        for (int x = 0; x < 5; x++) {
+            C[x] = state[x] ^ state[x + 5] ^ state[x + 10] ^ state[x + 15] ^ state[x + 20];
+        }
+        for (int x = 0; x < 5; x++) {
+            uint64_t D = C[(x + 4) % 5] ^ rotl64(C[(x + 1) % 5], 1);
+            for (int y = 0; y < 25; y += 5) {
+                state[y + x] ^= D;
+            }
+        }
+        // Rho and Pi
+        for (int i = 0; i < 25; i++) {
+            B[i] = rotl64(state[PI_SRC[i]], PI_ROT[i]);
+        }
+        // Chi
+        for (int y = 0; y < 25; y += 5) {
+            for (int x = 0; x < 5; x++) {
+                state[y + x] = B[y + x] ^ ((~B[y + (x + 1) % 5]) & B[y + (x + 2) % 5]);
+            }
+        }
+        // Iota
+        state[0] ^= RC[round];
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// AVX-512 single-state permutation: one row of five lanes per zmm register.
+// Theta and Chi are a pair of vpternlogq each, Rho is one vprolvq per row and
+// Pi is a three-step gather (vpermt2q from rows 0/1 and 2/3, masked vpermq
+// from row 4). The tables are PI_SRC/PI_ROT re-indexed by row.
+alignas(64) static const uint64_t AVX512_RHO[5][8] = {
+    {0, 36, 3, 41, 56}, {1, 44, 10, 45, 61}, {62, 6, 43, 15, 2}, {28, 55, 25, 21, 14}, {27, 20, 39, 8, 18}
+};
+alignas(64) static const uint64_t AVX512_PI_01[5][8] = {
+    {0, 0, 8, 0, 0}, {9, 0, 0, 1, 0}, {0, 2, 0, 10, 0}, {0, 11, 0, 0, 3}, {0, 0, 12, 4, 0}
+};
+alignas(64) static const uint64_t AVX512_PI_23[5][8] = {
+    {0, 8, 0, 0, 0}, {0, 0, 1, 0, 9}, {2, 0, 10, 0, 0}, {11, 0, 0, 3, 0}, {0, 4, 0, 0, 12}
+};
+alignas(64) static const uint64_t AVX512_PI_4[5][8] = {
+    {0, 0, 0, 0, 0}, {0, 1, 0, 0, 0}, {0, 0, 0, 0, 2}, {0, 0, 3, 0, 0}, {4, 0, 0, 0, 0}
+};
+static const uint8_t AVX512_PI_MASK_23[5] = {0x12, 0x14, 0x05, 0x09, 0x12};
+static const uint8_t AVX512_PI_MASK_4[5] = {0x08, 0x02, 0x10, 0x04, 0x01};
+
+__attribute__((target("avx512f")))
+void keccak_f_avx512(uint64_t state[25]) {
+    const __mmask8 row = 0x1F;
+    const __m512i x_minus_1 = _mm512_setr_epi64(4, 0, 1, 2, 3, 5, 6, 7);
+    const __m512i x_plus_1 = _mm512_setr_epi64(1, 2, 3, 4, 0, 5, 6, 7);
+    const __m512i x_plus_2 = _mm512_setr_epi64(2, 3, 4, 0, 1, 5, 6, 7);
+    __m512i a[5], b[5];
+    for (int y = 0; y < 5; y++) {
+        a[y] = _mm512_maskz_loadu_epi64(row, state + 5 * y);
+    }
+
+    for (int round = 0; round < 24; round++) {
+        // Theta
+        __m512i c = _mm512_ternarylogic_epi64(a[0], a[1], a[2], 0x96);
+        c = _mm512_ternarylogic_epi64(c, a[3], a[4], 0x96);
+        __m512i d = _mm512_xor_si512(_mm512_permutexvar_epi64(x_minus_1, c),
+                                     _mm512_rol_epi64(_mm512_permutexvar_epi64(x_plus_1, c), 1));
+        // Rho (rotation by source lane)
+        for (int y = 0; y < 5; y++) {
+            a[y] = _mm512_rolv_epi64(_mm512_xor_si512(a[y], d), _mm512_load_si512(AVX512_RHO[y]));
+        }
+        // Pi
+        for (int y = 0; y < 5; y++) {
+            __m512i t = _mm512_permutex2var_epi64(a[0], _mm512_load_si512(AVX512_PI_01[y]), a[1]);
+            t = _mm512_mask_mov_epi64(t, AVX512_PI_MASK_23[y],
+                                      _mm512_permutex2var_epi64(a[2], _mm512_load_si512(AVX512_PI_23[y]), a[3]));
+            b[y] = _mm512_mask_permutexvar_epi64(t, AVX512_PI_MASK_4[y], _mm512_load_si512(AVX512_PI_4[y]), a[4]);
+        }
+        // Chi: b0 ^ (~b1 & b2)
+        for (int y = 0; y < 5; y++) {
+            a[y] = _mm512_ternarylogic_epi64(b[y], _mm512_permutexvar_epi64(x_plus_1, b[y]),
+                                             _mm512_permutexvar_epi64(x_plus_2, b[y]), 0xD2);
+        }
+        // Iota
+        a[0] = _mm512_mask_xor_epi64(a[0], 1, a[0], _mm512_set1_epi64((long long)RC[round]));
+    }
+
+    for (int y = 0; y < 5; y++) {
+        _mm512_mask_storeu_epi64(state + 5 * y, row, a[y]);
+    }
+}
+#endif
+
 // External counter for profiling (defined in ruc_cipher.cpp)
-extern uint64_t profile_shake256_calls;
+extern thread_local uint64_t profile_shake256_calls;
+
+// Little-endian lane access (a plain 8-byte load/store on little-endian hosts, WASM included)
+static inline uint64_t load64_le(const uint8_t* p) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+#else
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) v |= (uint64_t)p[i] << (8 * i);
+    return v;
+#endif
+}
+
+static inline void store64_le(uint8_t* p, uint64_t v) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(p, &v, 8);
+#else
+    for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+#endif
+}
+
+// XOR len bytes into the state from lane 0, a word at a time
+static inline void absorb_words(uint64_t state[25], const uint8_t* in, size_t len) {
+    size_t lanes = len / 8;
+    for (size_t i = 0; i < lanes; i++) {
+        state[i] ^= load64_le(in + 8 * i);
+    }
+    size_t tail = len % 8;
+    if (tail) {
+        uint64_t v = 0;
+        for (size_t j = 0; j < tail; j++) v |= (uint64_t)in[8 * lanes + j] << (8 * j);
+        state[lanes] ^= v;
+    }
+}
+
+// Copy len bytes out of the state from lane 0, a word at a time
+static inline void squeeze_words(const uint64_t state[25], uint8_t* out, size_t len) {
+    size_t lanes = len / 8;
+    for (size_t i = 0; i < lanes; i++) {
+        store64_le(out + 8 * i, state[i]);
+    }
+    for (size_t j = 0; j < len % 8; j++) {
+        out[8 * lanes + j] = (uint8_t)(state[lanes] >> (8 * j));
+    }
+}
 
 // SHAKE256 sponge function (optimized)
 void shake256_hash(const uint8_t* input, size_t input_len, uint8_t* output, size_t output_len) {
     profile_shake256_calls++;
+    const keccak_f_fn keccak_f = ruc_kernels().keccak_f;
     uint64_t state[25] = {0};
     const size_t rate = 136; // SHAKE256 rate in bytes (1088 bits = 136 bytes)
     
-    // Absorb phase - optimized for small inputs (most common case)
-    size_t pos = 0;
+    // Absorb phase, whole lanes at a time
+    size_t pos;
     if (input_len <= rate) {
-        // Fast path: input fits in one rate block
-        for (size_t i = 0; i < input_len; i++) {
-            size_t lane = i / 8;
-            size_t byte_in_lane = i % 8;
-            state[lane] ^= ((uint64_t)input[i]) << (byte_in_lane * 8);
-        }
+        // Fast path: input fits in one rate block (the common case). A full
+        // 136-byte input is not permuted before padding, as it never was.
+        absorb_words(state, input, input_len);
         pos = input_len;
     } else {
-        // General case: multiple rate blocks
-        for (size_t i = 0; i < input_len; i++) {
-            size_t lane = pos / 8;
-            size_t byte_in_lane = pos % 8;
-            state[lane] ^= ((uint64_t)input[i]) << (byte_in_lane * 8);
-            pos++;
-            if (pos == rate) {
-                keccak_f(state);
-                pos = 0;
-            }
+        // General case: permute after every full rate block
+        while (input_len >= rate) {
+            absorb_words(state, input, rate);
+            keccak_f(state);
+            input += rate;
+            input_len -= rate;
         }
+        absorb_words(state, input, input_len);
+        pos = input_len;
     }
     
     // Padding for SHAKE256: domain separator 0x1F
@@ -131,35 +331,15 @@ void shake256_hash(const uint8_t* input, size_t input_len, uint8_t* output, size
     
     keccak_f(state);
     
-    // Squeeze phase - optimized for common output sizes (32 bytes is most common)
-    pos = 0;
-    if (output_len == 32) {
-        // Fast path: 32-byte output (most common case for BLOCK_SIZE)
-        // Output fits in first 4 lanes (32 bytes) - no need for keccak_f
-        for (int i = 0; i < 4; i++) {
-            uint64_t lane_val = state[i];
-            output[i*8 + 0] = (uint8_t)(lane_val & 0xFF);
-            output[i*8 + 1] = (uint8_t)((lane_val >> 8) & 0xFF);
-            output[i*8 + 2] = (uint8_t)((lane_val >> 16) & 0xFF);
-            output[i*8 + 3] = (uint8_t)((lane_val >> 24) & 0xFF);
-            output[i*8 + 4] = (uint8_t)((lane_val >> 32) & 0xFF);
-            output[i*8 + 5] = (uint8_t)((lane_val >> 40) & 0xFF);
-            output[i*8 + 6] = (uint8_t)((lane_val >> 48) & 0xFF);
-            output[i*8 + 7] = (uint8_t)((lane_val >> 56) & 0xFF);
-        }
-    } else {
-        // General case
-        for (size_t i = 0; i < output_len; i++) {
-            if (pos == rate) {
-                keccak_f(state);
-                pos = 0;
-            }
-            size_t lane = pos / 8;
-            size_t byte_in_lane = pos % 8;
-            output[i] = (uint8_t)((state[lane] >> (byte_in_lane * 8)) & 0xFF);
-            pos++;
-        }
+    // Squeeze phase, whole lanes at a time; outputs up to one rate block
+    // (32 bytes is by far the most common) need no further permutation
+    while (output_len > rate) {
+        squeeze_words(state, output, rate);
+        keccak_f(state);
+        output += rate;
+        output_len -= rate;
     }
+    squeeze_words(state, output, output_len);
 }
 
 // SHAKE256 with domain separation
@@ -171,15 +351,23 @@ void shake256_with_domain(
     uint8_t* output,
     size_t output_len
 ) {
-    std::vector<uint8_t> input;
-    input.insert(input.end(), key, key + key_len);
-    
+    // key || domain || index (big-endian); on the stack for every caller in
+    // this engine, heap only for unusually long keys or domains
     size_t domain_len = strlen(domain);
-    input.insert(input.end(), domain, domain + domain_len);
+    size_t input_len = key_len + domain_len + 2;
+    uint8_t stack_input[256];
+    std::vector<uint8_t> heap_input;
+    uint8_t* input = stack_input;
+    if (input_len > sizeof(stack_input)) {
+        heap_input.resize(input_len);
+        input = heap_input.data();
+    }
     
-    input.push_back((index >> 8) & 0xFF);
-    input.push_back(index & 0xFF);
+    memcpy(input, key, key_len);
+    memcpy(input + key_len, domain, domain_len);
+    input[key_len + domain_len] = (index >> 8) & 0xFF;
+    input[key_len + domain_len + 1] = index & 0xFF;
     
-    shake256_hash(input.data(), input.size(), output, output_len);
+    shake256_hash(input, input_len, output, output_len);
 }
 
@@ -7,6 +7,14 @@
 // SHAKE256 hash function
 void shake256_hash(const uint8_t* input, size_t input_len, uint8_t* output, size_t output_len);
 
+// Keccak-f[1600] permutation kernels (selected at runtime, see kernels.h)
+void keccak_f_unrolled(uint64_t state[25]);
+void keccak_f_looped(uint64_t state[25]);
+void keccak_f_lanecomp(uint64_t state[25]);
+#if defined(__x86_64__) || defined(__i386__)
+void keccak_f_avx512(uint64_t state[25]);
+#endif
+
 // SHAKE256 with domain separation
 void shake256_with_domain(
     const uint8_t* key,
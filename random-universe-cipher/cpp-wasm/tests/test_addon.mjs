@@ -0,0 +1,82 @@
+// Node addon checks (registered with CTest when RUC_BUILD_NODE_ADDON is on):
+//   node tests/test_addon.mjs path/to/ruc_native.node
+
+import assert from 'node:assert/strict';
+import { createRequire } from 'node:module';
+
+const require = createRequire(import.meta.url);
+const native = require(process.argv[2]);
+
+function testBytes(length, seed) {
+  const out = new Uint8Array(length);
+  let x = (seed * 2654435761 + 1) >>> 0;
+  for (let i = 0; i < length; i++) {
+    x ^= x << 13; x >>>= 0;
+    x ^= x >>> 17;
+    x ^= x << 5; x >>>= 0;
+    out[i] = x & 0xff;
+  }
+  return out;
+}
+
+// Byte view of a Buffer, TypedArray or ArrayBuffer, for comparisons
+function bytes(value) {
+  return value instanceof ArrayBuffer ? Buffer.from(value) : Buffer.from(value.buffer, value.byteOffset, value.byteLength);
+}
+
+const key = testBytes(64, 1);
+const iv = testBytes(32, 2);
+const handle = native.expandKey(key);
+
+// Round trips: sync, async (several pool chunks) and constant-time agree
+{
+  const plaintext = testBytes(2000 * 32, 3);
+  const sync = native.encryptBlocksSync(handle, iv, 5, plaintext);
+  assert.notDeepEqual(bytes(sync), bytes(plaintext));
+  assert.deepEqual(bytes(native.decryptBlocksSync(handle, iv, 5, sync)), bytes(plaintext));
+
+  const async = await native.encryptBlocks(handle, iv, 5, plaintext);
+  assert.deepEqual(bytes(async), bytes(sync));
+  assert.deepEqual(bytes(await native.decryptBlocks(handle, iv, 5, async)), bytes(plaintext));
+
+  assert.deepEqual(bytes(native.encryptBlocksCtSync(handle, iv, 5, plaintext.subarray(0, 70 * 32))),
+                   bytes(sync.subarray(0, 70 * 32)));
+
+  // In place, and through an ArrayBuffer
+  const inPlace = plaintext.slice();
+  native.encryptBlocksSync(handle, iv, 5, inPlace, inPlace);
+  assert.deepEqual(bytes(inPlace), bytes(sync));
+  assert.deepEqual(bytes(native.decryptBlocksSync(handle, iv, 5, inPlace.buffer)), bytes(plaintext));
+
+  // A different key gives different ciphertext
+  const other = native.expandKey(testBytes(64, 9));
+  assert.notDeepEqual(bytes(native.encryptBlocksSync(other, iv, 5, plaintext)), bytes(sync));
+}
+
+// Only handles made by expandKey() are accepted
+{
+  const block = new Uint8Array(32);
+  const notHandles = [undefined, null, 1, 'key', {}, key, Symbol('k'), () => {}];
+  for (const value of notHandles) {
+    assert.throws(() => native.encryptBlocksSync(value, iv, 0, block), TypeError);
+    assert.throws(() => native.encryptBlocks(value, iv, 0, block), TypeError);
+  }
+  assert.throws(() => native.expandKey(new Uint8Array(63)), RangeError);
+  assert.throws(() => native.expandKey('x'.repeat(64)), TypeError);
+  assert.throws(() => native.encryptBlocksSync(handle, new Uint8Array(31), 0, block), RangeError);
+  assert.throws(() => native.encryptBlocksSync(handle, iv, 0, new Uint8Array(33)), RangeError);
+  assert.throws(() => native.encryptBlocksSync(handle, iv, 0, block, new Uint8Array(64)), RangeError);
+}
+
+// Kernels cannot change under a running async batch
+{
+  const names = native.kernelNames();
+  const running = native.encryptBlocks(handle, iv, 0, testBytes(4000 * 32, 4));
+  assert.throws(() => native.forceKernel('keccak_f', names.keccak_f[0]), { code: 'ERR_RUC_BUSY' });
+  await running;
+  assert.equal(native.forceKernel('keccak_f', names.keccak_f[0]), 0);
+  assert.equal(native.kernels().keccak_f, names.keccak_f[0]);
+  assert.throws(() => native.forceKernel('no_such_primitive', 'x'), RangeError);
+}
+
+console.log('addon tests passed');
@@ -0,0 +1,124 @@
+#include "test_util.h"
+#include <algorithm>
+
+// Compress-then-encrypt round trips, fed to the decompressor in pieces of
+// different sizes and drained through output buffers of different sizes.
+// Key rotation of a compressed stream (as ruc_crypt rekey does it) keeps it
+// readable under the new key; rotating with the wrong old key is caught by
+// the decompressor.
+
+static std::vector<uint8_t> compress_all(uint32_t ctx_id, const std::vector<uint8_t>& data, size_t piece) {
+    uint32_t id = ruc_compress_init(ctx_id, 0);
+    CHECK(id != 0);
+    std::vector<uint8_t> out;
+    std::vector<uint8_t> buf(ruc_compress_bound(piece));
+    for (size_t pos = 0; pos < data.size(); pos += piece) {
+        size_t n = std::min(piece, data.size() - pos);
+        size_t out_len = 0;
+        CHECK(ruc_compress_update(id, data.data() + pos, n, buf.data(), buf.size(), &out_len) == 0);
+        out.insert(out.end(), buf.begin(), buf.begin() + out_len);
+    }
+    size_t out_len = 0;
+    uint64_t total = 0;
+    CHECK(ruc_compress_final(id, buf.data(), buf.size(), &out_len, &total) == 0);
+    CHECK(total == data.size());
+    out.insert(out.end(), buf.begin(), buf.begin() + out_len);
+    return out;
+}
+
+// Returns ruc_decompress_final's status; decoded bytes go to *plain
+static int decompress_all(uint32_t ctx_id, const std::vector<uint8_t>& data, size_t piece, size_t out_cap,
+                          std::vector<uint8_t>* plain) {
+    uint32_t id = ruc_decompress_init(ctx_id, 0);
+    CHECK(id != 0);
+    std::vector<uint8_t> buf(out_cap);
+    for (size_t pos = 0; pos < data.size(); pos += piece) {
+        size_t n = std::min(piece, data.size() - pos);
+        const uint8_t* src = data.data() + pos;
+        for (;;) {
+            size_t out_len = 0;
+            if (ruc_decompress_update(id, src, n, buf.data(), buf.size(), &out_len) != 0) {
+                return ruc_decompress_final(id, nullptr);
+            }
+            plain->insert(plain->end(), buf.begin(), buf.begin() + out_len);
+            if (out_len == 0) break;
+            n = 0;
+        }
+    }
+    return ruc_decompress_final(id, nullptr);
+}
+
+// ruc_reencrypt over a byte stream from block 0; the partial last block goes
+// through a zero-padded copy
+static std::vector<uint8_t> rekey_stream(uint32_t old_ctx, uint32_t new_ctx, const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> padded = data;
+    padded.resize((data.size() + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE);
+    CHECK(ruc_reencrypt(old_ctx, new_ctx, padded.data(), padded.size() / BLOCK_SIZE, 0, padded.data()) == 0);
+    padded.resize(data.size());
+    return padded;
+}
+
+int main() {
+    uint32_t key_id = ruc_key_create(test_bytes(KEY_SIZE, 1).data());
+    uint32_t ctx_id = ruc_ctx_create(key_id, test_bytes(IV_SIZE, 2).data());
+
+    // Compressible text followed by random bytes (stored frames)
+    std::vector<uint8_t> data;
+    for (size_t i = 0; data.size() < 150000; i++) {
+        const char* line = i % 3 ? "the quick brown fox jumps over the lazy dog\n" : "lorem ipsum dolor sit amet\n";
+        data.insert(data.end(), line, line + strlen(line));
+    }
+    std::vector<uint8_t> noise = test_bytes(90000, 3);
+    data.insert(data.end(), noise.begin(), noise.end());
+
+    std::vector<uint8_t> packed = compress_all(ctx_id, data, 70000);
+    CHECK(packed == compress_all(ctx_id, data, 4096));
+
+    const size_t pieces[] = {1, 1000, 65536, packed.size()};
+    const size_t caps[] = {RUC_COMPRESS_CHUNK_SIZE, 3 * RUC_COMPRESS_CHUNK_SIZE, data.size()};
+    for (size_t piece : pieces) {
+        for (size_t cap : caps) {
+            if (piece == 1 && cap != RUC_COMPRESS_CHUNK_SIZE) continue;
+            std::vector<uint8_t> plain;
+            CHECK(decompress_all(ctx_id, packed, piece, cap, &plain) == 0);
+            CHECK(plain == data);
+        }
+    }
+
+    // Truncated, corrupted and over-long streams are rejected
+    std::vector<uint8_t> plain;
+    std::vector<uint8_t> truncated(packed.begin(), packed.end() - 1);
+    CHECK(decompress_all(ctx_id, truncated, 1000, RUC_COMPRESS_CHUNK_SIZE, &plain) == -2);
+    std::vector<uint8_t> corrupted = packed;
+    corrupted[11] ^= 0x40;    // High byte of the first frame's raw_len
+    plain.clear();
+    CHECK(decompress_all(ctx_id, corrupted, packed.size(), data.size(), &plain) == -2);
+    std::vector<uint8_t> extended = packed;
+    extended.push_back(0);
+    plain.clear();
+    CHECK(decompress_all(ctx_id, extended, packed.size(), data.size(), &plain) == -2);
+
+    // Rotated to a new key it decompresses under that key only
+    uint32_t new_key_id = ruc_key_create(test_bytes(KEY_SIZE, 4).data());
+    uint32_t new_ctx = ruc_ctx_create(new_key_id, test_bytes(IV_SIZE, 5).data());
+    std::vector<uint8_t> rotated = rekey_stream(ctx_id, new_ctx, packed);
+    plain.clear();
+    CHECK(decompress_all(new_ctx, rotated, 65536, data.size(), &plain) == 0);
+    CHECK(plain == data);
+    plain.clear();
+    CHECK(decompress_all(ctx_id, rotated, 65536, data.size(), &plain) == -2);
+
+    // Wrong old key: the rotated stream does not parse under the new key
+    uint32_t wrong_key_id = ruc_key_create(test_bytes(KEY_SIZE, 6).data());
+    uint32_t wrong_ctx = ruc_ctx_create(wrong_key_id, test_bytes(IV_SIZE, 2).data());
+    plain.clear();
+    CHECK(decompress_all(new_ctx, rekey_stream(wrong_ctx, new_ctx, packed), 65536, data.size(), &plain) == -2);
+    ruc_ctx_destroy(wrong_ctx);
+    ruc_key_destroy(wrong_key_id);
+    ruc_ctx_destroy(new_ctx);
+    ruc_key_destroy(new_key_id);
+
+    ruc_ctx_destroy(ctx_id);
+    ruc_key_destroy(key_id);
+    return test_failures();
+}
@@ -0,0 +1,217 @@
+#include "test_util.h"
+#include "kernels.h"
+#include "chacha20.h"
+#include "gf_math.h"
+#include "shake256.h"
+
+// The constant-time engine must never end up on a table-lookup kernel, no
+// matter how rounds_batch is selected. Every other kernel, forced in turn,
+// must reproduce what the reference kernels compute.
+
+static const std::vector<uint8_t> key = test_bytes(KEY_SIZE, 1);
+static const std::vector<uint8_t> iv = test_bytes(IV_SIZE, 2);
+
+static bool active_is_constant_time(int primitive) {
+    const char* active = ruc_kernel_active(primitive);
+    for (size_t i = 0; i < ruc_kernel_count(primitive); i++) {
+        if (strcmp(ruc_kernel_name(primitive, i), active) == 0) {
+            return (ruc_kernel_status(primitive, i) & RUC_KERNEL_CONSTANT_TIME) != 0;
+        }
+    }
+    return false;
+}
+
+static void check_ct_output() {
+    const size_t n = 70;
+    std::vector<uint8_t> pt = test_bytes(n * BLOCK_SIZE, 3);
+    std::vector<uint8_t> expected = reference_encrypt(key.data(), iv.data(), 9, pt.data(), n);
+    void* km = ruc_expand_key(key.data());
+    std::vector<uint8_t> ct(n * BLOCK_SIZE);
+    ruc_encrypt_blocks_ct(pt.data(), n, key.data(), iv.data(), 9, km, ct.data());
+    ruc_free_key_material(km);
+    CHECK(ct == expected);
+}
+
+// The ACTIVE status bit sits on exactly the kernel ruc_kernel_active names
+static bool active_name_matches(int primitive) {
+    const char* active = ruc_kernel_active(primitive);
+    size_t marked = 0;
+    bool named = false;
+    for (size_t i = 0; i < ruc_kernel_count(primitive); i++) {
+        if (!(ruc_kernel_status(primitive, i) & RUC_KERNEL_ACTIVE)) continue;
+        marked++;
+        named = strcmp(ruc_kernel_name(primitive, i), active) == 0;
+    }
+    return marked == 1 && named;
+}
+
+// Everything the kernels feed: key expansion and both engines, plus each
+// primitive's own entry point
+static std::vector<uint8_t> kernel_outputs() {
+    const size_t n = 70;
+    std::vector<uint8_t> pt = test_bytes(n * BLOCK_SIZE, 4);
+    std::vector<uint8_t> out = reference_encrypt(key.data(), iv.data(), 3, pt.data(), n);
+
+    void* km = ruc_expand_key(key.data());
+    std::vector<uint8_t> ct(n * BLOCK_SIZE);
+    ruc_encrypt_blocks_ct(pt.data(), n, key.data(), iv.data(), 3, km, ct.data());
+    ruc_free_key_material(km);
+    out.insert(out.end(), ct.begin(), ct.end());
+
+    std::vector<uint8_t> digest(300);
+    shake256_hash(pt.data(), 500, digest.data(), digest.size());
+    out.insert(out.end(), digest.begin(), digest.end());
+
+    uint8_t stream[200];
+    ChaCha20PRNG prng(key.data(), iv.data());
+    prng.next_bytes(stream, sizeof(stream));
+    out.insert(out.end(), stream, stream + sizeof(stream));
+
+    uint8_t reg[REGISTER_SIZE];
+    memcpy(reg, pt.data(), sizeof(reg));
+    for (int m = 0; m < 256; m += 37) gf_mul_register_inplace(reg, (uint8_t)m | 1);
+    out.insert(out.end(), reg, reg + sizeof(reg));
+    return out;
+}
+
+static void check_all_kernels_match_reference() {
+    // Reference kernels (entries[0]) everywhere except the constant-time slot
+    for (int p = 0; p < RUC_PRIM_COUNT; p++) {
+        if (p == RUC_PRIM_ROUNDS_BATCH) continue;
+        CHECK(ruc_kernel_force(p, ruc_kernel_name(p, 0)) == RUC_KERNEL_OK);
+    }
+    const std::vector<uint8_t> expected = kernel_outputs();
+
+    for (int p = 0; p < RUC_PRIM_COUNT; p++) {
+        if (p == RUC_PRIM_ROUNDS_BATCH) continue;
+        for (size_t i = 1; i < ruc_kernel_count(p); i++) {
+            const char* name = ruc_kernel_name(p, i);
+            int rc = ruc_kernel_force(p, name);
+            if (rc == RUC_KERNEL_ERR_UNSUPPORTED) continue;
+            CHECK(rc == RUC_KERNEL_OK);
+            CHECK(strcmp(ruc_kernel_active(p), name) == 0);
+            if (kernel_outputs() != expected) {
+                fprintf(stderr, "%s kernel '%s' differs from the reference\n", ruc_kernel_primitive_name(p), name);
+                test_failure_count()++;
+            }
+        }
+        CHECK(ruc_kernel_force(p, ruc_kernel_name(p, 0)) == RUC_KERNEL_OK);
+    }
+
+    for (int p = 0; p < RUC_PRIM_COUNT; p++) {
+        CHECK(ruc_kernel_force(p, nullptr) == RUC_KERNEL_OK);
+        CHECK(active_name_matches(p));
+    }
+}
+
+// Byte-at-a-time SHAKE256 on the reference permutation, for checking the
+// word-level absorb/squeeze. Like shake256_hash, an input of exactly one rate
+// block is padded without a permutation first.
+static void shake256_bytewise(const uint8_t* in, size_t in_len, uint8_t* out, size_t out_len) {
+    const size_t rate = 136;
+    uint64_t state[25] = {0};
+    size_t pos = 0;
+    for (size_t i = 0; i < in_len; i++) {
+        if (pos == rate && in_len > rate) {
+            keccak_f_looped(state);
+            pos = 0;
+        }
+        state[pos / 8] ^= (uint64_t)in[i] << (8 * (pos % 8));
+        pos++;
+    }
+    if (pos == rate && in_len > rate) {
+        keccak_f_looped(state);
+        pos = 0;
+    }
+    state[pos / 8] ^= (uint64_t)0x1F << (8 * (pos % 8));
+    state[(rate - 1) / 8] ^= (uint64_t)0x80 << (8 * ((rate - 1) % 8));
+    keccak_f_looped(state);
+    for (size_t i = 0, p = 0; i < out_len; i++, p++) {
+        if (p == rate) {
+            keccak_f_looped(state);
+            p = 0;
+        }
+        out[i] = (uint8_t)(state[p / 8] >> (8 * (p % 8)));
+    }
+}
+
+// The sponge under every Keccak kernel against the byte-wise reference, on
+// lengths around lane and rate boundaries (partial lanes on both sides)
+static void check_shake_ragged_lengths() {
+    static const size_t in_lens[] = {0, 1, 7, 8, 9, 31, 64, 127, 135, 136, 137, 271, 272, 273, 590, 1001};
+    static const size_t out_lens[] = {1, 5, 8, 13, 32, 33, 135, 136, 137, 300, 512};
+    const std::vector<uint8_t> input = test_bytes(1001, 5);
+
+    for (size_t k = 0; k < ruc_kernel_count(RUC_PRIM_KECCAK_F); k++) {
+        const char* name = ruc_kernel_name(RUC_PRIM_KECCAK_F, k);
+        if (ruc_kernel_force(RUC_PRIM_KECCAK_F, name) != RUC_KERNEL_OK) continue;
+        for (size_t in_len : in_lens) {
+            for (size_t out_len : out_lens) {
+                std::vector<uint8_t> expected(out_len), actual(out_len + 1, 0xA5);
+                shake256_bytewise(input.data(), in_len, expected.data(), out_len);
+                shake256_hash(input.data(), in_len, actual.data(), out_len);
+                if (memcmp(actual.data(), expected.data(), out_len) != 0 || actual[out_len] != 0xA5) {
+                    fprintf(stderr, "keccak_f '%s': shake256_hash(%zu -> %zu bytes) differs\n", name, in_len, out_len);
+                    test_failure_count()++;
+                }
+            }
+        }
+    }
+    CHECK(ruc_kernel_force(RUC_PRIM_KECCAK_F, nullptr) == RUC_KERNEL_OK);
+}
+
+int main() {
+    // CTest runs this with RUC_KERNEL=rounds_batch=ref, which must be ignored
+    CHECK(active_is_constant_time(RUC_PRIM_ROUNDS_BATCH));
+    CHECK(strcmp(ruc_kernel_active(RUC_PRIM_ROUNDS_BATCH), "ref") != 0);
+    for (int p = 0; p < RUC_PRIM_COUNT; p++) CHECK(active_name_matches(p));
+
+    // Forcing the reference kernel is refused and changes nothing
+    const char* before = ruc_kernel_active(RUC_PRIM_ROUNDS_BATCH);
+    CHECK(ruc_kernel_force(RUC_PRIM_ROUNDS_BATCH, "ref") == RUC_KERNEL_ERR_NOT_CT);
+    CHECK(strcmp(ruc_kernel_active(RUC_PRIM_ROUNDS_BATCH), before) == 0);
+
+    // Autotuning only considers constant-time kernels; the refused
+    // RUC_KERNEL entry is reported
+    CHECK(ruc_kernel_init(1) == RUC_KERNEL_ERR_NOT_CT);
+    CHECK(active_is_constant_time(RUC_PRIM_ROUNDS_BATCH));
+    check_ct_output();
+
+    // Every kernel that can be forced is constant-time and matches the batch path
+    for (size_t i = 0; i < ruc_kernel_count(RUC_PRIM_ROUNDS_BATCH); i++) {
+        const char* name = ruc_kernel_name(RUC_PRIM_ROUNDS_BATCH, i);
+        uint32_t status = ruc_kernel_status(RUC_PRIM_ROUNDS_BATCH, i);
+        int rc = ruc_kernel_force(RUC_PRIM_ROUNDS_BATCH, name);
+        if (!(status & RUC_KERNEL_CONSTANT_TIME)) {
+            CHECK(rc == RUC_KERNEL_ERR_NOT_CT);
+        } else if (rc == RUC_KERNEL_OK) {
+            CHECK(strcmp(ruc_kernel_active(RUC_PRIM_ROUNDS_BATCH), name) == 0);
+            check_ct_output();
+        }
+        CHECK(active_is_constant_time(RUC_PRIM_ROUNDS_BATCH));
+    }
+
+    // Returning to automatic selection stays constant-time too
+    CHECK(ruc_kernel_force(RUC_PRIM_ROUNDS_BATCH, nullptr) == RUC_KERNEL_OK);
+    CHECK(active_is_constant_time(RUC_PRIM_ROUNDS_BATCH));
+
+    // Other slots are unaffected: their reference kernels can still be forced
+    CHECK(ruc_kernel_force(RUC_PRIM_KECCAK_F, "looped") == RUC_KERNEL_OK);
+    CHECK(ruc_kernel_force(RUC_PRIM_KECCAK_F, nullptr) == RUC_KERNEL_OK);
+
+    check_all_kernels_match_reference();
+    check_shake_ragged_lengths();
+
+    // Unusable RUC_KERNEL entries come back as errors; valid ones still apply
+    setenv("RUC_KERNEL", "keccak_f=nope,keccak_f=looped", 1);
+    CHECK(ruc_kernel_init(0) == RUC_KERNEL_ERR_UNKNOWN);
+    CHECK(strcmp(ruc_kernel_active(RUC_PRIM_KECCAK_F), "looped") == 0);
+    setenv("RUC_KERNEL", "no_such_primitive=x", 1);
+    CHECK(ruc_kernel_init(0) == RUC_KERNEL_ERR_UNKNOWN);
+    setenv("RUC_KERNEL", "keccak_f", 1);
+    CHECK(ruc_kernel_init(0) == RUC_KERNEL_ERR_UNKNOWN);
+    unsetenv("RUC_KERNEL");
+    CHECK(ruc_kernel_force(RUC_PRIM_KECCAK_F, nullptr) == RUC_KERNEL_OK);
+    CHECK(ruc_kernel_init(0) == RUC_KERNEL_OK);
+    return test_failures();
+}
@@ -0,0 +1,96 @@
+#include "test_util.h"
+#include "ruc_metrics.h"
+#include <thread>
+
+// Per-thread histograms merge into the counts and percentiles a single
+// histogram would give, keep the counts of exited threads, and count nested
+// entry points once.
+
+static RucMetricsSnapshot snapshot(int op) {
+    RucMetricsSnapshot s;
+    CHECK(ruc_metrics_snapshot(op, &s) == 0);
+    return s;
+}
+
+// Each of 4 threads records latencies 1..1000 ns and 32..32000 bytes
+static void test_merged_counts_and_percentiles() {
+    ruc_metrics_reset();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([] {
+            for (uint64_t v = 1; v <= 1000; v++) ruc_metrics_record(RUC_OP_ENCRYPT_BLOCK, v, v * BLOCK_SIZE);
+        });
+    }
+    for (std::thread& t : threads) t.join();
+
+    RucMetricsSnapshot s = snapshot(RUC_OP_ENCRYPT_BLOCK);
+    CHECK(s.calls == 4000);
+    CHECK(s.latency_sum_ns == 4 * 500500);
+    CHECK(s.latency_min_ns == 1);
+    CHECK(s.latency_max_ns == 1000);
+    // Bucket upper bounds: within 6.25% above the exact value
+    CHECK(s.latency_p50_ns == 511);
+    CHECK(s.latency_p90_ns == 927);
+    CHECK(s.latency_p99_ns == 991);
+    CHECK(s.latency_p999_ns == 1000);
+    CHECK(s.bytes_total == 4 * 500500 * BLOCK_SIZE);
+    CHECK(s.bytes_p50 >= 500 * BLOCK_SIZE && s.bytes_p50 <= 532 * BLOCK_SIZE);
+    CHECK(s.bytes_max == 1000 * BLOCK_SIZE);
+
+    // Other ops are untouched
+    CHECK(snapshot(RUC_OP_DECRYPT_BLOCK).calls == 0);
+
+    // A new thread reuses an exited thread's shard and adds to its counts
+    std::thread([] { ruc_metrics_record(RUC_OP_ENCRYPT_BLOCK, 5000, 0); }).join();
+    s = snapshot(RUC_OP_ENCRYPT_BLOCK);
+    CHECK(s.calls == 4001);
+    CHECK(s.latency_max_ns == 5000);
+    CHECK(s.bytes_p50 >= 500 * BLOCK_SIZE && s.bytes_p50 <= 532 * BLOCK_SIZE);
+
+    // Reset clears every shard, including ones whose threads are gone
+    ruc_metrics_reset();
+    s = snapshot(RUC_OP_ENCRYPT_BLOCK);
+    CHECK(s.calls == 0 && s.latency_sum_ns == 0 && s.latency_min_ns == 0 && s.latency_p50_ns == 0);
+    ruc_metrics_record(RUC_OP_ENCRYPT_BLOCK, 7, 32);
+    s = snapshot(RUC_OP_ENCRYPT_BLOCK);
+    CHECK(s.calls == 1 && s.latency_min_ns == 7 && s.latency_p99_ns == 7 && s.bytes_total == 32);
+}
+
+// Real entry points: one record per outermost call, none while disabled
+static void test_entry_points() {
+    std::vector<uint8_t> key = test_bytes(KEY_SIZE, 1);
+    std::vector<uint8_t> iv = test_bytes(IV_SIZE, 2);
+    std::vector<uint8_t> in = test_bytes(10 * BLOCK_SIZE, 3), out(in.size());
+    uint32_t key_id = ruc_key_create(key.data());
+    uint32_t ctx_id = ruc_ctx_create(key_id, iv.data());
+
+    ruc_metrics_reset();
+    for (int i = 0; i < 3; i++) ruc_ctx_decrypt(ctx_id, in.data(), 10, 0, out.data());
+    RucMetricsSnapshot s = snapshot(RUC_OP_CTX_DECRYPT);
+    CHECK(s.calls == 3);
+    CHECK(s.bytes_total == 3 * 10 * BLOCK_SIZE);
+    CHECK(s.bytes_p50 == 10 * BLOCK_SIZE);
+    CHECK(s.latency_min_ns <= s.latency_p50_ns && s.latency_p50_ns <= s.latency_max_ns);
+    // Runs through ruc_ctx_encrypt, which is not counted separately
+    CHECK(snapshot(RUC_OP_CTX_ENCRYPT).calls == 0);
+
+    ruc_metrics_enable(0);
+    ruc_ctx_encrypt(ctx_id, in.data(), 10, 0, out.data());
+    ruc_metrics_enable(1);
+    CHECK(snapshot(RUC_OP_CTX_ENCRYPT).calls == 0);
+
+    // The Prometheus export reads the same merged histograms
+    std::vector<char> text(ruc_metrics_prometheus(nullptr, 0) + 1);
+    ruc_metrics_prometheus(text.data(), text.size());
+    CHECK(strstr(text.data(), "ruc_call_duration_seconds_count{op=\"ctx_decrypt\"} 3\n") != nullptr);
+    CHECK(strstr(text.data(), "ruc_call_bytes_sum{op=\"ctx_decrypt\"} 960\n") != nullptr);
+
+    ruc_ctx_destroy(ctx_id);
+    ruc_key_destroy(key_id);
+}
+
+int main() {
+    test_merged_counts_and_percentiles();
+    test_entry_points();
+    return test_failures();
+}
@@ -0,0 +1,360 @@
+#include "test_util.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+// Stream, encrypt_many, CBC, context, bulk, rekey, async and constant-time entry points all
+// reduce to the same per-block keystream, so each is checked against
+// ruc_encrypt_blocks_batch.
+
+static const std::vector<uint8_t> key = test_bytes(KEY_SIZE, 1);
+static const std::vector<uint8_t> iv = test_bytes(IV_SIZE, 2);
+
+// Arbitrary chunking, including partial blocks, matches whole-block output
+static void test_stream(uint32_t key_id) {
+    const size_t len = 50 * BLOCK_SIZE + 7;
+    std::vector<uint8_t> pt = test_bytes(len, 3);
+    std::vector<uint8_t> padded = pt;
+    padded.resize(51 * BLOCK_SIZE);
+    std::vector<uint8_t> expected = reference_encrypt(key.data(), iv.data(), 5, padded.data(), 51);
+
+    uint32_t ctx_id = ruc_ctx_create(key_id, iv.data());
+    uint32_t stream_id = ruc_stream_init(ctx_id, 5);
+    ruc_ctx_destroy(ctx_id);
+    CHECK(stream_id != 0);
+
+    std::vector<uint8_t> ct(len);
+    const size_t chunks[] = {1, 31, 32, 33, 100, 5, 0, 64};
+    size_t pos = 0;
+    for (size_t i = 0; pos < len; i++) {
+        size_t n = chunks[i % (sizeof(chunks) / sizeof(chunks[0]))];
+        if (n > len - pos) n = len - pos;
+        CHECK(ruc_stream_update(stream_id, pt.data() + pos, n, ct.data() + pos) == 0);
+        pos += n;
+    }
+    uint64_t total = 0;
+    CHECK(ruc_stream_final(stream_id, &total) == 0);
+    CHECK(total == len);
+    CHECK_BYTES(ct.data(), expected.data(), len);
+
+    // Scatter/gather in place gives the same bytes
+    ctx_id = ruc_ctx_create(key_id, iv.data());
+    stream_id = ruc_stream_init(ctx_id, 5);
+    ruc_ctx_destroy(ctx_id);
+    std::vector<uint8_t> buf = pt;
+    RucIovec iov[3] = {{buf.data(), 45}, {buf.data() + 45, 0}, {buf.data() + 45, len - 45}};
+    CHECK(ruc_stream_updatev(stream_id, iov, 3) == 0);
+    CHECK(ruc_stream_final(stream_id, nullptr) == 0);
+    CHECK_BYTES(buf.data(), expected.data(), len);
+
+    CHECK(ruc_stream_update(stream_id, pt.data(), 1, ct.data()) == -1);
+}
+
+// The block counter is 32-bit: a stream stops at block 2^32 - 1 and rejects
+// anything past it without touching the output
+static void test_stream_limit(uint32_t key_id) {
+    uint32_t ctx_id = ruc_ctx_create(key_id, iv.data());
+    uint32_t stream_id = ruc_stream_init(ctx_id, 0xFFFFFFFEu);
+    ruc_ctx_destroy(ctx_id);
+
+    std::vector<uint8_t> pt = test_bytes(2 * BLOCK_SIZE, 4);
+    std::vector<uint8_t> expected = reference_encrypt(key.data(), iv.data(), 0xFFFFFFFEu, pt.data(), 2);
+    std::vector<uint8_t> ct(2 * BLOCK_SIZE);
+    CHECK(ruc_stream_update(stream_id, pt.data(), 40, ct.data()) == 0);
+    CHECK(ruc_stream_update(stream_id, pt.data() + 40, 24, ct.data() + 40) == 0);
+    CHECK_BYTES(ct.data(), expected.data(), 2 * BLOCK_SIZE);
+
+    uint8_t in = 0x55, out = 0xAA;
+    CHECK(ruc_stream_update(stream_id, &in, 1, &out) == -2);
+    CHECK(out == 0xAA);
+    RucIovec iov = {&in, 1};
+    CHECK(ruc_stream_updatev(stream_id, &iov, 1) == -2);
+    CHECK(in == 0x55);
+    CHECK(ruc_stream_update(stream_id, &in, 0, &out) == 0);
+    CHECK(ruc_stream_final(stream_id, nullptr) == 0);
+
+    // One update that would cross the limit fails as a whole
+    ctx_id = ruc_ctx_create(key_id, iv.data());
+    stream_id = ruc_stream_init(ctx_id, 0xFFFFFFFFu);
+    ruc_ctx_destroy(ctx_id);
+    std::vector<uint8_t> big(BLOCK_SIZE + 1, 0x11);
+    std::vector<uint8_t> big_out(BLOCK_SIZE + 1, 0x22);
+    CHECK(ruc_stream_update(stream_id, big.data(), big.size(), big_out.data()) == -2);
+    CHECK(big_out[0] == 0x22);
+    CHECK(ruc_stream_update(stream_id, big.data(), BLOCK_SIZE, big_out.data()) == 0);
+    CHECK(ruc_stream_final(stream_id, nullptr) == 0);
+}
+
+static void test_encrypt_many(uint32_t key_id) {
+    uint32_t other_key = ruc_key_create(test_bytes(KEY_SIZE, 9).data());
+    std::vector<uint8_t> other_iv = test_bytes(IV_SIZE, 10);
+    const size_t sizes[] = {1, 17, 0, 300};
+    std::vector<uint8_t> inputs[4], outputs[4];
+    RucJob jobs[5];
+    for (size_t j = 0; j < 4; j++) {
+        inputs[j] = test_bytes(sizes[j] * BLOCK_SIZE, 20 + (uint32_t)j);
+        outputs[j].resize(sizes[j] * BLOCK_SIZE);
+        bool odd = (j & 1) != 0;
+        jobs[j] = {odd ? other_key : key_id, odd ? other_iv.data() : iv.data(), (uint32_t)(j * 1000),
+                   inputs[j].data(), outputs[j].data(), sizes[j], 0};
+    }
+    uint8_t unused[BLOCK_SIZE];
+    jobs[4] = {0xFFFF, iv.data(), 0, unused, unused, 1, 0};
+    CHECK(ruc_encrypt_many(jobs, 5) == 1);
+    CHECK(jobs[4].status == -1);
+
+    std::vector<uint8_t> other_key_bytes = test_bytes(KEY_SIZE, 9);
+    for (size_t j = 0; j < 4; j++) {
+        bool odd = (j & 1) != 0;
+        CHECK(jobs[j].status == 0);
+        std::vector<uint8_t> expected =
+            reference_encrypt(odd ? other_key_bytes.data() : key.data(), odd ? other_iv.data() : iv.data(),
+                              (uint32_t)(j * 1000), inputs[j].data(), sizes[j]);
+        CHECK_BYTES(outputs[j].data(), expected.data(), expected.size());
+    }
+
+    // Decrypt in place round-trips
+    for (size_t j = 0; j < 4; j++) jobs[j].input = outputs[j].data();
+    CHECK(ruc_decrypt_many(jobs, 4) == 0);
+    for (size_t j = 0; j < 4; j++) CHECK(outputs[j] == inputs[j]);
+    ruc_key_destroy(other_key);
+}
+
+// C_n = P_n ^ keystream_n ^ C_{n-1}, C_{-1} = IV, PKCS#7 padded
+static void test_cbc(uint32_t key_id) {
+    // Both sides of the inline threshold (64 blocks)
+    const size_t lens[] = {0, 1, 31, 32, 33, 1000, 63 * BLOCK_SIZE, 64 * BLOCK_SIZE, 200 * BLOCK_SIZE + 3};
+    for (size_t len : lens) {
+        std::vector<uint8_t> pt = test_bytes(len, 30 + (uint32_t)len);
+        size_t padded_len = ruc_cbc_padded_len(len);
+        std::vector<uint8_t> padded = pt;
+        padded.resize(padded_len, (uint8_t)(padded_len - len));
+        std::vector<uint8_t> expected = reference_encrypt(key.data(), iv.data(), 0, padded.data(),
+                                                          padded_len / BLOCK_SIZE);
+        for (size_t n = 0; n < padded_len; n++) {
+            expected[n] ^= n < BLOCK_SIZE ? iv[n] : expected[n - BLOCK_SIZE];
+        }
+
+        std::vector<uint8_t> out(IV_SIZE + padded_len);
+        size_t out_len = 0;
+        CHECK(ruc_cbc_encrypt(key_id, iv.data(), pt.data(), len, out.data(), &out_len) == 0);
+        CHECK(out_len == IV_SIZE + padded_len);
+        CHECK_BYTES(out.data(), iv.data(), IV_SIZE);
+        CHECK_BYTES(out.data() + IV_SIZE, expected.data(), padded_len);
+
+        std::vector<uint8_t> back(padded_len);
+        size_t back_len = 0;
+        CHECK(ruc_cbc_decrypt(key_id, out.data(), out_len, back.data(), &back_len) == 0);
+        CHECK(back_len == len);
+        CHECK_BYTES(back.data(), pt.data(), len);
+    }
+
+    // An unknown key fails before anything is written
+    std::vector<uint8_t> pt = test_bytes(40, 40);
+    std::vector<uint8_t> out(IV_SIZE + ruc_cbc_padded_len(40), 0xEE);
+    size_t out_len = 7;
+    CHECK(ruc_cbc_encrypt(0xFFFF, iv.data(), pt.data(), pt.size(), out.data(), &out_len) == -1);
+    CHECK(out_len == 7);
+    for (uint8_t b : out) CHECK(b == 0xEE);
+
+    size_t back_len = 0;
+    std::vector<uint8_t> short_input(IV_SIZE + 5), back(64);
+    CHECK(ruc_cbc_decrypt(key_id, short_input.data(), short_input.size(), back.data(), &back_len) == -2);
+
+    // Bad padding (each last plaintext byte value) fails with the output wiped.
+    // Flipping C_0 flips the same bytes of P_1 (the IV also feeds the
+    // keystream, so it cannot be used for this)
+    CHECK(ruc_cbc_encrypt(key_id, iv.data(), pt.data(), BLOCK_SIZE + 5, out.data(), &out_len) == 0);
+    for (int flip = 1; flip < 256; flip++) {
+        std::vector<uint8_t> bad(out.begin(), out.begin() + out_len);
+        bad[IV_SIZE + BLOCK_SIZE - 1] ^= (uint8_t)flip;
+        uint8_t last = (uint8_t)((BLOCK_SIZE - 5) ^ flip);
+        back.assign(2 * BLOCK_SIZE, 0xEE);
+        back_len = 7;
+        int rc = ruc_cbc_decrypt(key_id, bad.data(), bad.size(), back.data(), &back_len);
+        if (last == 1) {
+            // The other padding bytes still hold 27, so only a 1 stays valid
+            CHECK(rc == 0 && back_len == 2 * BLOCK_SIZE - 1);
+        } else {
+            CHECK(rc == -3);
+            CHECK(back_len == 7);
+            for (uint8_t b : back) CHECK(b == 0);
+        }
+    }
+}
+
+static void test_ct() {
+    void* km = ruc_expand_key(key.data());
+    const size_t counts[] = {1, 63, 64, 65, 300};
+    for (size_t n : counts) {
+        std::vector<uint8_t> pt = test_bytes(n * BLOCK_SIZE, 50 + (uint32_t)n);
+        std::vector<uint8_t> expected = reference_encrypt(key.data(), iv.data(), 77, pt.data(), n);
+        std::vector<uint8_t> ct(n * BLOCK_SIZE);
+        ruc_encrypt_blocks_ct(pt.data(), n, key.data(), iv.data(), 77, km, ct.data());
+        CHECK(ct == expected);
+        ruc_decrypt_blocks_ct(ct.data(), n, key.data(), iv.data(), 77, km, ct.data());
+        CHECK(ct == pt);
+    }
+    ruc_free_key_material(km);
+}
+
+// Context handles and persistent buffers
+static void test_context(uint32_t key_id) {
+    const size_t n = 5;
+    std::vector<uint8_t> pt = test_bytes(n * BLOCK_SIZE, 60);
+    std::vector<uint8_t> expected = reference_encrypt(key.data(), iv.data(), 4, pt.data(), n);
+    std::vector<uint8_t> out(n * BLOCK_SIZE);
+    uint32_t ctx_id = ruc_ctx_create(key_id, iv.data());
+    CHECK(ruc_ctx_encrypt(ctx_id, pt.data(), n, 4, out.data()) == 0);
+    CHECK(out == expected);
+    ruc_ctx_destroy(ctx_id);
+    CHECK(ruc_ctx_encrypt(ctx_id, pt.data(), n, 4, out.data()) == -1);
+
+    uint8_t* buffer = ruc_buffer_acquire(3, 10000);
+    CHECK(buffer != nullptr && ruc_buffer_capacity(3) >= 10000);
+    // Sizes no doubling can reach fail (rather than looping) and keep the region
+    CHECK(ruc_buffer_acquire(3, SIZE_MAX) == nullptr);
+    CHECK(ruc_buffer_acquire(3, SIZE_MAX / 2 + 2) == nullptr);
+    CHECK(ruc_buffer_acquire(3, 100) == buffer);
+    ruc_buffer_release(3);
+    CHECK(ruc_buffer_capacity(3) == 0);
+}
+
+// Bulk (sharded, NUMA-aware) output equals ruc_ctx_encrypt, also once the
+// key handle is destroyed and only the context keeps it alive
+static void test_bulk() {
+    const size_t sizes[] = {1, 127, 128, 129, 3000};
+    uint32_t key_id = ruc_key_create(key.data());
+    uint32_t ctx_id = ruc_ctx_create(key_id, iv.data());
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass == 1) ruc_key_destroy(key_id);
+        for (size_t n : sizes) {
+            std::vector<uint8_t> pt = test_bytes(n * BLOCK_SIZE, 80 + (uint32_t)n);
+            std::vector<uint8_t> expected(pt.size()), bulk(pt.size(), 0xEE), back(pt.size());
+            CHECK(ruc_ctx_encrypt(ctx_id, pt.data(), n, 11, expected.data()) == 0);
+            CHECK(ruc_ctx_encrypt_bulk(ctx_id, pt.data(), n, 11, bulk.data()) == 0);
+            CHECK(bulk == expected);
+            CHECK(ruc_ctx_decrypt_bulk(ctx_id, bulk.data(), n, 11, back.data()) == 0);
+            CHECK(back == pt);
+        }
+    }
+    ruc_ctx_destroy(ctx_id);
+    std::vector<uint8_t> block(BLOCK_SIZE);
+    CHECK(ruc_ctx_encrypt_bulk(ctx_id, block.data(), 1, 0, block.data()) == -1);
+}
+
+// Key rotation: old-key ciphertext becomes exactly the new key's ciphertext,
+// one-shot, chunked and in place. The keystreams carry no tag, so a wrong old
+// key cannot fail the call; its output must just not decrypt to the plaintext.
+static void test_reencrypt(uint32_t key_id) {
+    const size_t n = 300;
+    std::vector<uint8_t> pt = test_bytes(n * BLOCK_SIZE, 90);
+    std::vector<uint8_t> new_iv = test_bytes(IV_SIZE, 91);
+    uint32_t new_key_id = ruc_key_create(test_bytes(KEY_SIZE, 92).data());
+    uint32_t old_ctx = ruc_ctx_create(key_id, iv.data());
+    uint32_t new_ctx = ruc_ctx_create(new_key_id, new_iv.data());
+
+    std::vector<uint8_t> old_ct(pt.size()), expected(pt.size()), out(pt.size());
+    CHECK(ruc_ctx_encrypt(old_ctx, pt.data(), n, 5, old_ct.data()) == 0);
+    CHECK(ruc_ctx_encrypt(new_ctx, pt.data(), n, 5, expected.data()) == 0);
+    CHECK(ruc_reencrypt(old_ctx, new_ctx, old_ct.data(), n, 5, out.data()) == 0);
+    CHECK(out == expected);
+
+    // Chunk by chunk with advancing block numbers, in place
+    std::vector<uint8_t> chunked = old_ct;
+    for (size_t begin = 0; begin < n; begin += 77) {
+        size_t count = std::min<size_t>(77, n - begin);
+        uint8_t* p = chunked.data() + begin * BLOCK_SIZE;
+        CHECK(ruc_reencrypt(old_ctx, new_ctx, p, count, 5 + (uint32_t)begin, p) == 0);
+    }
+    CHECK(chunked == expected);
+
+    // And back again: the new key's ciphertext decrypts to the plaintext
+    std::vector<uint8_t> back(pt.size());
+    CHECK(ruc_ctx_decrypt(new_ctx, out.data(), n, 5, back.data()) == 0);
+    CHECK(back == pt);
+    CHECK(ruc_reencrypt(new_ctx, old_ctx, out.data(), n, 5, back.data()) == 0);
+    CHECK(back == old_ct);
+
+    // Wrong old key (right IV): not one block comes out as the new key's ciphertext
+    uint32_t wrong_key_id = ruc_key_create(test_bytes(KEY_SIZE, 93).data());
+    uint32_t wrong_ctx = ruc_ctx_create(wrong_key_id, iv.data());
+    CHECK(ruc_reencrypt(wrong_ctx, new_ctx, old_ct.data(), n, 5, out.data()) == 0);
+    size_t matching = 0;
+    for (size_t b = 0; b < n; b++) {
+        matching += memcmp(out.data() + b * BLOCK_SIZE, expected.data() + b * BLOCK_SIZE, BLOCK_SIZE) == 0;
+    }
+    CHECK(matching == 0);
+    CHECK(ruc_ctx_decrypt(new_ctx, out.data(), n, 5, back.data()) == 0);
+    CHECK(back != pt);
+
+    // Unknown contexts are refused and the output is left alone
+    ruc_ctx_destroy(wrong_ctx);
+    std::fill(out.begin(), out.end(), 0xEE);
+    CHECK(ruc_reencrypt(wrong_ctx, new_ctx, old_ct.data(), n, 5, out.data()) == -1);
+    CHECK(ruc_reencrypt(old_ctx, wrong_ctx, old_ct.data(), n, 5, out.data()) == -1);
+    CHECK(std::all_of(out.begin(), out.end(), [](uint8_t b) { return b == 0xEE; }));
+
+    ruc_ctx_destroy(old_ctx);
+    ruc_ctx_destroy(new_ctx);
+    ruc_key_destroy(wrong_key_id);
+    ruc_key_destroy(new_key_id);
+}
+
+static std::atomic<int> async_done(0);
+static std::atomic<int> async_failed(0);
+
+static void on_async_done(uint64_t, int status, void*) {
+    if (status != 0) async_failed.fetch_add(1);
+    async_done.fetch_add(1);
+}
+
+// Concurrent requests on the engine pool, then shutdown: in-flight requests
+// finish, later submits are refused until ruc_async_init
+static void test_async(uint32_t key_id) {
+    const size_t sizes[] = {1, 64, 65, 700};
+    const size_t count = sizeof(sizes) / sizeof(sizes[0]);
+    uint32_t ctx_id = ruc_ctx_create(key_id, iv.data());
+    std::vector<std::vector<uint8_t>> pts, outs;
+    for (size_t i = 0; i < count; i++) {
+        pts.push_back(test_bytes(sizes[i] * BLOCK_SIZE, 70 + (uint32_t)i));
+        outs.emplace_back(sizes[i] * BLOCK_SIZE);
+    }
+    async_done = 0;
+    for (size_t i = 0; i < count; i++) {
+        CHECK(ruc_ctx_encrypt_async(ctx_id, pts[i].data(), sizes[i], 9, outs[i].data(), on_async_done, nullptr) != 0);
+    }
+    ruc_async_shutdown();
+    CHECK(async_done == (int)count && async_failed == 0);
+    for (size_t i = 0; i < count; i++) {
+        CHECK(outs[i] == reference_encrypt(key.data(), iv.data(), 9, pts[i].data(), sizes[i]));
+    }
+
+    // Refused while shut down: no ID and no callback
+    std::vector<uint8_t> out(BLOCK_SIZE);
+    CHECK(ruc_ctx_encrypt_async(ctx_id, pts[0].data(), 1, 0, out.data(), on_async_done, nullptr) == 0);
+    CHECK(async_done == (int)count);
+
+    CHECK(ruc_async_init(1) == 0);
+    CHECK(ruc_async_init(1) == -1);
+    CHECK(ruc_ctx_decrypt_async(ctx_id, outs[3].data(), sizes[3], 9, outs[3].data(), on_async_done, nullptr) != 0);
+    while (async_done < (int)count + 1) std::this_thread::yield();
+    CHECK(outs[3] == pts[3] && async_failed == 0);
+    ruc_ctx_destroy(ctx_id);
+}
+
+int main() {
+    uint32_t key_id = ruc_key_create(key.data());
+    CHECK(key_id != 0);
+    test_stream(key_id);
+    test_stream_limit(key_id);
+    test_encrypt_many(key_id);
+    test_cbc(key_id);
+    test_ct();
+    test_context(key_id);
+    test_bulk();
+    test_reencrypt(key_id);
+    test_async(key_id);
+    ruc_key_destroy(key_id);
+    return test_failures();
+}
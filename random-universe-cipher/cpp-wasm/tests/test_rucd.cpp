@@ -0,0 +1,184 @@
+#include "test_util.h"
+#include "rucd_client.h"
+#include "rucd_protocol.h"
+#include <cerrno>
+#include <csignal>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Starts the rucd binary given on the command line and sends it shared-memory
+// attaches it must refuse: a memfd smaller than declared (mapping it would
+// SIGBUS the daemon on first touch) and one not sealed against shrinking.
+// The daemon has to answer RUCD_ERR_BAD_REQUEST and keep serving. A linger
+// time poll() cannot represent is refused before the daemon starts.
+
+static int connect_raw(const std::string& path) {
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0) return fd;
+    if (fd >= 0) close(fd);
+    return -1;
+}
+
+static int make_memfd(size_t size, bool seal) {
+    int fd = memfd_create("rucd_test", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) return -1;
+    if (ftruncate(fd, (off_t)size) != 0 || (seal && fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK) != 0)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Send a payload-less request (with memfd attached unless it is -1); returns the status
+static int32_t send_request(int sock, uint16_t op, uint32_t flags, uint64_t length, uint64_t shm_offset,
+                            int memfd, uint64_t request_id) {
+    RucdRequestHeader h;
+    memset(&h, 0, sizeof(h));
+    h.magic = RUCD_MAGIC;
+    h.version = RUCD_VERSION;
+    h.op = op;
+    h.flags = flags;
+    h.request_id = request_id;
+    h.length = length;
+    h.shm_offset = shm_offset;
+
+    iovec iov = { &h, sizeof(h) };
+    char control[CMSG_SPACE(sizeof(int))];
+    memset(control, 0, sizeof(control));
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (memfd >= 0) {
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &memfd, sizeof(int));
+    }
+    if (sendmsg(sock, &msg, MSG_NOSIGNAL) != (ssize_t)sizeof(h)) return INT32_MIN;
+
+    RucdResponseHeader r;
+    size_t got = 0;
+    while (got < sizeof(r)) {
+        ssize_t n = read(sock, (uint8_t*)&r + got, sizeof(r) - got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return INT32_MIN;
+        got += (size_t)n;
+    }
+    if (r.magic != RUCD_MAGIC || r.request_id != request_id) return INT32_MIN;
+    return r.status;
+}
+
+static int32_t attach(int sock, int memfd, uint64_t length, uint64_t request_id) {
+    return send_request(sock, RUCD_OP_ATTACH_SHM, 0, length, 0, memfd, request_id);
+}
+
+// Exit status of rucd run with these extra arguments (2 = usage error)
+static int run_rucd(const char* rucd, const std::string& socket_path, const char* flag, const char* value) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        execl(rucd, rucd, "--socket", socket_path.c_str(), flag, value, (char*)nullptr);
+        _exit(127);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static bool still_running(pid_t pid) {
+    int status;
+    return waitpid(pid, &status, WNOHANG) == 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s PATH_TO_RUCD\n", argv[0]);
+        return 2;
+    }
+    char dir[] = "/tmp/rucd_test_XXXXXX";
+    if (!mkdtemp(dir)) return 2;
+    std::string socket_path = std::string(dir) + "/rucd.sock";
+
+    const char* bad_lingers[] = {"60000001", "18446744073709551615", "99999999999999999999", "-1", "5ms"};
+    for (const char* linger : bad_lingers) CHECK(run_rucd(argv[1], socket_path, "--linger-us", linger) == 2);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        execl(argv[1], argv[1], "--socket", socket_path.c_str(), (char*)nullptr);
+        _exit(127);
+    }
+
+    int sock = -1;
+    for (int i = 0; i < 200 && sock < 0; i++) {
+        sock = connect_raw(socket_path);
+        if (sock < 0) usleep(10000);
+    }
+    CHECK(sock >= 0);
+
+    if (sock >= 0) {
+        const size_t declared = 1 << 20;
+
+        // Smaller than declared
+        int fd = make_memfd(4096, true);
+        CHECK(attach(sock, fd, declared, 1) == RUCD_ERR_BAD_REQUEST);
+        close(fd);
+        // Encrypting past the real end of that memfd would have crashed the daemon
+        CHECK(send_request(sock, RUCD_OP_ENCRYPT, RUCD_FLAG_SHM, BLOCK_SIZE, declared / 2, -1, 10) ==
+              RUCD_ERR_BAD_REQUEST);
+        CHECK(still_running(pid));
+
+        // Right size but not sealed against shrinking
+        fd = make_memfd(declared, false);
+        CHECK(attach(sock, fd, declared, 2) == RUCD_ERR_BAD_REQUEST);
+        close(fd);
+        CHECK(still_running(pid));
+
+        // Sealed and large enough: accepted, and can no longer be shrunk
+        fd = make_memfd(declared, true);
+        CHECK(attach(sock, fd, declared, 3) == RUCD_OK);
+        CHECK(ftruncate(fd, 4096) != 0);
+        close(fd);
+        close(sock);
+    }
+
+    // The daemon still serves requests, through the socket and shared memory
+    RucdClient* client = rucd_connect(socket_path.c_str());
+    CHECK(client != nullptr);
+    if (client) {
+        std::vector<uint8_t> key = test_bytes(KEY_SIZE, 1);
+        std::vector<uint8_t> iv = test_bytes(IV_SIZE, 2);
+        const size_t sizes[] = {100, 4096 * BLOCK_SIZE};
+        for (size_t len : sizes) {
+            std::vector<uint8_t> pt = test_bytes(len, 3);
+            std::vector<uint8_t> ct(len);
+            CHECK(rucd_encrypt(client, key.data(), iv.data(), 0, pt.data(), len, ct.data()) == 0);
+            std::vector<uint8_t> padded = pt;
+            padded.resize((len + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE);
+            std::vector<uint8_t> expected =
+                reference_encrypt(key.data(), iv.data(), 0, padded.data(), padded.size() / BLOCK_SIZE);
+            CHECK_BYTES(ct.data(), expected.data(), len);
+        }
+        rucd_close(client);
+    }
+
+    CHECK(still_running(pid));
+    kill(pid, SIGTERM);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    unlink(socket_path.c_str());
+    rmdir(dir);
+    return test_failures();
+}
@@ -0,0 +1,133 @@
+#include "test_util.h"
+#include <string>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Runs the ruc_crypt and ruc_bulk binaries given on the command line against
+// each other: every file ruc_bulk encrypts decrypts with ruc_crypt, and a tree
+// of ruc_crypt files decrypts with ruc_bulk. The tree mixes empty, sub-block,
+// multi-block and nested files with one large enough to be split into block
+// ranges (--split-mb 1). A compressed ruc_crypt file is refused by ruc_bulk
+// without stopping the rest of the tree.
+
+static const char* KEY_HEX =
+    "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+    "202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f";
+
+struct TestFile {
+    const char* rel;
+    size_t size;
+};
+
+static const TestFile FILES[] = {
+    { "empty.bin", 0 },
+    { "one.bin", 1 },
+    { "block.bin", BLOCK_SIZE },
+    { "odd.bin", 1000 },
+    { "sub/nested.bin", BLOCK_SIZE + 1 },
+    { "sub/deeper/big.bin", (5 << 19) + 7 },
+};
+
+// Run argv[0] with the given arguments; returns the exit status (-1 if it
+// did not exit normally)
+static int run(std::vector<const char*> args) {
+    args.push_back(nullptr);
+    pid_t pid = fork();
+    if (pid == 0) {
+        execv(args[0], (char* const*)args.data());
+        _exit(127);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static bool write_file(const std::string& path, const std::vector<uint8_t>& data) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    return fclose(f) == 0 && ok;
+}
+
+static bool read_file(const std::string& path, std::vector<uint8_t>& data) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    data.clear();
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+    bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+static bool same_contents(const std::string& path, const std::vector<uint8_t>& expected) {
+    std::vector<uint8_t> data;
+    return read_file(path, data) && data == expected;
+}
+
+// Create SRC with the test files (and their directories)
+static void make_tree(const std::string& src) {
+    mkdir(src.c_str(), 0700);
+    mkdir((src + "/sub").c_str(), 0700);
+    mkdir((src + "/sub/deeper").c_str(), 0700);
+    uint32_t seed = 1;
+    for (const TestFile& f : FILES) CHECK(write_file(src + "/" + f.rel, test_bytes(f.size, seed++)));
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s PATH_TO_RUC_CRYPT PATH_TO_RUC_BULK\n", argv[0]);
+        return 2;
+    }
+    const char* crypt = argv[1];
+    const char* bulk = argv[2];
+    char dir[] = "/tmp/ruc_tools_test_XXXXXX";
+    if (!mkdtemp(dir)) return 2;
+    std::string root = dir;
+    std::string src = root + "/src";
+    make_tree(src);
+
+    // ruc_bulk encrypt -> ruc_crypt decrypt, with large-file ranges on several threads
+    std::string bulk_enc = root + "/bulk_enc";
+    CHECK(run({ bulk, "encrypt", "--key", KEY_HEX, "--threads", "3", "--split-mb", "1",
+                src.c_str(), bulk_enc.c_str() }) == 0);
+    uint32_t seed = 1;
+    for (const TestFile& f : FILES) {
+        std::string enc = bulk_enc + "/" + f.rel + ".ruc";
+        std::string out = root + "/crypt_dec.bin";
+        CHECK(run({ crypt, "decrypt", "--key", KEY_HEX, enc.c_str(), out.c_str() }) == 0);
+        CHECK(same_contents(out, test_bytes(f.size, seed++)));
+        remove(out.c_str());
+    }
+
+    // ruc_crypt encrypt -> ruc_bulk decrypt
+    std::string crypt_enc = root + "/crypt_enc";
+    mkdir(crypt_enc.c_str(), 0700);
+    mkdir((crypt_enc + "/sub").c_str(), 0700);
+    mkdir((crypt_enc + "/sub/deeper").c_str(), 0700);
+    for (const TestFile& f : FILES) {
+        std::string in = src + "/" + f.rel;
+        std::string enc = crypt_enc + "/" + f.rel + ".ruc";
+        CHECK(run({ crypt, "encrypt", "--key", KEY_HEX, in.c_str(), enc.c_str() }) == 0);
+    }
+    std::string bulk_dec = root + "/bulk_dec";
+    CHECK(run({ bulk, "decrypt", "--key", KEY_HEX, "--threads", "3", "--split-mb", "1",
+                crypt_enc.c_str(), bulk_dec.c_str() }) == 0);
+    seed = 1;
+    for (const TestFile& f : FILES) CHECK(same_contents(bulk_dec + "/" + f.rel, test_bytes(f.size, seed++)));
+
+    // A compressed file fails on its own; the rest of the tree still decrypts
+    std::string packed = crypt_enc + "/packed.bin.ruc";
+    std::string in = src + "/odd.bin";
+    CHECK(run({ crypt, "encrypt", "--compress", "--key", KEY_HEX, in.c_str(), packed.c_str() }) == 0);
+    std::string mixed_dec = root + "/mixed_dec";
+    CHECK(run({ bulk, "decrypt", "--key", KEY_HEX, "--split-mb", "1", crypt_enc.c_str(), mixed_dec.c_str() }) == 1);
+    seed = 1;
+    for (const TestFile& f : FILES) CHECK(same_contents(mixed_dec + "/" + f.rel, test_bytes(f.size, seed++)));
+
+    std::string cleanup = "rm -rf '" + root + "'";
+    if (system(cleanup.c_str()) != 0) fprintf(stderr, "could not remove %s\n", root.c_str());
+    return test_failures();
+}
@@ -0,0 +1,102 @@
+#include "test_util.h"
+#include <atomic>
+#include <string>
+#include <thread>
+
+// Records a trace across several threads, exporting it repeatedly while they
+// still record, then checks the final JSON: balanced structure, one lane per
+// recording thread, and the spans and byte counts of the calls made.
+
+static std::string trace_json() {
+    std::string text(ruc_trace_json(nullptr, 0) + 1, '\0');
+    size_t len;
+    while ((len = ruc_trace_json(&text[0], text.size())) >= text.size()) text.resize(len + 1);
+    text.resize(len);
+    return text;
+}
+
+static size_t count(const std::string& text, const std::string& needle) {
+    size_t n = 0;
+    for (size_t pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + 1)) n++;
+    return n;
+}
+
+// Brackets and braces balance outside strings, and never go negative
+static bool balanced(const std::string& text) {
+    int depth = 0;
+    bool in_string = false;
+    for (char c : text) {
+        if (c == '"') in_string = !in_string;
+        if (in_string) continue;
+        if (c == '{' || c == '[') depth++;
+        if (c == '}' || c == ']') depth--;
+        if (depth < 0) return false;
+    }
+    return depth == 0 && !in_string;
+}
+
+int main() {
+    std::vector<uint8_t> key = test_bytes(KEY_SIZE, 1);
+    std::vector<uint8_t> iv = test_bytes(IV_SIZE, 2);
+    uint32_t key_id = ruc_key_create(key.data());
+    uint32_t ctx_id = ruc_ctx_create(key_id, iv.data());
+    const int threads = 3, calls = 50;
+
+    // Small rings, so they wrap while the exporter reads them
+    CHECK(ruc_trace_start(64) == 0);
+    std::atomic<bool> recording(true);
+    std::thread exporter([&] {
+        while (recording) CHECK(balanced(trace_json()));
+    });
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&] {
+            std::vector<uint8_t> buf(10 * BLOCK_SIZE);
+            for (int i = 0; i < calls; i++) ruc_ctx_encrypt(ctx_id, buf.data(), 10, 0, buf.data());
+        });
+    }
+    for (std::thread& t : workers) t.join();
+    recording = false;
+    exporter.join();
+
+    // Short trace after a restart: nothing from the earlier session survives
+    CHECK(ruc_trace_start(0) == 0);
+    std::thread([&] {
+        std::vector<uint8_t> buf(3 * BLOCK_SIZE);
+        ruc_ctx_encrypt(ctx_id, buf.data(), 3, 0, buf.data());
+        ruc_ctx_decrypt(ctx_id, buf.data(), 3, 0, buf.data());
+    }).join();
+    ruc_trace_stop();
+    std::vector<uint8_t> buf(BLOCK_SIZE);
+    ruc_ctx_encrypt(ctx_id, buf.data(), 1, 0, buf.data());   // Not traced
+
+    std::string json = trace_json();
+    CHECK(json.compare(0, 39, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[") == 0);
+    CHECK(json.size() >= 4 && json.compare(json.size() - 4, 4, "\n]}\n") == 0);
+    CHECK(balanced(json));
+    CHECK(count(json, "\"ph\":\"M\"") == 2);     // Process name and one lane
+    CHECK(count(json, "\"name\":\"ctx_encrypt\",\"cat\":\"ruc\",\"ph\":\"X\"") == 2);
+    CHECK(count(json, "\"name\":\"ctx_decrypt\",\"cat\":\"ruc\",\"ph\":\"X\"") == 1);
+    CHECK(count(json, "\"args\":{\"bytes\":96}") == 3);
+    CHECK(count(json, "\"bytes\":320") == 0);
+    CHECK(count(json, "\"name\":\"rounds\"") == 6);        // One phase span per block
+
+    // The file holds the same JSON
+    const char* path = "test_trace_output.json";
+    CHECK(ruc_trace_write(path) == 0);
+    FILE* f = fopen(path, "rb");
+    CHECK(f != nullptr);
+    if (f) {
+        std::string file;
+        char chunk[4096];
+        size_t n;
+        while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) file.append(chunk, n);
+        fclose(f);
+        CHECK(file == json);
+    }
+    remove(path);
+
+    ruc_ctx_destroy(ctx_id);
+    ruc_key_destroy(key_id);
+    return test_failures();
+}
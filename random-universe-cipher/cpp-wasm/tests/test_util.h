@@ -0,0 +1,57 @@
+#ifndef RUC_TEST_UTIL_H
+#define RUC_TEST_UTIL_H
+
+#include "ruc_cipher.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Minimal check macros for the native tests (registered with CTest in
+// CMakeLists.txt). A failed check reports and counts; main returns
+// test_failures() so CTest sees a non-zero exit.
+
+inline int& test_failure_count() {
+    static int failures = 0;
+    return failures;
+}
+
+inline int test_failures() {
+    if (test_failure_count() > 0) fprintf(stderr, "%d check(s) failed\n", test_failure_count());
+    return test_failure_count() > 0 ? 1 : 0;
+}
+
+#define CHECK(cond)                                                            \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            test_failure_count()++;                                            \
+        }                                                                      \
+    } while (0)
+
+#define CHECK_BYTES(a, b, n) CHECK(memcmp((a), (b), (n)) == 0)
+
+// Deterministic test data
+inline std::vector<uint8_t> test_bytes(size_t len, uint32_t seed) {
+    std::vector<uint8_t> out(len);
+    uint32_t x = seed * 2654435761u + 1;
+    for (size_t i = 0; i < len; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        out[i] = (uint8_t)x;
+    }
+    return out;
+}
+
+// Reference keystream output: ruc_encrypt_blocks_batch over whole blocks
+inline std::vector<uint8_t> reference_encrypt(const uint8_t* key, const uint8_t* iv, uint32_t start_block,
+                                              const uint8_t* input, size_t num_blocks) {
+    std::vector<uint8_t> out(num_blocks * BLOCK_SIZE);
+    void* km = ruc_expand_key(key);
+    ruc_encrypt_blocks_batch(input, num_blocks, key, iv, start_block, km, out.data());
+    ruc_free_key_material(km);
+    return out;
+}
+
+#endif // RUC_TEST_UTIL_H
@@ -0,0 +1,446 @@
+// Many-file encryption tool
+//
+//   ruc_bulk encrypt (--key HEX | --key-file FILE) [--threads N] [--split-mb N]
+//                    [--manifest FILE] [-v] SRC_DIR DST_DIR
+//   ruc_bulk decrypt (--key HEX | --key-file FILE) [--threads N] [--split-mb N]
+//                    [--manifest FILE] [-v] SRC_DIR DST_DIR
+//
+// Encrypts every regular file under SRC_DIR into the same relative path
+// under DST_DIR with ".ruc" appended; decrypt takes the ".ruc" files back.
+// Each output is a ruc_crypt file (40-byte header with a fresh IV, then the
+// CTR ciphertext from block 0), so `ruc_crypt decrypt` opens any one of them.
+//
+// For trees of many small files the per-file setup dominates, so:
+// - the key is expanded once and shared by all threads (ruc_expand_key +
+//   ruc_encrypt_blocks_batch, no per-file key work);
+// - IVs come from one pooled read of /dev/urandom rather than a call per file;
+// - files up to --split-mb are grouped into tasks of up to GROUP_BYTES or
+//   GROUP_FILES and handled with one read and one write each, encrypted in
+//   place in a reused buffer;
+// - larger files are split into --split-mb block ranges that run in parallel,
+//   read through mmap and written with pwrite at their offset.
+// Tasks are claimed from one queue, largest first. The manifest (TSV: status,
+// size, IV, relative path) and a files/s and MB/s summary are written at the
+// end. Outputs are created with mode 0600; symlinks and special files are
+// skipped, and files over 128 GiB (2^32 blocks) fail.
+
+#include "ruc_cipher.h"
+#include "ruc_file_format.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+constexpr uint64_t GROUP_BYTES = 1 << 20;
+constexpr size_t GROUP_FILES = 256;
+constexpr const char* SUFFIX = ".ruc";
+
+typedef std::chrono::steady_clock bulk_clock;
+
+struct FileEntry {
+    std::string rel;               // Relative input path
+    uint64_t size;                 // Input bytes
+    uint64_t data_size;            // Plaintext bytes (size without header when decrypting)
+    uint8_t iv[IV_SIZE];
+    bool failed;
+    std::string error;
+};
+
+// A run of small files, or one block range of a large file
+struct Task {
+    size_t first_file;
+    size_t num_files;
+    uint64_t offset;               // Plaintext byte range (large files)
+    uint64_t length;
+    bool range;
+};
+
+struct Bulk {
+    bool encrypt;
+    std::string src;
+    std::string dst;
+    uint8_t key[KEY_SIZE];
+    void* km;
+    uint64_t split_bytes;
+    std::vector<FileEntry> files;
+    std::vector<Task> tasks;
+    std::mutex error_mutex;
+};
+
+static bool ends_with(const std::string& s, const char* suffix) {
+    size_t n = strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+static std::string output_rel(const Bulk& b, const FileEntry& f) {
+    return b.encrypt ? f.rel + SUFFIX : f.rel.substr(0, f.rel.size() - strlen(SUFFIX));
+}
+
+static void fail(Bulk& b, FileEntry& f, const std::string& what) {
+    std::lock_guard<std::mutex> lock(b.error_mutex);
+    if (f.failed) return;
+    f.failed = true;
+    f.error = what + (errno ? std::string(": ") + strerror(errno) : std::string());
+}
+
+// The failed flag of a file other workers may be writing (a large file's
+// ranges run concurrently) is only read under error_mutex
+static bool has_failed(Bulk& b, const FileEntry& f) {
+    std::lock_guard<std::mutex> lock(b.error_mutex);
+    return f.failed;
+}
+
+// Collect regular files (sorted per directory) and create the output directories
+static bool walk(Bulk& b, const std::string& rel) {
+    std::string dir = rel.empty() ? b.src : b.src + "/" + rel;
+    DIR* d = opendir(dir.c_str());
+    if (!d) {
+        perror(dir.c_str());
+        return false;
+    }
+    std::vector<std::string> names;
+    while (dirent* e = readdir(d)) {
+        if (strcmp(e->d_name, ".") != 0 && strcmp(e->d_name, "..") != 0) names.push_back(e->d_name);
+    }
+    closedir(d);
+    std::sort(names.begin(), names.end());
+
+    std::string out_dir = rel.empty() ? b.dst : b.dst + "/" + rel;
+    if (mkdir(out_dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        perror(out_dir.c_str());
+        return false;
+    }
+    for (const std::string& name : names) {
+        std::string child = rel.empty() ? name : rel + "/" + name;
+        struct stat st;
+        if (lstat((b.src + "/" + child).c_str(), &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) {
+            if (!walk(b, child)) return false;
+        } else if (S_ISREG(st.st_mode) && (b.encrypt || ends_with(child, SUFFIX))) {
+            FileEntry f;
+            f.rel = child;
+            f.size = (uint64_t)st.st_size;
+            f.data_size = f.size;
+            f.failed = false;
+            b.files.push_back(f);
+        }
+    }
+    return true;
+}
+
+// IVs for every file from one pooled read of the system RNG
+static bool fill_ivs(Bulk& b) {
+    FILE* rng = fopen("/dev/urandom", "rb");
+    if (!rng) return false;
+    std::vector<uint8_t> pool;
+    size_t used = 0;
+    bool ok = true;
+    for (FileEntry& f : b.files) {
+        if (used == pool.size()) {
+            pool.assign(4096, 0);
+            used = 0;
+            if (fread(pool.data(), 1, pool.size(), rng) != pool.size()) {
+                ok = false;
+                break;
+            }
+        }
+        memcpy(f.iv, pool.data() + used, IV_SIZE);
+        used += IV_SIZE;
+    }
+    std::fill(pool.begin(), pool.end(), 0);
+    fclose(rng);
+    return ok;
+}
+
+static bool write_full(int fd, const uint8_t* buf, size_t len, uint64_t offset) {
+    while (len > 0) {
+        ssize_t n = pwrite(fd, buf, len, (off_t)offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        buf += n;
+        len -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return true;
+}
+
+static bool read_full(int fd, uint8_t* buf, size_t len, uint64_t offset) {
+    while (len > 0) {
+        ssize_t n = pread(fd, buf, len, (off_t)offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        buf += n;
+        len -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return true;
+}
+
+// Encrypt/decrypt len plaintext-position bytes in place (CTR: same operation);
+// buf has room for the zero padding of a partial last block. plan_tasks
+// rejects files past FILE_MAX_DATA_BYTES, so the block number fits 32 bits
+static void apply_cipher(const Bulk& b, const uint8_t* iv, uint64_t offset, uint8_t* buf, size_t len) {
+    size_t blocks = (len + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    memset(buf + len, 0, blocks * BLOCK_SIZE - len);
+    ruc_encrypt_blocks_batch(buf, blocks, b.key, iv, (uint32_t)(offset / BLOCK_SIZE), b.km, buf);
+}
+
+static void make_header(const FileEntry& f, uint8_t* header) {
+    memset(header, 0, FILE_HEADER_SIZE);
+    memcpy(header, FILE_MAGIC, 4);
+    header[4] = FILE_VERSION;
+    memcpy(header + 8, f.iv, IV_SIZE);
+}
+
+// Whole small file: one read, one write; buf keeps the header in front
+static void process_small(Bulk& b, FileEntry& f, std::vector<uint8_t>& buf) {
+    errno = 0;
+    int in = open((b.src + "/" + f.rel).c_str(), O_RDONLY);
+    if (in < 0) return fail(b, f, "open");
+    buf.resize(FILE_HEADER_SIZE + f.size + BLOCK_SIZE);
+    bool ok = read_full(in, buf.data() + FILE_HEADER_SIZE, f.size, 0);
+    close(in);
+    if (!ok) return fail(b, f, "read");
+
+    uint8_t* data = buf.data() + FILE_HEADER_SIZE;
+    if (b.encrypt) {
+        make_header(f, buf.data());
+    } else {
+        if (memcmp(data, FILE_MAGIC, 4) != 0 || data[4] != FILE_VERSION || data[5] != 0) {
+            return fail(b, f, "not an uncompressed ruc_crypt file");
+        }
+        memcpy(f.iv, data + 8, IV_SIZE);
+        data += FILE_HEADER_SIZE;
+    }
+    apply_cipher(b, f.iv, 0, data, (size_t)f.data_size);
+
+    int out = open((b.dst + "/" + output_rel(b, f)).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (out < 0) return fail(b, f, "create");
+    const uint8_t* start = b.encrypt ? buf.data() : data;
+    size_t len = (size_t)f.data_size + (b.encrypt ? FILE_HEADER_SIZE : 0);
+    ok = write_full(out, start, len, 0);
+    if (close(out) != 0) ok = false;
+    if (!ok) fail(b, f, "write");
+}
+
+// One block range of a large file: mmap the input, encrypt into buf, pwrite
+static void process_range(Bulk& b, FileEntry& f, uint64_t offset, uint64_t length, std::vector<uint8_t>& buf) {
+    errno = 0;
+    uint64_t in_offset = offset + (b.encrypt ? 0 : FILE_HEADER_SIZE);
+    uint64_t out_offset = offset + (b.encrypt ? FILE_HEADER_SIZE : 0);
+    int in = open((b.src + "/" + f.rel).c_str(), O_RDONLY);
+    if (in < 0) return fail(b, f, "open");
+
+    // Map from the page containing in_offset (a header shifts ranges off page boundaries)
+    uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t map_start = in_offset & ~(page - 1);
+    size_t map_len = (size_t)(in_offset + length - map_start);
+    void* map = mmap(nullptr, map_len, PROT_READ, MAP_PRIVATE, in, (off_t)map_start);
+    close(in);
+    if (map == MAP_FAILED) return fail(b, f, "mmap");
+    madvise(map, map_len, MADV_SEQUENTIAL);
+
+    buf.resize(length + BLOCK_SIZE);
+    memcpy(buf.data(), (const uint8_t*)map + (in_offset - map_start), length);
+    munmap(map, map_len);
+    apply_cipher(b, f.iv, offset, buf.data(), (size_t)length);
+
+    int out = open((b.dst + "/" + output_rel(b, f)).c_str(), O_WRONLY);
+    if (out < 0) return fail(b, f, "open output");
+    bool ok = write_full(out, buf.data(), (size_t)length, out_offset);
+    if (close(out) != 0) ok = false;
+    if (!ok) fail(b, f, "write");
+}
+
+// Large files: read/write headers and size the outputs before the ranges run
+static void prepare_large(Bulk& b, FileEntry& f) {
+    errno = 0;
+    if (!b.encrypt) {
+        int in = open((b.src + "/" + f.rel).c_str(), O_RDONLY);
+        uint8_t header[FILE_HEADER_SIZE];
+        bool ok = in >= 0 && read_full(in, header, FILE_HEADER_SIZE, 0);
+        if (in >= 0) close(in);
+        if (!ok || memcmp(header, FILE_MAGIC, 4) != 0 || header[4] != FILE_VERSION || header[5] != 0) {
+            return fail(b, f, "not an uncompressed ruc_crypt file");
+        }
+        memcpy(f.iv, header + 8, IV_SIZE);
+    }
+    int out = open((b.dst + "/" + output_rel(b, f)).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (out < 0) return fail(b, f, "create");
+    bool ok = ftruncate(out, (off_t)(f.data_size + (b.encrypt ? FILE_HEADER_SIZE : 0))) == 0;
+    if (ok && b.encrypt) {
+        uint8_t header[FILE_HEADER_SIZE];
+        make_header(f, header);
+        ok = write_full(out, header, FILE_HEADER_SIZE, 0);
+    }
+    if (close(out) != 0) ok = false;
+    if (!ok) fail(b, f, "write");
+}
+
+static void plan_tasks(Bulk& b) {
+    std::vector<Task> large, small;
+    Task group = { 0, 0, 0, 0, false };
+    size_t group_count = 0;
+    for (size_t i = 0; i < b.files.size(); i++) {
+        FileEntry& f = b.files[i];
+        if (!b.encrypt) {
+            if (f.size < FILE_HEADER_SIZE) {
+                errno = 0;
+                fail(b, f, "too short for a ruc_crypt file");
+                continue;
+            }
+            f.data_size = f.size - FILE_HEADER_SIZE;
+        }
+        if (f.data_size > FILE_MAX_DATA_BYTES) {
+            errno = 0;
+            fail(b, f, "too large (the 32-bit block counter covers 128 GiB)");
+            continue;
+        }
+        if (f.data_size > b.split_bytes) {
+            prepare_large(b, f);
+            if (f.failed) continue;
+            for (uint64_t off = 0; off < f.data_size; off += b.split_bytes) {
+                large.push_back({ i, 1, off, std::min(b.split_bytes, f.data_size - off), true });
+            }
+            continue;
+        }
+        if (group_count == GROUP_FILES || (group_count && group.length + f.size > GROUP_BYTES)) {
+            small.push_back(group);
+            group_count = 0;
+        }
+        if (group_count == 0) group = { i, 0, 0, 0, false };
+        group_count++;
+        group.num_files = i + 1 - group.first_file;
+        group.length += f.size;
+    }
+    if (group_count) small.push_back(group);
+    // A group spans an index range; large and failed files inside it are skipped when run
+    b.tasks = large;
+    b.tasks.insert(b.tasks.end(), small.begin(), small.end());
+}
+
+static void run_task(Bulk& b, const Task& t, std::vector<uint8_t>& buf) {
+    // Ranges only exist for files prepared without error; a failing range
+    // marks the file under error_mutex and the others still run. A group can
+    // span large files whose ranges are in flight, so the flag is read locked
+    if (t.range) return process_range(b, b.files[t.first_file], t.offset, t.length, buf);
+    for (size_t i = t.first_file; i < t.first_file + t.num_files; i++) {
+        FileEntry& f = b.files[i];
+        if (f.data_size <= b.split_bytes && !has_failed(b, f)) process_small(b, f, buf);
+    }
+}
+
+static bool write_manifest(const Bulk& b, const char* path) {
+    FILE* m = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (!m) return false;
+    fprintf(m, "# ruc_bulk %s manifest: status\tbytes\tiv\tpath\n", b.encrypt ? "encrypt" : "decrypt");
+    for (const FileEntry& f : b.files) {
+        char iv_hex[IV_SIZE * 2 + 1];
+        for (size_t i = 0; i < IV_SIZE; i++) snprintf(iv_hex + i * 2, 3, "%02x", f.iv[i]);
+        fprintf(m, "%s\t%llu\t%s\t%s\n", f.failed ? "error" : "ok", (unsigned long long)f.data_size,
+                f.failed && !b.encrypt ? "-" : iv_hex, output_rel(b, f).c_str());
+    }
+    bool ok = !ferror(m);
+    if (m != stdout) ok = fclose(m) == 0 && ok;
+    return ok;
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s encrypt|decrypt (--key HEX | --key-file FILE) [--threads N] [--split-mb N]\n"
+            "          [--manifest FILE|-] [-v] SRC_DIR DST_DIR\n", argv0);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) { usage(argv[0]); return 2; }
+    Bulk b;
+    b.encrypt = strcmp(argv[1], "encrypt") == 0;
+    if (!b.encrypt && strcmp(argv[1], "decrypt") != 0) { usage(argv[0]); return 2; }
+
+    bool verbose = false, have_key = false;
+    size_t num_threads = std::max(1u, std::thread::hardware_concurrency());
+    uint64_t split_mb = 8;
+    const char* manifest = nullptr;
+    const char* paths[2];
+    int num_paths = 0;
+    for (int i = 2; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!strcmp(a, "-v")) verbose = true;
+        else if (!strcmp(a, "--key") && v) { have_key = parse_hex_key(v, b.key); i++; }
+        else if (!strcmp(a, "--key-file") && v) { have_key = load_key_file(v, b.key); i++; }
+        else if (!strcmp(a, "--threads") && v) { num_threads = (size_t)strtoull(v, nullptr, 10); i++; }
+        else if (!strcmp(a, "--split-mb") && v) { split_mb = strtoull(v, nullptr, 10); i++; }
+        else if (!strcmp(a, "--manifest") && v) { manifest = v; i++; }
+        else if (a[0] != '-' && num_paths < 2) paths[num_paths++] = a;
+        else { usage(argv[0]); return 2; }
+    }
+    if (!have_key) { fprintf(stderr, "a 64-byte key is required (--key or --key-file)\n"); return 2; }
+    if (num_paths != 2 || num_threads == 0 || split_mb == 0) { usage(argv[0]); return 2; }
+    b.src = paths[0];
+    b.dst = paths[1];
+    b.split_bytes = split_mb << 20;
+
+    bulk_clock::time_point t0 = bulk_clock::now();
+    if (!walk(b, "")) return 1;
+    if (b.encrypt && !fill_ivs(b)) { perror("/dev/urandom"); return 1; }
+    b.km = ruc_expand_key(b.key);
+    plan_tasks(b);
+
+    std::atomic<size_t> next_task(0);
+    auto worker = [&]() {
+        std::vector<uint8_t> buf;
+        for (;;) {
+            size_t t = next_task.fetch_add(1, std::memory_order_relaxed);
+            if (t >= b.tasks.size()) break;
+            run_task(b, b.tasks[t], buf);
+        }
+        std::fill(buf.begin(), buf.end(), 0);
+    };
+    num_threads = std::min(num_threads, std::max<size_t>(1, b.tasks.size()));
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < num_threads; t++) threads.emplace_back(worker);
+    worker();
+    for (std::thread& thread : threads) thread.join();
+    double secs = std::chrono::duration<double>(bulk_clock::now() - t0).count();
+
+    ruc_free_key_material(b.km);
+    memset(b.key, 0, sizeof(b.key));
+
+    size_t failed = 0;
+    uint64_t bytes = 0;
+    for (const FileEntry& f : b.files) {
+        if (f.failed) {
+            failed++;
+            fprintf(stderr, "%s: %s\n", f.rel.c_str(), f.error.c_str());
+        } else {
+            bytes += f.data_size;
+        }
+    }
+    if (manifest && !write_manifest(b, manifest)) {
+        perror(manifest);
+        return 1;
+    }
+    size_t done = b.files.size() - failed;
+    fprintf(stderr, "%zu files, %.1f MB in %.3f s: %.0f files/s, %.2f MB/s (%zu threads, %zu tasks)%s\n",
+            done, bytes / 1e6, secs, secs > 0 ? done / secs : 0.0, secs > 0 ? bytes / 1e6 / secs : 0.0,
+            num_threads, b.tasks.size(), failed ? ", some files failed" : "");
+    if (verbose) {
+        size_t ranges = 0;
+        for (const Task& t : b.tasks) ranges += t.range;
+        fprintf(stderr, "%zu block-range tasks, %zu small-file groups\n", ranges, b.tasks.size() - ranges);
+    }
+    return failed ? 1 : 0;
+}
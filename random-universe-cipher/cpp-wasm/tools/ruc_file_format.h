@@ -0,0 +1,65 @@
+#ifndef RUC_FILE_FORMAT_H
+#define RUC_FILE_FORMAT_H
+
+#include "ruc_cipher.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+// ruc_crypt file layout, shared by ruc_crypt and ruc_bulk:
+//
+//   "RUCF" version flags 0 0 IV[32]     header (40 bytes, not encrypted)
+//   ciphertext                          from block 0
+//
+// The block counter is 32 bits, so a file holds at most FILE_MAX_DATA_BYTES
+// of (uncompressed) ciphertext; past that the keystream would repeat.
+
+constexpr uint8_t FILE_MAGIC[4] = {'R', 'U', 'C', 'F'};
+constexpr uint8_t FILE_VERSION = 1;
+constexpr uint8_t FILE_FLAG_COMPRESSED = 1;
+constexpr size_t FILE_HEADER_SIZE = 8 + IV_SIZE;
+constexpr uint64_t FILE_MAX_DATA_BYTES = (1ull << 32) * BLOCK_SIZE;
+
+inline int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Parse exactly KEY_SIZE bytes of hex, ignoring whitespace
+inline bool parse_hex_key(const std::string& text, uint8_t key[KEY_SIZE]) {
+    size_t n = 0;
+    int hi = -1;
+    for (char c : text) {
+        if (c == ' ' || c == '\n' || c == '\r' || c == '\t') continue;
+        int v = hex_value(c);
+        if (v < 0 || n == KEY_SIZE) return false;
+        if (hi < 0) {
+            hi = v;
+        } else {
+            key[n++] = (uint8_t)(hi << 4 | v);
+            hi = -1;
+        }
+    }
+    return n == KEY_SIZE && hi < 0;
+}
+
+// Key file holding either the raw KEY_SIZE bytes or the hex digits
+inline bool load_key_file(const char* path, uint8_t key[KEY_SIZE]) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    std::string data;
+    char buf[512];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0 && data.size() < 4096) data.append(buf, n);
+    fclose(f);
+    if (data.size() == KEY_SIZE) {
+        memcpy(key, data.data(), KEY_SIZE);
+        return true;
+    }
+    return parse_hex_key(data, key);
+}
+
+#endif // RUC_FILE_FORMAT_H
@@ -0,0 +1,124 @@
+/**
+ * C++ WASM Variant Loader
+ *
+ * cpp-wasm/build.sh emits three builds of the same module:
+ * - ruc_wasm:         baseline, runs on any WebAssembly runtime
+ * - ruc_wasm_simd:    SIMD128 kernels
+ * - ruc_wasm_simd_mt: SIMD128 + shared-memory threads (ruc_encrypt_many etc.
+ *                     spread blocks over a pthread pool)
+ *
+ * loadCppWasm() picks the best variant the runtime supports and falls back
+ * to the next one if it is missing or fails to instantiate, so older
+ * runtimes and partial builds keep working.
+ */
+
+export type CppWasmVariant = 'simd-mt' | 'simd' | 'baseline';
+
+export interface CppWasmLoadOptions {
+  /**
+   * Allow the threaded variant. By default it is used whenever the runtime
+   * supports it: SharedArrayBuffer on a cross-origin isolated page, or Node.
+   * Pass false to opt out, e.g. on a browser main thread, where blocking on
+   * worker threads stalls the page.
+   */
+  threads?: boolean;
+  /** Load exactly this variant (no detection or fallback) */
+  variant?: CppWasmVariant;
+}
+
+export interface CppWasmModule {
+  module: any;
+  variant: CppWasmVariant;
+}
+
+// (func (result v128) i32.const 0 i8x16.splat i8x16.popcnt)
+const SIMD_PROBE = new Uint8Array([
+  0, 97, 115, 109, 1, 0, 0, 0, 1, 5, 1, 96, 0, 1, 123, 3, 2, 1, 0, 10, 10, 1, 8, 0, 65, 0, 253, 15, 253, 98, 11,
+]);
+
+// Shared memory + (func i32.const 0 i32.atomic.load drop)
+const THREADS_PROBE = new Uint8Array([
+  0, 97, 115, 109, 1, 0, 0, 0, 1, 4, 1, 96, 0, 0, 3, 2, 1, 0, 5, 4, 1, 3, 1, 1, 10, 11, 1, 9, 0, 65, 0, 254, 16, 2, 0,
+  26, 11,
+]);
+
+function validates(bytes: Uint8Array): boolean {
+  try {
+    return typeof WebAssembly === 'object' && WebAssembly.validate(bytes);
+  } catch {
+    return false;
+  }
+}
+
+/**
+ * Whether the runtime can compile WASM SIMD128
+ */
+export function supportsWasmSimd(): boolean {
+  return validates(SIMD_PROBE);
+}
+
+/**
+ * Whether the runtime can run shared-memory WASM threads. Browsers only hand
+ * out SharedArrayBuffer on cross-origin isolated pages; Node always can.
+ */
+export function supportsWasmThreads(): boolean {
+  if (typeof SharedArrayBuffer === 'undefined' || !validates(THREADS_PROBE)) return false;
+  const isolated = (globalThis as { crossOriginIsolated?: boolean }).crossOriginIsolated;
+  if (isolated === false) return false;
+  try {
+    const memory = new WebAssembly.Memory({ initial: 1, maximum: 1, shared: true });
+    return memory.buffer instanceof SharedArrayBuffer;
+  } catch {
+    return false;
+  }
+}
+
+/**
+ * Variants this runtime can run, best first
+ */
+export function selectCppWasmVariants(options: CppWasmLoadOptions = {}): CppWasmVariant[] {
+  if (options.variant) return [options.variant];
+  const allowThreads = options.threads ?? true;
+  const variants: CppWasmVariant[] = [];
+  if (supportsWasmSimd()) {
+    if (allowThreads && supportsWasmThreads()) variants.push('simd-mt');
+    variants.push('simd');
+  }
+  variants.push('baseline');
+  return variants;
+}
+
+// Static import paths so the bundler emits every variant
+async function importVariant(variant: CppWasmVariant): Promise<any> {
+  switch (variant) {
+    case 'simd-mt':
+      // @ts-ignore - generated by cpp-wasm/build.sh
+      return import('../../cpp-wasm/pkg/ruc_wasm_simd_mt');
+    case 'simd':
+      // @ts-ignore - generated by cpp-wasm/build.sh
+      return import('../../cpp-wasm/pkg/ruc_wasm_simd');
+    default:
+      // @ts-ignore - generated by cpp-wasm/build.sh
+      return import('../../cpp-wasm/pkg/ruc_wasm');
+  }
+}
+
+/**
+ * Load and initialize the best available C++ WASM variant
+ */
+export async function loadCppWasm(options: CppWasmLoadOptions = {}): Promise<CppWasmModule> {
+  const variants = selectCppWasmVariants(options);
+  let lastError: unknown = null;
+  for (const variant of variants) {
+    try {
+      const wasm = await importVariant(variant);
+      // default() returns the Module object (or a Promise if the runtime isn't ready)
+      const module = await wasm.default();
+      const actualModule = module instanceof Promise ? await module : module;
+      return { module: actualModule, variant };
+    } catch (error) {
+      lastError = error;
+    }
+  }
+  throw lastError instanceof Error ? lastError : new Error(`C++ WASM unavailable: ${String(lastError)}`);
+}
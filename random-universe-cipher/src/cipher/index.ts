@@ -41,7 +41,7 @@ export {
 // Re-export encryption/decryption
 export { encryptBlock, createCipherState, cloneCipherState } from './encrypt';
 export { decryptBlock } from './decrypt';
-export { encryptCTR, decryptCTR, encryptCBC, decryptCBC, encrypt, decrypt } from './modes';
+export { encryptCTR, decryptCTR, encryptCTRBlocks, encryptCBC, decryptCBC, encrypt, decrypt } from './modes';
 export { encryptCTRFast, decryptCTRFast, encryptFast, decryptFast } from './modes-fast';
 export { initWASM, isWASMAvailable, encryptBlockWASM, decryptBlockWASM } from './wasm-accelerated';
 export { encryptCTRCppParallel, decryptCTRCppParallel, encryptCppParallel, decryptCppParallel } from './modes-cpp-parallel';
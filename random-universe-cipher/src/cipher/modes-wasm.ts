@@ -65,6 +65,54 @@ function precomputeKeyConstants(
   return constants;
 }
 
+/**
+ * Key material flattened into the byte layout encrypt_blocks_batch takes
+ */
+export interface WASMKeyMaterial {
+  keyConstants: Uint8Array;
+  sboxesFlat: Uint8Array;
+  roundKeysFlat: Uint8Array;
+  registersFlat: Uint8Array;
+}
+
+/**
+ * Flatten expanded key material for the Rust batch kernel
+ */
+export function packKeyMaterialForWASM(key: Uint8Array, keyMaterial: KeyMaterial): WASMKeyMaterial {
+  // Pre-compute key constants for all selectors (batch optimization)
+  const keyConstants = precomputeKeyConstants(keyMaterial.selectors, key);
+  
+  // Flatten S-boxes and round keys for WASM
+  const sboxesFlat = new Uint8Array(CONFIG.rounds * 256);
+  const roundKeysFlat = new Uint8Array(CONFIG.rounds * BYTES.REGISTER);
+  
+  for (let r = 0; r < CONFIG.rounds; r++) {
+    // S-boxes
+    sboxesFlat.set(keyMaterial.sboxes[r], r * 256);
+    
+    // Round keys (convert BigInt to bytes)
+    const rkBytes = new Uint8Array(BYTES.REGISTER);
+    let rkValue = keyMaterial.roundKeys[r];
+    for (let i = 0; i < BYTES.REGISTER; i++) {
+      rkBytes[BYTES.REGISTER - 1 - i] = Number((rkValue >> BigInt(i * 8)) & 0xffn);
+    }
+    roundKeysFlat.set(rkBytes, r * BYTES.REGISTER);
+  }
+  
+  // Flatten registers for WASM
+  const registersFlat = new Uint8Array(CONFIG.registerCount * BYTES.REGISTER);
+  for (let i = 0; i < CONFIG.registerCount; i++) {
+    const regBytes = new Uint8Array(BYTES.REGISTER);
+    let regValue = keyMaterial.registers[i];
+    for (let j = 0; j < BYTES.REGISTER; j++) {
+      regBytes[BYTES.REGISTER - 1 - j] = Number((regValue >> BigInt(j * 8)) & 0xffn);
+    }
+    registersFlat.set(regBytes, i * BYTES.REGISTER);
+  }
+  
+  return { keyConstants, sboxesFlat, roundKeysFlat, registersFlat };
+}
+
 /**
  * WASM-accelerated CTR mode encryption with batch processing
  * Processes blocks in batches for maximum performance
@@ -106,36 +154,7 @@ export async function encryptCTRWASM(
   const output = new Uint8Array(BYTES.NONCE + padded.length);
   output.set(nonce, 0);
   
-  // Pre-compute key constants for all selectors (batch optimization)
-  const keyConstants = precomputeKeyConstants(keyMaterial.selectors, key);
-  
-  // Flatten S-boxes and round keys for WASM
-  const sboxesFlat = new Uint8Array(CONFIG.rounds * 256);
-  const roundKeysFlat = new Uint8Array(CONFIG.rounds * BYTES.REGISTER);
-  
-  for (let r = 0; r < CONFIG.rounds; r++) {
-    // S-boxes
-    sboxesFlat.set(keyMaterial.sboxes[r], r * 256);
-    
-    // Round keys (convert BigInt to bytes)
-    const rkBytes = new Uint8Array(BYTES.REGISTER);
-    let rkValue = keyMaterial.roundKeys[r];
-    for (let i = 0; i < BYTES.REGISTER; i++) {
-      rkBytes[BYTES.REGISTER - 1 - i] = Number((rkValue >> BigInt(i * 8)) & 0xffn);
-    }
-    roundKeysFlat.set(rkBytes, r * BYTES.REGISTER);
-  }
-  
-  // Flatten registers for WASM
-  const registersFlat = new Uint8Array(CONFIG.registerCount * BYTES.REGISTER);
-  for (let i = 0; i < CONFIG.registerCount; i++) {
-    const regBytes = new Uint8Array(BYTES.REGISTER);
-    let regValue = keyMaterial.registers[i];
-    for (let j = 0; j < BYTES.REGISTER; j++) {
-      regBytes[BYTES.REGISTER - 1 - j] = Number((regValue >> BigInt(j * 8)) & 0xffn);
-    }
-    registersFlat.set(regBytes, i * BYTES.REGISTER);
-  }
+  const { keyConstants, sboxesFlat, roundKeysFlat, registersFlat } = packKeyMaterialForWASM(key, keyMaterial);
   
   // Process in batches (WASM batch function processes multiple blocks)
   const BATCH_SIZE = 64; // Process 64 blocks at a time
@@ -241,36 +260,7 @@ export async function decryptCTRWASM(
   
   const numBlocks = encryptedData.length / BYTES.BLOCK;
   
-  // Pre-compute key constants for all selectors (batch optimization)
-  const keyConstants = precomputeKeyConstants(keyMaterial.selectors, key);
-  
-  // Flatten S-boxes and round keys for WASM
-  const sboxesFlat = new Uint8Array(CONFIG.rounds * 256);
-  const roundKeysFlat = new Uint8Array(CONFIG.rounds * BYTES.REGISTER);
-  
-  for (let r = 0; r < CONFIG.rounds; r++) {
-    // S-boxes
-    sboxesFlat.set(keyMaterial.sboxes[r], r * 256);
-    
-    // Round keys (convert BigInt to bytes)
-    const rkBytes = new Uint8Array(BYTES.REGISTER);
-    let rkValue = keyMaterial.roundKeys[r];
-    for (let i = 0; i < BYTES.REGISTER; i++) {
-      rkBytes[BYTES.REGISTER - 1 - i] = Number((rkValue >> BigInt(i * 8)) & 0xffn);
-    }
-    roundKeysFlat.set(rkBytes, r * BYTES.REGISTER);
-  }
-  
-  // Flatten registers for WASM
-  const registersFlat = new Uint8Array(CONFIG.registerCount * BYTES.REGISTER);
-  for (let i = 0; i < CONFIG.registerCount; i++) {
-    const regBytes = new Uint8Array(BYTES.REGISTER);
-    let regValue = keyMaterial.registers[i];
-    for (let j = 0; j < BYTES.REGISTER; j++) {
-      regBytes[BYTES.REGISTER - 1 - j] = Number((regValue >> BigInt(j * 8)) & 0xffn);
-    }
-    registersFlat.set(regBytes, i * BYTES.REGISTER);
-  }
+  const { keyConstants, sboxesFlat, roundKeysFlat, registersFlat } = packKeyMaterialForWASM(key, keyMaterial);
   
   // Process in batches (WASM batch function processes multiple blocks)
   const BATCH_SIZE = 64; // Process 64 blocks at a time
@@ -4,6 +4,7 @@
  * Implementations of CTR and CBC modes for variable-length messages
  */
 
+import type { KeyMaterial } from './types';
 import { BYTES, DOMAIN } from './constants';
 import { expandKey, mixIVIntoState } from './key-expansion';
 import { encryptBlock, createCipherState } from './encrypt';
@@ -71,20 +72,42 @@ export function encryptCTR(
     BYTES.IV
   );
   
-  // Key expansion
-  const keyMaterial = expandKey(key);
-  
   // Pad plaintext
   const padded = pkcs7Pad(plaintext, BYTES.BLOCK);
-  const numBlocks = padded.length / BYTES.BLOCK;
   
   // Allocate output: nonce + ciphertext
   const output = new Uint8Array(BYTES.NONCE + padded.length);
   output.set(actualNonce, 0);
+  output.set(encryptCTRBlocks(padded, key, iv, 0), BYTES.NONCE);
+  
+  return output;
+}
+
+/**
+ * CTR keystream over whole blocks, numbered from startBlock
+ * 
+ * The block loop of encryptCTR without the nonce, IV derivation and padding,
+ * so other engines can be checked against it block for block
+ * (bench/conformance.ts).
+ */
+export function encryptCTRBlocks(
+  blocks: Uint8Array,
+  key: Uint8Array,
+  iv: Uint8Array,
+  startBlock: number,
+  keyMaterial: KeyMaterial = expandKey(key)
+): Uint8Array {
+  if (blocks.length % BYTES.BLOCK !== 0) {
+    throw new Error(`Input must be a multiple of ${BYTES.BLOCK} bytes`);
+  }
+  const numBlocks = blocks.length / BYTES.BLOCK;
+  const output = new Uint8Array(blocks.length);
   
   // Encrypt each block
   // In CTR mode, each block uses independent state derived from counter
   for (let n = 0; n < numBlocks; n++) {
+    const blockNumber = BigInt(startBlock + n);
+    
     // Create fresh state for this block
     const state = createCipherState(keyMaterial);
     
@@ -94,7 +117,7 @@ export function encryptCTR(
     // Incorporate counter into state
     const counterBytes = new Uint8Array(8);
     const counterView = new DataView(counterBytes.buffer);
-    counterView.setBigUint64(0, BigInt(n), false); // Big-endian
+    counterView.setBigUint64(0, blockNumber, false); // Big-endian
     
     const counterHash = shake256Hash(
       concatBytes(counterBytes, stringToBytes('CTR')),
@@ -104,13 +127,13 @@ export function encryptCTR(
     state.registers[0] ^= counterInt;
     
     // Extract plaintext block
-    const pBlock = padded.subarray(n * BYTES.BLOCK, (n + 1) * BYTES.BLOCK);
+    const pBlock = blocks.subarray(n * BYTES.BLOCK, (n + 1) * BYTES.BLOCK);
     
     // Encrypt
-    const cBlock = encryptBlock(pBlock, key, iv, BigInt(n), state, keyMaterial);
+    const cBlock = encryptBlock(pBlock, key, iv, blockNumber, state, keyMaterial);
     
     // Store ciphertext
-    output.set(cBlock, BYTES.NONCE + n * BYTES.BLOCK);
+    output.set(cBlock, n * BYTES.BLOCK);
   }
   
   return output;
@@ -5,6 +5,8 @@
  * based on the user's CPU core count
  */
 
+import { loadCppWasm, type CppWasmLoadOptions } from './cpp-wasm-loader';
+
 export interface ParallelWorkerMessage {
   type: 'encrypt' | 'decrypt';
   id: string;
@@ -13,6 +15,17 @@ export interface ParallelWorkerMessage {
   numBlocks: number;
   key: Uint8Array;
   iv: Uint8Array;
+  output?: Uint8Array; // Optional view into shared memory for the worker to write results into
+}
+
+/**
+ * First message to every worker: how to load its WASM module. The worker
+ * answers with the 'ready' response once loaded.
+ */
+export interface ParallelWorkerInitMessage {
+  type: 'init';
+  id: 'init';
+  loadOptions: CppWasmLoadOptions;
 }
 
 export interface ParallelWorkerResponse {
@@ -31,6 +44,15 @@ export function getCpuCoreCount(): number {
   return navigator.hardwareConcurrency || 4;
 }
 
+/**
+ * Whether workers can write results into a SharedArrayBuffer
+ * (requires a cross-origin isolated page)
+ */
+function supportsSharedOutput(): boolean {
+  return typeof SharedArrayBuffer !== 'undefined' &&
+    (globalThis as { crossOriginIsolated?: boolean }).crossOriginIsolated === true;
+}
+
 /**
  * Worker pool with persistent workers for better performance
  */
@@ -51,9 +73,16 @@ export class ParallelWorkerPool {
   private taskQueue: WorkerTask[] = [];
   private activeTasks: Map<string, WorkerTask> = new Map();
   private nextWorkerIndex = 0;
+  private loadOptions: CppWasmLoadOptions;
   
-  constructor(numWorkers?: number) {
+  /**
+   * loadOptions select the WASM variant for the pool and every worker. The
+   * threaded variant is picked when the page is cross-origin isolated; pass
+   * { threads: false } to keep one single-threaded module per worker.
+   */
+  constructor(numWorkers?: number, loadOptions: CppWasmLoadOptions = {}) {
     this.numWorkers = numWorkers || getCpuCoreCount();
+    this.loadOptions = { ...loadOptions };
     // Create a blob URL for the worker script
     const workerCode = `
       importScripts('${new URL('../worker/cpp-wasm-worker.ts', import.meta.url).href}');
@@ -73,18 +102,11 @@ export class ParallelWorkerPool {
     this.wasmInitialized = true;
     
     try {
-      // Import C++ WASM module (placeholder exists for Vite, actual loading happens at runtime)
-      const wasm = await import('../../cpp-wasm/pkg/ruc_wasm');
+      // Load the same variant the workers will use (placeholder exists for
+      // Vite, actual loading happens at runtime)
+      const { module: actualModule, variant } = await loadCppWasm(this.loadOptions);
       
-      // Try to initialize - placeholder will reject, actual WASM will succeed
       try {
-        // Initialize WASM module - default() returns the Module object (or Promise if not ready)
-        const module = await wasm.default();
-        
-        // Wait for runtime to be fully initialized if needed
-        // Emscripten may return a Promise if runtime isn't ready
-        const actualModule = module instanceof Promise ? await module : module;
-        
         // After initialization, functions are on the Module object
         // Emscripten exports C functions with underscore prefix
         // Functions are accessible as module._ruc_expand_key or module["_ruc_expand_key"]
@@ -97,7 +119,7 @@ export class ParallelWorkerPool {
         
         if (hasExpandKey && hasMalloc && hasHeap) {
           this.wasmModule = actualModule;
-          console.log('✅ C++ WASM loaded successfully');
+          console.log(`✅ C++ WASM loaded successfully (${variant})`);
           
           // Create persistent workers
           await this.createWorkers();
@@ -190,6 +212,7 @@ export class ParallelWorkerPool {
       };
       
       this.workers[i] = worker;
+      worker.postMessage({ type: 'init', id: 'init', loadOptions: this.loadOptions } as ParallelWorkerInitMessage);
     }
     
     // Wait for all workers to be ready (with timeout)
@@ -231,8 +254,8 @@ export class ParallelWorkerPool {
     this.activeTasks.delete(response.id);
     this.workerReady[workerIndex] = true;
     
-    if (response.type === 'success' && response.data) {
-      task.resolve(response.data);
+    if (response.type === 'success' && (response.data || task.message.output)) {
+      task.resolve(response.data ?? task.message.output!);
     } else if (response.type === 'error') {
       task.reject(new Error(response.error || 'Worker error'));
     }
@@ -306,6 +329,11 @@ export class ParallelWorkerPool {
     const workerKey = new Uint8Array(key);
     const workerIv = new Uint8Array(iv);
     
+    // With shared memory, workers write results straight into one output view
+    const sharedOutput = supportsSharedOutput()
+      ? new Uint8Array(new SharedArrayBuffer(totalBytes))
+      : null;
+    
     const cloneStart = performance.now();
     for (let i = 0; i < this.numWorkers; i++) {
       const workerStartBlock = i * blocksPerWorker;
@@ -333,6 +361,7 @@ export class ParallelWorkerPool {
             numBlocks: workerNumBlocks,
             key: workerKey, // Reuse cloned key
             iv: workerIv,   // Reuse cloned iv
+            output: sharedOutput?.subarray(workerBlocksStart, workerBlocksEnd),
           }
         };
         
@@ -359,13 +388,20 @@ export class ParallelWorkerPool {
     const workerTime = performance.now() - workerStart;
     console.log(`⏱️ Worker processing: ${workerTime.toFixed(2)}ms (${(totalBytes / 1024 / 1024 / (workerTime / 1000)).toFixed(2)} MB/s)`);
     
-    // Combine results
+    // Combine results. Workers already wrote into shared memory when it is
+    // available, but the SharedArrayBuffer stays inside the pool: callers get
+    // a regular buffer, since TextDecoder, Blob and friends reject shared views
     const combineStart = performance.now();
-    const output = new Uint8Array(totalBytes);
-    let offset = 0;
-    for (const result of results) {
-      output.set(result, offset);
-      offset += result.length;
+    let output: Uint8Array;
+    if (sharedOutput) {
+      output = new Uint8Array(sharedOutput);
+    } else {
+      output = new Uint8Array(totalBytes);
+      let offset = 0;
+      for (const result of results) {
+        output.set(result, offset);
+        offset += result.length;
+      }
     }
     const combineTime = performance.now() - combineStart;
     console.log(`⏱️ Combining results: ${combineTime.toFixed(2)}ms`);
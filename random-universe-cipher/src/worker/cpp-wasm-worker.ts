@@ -4,26 +4,23 @@
  * Each worker loads the C++ WASM module and processes blocks independently
  */
 
-import type { ParallelWorkerMessage, ParallelWorkerResponse } from '../cipher/parallel-worker';
+import type {
+  ParallelWorkerInitMessage,
+  ParallelWorkerMessage,
+  ParallelWorkerResponse,
+} from '../cipher/parallel-worker';
+import { loadCppWasm, type CppWasmLoadOptions } from '../cipher/cpp-wasm-loader';
+import { sha3_256 } from '@noble/hashes/sha3';
 
 let wasmModule: any = null;
-let encryptBatchFn: any = null;
-let decryptBatchFn: any = null;
 
-// Initialize WASM module
-async function initWASM(): Promise<void> {
+// Initialize WASM module with the pool's load options (best variant this
+// runtime supports unless the pool opted out of threads)
+async function initWASM(loadOptions: CppWasmLoadOptions = {}): Promise<void> {
   if (wasmModule) return;
   
   try {
-    // Dynamic import to avoid Vite build errors when WASM is not yet built
-    const wasm = await import('../../cpp-wasm/pkg/ruc_wasm');
-    
-    // Initialize WASM module - default() returns the Module object (or Promise if not ready)
-    const module = await wasm.default();
-    
-    // Wait for runtime to be fully initialized if needed
-    // Emscripten may return a Promise if runtime isn't ready
-    const actualModule = module instanceof Promise ? await module : module;
+    const { module: actualModule } = await loadCppWasm(loadOptions);
     
     // Check if functions are available (Emscripten exports with underscore prefix)
     const hasExpandKey = typeof actualModule._ruc_expand_key === 'function' || 
@@ -41,203 +38,243 @@ async function initWASM(): Promise<void> {
     }
     
     wasmModule = actualModule;
-    
-    // Try using cwrap for functions with uint64_t to avoid BigInt conversion issues
-    // cwrap expects function names without underscore prefix
-    if (actualModule.cwrap) {
-      try {
-        encryptBatchFn = actualModule.cwrap('_ruc_encrypt_blocks_batch', null, 
-          ['number', 'number', 'number', 'number', 'number', 'number', 'number']);
-        decryptBatchFn = actualModule.cwrap('_ruc_decrypt_blocks_batch', null,
-          ['number', 'number', 'number', 'number', 'number', 'number', 'number']);
-      } catch (e) {
-        // cwrap might not work, fall back to direct calls
-        console.warn('cwrap failed, using direct calls:', e);
-      }
-    }
   } catch (error) {
     console.error('Failed to load C++ WASM in worker:', error);
     throw error;
   }
 }
 
+// Resident WASM state: I/O regions and key/context handles live across tasks,
+// so repeated chunks with the same key/IV skip key expansion and allocation.
+// Caches are keyed by a SHA3-256 tag of the key, never by the key itself, so
+// no key material is kept alive as a JS string.
+const INPUT_BUFFER_ID = 0;
+const OUTPUT_BUFFER_ID = 1;
+const STAGING_BUFFER_ID = 2;
+const MAX_CACHED_CONTEXTS = 4;
+const KEY_TAG_DOMAIN = new TextEncoder().encode('RUC-worker-key-cache');
+
+interface CachedContext {
+  keyTag: string;
+  ctxId: number;
+}
+
+const keyIds = new Map<string, number>();
+const contexts = new Map<string, CachedContext>(); // insertion order = LRU order
+
+function toHex(bytes: Uint8Array): string {
+  let hex = '';
+  for (let i = 0; i < bytes.length; i++) {
+    hex += bytes[i].toString(16).padStart(2, '0');
+  }
+  return hex;
+}
+
+// Domain-separated SHA3-256 of the key, used as its cache tag
+function keyTagFor(key: Uint8Array): string {
+  const input = new Uint8Array(KEY_TAG_DOMAIN.length + key.length);
+  input.set(KEY_TAG_DOMAIN);
+  input.set(key, KEY_TAG_DOMAIN.length);
+  const tag = toHex(sha3_256(input));
+  input.fill(0);
+  return tag;
+}
+
+// Get (or create) the context handle for this key/IV pair
+function getContext(key: Uint8Array, iv: Uint8Array): number {
+  const keyTag = keyTagFor(key);
+  const ctxKey = `${keyTag}:${toHex(iv)}`;
+  
+  const cached = contexts.get(ctxKey);
+  if (cached) {
+    // Refresh LRU position
+    contexts.delete(ctxKey);
+    contexts.set(ctxKey, cached);
+    return cached.ctxId;
+  }
+  
+  const stagingLen = key.length + iv.length;
+  const stagingPtr = wasmModule._ruc_buffer_acquire(STAGING_BUFFER_ID, stagingLen);
+  let ctxId = 0;
+  try {
+    wasmModule.HEAPU8.set(key, stagingPtr);
+    wasmModule.HEAPU8.set(iv, stagingPtr + key.length);
+    
+    let keyId = keyIds.get(keyTag);
+    if (!keyId) {
+      keyId = wasmModule._ruc_key_create(stagingPtr) as number;
+      keyIds.set(keyTag, keyId);
+    }
+    ctxId = wasmModule._ruc_ctx_create(keyId, stagingPtr + key.length) as number;
+  } finally {
+    // Key and IV are resident in the handles now; clear the staging copy
+    // (HEAPU8 re-read: creating handles may have grown memory)
+    wasmModule.HEAPU8.fill(0, stagingPtr, stagingPtr + stagingLen);
+  }
+  if (!ctxId) {
+    throw new Error('Failed to create C++ WASM context');
+  }
+  contexts.set(ctxKey, { keyTag, ctxId });
+  
+  // Evict the least recently used context (and its key once unused)
+  if (contexts.size > MAX_CACHED_CONTEXTS) {
+    const [oldestKey, oldest] = contexts.entries().next().value as [string, CachedContext];
+    contexts.delete(oldestKey);
+    wasmModule._ruc_ctx_destroy(oldest.ctxId);
+    const keyStillUsed = Array.from(contexts.values()).some(ctx => ctx.keyTag === oldest.keyTag);
+    if (!keyStillUsed) {
+      wasmModule._ruc_key_destroy(keyIds.get(oldest.keyTag));
+      keyIds.delete(oldest.keyTag);
+    }
+  }
+  
+  return ctxId;
+}
+
 // Process blocks using C++ WASM
+// When `output` is given (a view into shared memory), results are written there
+// directly and nothing is returned
 async function processBlocks(
   blocks: Uint8Array,
   numBlocks: number,
   key: Uint8Array,
   iv: Uint8Array,
   startBlockNumber: number,
-  encrypt: boolean
-): Promise<Uint8Array> {
+  encrypt: boolean,
+  output?: Uint8Array
+): Promise<Uint8Array | undefined> {
   if (!wasmModule) {
     await initWASM();
   }
   
   const startTime = performance.now();
   const BLOCK_SIZE = 32;
+  const dataLen = numBlocks * BLOCK_SIZE;
+  
+  // Resident key material and IV expansion
+  const contextStart = performance.now();
+  const ctxId = getContext(key, iv);
+  const contextTime = performance.now() - contextStart;
   
-  // Allocate WASM memory
-  const blocksLen = blocks.length;
-  const outputLen = numBlocks * BLOCK_SIZE;
+  // Reuse persistent I/O regions (they only grow)
+  const inputPtr = wasmModule._ruc_buffer_acquire(INPUT_BUFFER_ID, dataLen);
+  const outputPtr = wasmModule._ruc_buffer_acquire(OUTPUT_BUFFER_ID, dataLen);
+  if (!inputPtr || !outputPtr) {
+    throw new Error('C++ WASM buffer allocation failed');
+  }
   
-  const allocStart = performance.now();
-  const blocksPtr = wasmModule._malloc(blocksLen);
-  const keyPtr = wasmModule._malloc(key.length);
-  const ivPtr = wasmModule._malloc(iv.length);
-  const outputPtr = wasmModule._malloc(outputLen);
-  const allocTime = performance.now() - allocStart;
+  // Copy input (HEAPU8 must be re-read: acquiring may have grown memory)
+  const copyStart = performance.now();
+  wasmModule.HEAPU8.set(blocks.subarray(0, dataLen), inputPtr);
+  const copyTime = performance.now() - copyStart;
   
-  try {
-    // Copy data to WASM memory
-    const copyStart = performance.now();
-    wasmModule.HEAPU8.set(blocks, blocksPtr);
-    wasmModule.HEAPU8.set(key, keyPtr);
-    wasmModule.HEAPU8.set(iv, ivPtr);
-    const copyTime = performance.now() - copyStart;
+  const processStart = performance.now();
+  if (encrypt) {
+    wasmModule._ruc_ctx_encrypt(ctxId, inputPtr, numBlocks, Number(startBlockNumber), outputPtr);
+  } else {
+    wasmModule._ruc_ctx_decrypt(ctxId, inputPtr, numBlocks, Number(startBlockNumber), outputPtr);
+  }
+  const processTime = performance.now() - processStart;
+  const mbPerSec = (dataLen / 1024 / 1024) / (processTime / 1000);
+  console.log(`  Worker: ${numBlocks} blocks, ${processTime.toFixed(2)}ms (${mbPerSec.toFixed(2)} MB/s)`);
+  
+  // Get profiling stats from WASM
+  if (wasmModule._ruc_get_profile_stats && processTime > 100) {
+    const statsPtr = wasmModule._ruc_buffer_acquire(STAGING_BUFFER_ID, 8 * 8); // 8 uint64_t values
+    wasmModule._ruc_get_profile_stats(
+      statsPtr,
+      statsPtr + 8,
+      statsPtr + 16,
+      statsPtr + 24,
+      statsPtr + 32,
+      statsPtr + 40,
+      statsPtr + 48,
+      statsPtr + 56
+    );
     
-    // Expand key material (Emscripten exports with underscore prefix)
-    const keyExpandStart = performance.now();
-    const kmPtr = wasmModule._ruc_expand_key(keyPtr);
-    const keyExpandTime = performance.now() - keyExpandStart;
+    const view = new DataView(wasmModule.HEAPU8.buffer, statsPtr, 64);
+    const shake256Calls = Number(view.getBigUint64(0, true));
+    const roundsExecuted = Number(view.getBigUint64(16, true));
+    const selectorOrderingCalls = Number(view.getBigUint64(24, true));
+    const keystreamCalls = Number(view.getBigUint64(32, true));
+    const counterHashCalls = Number(view.getBigUint64(40, true));
+    const gfMulCalls = Number(view.getBigUint64(48, true));
+    const registerOpsCalls = Number(view.getBigUint64(56, true));
     
-    try {
-      // Process blocks
-      const startBlockNum = Number(startBlockNumber);
-      const processStart = performance.now();
-      
-      if (encrypt) {
-        if (encryptBatchFn) {
-          encryptBatchFn(blocksPtr, numBlocks, keyPtr, ivPtr, startBlockNum, kmPtr, outputPtr);
-        } else {
-          wasmModule._ruc_encrypt_blocks_batch(
-            blocksPtr,
-            numBlocks,
-            keyPtr,
-            ivPtr,
-            startBlockNum,
-            kmPtr,
-            outputPtr
-          );
-        }
-      } else {
-        if (decryptBatchFn) {
-          decryptBatchFn(blocksPtr, numBlocks, keyPtr, ivPtr, startBlockNum, kmPtr, outputPtr);
-        } else {
-          wasmModule._ruc_decrypt_blocks_batch(
-            blocksPtr,
-            numBlocks,
-            keyPtr,
-            ivPtr,
-            startBlockNum,
-            kmPtr,
-            outputPtr
-          );
-        }
-      }
-      
-      const processTime = performance.now() - processStart;
-      const mbProcessed = (blocksLen / 1024 / 1024);
-      const mbPerSec = mbProcessed / (processTime / 1000);
-      console.log(`  Worker: ${numBlocks} blocks, ${processTime.toFixed(2)}ms (${mbPerSec.toFixed(2)} MB/s)`);
-      
-      // Get profiling stats from WASM
-      if (wasmModule._ruc_get_profile_stats) {
-        const statsPtr = wasmModule._malloc(8 * 8); // 8 uint64_t values
-        try {
-          wasmModule._ruc_get_profile_stats(
-            statsPtr,
-            statsPtr + 8,
-            statsPtr + 16,
-            statsPtr + 24,
-            statsPtr + 32,
-            statsPtr + 40,
-            statsPtr + 48,
-            statsPtr + 56
-          );
-          
-          const view = new DataView(wasmModule.HEAPU8.buffer, statsPtr, 64);
-          const shake256Calls = Number(view.getBigUint64(0, true));
-          const roundsExecuted = Number(view.getBigUint64(16, true));
-          const selectorOrderingCalls = Number(view.getBigUint64(24, true));
-          const keystreamCalls = Number(view.getBigUint64(32, true));
-          const counterHashCalls = Number(view.getBigUint64(40, true));
-          const gfMulCalls = Number(view.getBigUint64(48, true));
-          const registerOpsCalls = Number(view.getBigUint64(56, true));
-          
-          if (processTime > 100) {
-            console.log(`  📊 Profiling: SHAKE256=${shake256Calls}, Rounds=${roundsExecuted}, Selectors=${selectorOrderingCalls}, Keystream=${keystreamCalls}, Counter=${counterHashCalls}, GF=${gfMulCalls}, RegOps=${registerOpsCalls}`);
-            console.log(`  📊 Per block: SHAKE256=${(shake256Calls/numBlocks).toFixed(1)}, Rounds=${(roundsExecuted/numBlocks).toFixed(1)}, GF=${(gfMulCalls/numBlocks).toFixed(0)}`);
-          }
-        } finally {
-          wasmModule._free(statsPtr);
-        }
-      }
-      
-      // Copy output from WASM memory
-      const outputStart = performance.now();
-      const output = new Uint8Array(outputLen);
-      output.set(wasmModule.HEAPU8.subarray(outputPtr, outputPtr + outputLen));
-      const outputTime = performance.now() - outputStart;
-      
-      const totalTime = performance.now() - startTime;
-      if (totalTime > 100) { // Only log if > 100ms
-        console.log(`  Worker breakdown: alloc=${allocTime.toFixed(1)}ms, copy=${copyTime.toFixed(1)}ms, key=${keyExpandTime.toFixed(1)}ms, process=${processTime.toFixed(1)}ms, output=${outputTime.toFixed(1)}ms`);
-      }
-      
-      return output;
-    } finally {
-      wasmModule._ruc_free_key_material(kmPtr);
-    }
-  } finally {
-    wasmModule._free(blocksPtr);
-    wasmModule._free(keyPtr);
-    wasmModule._free(ivPtr);
-    wasmModule._free(outputPtr);
+    console.log(`  📊 Profiling: SHAKE256=${shake256Calls}, Rounds=${roundsExecuted}, Selectors=${selectorOrderingCalls}, Keystream=${keystreamCalls}, Counter=${counterHashCalls}, GF=${gfMulCalls}, RegOps=${registerOpsCalls}`);
+    console.log(`  📊 Per block: SHAKE256=${(shake256Calls/numBlocks).toFixed(1)}, Rounds=${(roundsExecuted/numBlocks).toFixed(1)}, GF=${(gfMulCalls/numBlocks).toFixed(0)}`);
+  }
+  
+  // Write results straight into the caller's shared view, or hand back a copy
+  const outputStart = performance.now();
+  const result = wasmModule.HEAPU8.subarray(outputPtr, outputPtr + dataLen);
+  let returned: Uint8Array | undefined;
+  if (output) {
+    output.set(result);
+  } else {
+    returned = result.slice();
+  }
+  const outputTime = performance.now() - outputStart;
+  
+  const totalTime = performance.now() - startTime;
+  if (totalTime > 100) { // Only log if > 100ms
+    console.log(`  Worker breakdown: context=${contextTime.toFixed(1)}ms, copy=${copyTime.toFixed(1)}ms, process=${processTime.toFixed(1)}ms, output=${outputTime.toFixed(1)}ms`);
   }
+  
+  return returned;
 }
 
-let wasmInitialized = false;
+let wasmInitialized: Promise<void> | null = null;
+let poolLoadOptions: CppWasmLoadOptions = {};
 
-// Initialize WASM on worker startup
-initWASM().then(() => {
-  wasmInitialized = true;
-  // Signal that worker is ready
-  self.postMessage({
-    type: 'success',
-    id: 'ready',
-  } as ParallelWorkerResponse);
-}).catch((error) => {
-  console.error('Worker WASM initialization failed:', error);
-  wasmInitialized = false;
-});
+// Load once; concurrent callers share the same load, and a failed load is
+// retried (with the pool's options) by the next task
+function ensureWASM(): Promise<void> {
+  if (!wasmInitialized) {
+    wasmInitialized = initWASM(poolLoadOptions).catch((error) => {
+      wasmInitialized = null;
+      throw error;
+    });
+  }
+  return wasmInitialized;
+}
 
 // Handle messages from main thread
-self.onmessage = async (event: MessageEvent<ParallelWorkerMessage>) => {
-  const { type, id, blocks, startBlockNumber, numBlocks, key, iv } = event.data;
+self.onmessage = async (event: MessageEvent<ParallelWorkerMessage | ParallelWorkerInitMessage>) => {
+  // The pool's first message says how to load WASM; signal ready once loaded
+  if (event.data.type === 'init') {
+    poolLoadOptions = event.data.loadOptions;
+    try {
+      await ensureWASM();
+      self.postMessage({ type: 'success', id: 'ready' } as ParallelWorkerResponse);
+    } catch (error) {
+      console.error('Worker WASM initialization failed:', error);
+    }
+    return;
+  }
+  
+  const { type, id, blocks, startBlockNumber, numBlocks, key, iv, output } = event.data;
   
   // Ignore ready check messages
   if (id === 'ready') return;
   
-  // Wait for WASM to be initialized if not ready yet
-  if (!wasmInitialized) {
-    await initWASM();
-    wasmInitialized = true;
-  }
-  
   try {
+    // Wait for WASM to be initialized if not ready yet
+    await ensureWASM();
     const result = await processBlocks(
       blocks,
       numBlocks,
       key,
       iv,
       startBlockNumber,
-      type === 'encrypt'
+      type === 'encrypt',
+      output
     );
     
-    // Use Transferable to avoid copying result back
+    // Use Transferable to avoid copying result back (nothing to send when
+    // the result was written into shared memory)
     const transferList: Transferable[] = [];
-    if (result.buffer instanceof ArrayBuffer) {
+    if (result && result.buffer instanceof ArrayBuffer) {
       transferList.push(result.buffer);
     }
     